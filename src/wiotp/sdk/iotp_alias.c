@@ -0,0 +1,258 @@
+/*******************************************************************************
+ * Copyright (c) 2019 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *
+ * Contrinutors:
+ *    Ranjan Dasgupta         - Initial drop
+ *
+ *******************************************************************************/
+
+/*
+ * MQTT v5 topic aliases of outbound topics.
+ *
+ * A topic gets an alias when it is published again, while it is still in the
+ * filter of recently published topics. The first publish request with the alias
+ * carries the topic, to set the alias on the server. Once that request is submitted
+ * to MQTT client, later requests carry only the alias. When all aliases are assigned,
+ * the clock hand picks an alias that was not used recently, and that is not used by
+ * a publish request in progress, and assigns it to the new topic.
+ *
+ * Aliases are valid only for a network connection, and are reset when the client
+ * connects or the connection is lost.
+ */
+
+#include "iotp_utils.h"
+#include "iotp_internal.h"
+
+/* Topic alias property takes 3 bytes - no savings for topics of 3 bytes or less */
+#define IOTP_ALIAS_PROPERTY_LEN  3
+
+static uint32_t iotp_alias_hash(const char *topic)
+{
+    uint32_t h = 2166136261u;
+    const unsigned char *p = (const unsigned char *)topic;
+    while ( *p ) {
+        h ^= *p++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Removes topic of an alias from hash chain */
+static void iotp_alias_unassign(IoTPTopicAliases *aliases, IoTPTopicAlias *slot)
+{
+    IoTPTopicAlias **pp = &aliases->buckets[slot->hash & (aliases->nbuckets - 1)];
+
+    while ( *pp ) {
+        if ( *pp == slot ) {
+            *pp = slot->next;
+            break;
+        }
+        pp = &(*pp)->next;
+    }
+    iotp_utils_freePtr((void *)slot->topic);
+    slot->topic = NULL;
+    slot->next = NULL;
+    slot->established = 0;
+    slot->referenced = 0;
+    aliases->used -= 1;
+}
+
+/* Returns a free alias slot, evicting an alias not used recently. Returns NULL if all aliases are in use. */
+static IoTPTopicAlias * iotp_alias_getFreeSlot(IoTPTopicAliases *aliases)
+{
+    int i;
+
+    if ( aliases->used < aliases->count ) {
+        for (i = 0; i < aliases->count; i++) {
+            if ( aliases->slots[i].topic == NULL )
+                return &aliases->slots[i];
+        }
+    }
+
+    /* two rounds - first round clears referenced flags */
+    for (i = 0; i < 2 * aliases->count; i++) {
+        IoTPTopicAlias *slot = &aliases->slots[aliases->hand];
+        aliases->hand = (aliases->hand + 1) % aliases->count;
+        if ( slot->users > 0 )
+            continue;
+        if ( slot->referenced ) {
+            slot->referenced = 0;
+            continue;
+        }
+        iotp_alias_unassign(aliases, slot);
+        return slot;
+    }
+
+    return NULL;
+}
+
+/*
+ * Initializes topic aliases. Aliases are used once server maximum is known, when client connects.
+ * If topicRequired is set, QoS1 and QoS2 publish requests always carry the topic, as
+ * they may be resent on another connection (persistent session or store).
+ */
+void iotp_alias_init(IoTPTopicAliases *aliases, int maxAliases, int topicRequired)
+{
+    int nbuckets = 16;
+
+    memset(aliases, 0, sizeof(IoTPTopicAliases));
+    if ( maxAliases <= 0 ) {
+        return;
+    }
+
+    while ( nbuckets < maxAliases )
+        nbuckets <<= 1;
+    aliases->slots = (IoTPTopicAlias *)calloc((size_t)maxAliases, sizeof(IoTPTopicAlias));
+    aliases->buckets = (IoTPTopicAlias **)calloc((size_t)nbuckets, sizeof(IoTPTopicAlias *));
+    if ( aliases->slots == NULL || aliases->buckets == NULL ) {
+        LOG(ERROR, "Failed to allocate topic alias table. Topic aliases are not used. maxAliases: %d", maxAliases);
+        iotp_utils_freePtr((void *)aliases->slots);
+        iotp_utils_freePtr((void *)aliases->buckets);
+        aliases->slots = NULL;
+        aliases->buckets = NULL;
+        return;
+    }
+    aliases->nbuckets = nbuckets;
+    aliases->maxAliases = maxAliases;
+    aliases->topicRequired = topicRequired;
+    pthread_mutex_init(&aliases->lock, NULL);
+    aliases->enabled = 1;
+}
+
+/* Frees topic aliases */
+void iotp_alias_free(IoTPTopicAliases *aliases)
+{
+    int i;
+
+    if ( aliases->enabled == 0 ) {
+        return;
+    }
+    for (i = 0; i < aliases->maxAliases; i++) {
+        iotp_utils_freePtr((void *)aliases->slots[i].topic);
+    }
+    iotp_utils_freePtr((void *)aliases->slots);
+    iotp_utils_freePtr((void *)aliases->buckets);
+    pthread_mutex_destroy(&aliases->lock);
+    aliases->enabled = 0;
+}
+
+/*
+ * Resets aliases for a new connection. serverMax is Topic Alias Maximum returned by the
+ * server in CONNACK, or -1 to keep the negotiated maximum.
+ */
+void iotp_alias_reset(IoTPTopicAliases *aliases, int serverMax)
+{
+    int i;
+
+    if ( aliases->enabled == 0 ) {
+        return;
+    }
+
+    pthread_mutex_lock(&aliases->lock);
+    for (i = 0; i < aliases->maxAliases; i++) {
+        IoTPTopicAlias *slot = &aliases->slots[i];
+        iotp_utils_freePtr((void *)slot->topic);
+        memset(slot, 0, sizeof(IoTPTopicAlias));
+    }
+    memset(aliases->buckets, 0, sizeof(IoTPTopicAlias *) * (size_t)aliases->nbuckets);
+    memset(aliases->seen, 0, sizeof(aliases->seen));
+    aliases->used = 0;
+    aliases->hand = 0;
+    aliases->generation += 1;
+    if ( serverMax >= 0 ) {
+        aliases->count = serverMax < aliases->maxAliases ? serverMax : aliases->maxAliases;
+        LOG(INFO, "Topic aliases: %d | configured: %d | server maximum: %d", aliases->count, aliases->maxAliases, serverMax);
+    }
+    pthread_mutex_unlock(&aliases->lock);
+}
+
+/*
+ * Returns alias to use for a publish request, or 0 if topic is not aliased. Sets omitTopic
+ * to 1 if the request can be sent without the topic. Caller must call iotp_alias_release()
+ * with the returned alias and generation, once the request is submitted to MQTT client.
+ */
+int iotp_alias_acquire(IoTPTopicAliases *aliases, const char *topic, int qos, int *omitTopic, uint32_t *generation)
+{
+    IoTPTopicAlias *slot = NULL;
+    uint32_t hash = 0;
+    int alias = 0;
+
+    *omitTopic = 0;
+    if ( aliases->enabled == 0 || topic == NULL || strlen(topic) <= IOTP_ALIAS_PROPERTY_LEN ) {
+        return 0;
+    }
+
+    hash = iotp_alias_hash(topic);
+    pthread_mutex_lock(&aliases->lock);
+    if ( aliases->count <= 0 ) {
+        pthread_mutex_unlock(&aliases->lock);
+        return 0;
+    }
+
+    for (slot = aliases->buckets[hash & (aliases->nbuckets - 1)]; slot; slot = slot->next) {
+        if ( slot->hash == hash && !strcmp(slot->topic, topic) )
+            break;
+    }
+
+    if ( slot == NULL ) {
+        /* assign an alias to a topic published recently */
+        uint32_t *seen = &aliases->seen[hash % IOTP_ALIAS_SEEN_SIZE];
+        if ( *seen != hash || (slot = iotp_alias_getFreeSlot(aliases)) == NULL ) {
+            *seen = hash;
+            pthread_mutex_unlock(&aliases->lock);
+            return 0;
+        }
+        slot->topic = strdup(topic);
+        if ( slot->topic == NULL ) {
+            pthread_mutex_unlock(&aliases->lock);
+            return 0;
+        }
+        slot->hash = hash;
+        slot->next = aliases->buckets[hash & (aliases->nbuckets - 1)];
+        aliases->buckets[hash & (aliases->nbuckets - 1)] = slot;
+        aliases->used += 1;
+    }
+
+    slot->users += 1;
+    slot->referenced = 1;
+    if ( slot->established && (qos == 0 || aliases->topicRequired == 0) )
+        *omitTopic = 1;
+    alias = (int)(slot - aliases->slots) + 1;
+    *generation = aliases->generation;
+    pthread_mutex_unlock(&aliases->lock);
+
+    return alias;
+}
+
+/*
+ * Releases an alias acquired for a publish request. If the request carried the topic and
+ * is submitted to MQTT client, later requests of the same connection can omit the topic.
+ */
+void iotp_alias_release(IoTPTopicAliases *aliases, int alias, uint32_t generation, int sent)
+{
+    IoTPTopicAlias *slot = NULL;
+
+    if ( aliases->enabled == 0 || alias <= 0 || alias > aliases->maxAliases ) {
+        return;
+    }
+
+    pthread_mutex_lock(&aliases->lock);
+    if ( generation == aliases->generation ) {
+        slot = &aliases->slots[alias - 1];
+        if ( slot->users > 0 )
+            slot->users -= 1;
+        if ( sent )
+            slot->established = 1;
+    }
+    pthread_mutex_unlock(&aliases->lock);
+}
@@ -25,7 +25,12 @@ IOTPRC IoTPApplication_create(IoTPApplication **application, IoTPConfig *config)
 {
     IOTPRC rc = IOTPRC_SUCCESS;
 
-    rc = iotp_client_create((void **)application, config, IoTPClient_application);
+    /* Shared subscriptions use client ID A:<orgId>:<appId> */
+    IoTPClientType type = IoTPClient_application;
+    if ( config && config->mqttopts && config->mqttopts->sharedSubscription == 1 )
+        type = IoTPClient_Application;
+
+    rc = iotp_client_create((void **)application, config, type);
     if ( rc != IOTPRC_SUCCESS ) {
         LOG(ERROR, "Failed to create an application handle. rc: %d | Reason: %s", rc, IOTPRC_toString(rc));
     }
@@ -98,13 +103,46 @@ IOTPRC IoTPApplication_setEventCallback(IoTPApplication *application, IoTPEventC
     return rc;
 }
 
+/* Sets connection state handler */
+IOTPRC IoTPApplication_setConnectionStateHandler(IoTPApplication *application, IoTPConnectionStateHandler cb, void *context)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    rc = iotp_client_setConnectionStateHandler((void *)application, cb, context);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to set connection state handler. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
+/* Returns client statistics */
+IOTPRC IoTPApplication_getStats(IoTPApplication *application, IoTPStats *stats)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    rc = iotp_client_getStats((void *)application, stats);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to get client statistics. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
 /* Sends Event on behalf of a device or gateway */
 IOTPRC IoTPApplication_sendEvent(IoTPApplication *application, char *typeId, char *deviceId, char *eventId, char *data, char *formatString, QoS qos, MQTTProperties *props)
+{
+    size_t datalen = data ? strlen(data) : 0;
+    return IoTPApplication_sendEventBuffer(application, typeId, deviceId, eventId, data, datalen, formatString, qos, props, NULL, NULL);
+}
+
+/* Sends Event on behalf of a device or gateway, using payload buffer of specified length */
+IOTPRC IoTPApplication_sendEventBuffer(IoTPApplication *application, char *typeId, char *deviceId, char *eventId, void *buffer, size_t bufferlen, char *formatString, QoS qos, MQTTProperties *props, IoTPBufferReleaseHandler releaseCB, void *context)
 {
     IOTPRC rc = IOTPRC_SUCCESS;
 
     /* Sanity check */
-    if ( !application || !typeId || *typeId == '\0' || !deviceId || *deviceId == '\0' || !eventId || *eventId == '\0' || !formatString || *formatString == '\0' ) {
+    if ( !application || !typeId || *typeId == '\0' || !deviceId || *deviceId == '\0' || !eventId || *eventId == '\0' || !formatString || *formatString == '\0' || (!buffer && bufferlen > 0) ) {
         rc = IOTPRC_ARGS_NULL_VALUE;
         LOG(WARN, "Invalid or NULL argument. rc: %d | Reason: %s", rc, IOTPRC_toString(rc));
         return rc;
@@ -123,7 +161,40 @@ IOTPRC IoTPApplication_sendEvent(IoTPApplication *application, char *typeId, cha
 
     LOG(DEBUG,"Send event. topic: %s", topic);
 
-    rc = iotp_client_publish((void *)application, topic, data, qos, props);
+    rc = iotp_client_publishBuffer((void *)application, topic, buffer, bufferlen, qos, props, releaseCB, context);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to send event. topic: %s | rc: %d | Reason: %s", topic, rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
+/* Sends Event on behalf of a device or gateway, and returns delivery token of the publish request */
+IOTPRC IoTPApplication_sendEventAsync(IoTPApplication *application, char *typeId, char *deviceId, char *eventId, void *buffer, size_t bufferlen, char *formatString, QoS qos, MQTTProperties *props, IoTPDeliveryHandler deliveryCB, void *context, int *token)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* Sanity check */
+    if ( !application || !typeId || *typeId == '\0' || !deviceId || *deviceId == '\0' || !eventId || *eventId == '\0' || !formatString || *formatString == '\0' || (!buffer && bufferlen > 0) ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Invalid or NULL argument. rc: %d | Reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+    if ( qos != QoS0 && qos != QoS1 && qos != QoS2 ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(WARN, "Invalid QoS. qos: %d | rc: %d | reason: %s", qos, rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    /* Set topic string */
+    char *format = "iot-2/type/%s/id/%s/evt/%s/fmt/%s";
+    int len = strlen(format) + strlen(typeId) + strlen(deviceId) + strlen(eventId) + strlen(formatString) - 7;
+    char topic[len];
+    snprintf(topic, len, format, typeId, deviceId, eventId, formatString);
+
+    LOG(DEBUG,"Send event. topic: %s", topic);
+
+    rc = iotp_client_publishAsync((void *)application, topic, buffer, bufferlen, qos, props, deliveryCB, context, token);
     if ( rc != IOTPRC_SUCCESS ) {
         LOG(ERROR, "Failed to send event. topic: %s | rc: %d | Reason: %s", topic, rc, IOTPRC_toString(rc));
     }
@@ -164,6 +235,102 @@ IOTPRC IoTPApplication_sendCommand(IoTPApplication *application, char *typeId, c
     return rc;
 }
 
+/* Sends command to a device, and invokes a handler with the response of the device or on timeout */
+IOTPRC IoTPApplication_sendCommandRequest(IoTPApplication *application, char *typeId, char *deviceId, char *commandId, void *buffer, size_t bufferlen, char *formatString, QoS qos, MQTTProperties *props, int timeout, IoTPCommandResponseHandler cb, void *context, uint64_t *request)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* Sanity check */
+    if ( !application || !typeId || *typeId == '\0' || !deviceId || *deviceId == '\0' || !commandId || *commandId == '\0' || !formatString || *formatString == '\0' || !cb ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Invalid or NULL argument. rc: %d | Reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+    if ( qos != QoS0 && qos != QoS1 && qos != QoS2 ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(WARN, "Invalid QoS. qos: %d | rc: %d | reason: %s", qos, rc, IOTPRC_toString(rc));
+        return rc;
+    }
+    /* response is matched to the device, wild cards are not valid */
+    if ( timeout <= 0 || !iotp_topic_isValidLevel(typeId) || !iotp_topic_isValidLevel(deviceId) ||
+         !iotp_topic_isValidLevel(commandId) || !iotp_topic_isValidLevel(formatString) ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(WARN, "Invalid timeout or topic level. timeout: %d | rc: %d | reason: %s", timeout, rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    /* Set topic string */
+    char *format = "iot-2/type/%s/id/%s/cmd/%s/fmt/%s";
+    int len = strlen(format) + strlen(typeId) + strlen(deviceId) + strlen(commandId) + strlen(formatString) - 7;
+    char topic[len];
+    snprintf(topic, len, format, typeId, deviceId, commandId, formatString);
+
+    rc = iotp_client_sendCommandRequest((void *)application, topic, typeId, deviceId, buffer, bufferlen, qos, props, timeout, cb, context, request);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to send command request. topic: %s | rc: %d | Reason: %s", topic, rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
+/* Cancels a command request */
+IOTPRC IoTPApplication_cancelCommandRequest(IoTPApplication *application, uint64_t request)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    if ( !application ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Invalid or NULL argument. rc: %d | Reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    return iotp_client_cancelCommandRequest((void *)application, request);
+}
+
+/* Creates a topic handle for events or commands of a device */
+static IOTPRC iotp_application_prepareTopic(IoTPApplication *application, char *typeId, char *deviceId, char *type, char *id, char *formatString, IoTPTopic **topic)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* Sanity check */
+    if ( !application || !typeId || *typeId == '\0' || !deviceId || *deviceId == '\0' || !id || *id == '\0' || !formatString || *formatString == '\0' || !topic ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Invalid or NULL argument. rc: %d | Reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+    if ( !iotp_topic_isValidLevel(typeId) || !iotp_topic_isValidLevel(deviceId) ||
+         !iotp_topic_isValidLevel(id) || !iotp_topic_isValidLevel(formatString) ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(WARN, "Invalid topic level. rc: %d | Reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    /* Set topic string */
+    char *format = "iot-2/type/%s/id/%s/%s/%s/fmt/%s";
+    int len = strlen(format) + strlen(typeId) + strlen(deviceId) + strlen(type) + strlen(id) + strlen(formatString) - 9;
+    char pubTopic[len];
+    snprintf(pubTopic, len, format, typeId, deviceId, type, id, formatString);
+
+    rc = iotp_client_prepareTopic((void *)application, pubTopic, topic);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to prepare topic. topic: %s | rc: %d | Reason: %s", pubTopic, rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
+/* Creates a topic handle for events of a device */
+IOTPRC IoTPApplication_prepareEventTopic(IoTPApplication *application, char *typeId, char *deviceId, char *eventId, char *formatString, IoTPTopic **topic)
+{
+    return iotp_application_prepareTopic(application, typeId, deviceId, "evt", eventId, formatString, topic);
+}
+
+/* Creates a topic handle for commands to a device */
+IOTPRC IoTPApplication_prepareCommandTopic(IoTPApplication *application, char *typeId, char *deviceId, char *commandId, char *formatString, IoTPTopic **topic)
+{
+    return iotp_application_prepareTopic(application, typeId, deviceId, "cmd", commandId, formatString, topic);
+}
+
 /* Sets event handler */
 IOTPRC IoTPApplication_setEventHandler(IoTPApplication *application, IoTPCallbackHandler cb, char *typeId, char *deviceId, char *eventId, char *formatString)
 {
@@ -192,6 +359,62 @@ IOTPRC IoTPApplication_setEventHandler(IoTPApplication *application, IoTPCallbac
     return rc;
 }
 
+/* Set event handler, invoked with message descriptor */
+IOTPRC IoTPApplication_setEventMessageHandler(IoTPApplication *application, IoTPMessageHandler cb, void *context, char *typeId, char *deviceId, char *eventId, char *formatString)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* Sanity check */
+    if ( !application || !cb || !typeId || *typeId == '\0' || !deviceId || *deviceId == '\0' || !eventId || *eventId == '\0' || !formatString || *formatString == '\0' ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Invalid or NULL argument. rc: %d | Reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    /* Set topic string */
+    char *format = "iot-2/type/%s/id/%s/evt/%s/fmt/%s";
+    int len = strlen(format) + strlen(typeId) + strlen(deviceId) + strlen(eventId) + strlen(formatString) - 7;
+    char topic[len];
+    snprintf(topic, len, format, typeId, deviceId, eventId, formatString);
+
+    LOG(DEBUG,"Set event message handler. topic: %s", topic);
+
+    rc = iotp_client_setMessageHandler((void *)application, topic, IoTP_Handler_AppEvent, cb, context);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to set handler. topic: %s | rc: %d | Reason: %s", topic, rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
+/* Set event batch handler */
+IOTPRC IoTPApplication_setEventBatchHandler(IoTPApplication *application, IoTPBatchHandler cb, void *context, char *typeId, char *deviceId, char *eventId, char *formatString)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* Sanity check */
+    if ( !application || !cb || !typeId || *typeId == '\0' || !deviceId || *deviceId == '\0' || !eventId || *eventId == '\0' || !formatString || *formatString == '\0' ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Invalid or NULL argument. rc: %d | Reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    /* Set topic string */
+    char *format = "iot-2/type/%s/id/%s/evt/%s/fmt/%s";
+    int len = strlen(format) + strlen(typeId) + strlen(deviceId) + strlen(eventId) + strlen(formatString) - 7;
+    char topic[len];
+    snprintf(topic, len, format, typeId, deviceId, eventId, formatString);
+
+    LOG(DEBUG,"Set event batch handler. topic: %s", topic);
+
+    rc = iotp_client_setBatchHandler((void *)application, topic, IoTP_Handler_AppEvent, cb, context);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to set handler. topic: %s | rc: %d | Reason: %s", topic, rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
 /* Subscribe to events */
 IOTPRC IoTPApplication_subscribeToEvents(IoTPApplication *application, char *typeId, char *deviceId, char *eventId, char *formatString)
 {
@@ -276,6 +499,34 @@ IOTPRC IoTPApplication_setCommandHandler(IoTPApplication *application, IoTPCallb
     return rc;
 }
 
+/* Set Command Message Handler */
+IOTPRC IoTPApplication_setCommandMessageHandler(IoTPApplication *application, IoTPMessageHandler cb, void *context, char *typeId, char *deviceId, char *commandId, char *formatString)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* Sanity check */
+    if ( !application || !cb || !typeId || *typeId == '\0' || !deviceId || *deviceId == '\0' || !commandId || *commandId == '\0' || !formatString || *formatString == '\0' ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Invalid or NULL argument. rc: %d | Reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    /* Set topic string */
+    char *format = "iot-2/type/%s/id/%s/cmd/%s/fmt/%s";
+    int len = strlen(format) + strlen(typeId) + strlen(deviceId) + strlen(commandId) + strlen(formatString) - 7;
+    char topic[len];
+    snprintf(topic, len, format, typeId, deviceId, commandId, formatString);
+
+    LOG(DEBUG,"Set command message handler. topic: %s", topic);
+
+    rc = iotp_client_setMessageHandler((void *)application, topic, IoTP_Handler_Command, cb, context);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to set handler. topic: %s | rc: %d | Reason: %s", topic, rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
 /* Subscribe to commands */
 IOTPRC IoTPApplication_subscribeToCommands(IoTPApplication *application, char *typeId, char *deviceId, char *commandId, char *formatString)
 {
@@ -503,3 +754,265 @@ IOTPRC IoTPApplication_unsubscribeFromAppMonitoringMessages(IoTPApplication *app
 }
 
 
+/*
+ * Application group - clients with the same appId, that connect using shared subscriptions.
+ * The server distributes messages of a subscription across the connections, so messages are
+ * received by a receiving thread of each connection. Handlers are set in the handlers of the
+ * first client, which are shared by all clients of the group. The handlers are protected by a
+ * read-write lock, so they can be set while receiving threads of the group look them up.
+ */
+
+/* Destroys clients of a group, first client (owner of handlers) is destroyed last */
+static void iotp_application_destroyGroup(IoTPClientGroup *group)
+{
+    int i;
+
+    for (i = group->count - 1; i >= 0; i--) {
+        if ( group->members[i] )
+            iotp_client_destroy(group->members[i]);
+    }
+    iotp_utils_freePtr((void *)group->members);
+    iotp_utils_freePtr((void *)group);
+}
+
+/* Creates an application group */
+IOTPRC IoTPApplicationGroup_create(IoTPApplicationGroup **group, IoTPConfig *config, int connections)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+    IoTPClientGroup *clientGroup = NULL;
+    int i;
+
+    /* Sanity check */
+    if ( !group || !config ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Invalid or NULL argument. rc: %d | Reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+    if ( *group != NULL ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(ERROR, "Group handle is already created.");
+        return rc;
+    }
+    if ( connections == 0 ) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        connections = cpus > 0 ? (int)cpus : 1;
+        if ( connections > IOTP_MAX_GROUP_CONNECTIONS )
+            connections = IOTP_MAX_GROUP_CONNECTIONS;
+    }
+    if ( connections < 0 || connections > IOTP_MAX_GROUP_CONNECTIONS ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(WARN, "Invalid number of connections. connections: %d | rc: %d | Reason: %s", connections, rc, IOTPRC_toString(rc));
+        return rc;
+    }
+    /* clients of the group have the same client ID, a persistent store can not be shared */
+    if ( config->mqttopts && config->mqttopts->persistencePath != NULL ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(ERROR, "Persistent store is not supported by application group. rc: %d | Reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    clientGroup = (IoTPClientGroup *)calloc(1, sizeof(IoTPClientGroup));
+    if ( clientGroup )
+        clientGroup->members = (void **)calloc((size_t)connections, sizeof(void *));
+    if ( clientGroup == NULL || clientGroup->members == NULL ) {
+        iotp_utils_freePtr((void *)clientGroup);
+        rc = IOTPRC_NOMEM;
+        LOG(ERROR, "Failed to allocate application group. rc: %d | Reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+    clientGroup->count = connections;
+
+    for (i = 0; i < connections; i++) {
+        rc = iotp_client_create(&clientGroup->members[i], config, IoTPClient_Application);
+        if ( rc == IOTPRC_SUCCESS && i > 0 )
+            rc = iotp_client_shareHandlers(clientGroup->members[i], clientGroup->members[0]);
+        if ( rc != IOTPRC_SUCCESS ) {
+            LOG(ERROR, "Failed to create client of application group. index: %d | rc: %d | Reason: %s", i, rc, IOTPRC_toString(rc));
+            iotp_application_destroyGroup(clientGroup);
+            return rc;
+        }
+    }
+
+    LOG(INFO, "Application group is created. connections: %d", connections);
+    *group = (IoTPApplicationGroup *)clientGroup;
+    return rc;
+}
+
+/* Destroys an application group */
+IOTPRC IoTPApplicationGroup_destroy(IoTPApplicationGroup *group)
+{
+    if ( !group ) {
+        LOG(WARN, "Invalid or NULL argument.");
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+
+    iotp_application_destroyGroup((IoTPClientGroup *)group);
+    return IOTPRC_SUCCESS;
+}
+
+/* Connects clients of an application group */
+IOTPRC IoTPApplicationGroup_connect(IoTPApplicationGroup *group)
+{
+    IoTPClientGroup *clientGroup = (IoTPClientGroup *)group;
+    IOTPRC rc = IOTPRC_SUCCESS;
+    int i;
+
+    if ( !group ) {
+        LOG(WARN, "Invalid or NULL argument.");
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+
+    for (i = 0; i < clientGroup->count; i++) {
+        IOTPRC crc = iotp_client_connect(clientGroup->members[i]);
+        if ( crc != IOTPRC_SUCCESS ) {
+            LOG(ERROR, "Failed to connect client of application group. index: %d | rc: %d | Reason: %s", i, crc, IOTPRC_toString(crc));
+            if ( rc == IOTPRC_SUCCESS )
+                rc = crc;
+        }
+    }
+
+    return rc;
+}
+
+/* Disconnects clients of an application group */
+IOTPRC IoTPApplicationGroup_disconnect(IoTPApplicationGroup *group)
+{
+    IoTPClientGroup *clientGroup = (IoTPClientGroup *)group;
+    IOTPRC rc = IOTPRC_SUCCESS;
+    int i;
+
+    if ( !group ) {
+        LOG(WARN, "Invalid or NULL argument.");
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+
+    for (i = 0; i < clientGroup->count; i++) {
+        IOTPRC crc = iotp_client_disconnect(clientGroup->members[i]);
+        if ( crc != IOTPRC_SUCCESS && rc == IOTPRC_SUCCESS )
+            rc = crc;
+    }
+
+    return rc;
+}
+
+/* Returns a client of an application group */
+IOTPRC IoTPApplicationGroup_getApplication(IoTPApplicationGroup *group, int index, IoTPApplication **application)
+{
+    IoTPClientGroup *clientGroup = (IoTPClientGroup *)group;
+
+    if ( !group || !application ) {
+        LOG(WARN, "Invalid or NULL argument.");
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+    if ( index < 0 || index >= clientGroup->count ) {
+        return IOTPRC_NOT_FOUND;
+    }
+
+    *application = (IoTPApplication *)clientGroup->members[index];
+    return IOTPRC_SUCCESS;
+}
+
+/* Returns number of connections of an application group */
+IOTPRC IoTPApplicationGroup_getConnections(IoTPApplicationGroup *group, int *connections)
+{
+    if ( !group || !connections ) {
+        LOG(WARN, "Invalid or NULL argument.");
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+
+    *connections = ((IoTPClientGroup *)group)->count;
+    return IOTPRC_SUCCESS;
+}
+
+/* Sets event handler in shared handlers of a group */
+IOTPRC IoTPApplicationGroup_setEventHandler(IoTPApplicationGroup *group, IoTPCallbackHandler cb, char *typeId, char *deviceId, char *eventId, char *formatString)
+{
+    if ( !group ) {
+        LOG(WARN, "Invalid or NULL argument.");
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+
+    return IoTPApplication_setEventHandler(((IoTPClientGroup *)group)->members[0], cb, typeId, deviceId, eventId, formatString);
+}
+
+/* Sets event message handler in shared handlers of a group */
+IOTPRC IoTPApplicationGroup_setEventMessageHandler(IoTPApplicationGroup *group, IoTPMessageHandler cb, void *context, char *typeId, char *deviceId, char *eventId, char *formatString)
+{
+    if ( !group ) {
+        LOG(WARN, "Invalid or NULL argument.");
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+
+    return IoTPApplication_setEventMessageHandler(((IoTPClientGroup *)group)->members[0], cb, context, typeId, deviceId, eventId, formatString);
+}
+
+/* Sets event batch handler in shared handlers of a group */
+IOTPRC IoTPApplicationGroup_setEventBatchHandler(IoTPApplicationGroup *group, IoTPBatchHandler cb, void *context, char *typeId, char *deviceId, char *eventId, char *formatString)
+{
+    if ( !group ) {
+        LOG(WARN, "Invalid or NULL argument.");
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+
+    return IoTPApplication_setEventBatchHandler(((IoTPClientGroup *)group)->members[0], cb, context, typeId, deviceId, eventId, formatString);
+}
+
+/* Subscribes to events on all connections of a group */
+IOTPRC IoTPApplicationGroup_subscribeToEvents(IoTPApplicationGroup *group, char *typeId, char *deviceId, char *eventId, char *formatString)
+{
+    IoTPClientGroup *clientGroup = (IoTPClientGroup *)group;
+    IOTPRC rc = IOTPRC_SUCCESS;
+    int i;
+
+    if ( !group ) {
+        LOG(WARN, "Invalid or NULL argument.");
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+
+    for (i = 0; i < clientGroup->count; i++) {
+        IOTPRC crc = IoTPApplication_subscribeToEvents(clientGroup->members[i], typeId, deviceId, eventId, formatString);
+        if ( crc != IOTPRC_SUCCESS && rc == IOTPRC_SUCCESS )
+            rc = crc;
+    }
+
+    return rc;
+}
+
+/* Unsubscribes from events on all connections of a group */
+IOTPRC IoTPApplicationGroup_unsubscribeFromEvents(IoTPApplicationGroup *group, char *typeId, char *deviceId, char *eventId, char *formatString)
+{
+    IoTPClientGroup *clientGroup = (IoTPClientGroup *)group;
+    IOTPRC rc = IOTPRC_SUCCESS;
+    int i;
+
+    if ( !group ) {
+        LOG(WARN, "Invalid or NULL argument.");
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+
+    for (i = 0; i < clientGroup->count; i++) {
+        IOTPRC crc = IoTPApplication_unsubscribeFromEvents(clientGroup->members[i], typeId, deviceId, eventId, formatString);
+        if ( crc != IOTPRC_SUCCESS && rc == IOTPRC_SUCCESS )
+            rc = crc;
+    }
+
+    return rc;
+}
+
+/* Sets connection state handler of all clients of a group */
+IOTPRC IoTPApplicationGroup_setConnectionStateHandler(IoTPApplicationGroup *group, IoTPConnectionStateHandler cb, void *context)
+{
+    IoTPClientGroup *clientGroup = (IoTPClientGroup *)group;
+    IOTPRC rc = IOTPRC_SUCCESS;
+    int i;
+
+    if ( !group ) {
+        LOG(WARN, "Invalid or NULL argument.");
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+
+    for (i = 0; i < clientGroup->count && rc == IOTPRC_SUCCESS; i++)
+        rc = iotp_client_setConnectionStateHandler(clientGroup->members[i], cb, context);
+
+    return rc;
+}
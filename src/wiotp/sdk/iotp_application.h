@@ -56,6 +56,16 @@
  */
 typedef void * IoTPApplication;
 
+/**
+ * A handle representing a group of IBM Watson IoT Platform MQTT application clients, that connect
+ * with the same application ID and share subscriptions. A valid group handle is available following
+ * a successful call to IoTPApplicationGroup_create()
+ */
+typedef void * IoTPApplicationGroup;
+
+/** Maximum number of connections of an application group */
+#define IOTP_MAX_GROUP_CONNECTIONS  64
+
 
 /**
  * IoTPApplication_create: Creates IBM Watson IoT platform application client.
@@ -180,6 +190,83 @@ DLLExport IOTPRC IoTPApplication_disconnect(IoTPApplication *application);
 DLLExport IOTPRC IoTPApplication_sendEvent(IoTPApplication *application, char *typeId, char *deviceId, char *eventId, char *data, char *formatString, QoS qos, MQTTProperties *props);
 
 
+/**
+ * IoTPApplication_sendEventBuffer: Publishs events for the application to the IBM Watson IoT service, or
+ *                            on behalf of other devices, using a payload buffer of specified length.
+ *                            The buffer can contain binary data, and is handed to the MQTT client
+ *                            without being scanned or copied. If releaseCB is specified, the buffer
+ *                            must not be modified or freed until releaseCB is invoked on completion
+ *                            of the publish request. If this API returns an error, releaseCB is not invoked.
+ *
+ * @param application    - A valid application handle
+ *
+ * @param typeId         - Device type ID
+ *
+ * @param deviceId       - Device ID
+ *
+ * @param eventId        - Event id to be published e.g status, gps
+ *
+ * @param buffer         - Payload buffer of the event
+ *
+ * @param bufferlen      - Size of payload buffer
+ *
+ * @param formatString   - Format of the event e.g json, cbor, bin
+ *
+ * @param qos            - QoS for the publish event. Supported values : QoS0, QoS1, QoS2
+ *
+ * @param props          - MQTT V5 properties
+ *
+ * @param releaseCB      - Optional. A function pointer to the IoTPBufferReleaseHandler.
+ *
+ * @param context        - Optional. User context passed to the release callback.
+ *
+ * @return IOTPRC  - Returns one of the following codes:
+ *                       - IOTPRC_SUCCESS for success
+ *                       - IOTPRC_INVALID_HANDLE - if handle in invalid
+ *
+ */
+DLLExport IOTPRC IoTPApplication_sendEventBuffer(IoTPApplication *application, char *typeId, char *deviceId, char *eventId, void *buffer, size_t bufferlen, char *formatString, QoS qos, MQTTProperties *props, IoTPBufferReleaseHandler releaseCB, void *context);
+
+
+/**
+ * IoTPApplication_sendEventAsync: Publishs events for the application to the IBM Watson IoT service, or
+ *                            on behalf of other devices, and returns the delivery token of the publish
+ *                            request. If deliveryCB is specified, it is invoked once the publish request
+ *                            completes, with the delivery token, status of the request, and the time the
+ *                            request was submitted and acknowledged.
+ *
+ * @param application    - A valid application handle
+ *
+ * @param typeId         - Device type ID
+ *
+ * @param deviceId       - Device ID
+ *
+ * @param eventId        - Event id to be published e.g status, gps
+ *
+ * @param buffer         - Payload buffer of the event
+ *
+ * @param bufferlen      - Size of payload buffer
+ *
+ * @param formatString   - Format of the event e.g json, cbor, bin
+ *
+ * @param qos            - QoS for the publish event. Supported values : QoS0, QoS1, QoS2
+ *
+ * @param props          - MQTT V5 properties
+ *
+ * @param deliveryCB     - Optional. A function pointer to the IoTPDeliveryHandler.
+ *
+ * @param context        - Optional. User context passed to the delivery callback.
+ *
+ * @param token          - Optional. Returned delivery token.
+ *
+ * @return IOTPRC  - Returns one of the following codes:
+ *                       - IOTPRC_SUCCESS for success
+ *                       - IOTPRC_INVALID_HANDLE - if handle in invalid
+ *
+ */
+DLLExport IOTPRC IoTPApplication_sendEventAsync(IoTPApplication *application, char *typeId, char *deviceId, char *eventId, void *buffer, size_t bufferlen, char *formatString, QoS qos, MQTTProperties *props, IoTPDeliveryHandler deliveryCB, void *context, int *token);
+
+
 /**
  * IoTPApplication_sendCommand: Publishs a command from the application to the IBM Watson IoT service
  *
@@ -207,6 +294,119 @@ DLLExport IOTPRC IoTPApplication_sendEvent(IoTPApplication *application, char *t
 DLLExport IOTPRC IoTPApplication_sendCommand(IoTPApplication *application, char *typeId, char *deviceId, char *commandId, char *data, char *formatString, QoS qos, MQTTProperties *props);
 
 
+/**
+ * IoTPApplication_sendCommandRequest: Publishs a command to a device, and invokes a handler with the response of
+ *                            the device. The command is sent with MQTT V5 Response Topic and Correlation Data
+ *                            properties. The device sends the response using IoTPDevice_sendCommandResponse(), as
+ *                            event IOTP_COMMAND_RESPONSE_EVENT-<token of the connection> in format of the command.
+ *                            The first request of a connection waits until the subscription to responses is
+ *                            acknowledged. The handler is invoked once, with the response, or with IOTPRC_TIMEOUT
+ *                            if no response is received within the timeout.
+ *                            The handler can be invoked before this API returns.
+ *
+ * @param application    - A valid application handle
+ *
+ * @param typeId         - Device type ID
+ *
+ * @param deviceId       - Device ID
+ *
+ * @param commandId      - Command id to be published e.g reboot
+ *
+ * @param buffer         - Payload buffer of the command
+ *
+ * @param bufferlen      - Size of payload buffer
+ *
+ * @param formatString   - Format of the command and the response e.g json
+ *
+ * @param qos            - QoS for the publish command. Supported values : QoS0, QoS1, QoS2
+ *
+ * @param props          - MQTT V5 properties
+ *
+ * @param timeout        - Time (in milliseconds) to wait for the response
+ *
+ * @param cb             - A function pointer to the IoTPCommandResponseHandler.
+ *
+ * @param context        - Optional. User context passed to the handler.
+ *
+ * @param request        - Optional. Returned handle of the request.
+ *
+ * @return IOTPRC  - Returns one of the following codes:
+ *                       - IOTPRC_SUCCESS for success
+ *                       - IOTPRC_INVALID_HANDLE - if handle in invalid
+ *                       - IOTPRC_NOT_CONNECTED - if application is not connected
+ *
+ */
+DLLExport IOTPRC IoTPApplication_sendCommandRequest(IoTPApplication *application, char *typeId, char *deviceId, char *commandId, void *buffer, size_t bufferlen, char *formatString, QoS qos, MQTTProperties *props, int timeout, IoTPCommandResponseHandler cb, void *context, uint64_t *request);
+
+
+/**
+ * IoTPApplication_cancelCommandRequest: Cancels a command request, that is waiting for a response.
+ *                            Handler of the request is not invoked.
+ *
+ * @param application    - A valid application handle
+ *
+ * @param request        - Handle of the request, returned by IoTPApplication_sendCommandRequest()
+ *
+ * @return IOTPRC  - Returns one of the following codes:
+ *                       - IOTPRC_SUCCESS for success
+ *                       - IOTPRC_NOT_FOUND - if request is completed, timed out or cancelled
+ *
+ */
+DLLExport IOTPRC IoTPApplication_cancelCommandRequest(IoTPApplication *application, uint64_t request);
+
+
+/**
+ * IoTPApplication_prepareEventTopic: Creates a topic handle for events of a device. The topic is built
+ *                            and validated once, and can be reused to publish events using IoTPTopic_publish().
+ *                            The topic handle must be destroyed using IoTPTopic_destroy(), before the
+ *                            application handle is destroyed.
+ *
+ * @param application    - A valid application handle
+ *
+ * @param typeId         - Device type ID
+ *
+ * @param deviceId       - Device ID
+ *
+ * @param eventId        - Event id e.g status, gps
+ *
+ * @param formatString   - Format of the event e.g json
+ *
+ * @param topic          - Returned topic handle
+ *
+ * @return IOTPRC  - Returns one of the following codes:
+ *                       - IOTPRC_SUCCESS for success
+ *                       - IOTPRC_INVALID_HANDLE - if handle in invalid
+ *
+ */
+DLLExport IOTPRC IoTPApplication_prepareEventTopic(IoTPApplication *application, char *typeId, char *deviceId, char *eventId, char *formatString, IoTPTopic **topic);
+
+
+/**
+ * IoTPApplication_prepareCommandTopic: Creates a topic handle for commands to a device. The topic is built
+ *                            and validated once, and can be reused to publish commands using IoTPTopic_publish().
+ *                            The topic handle must be destroyed using IoTPTopic_destroy(), before the
+ *                            application handle is destroyed.
+ *
+ * @param application    - A valid application handle
+ *
+ * @param typeId         - Device type ID
+ *
+ * @param deviceId       - Device ID
+ *
+ * @param commandId      - Command id
+ *
+ * @param formatString   - Format of the command e.g json
+ *
+ * @param topic          - Returned topic handle
+ *
+ * @return IOTPRC  - Returns one of the following codes:
+ *                       - IOTPRC_SUCCESS for success
+ *                       - IOTPRC_INVALID_HANDLE - if handle in invalid
+ *
+ */
+DLLExport IOTPRC IoTPApplication_prepareCommandTopic(IoTPApplication *application, char *typeId, char *deviceId, char *commandId, char *formatString, IoTPTopic **topic);
+
+
 /**
  * IoTPApplication_setEventHandler: Sets the Event Callback function. 
  *
@@ -229,6 +429,57 @@ DLLExport IOTPRC IoTPApplication_sendCommand(IoTPApplication *application, char
  */
 DLLExport IOTPRC IoTPApplication_setEventHandler(IoTPApplication *application, IoTPCallbackHandler cb, char *typeId, char *deviceId, char *eventId, char *formatString);
 
+/**
+ * IoTPApplication_setEventMessageHandler: Sets the Event Callback function, that is invoked
+ * with a message descriptor and a user context. Topic and payload of the events are not copied.
+ *
+ * @param application    - A valid application handle
+ *
+ * @param cb             - A Function pointer to the IoTPMessageHandler.
+ *
+ * @param context        - User context passed to the callback.
+ *
+ * @param typeId         - Device type ID
+ *
+ * @param deviceId       - Device ID
+ *
+ * @param eventId        - ID of event.
+ *
+ * @param formatString   - Format of the event e.g json
+ *
+ * @return IOTPRC  - Returns one of the following codes:
+ *                       - IOTPRC_SUCCESS for success
+ *                       - IOTPRC_INVALID_HANDLE if handle is not valid
+ *             
+ */
+DLLExport IOTPRC IoTPApplication_setEventMessageHandler(IoTPApplication *application, IoTPMessageHandler cb, void *context, char *typeId, char *deviceId, char *eventId, char *formatString);
+
+/**
+ * IoTPApplication_setEventBatchHandler: Sets the Event Callback function, that is invoked with
+ * a batch of message descriptors and a user context. Batches are collected by a dispatch worker,
+ * if options.mqtt.batchSize is set, otherwise the callback is invoked with one message at a time.
+ *
+ * @param application    - A valid application handle
+ *
+ * @param cb             - A Function pointer to the IoTPBatchHandler.
+ *
+ * @param context        - User context passed to the callback.
+ *
+ * @param typeId         - Device type ID
+ *
+ * @param deviceId       - Device ID
+ *
+ * @param eventId        - ID of event.
+ *
+ * @param formatString   - Format of the event e.g json
+ *
+ * @return IOTPRC  - Returns one of the following codes:
+ *                       - IOTPRC_SUCCESS for success
+ *                       - IOTPRC_INVALID_HANDLE if handle is not valid
+ *
+ */
+DLLExport IOTPRC IoTPApplication_setEventBatchHandler(IoTPApplication *application, IoTPBatchHandler cb, void *context, char *typeId, char *deviceId, char *eventId, char *formatString);
+
 
 /**
  * IoTPApplication_subscribeToEvents: Subscribe to events
@@ -301,6 +552,32 @@ DLLExport IOTPRC IoTPApplication_unsubscribeFromEvents(IoTPApplication *applicat
 DLLExport IOTPRC IoTPApplication_setCommandHandler(IoTPApplication *application, IoTPCallbackHandler cb, char *typeId, char *deviceId, char *commandId, char *formatString);
 
 
+/**
+ * IoTPApplication_setCommandMessageHandler: Sets the Command Callback function, that is invoked
+ * with a message descriptor and a user context. Topic and payload of the commands are not copied.
+ *
+ * @param application    - A valid application handle
+ *
+ * @param cb             - A Function pointer to the IoTPMessageHandler.
+ *
+ * @param context        - User context passed to the callback.
+ *
+ * @param typeId         - Device type ID
+ *
+ * @param deviceId       - Device ID
+ *
+ * @param commandId      - Command ID
+ *
+ * @param formatString   - Format of the command e.g json
+ *
+ * @return IOTPRC  - Returns one of the following codes:
+ *                       - IOTPRC_SUCCESS for success
+ *                       - IOTPRC_INVALID_HANDLE if handle is not valid
+ *             
+ */
+DLLExport IOTPRC IoTPApplication_setCommandMessageHandler(IoTPApplication *application, IoTPMessageHandler cb, void *context, char *typeId, char *deviceId, char *commandId, char *formatString);
+
+
 /**
  * IoTPApplication_subscribeToCommands: Subscribe to commands
  *
@@ -471,6 +748,155 @@ DLLExport IOTPRC IoTPApplication_unsubscribeFromAppMonitoringMessages(IoTPApplic
  */
 DLLExport IOTPRC IoTPApplication_setEventCallback(IoTPApplication *application, IoTPEventCallbackHandler cb);
 
+/**
+ * The IoTPApplication_setConnectionStateHandler() API sets handler to get notifications on connection
+ * state changes. If connection is lost and automatic reconnect is enabled, client reconnects in
+ * background, and events sent while reconnecting are buffered by MQTT client.
+ *
+ * @param application    - A pointer to IoTP application handle.
+ * @param cb             - A Function pointer to the IoTPConnectionStateHandler. Set to NULL to clear handler.
+ * @param context        - User context passed to the handler
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPApplication_setConnectionStateHandler(IoTPApplication *application, IoTPConnectionStateHandler cb, void *context);
+
+/**
+ * The IoTPApplication_getStats() API returns client statistics, e.g. number of events merged
+ * by event coalescer (options.mqtt.coalesceWindow) and number of batches published.
+ *
+ * @param application    - A pointer to IoTP application handle.
+ * @param stats          - A pointer to IoTPStats, filled in by the API.
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPApplication_getStats(IoTPApplication *application, IoTPStats *stats);
+
+
+/**
+ * IoTPApplicationGroup_create: Creates a group of application clients, that connect with the same
+ *                            application ID using shared subscriptions (client ID A:<orgId>:<appId>).
+ *                            The server distributes messages of a subscription across the connections
+ *                            of the group, and each connection has its own receiving thread.
+ *                            Handlers are shared by the clients of the group - a handler set once is
+ *                            invoked for messages received on any connection.
+ *
+ * @param group          - A pointer to IoTPApplicationGroup handle.
+ *
+ * @param config         - A pointer to IoTPConfig handle. options.mqtt.persistence.path is not supported.
+ *
+ * @param connections    - Number of connections, upto IOTP_MAX_GROUP_CONNECTIONS, or 0 to use the
+ *                         number of online processors.
+ *
+ * @return IOTPRC  - Returns one of the following codes:
+ *                       - IOTPRC_SUCCESS for success
+ *                       - IOTPRC_ARGS_INVALID_VALUE if connections is not valid, or persistent store is configured
+ *                       - IOTPRC_NOMEM if system runs out of memory
+ *
+ * Use IoTPApplicationGroup_destroy() API, to destroy a group created using this API.
+ */
+DLLExport IOTPRC IoTPApplicationGroup_create(IoTPApplicationGroup **group, IoTPConfig *config, int connections);
+
+/**
+ * IoTPApplicationGroup_destroy: Destroys clients of an application group, and the group handle.
+ *
+ * @param group          - A valid group handle
+ *
+ * @return IOTPRC  - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPApplicationGroup_destroy(IoTPApplicationGroup *group);
+
+/**
+ * IoTPApplicationGroup_connect: Connects all clients of an application group.
+ *
+ * @param group          - A valid group handle
+ *
+ * @return IOTPRC  - Returns IOTPRC_SUCCESS if all clients are connected, or error of the first client
+ *                   that failed to connect
+ */
+DLLExport IOTPRC IoTPApplicationGroup_connect(IoTPApplicationGroup *group);
+
+/**
+ * IoTPApplicationGroup_disconnect: Disconnects all clients of an application group.
+ *
+ * @param group          - A valid group handle
+ *
+ * @return IOTPRC  - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPApplicationGroup_disconnect(IoTPApplicationGroup *group);
+
+/**
+ * IoTPApplicationGroup_getApplication: Returns a client of an application group, e.g. to publish
+ *                            commands or get statistics of the connection. The client must not be
+ *                            destroyed using IoTPApplication_destroy().
+ *
+ * @param group          - A valid group handle
+ *
+ * @param index          - Index of the client, from 0 to number of connections - 1
+ *
+ * @param application    - Returned application handle
+ *
+ * @return IOTPRC  - Returns IOTPRC_SUCCESS onsuccess, or IOTPRC_NOT_FOUND if index is not valid
+ */
+DLLExport IOTPRC IoTPApplicationGroup_getApplication(IoTPApplicationGroup *group, int index, IoTPApplication **application);
+
+/**
+ * IoTPApplicationGroup_getConnections: Returns number of connections of an application group.
+ *
+ * @param group          - A valid group handle
+ *
+ * @param connections    - Returned number of connections
+ *
+ * @return IOTPRC  - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPApplicationGroup_getConnections(IoTPApplicationGroup *group, int *connections);
+
+/**
+ * IoTPApplicationGroup_setEventHandler: Sets event handler of the group. See IoTPApplication_setEventHandler().
+ *
+ * @return IOTPRC  - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPApplicationGroup_setEventHandler(IoTPApplicationGroup *group, IoTPCallbackHandler cb, char *typeId, char *deviceId, char *eventId, char *formatString);
+
+/**
+ * IoTPApplicationGroup_setEventMessageHandler: Sets event message handler of the group.
+ *                            See IoTPApplication_setEventMessageHandler().
+ *
+ * @return IOTPRC  - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPApplicationGroup_setEventMessageHandler(IoTPApplicationGroup *group, IoTPMessageHandler cb, void *context, char *typeId, char *deviceId, char *eventId, char *formatString);
+
+/**
+ * IoTPApplicationGroup_setEventBatchHandler: Sets event batch handler of the group.
+ *                            See IoTPApplication_setEventBatchHandler().
+ *
+ * @return IOTPRC  - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPApplicationGroup_setEventBatchHandler(IoTPApplicationGroup *group, IoTPBatchHandler cb, void *context, char *typeId, char *deviceId, char *eventId, char *formatString);
+
+/**
+ * IoTPApplicationGroup_subscribeToEvents: Subscribes to events on all connections of the group.
+ *                            See IoTPApplication_subscribeToEvents().
+ *
+ * @return IOTPRC  - Returns IOTPRC_SUCCESS if all clients are subscribed, or error of the first
+ *                   client that failed to subscribe
+ */
+DLLExport IOTPRC IoTPApplicationGroup_subscribeToEvents(IoTPApplicationGroup *group, char *typeId, char *deviceId, char *eventId, char *formatString);
+
+/**
+ * IoTPApplicationGroup_unsubscribeFromEvents: Unsubscribes from events on all connections of the group.
+ *                            See IoTPApplication_unsubscribeFromEvents().
+ *
+ * @return IOTPRC  - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPApplicationGroup_unsubscribeFromEvents(IoTPApplicationGroup *group, char *typeId, char *deviceId, char *eventId, char *formatString);
+
+/**
+ * IoTPApplicationGroup_setConnectionStateHandler: Sets connection state handler of all clients of the group.
+ *                            See IoTPApplication_setConnectionStateHandler().
+ *
+ * @return IOTPRC  - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPApplicationGroup_setConnectionStateHandler(IoTPApplicationGroup *group, IoTPConnectionStateHandler cb, void *context);
+
 
 
 #if defined(__cplusplus)
@@ -24,38 +24,37 @@
 
 #if defined(WIN32) || defined(WIN64)
 static mutex_type iotp_client_mutex = NULL;
-static mutex_type iotp_managed_mutex = NULL;
 #else
 static pthread_mutex_t iotp_client_mutex_store = PTHREAD_MUTEX_INITIALIZER;
 static mutex_type iotp_client_mutex = &iotp_client_mutex_store;
-static pthread_mutex_t iotp_managed_mutex_store = PTHREAD_MUTEX_INITIALIZER;
-static mutex_type iotp_managed_mutex = &iotp_managed_mutex_store;
 #endif
 static int iotp_mutex_inited = 0;
 
 /*
- * Structure with DM action type and topic mapping 
+ * Topic of DM actions, after the DM action prefix of the client, by IoTP_DMAction_type_t
  */
-static struct {
-    IoTP_DMAction_type_t  type;
-    const char *          topic;
-} dmActionTopics[] = {
-    { 0,                        "NotUsed" },
-    { IoTP_DMResponse,          NULL      },
-    { IoTP_DMUpdate,            NULL      },
-    { IoTP_DMObserve,           NULL      }, 
-    { IoTP_DMCancel,            NULL      },
-    { IoTP_DMFactoryReset,      NULL      },
-    { IoTP_DMReboot,            NULL      },
-    { IoTP_DMFirmwareDownload,  NULL      },
-    { IoTP_DMFirmwareUpdate,    NULL      },
-    { IoTP_DMActions,           NULL      }
+static const char * dmActionTopics[] = {
+    NULL,
+    DM_ACTION_RESPONSE,
+    DM_ACTION_UPDATE,
+    DM_ACTION_OBSERVE,
+    DM_ACTION_CANCEL,
+    DM_ACTION_FACTORYRESET,
+    DM_ACTION_REBOOT,
+    DM_ACTION_FIRMWAREDOWNLOAD,
+    DM_ACTION_FIRMWAREUPDATE,
+    DM_ACTION_ALL
 };
 
-#define numActionTopic  (sizeof(dmActionTopics)/sizeof(dmActionTopics[0]))
-
 static int iotp_client_messageArrived(void *context, char *topicName, int topicLen, MQTTAsync_message * message);
-static int iotp_client_dmMessageArrived(void *context, char *topicName, int topicLen, MQTTAsync_message * message);
+static void iotp_client_dispatchMessages(void *context, IoTPDispatchEntry *entries, int count);
+static void iotp_client_initCoalescer(IoTPClient *client, IoTPConfig *config);
+static void iotp_client_stopCoalescer(IoTPClient *client);
+static void iotp_client_flushCoalescer(IoTPClient *client);
+static void iotp_client_initSubmitQueue(IoTPClient *client, IoTPConfig *config);
+static void iotp_client_stopSubmitQueue(IoTPClient *client);
+static void iotp_client_drainSubmitQueue(IoTPClient *client);
+static void iotp_client_free(IoTPClient *client);
 
 
 /* Initialize mutex - should be done only one time */
@@ -68,7 +67,6 @@ static void iotp_init_mutex(void)
 #if defined(WIN32) || defined(WIN64)
     if ( iotp_client_mutex == NULL ) {
         iotp_client_mutex = CreateMutex(NULL, 0, NULL);
-        iotp_managed_mutex = CreateMutex(NULL, 0, NULL);
         iotp_mutex_inited = 1;
     }
 #else
@@ -77,21 +75,34 @@ static void iotp_init_mutex(void)
     pthread_mutexattr_init(&attr);
     if ((rc = pthread_mutex_init(iotp_client_mutex, &attr)) != 0)
         LOG(ERROR, "Faild to initialize iotp_client_mutex. rc: %d", rc);
-    if ((rc = pthread_mutex_init(iotp_managed_mutex, &attr)) != 0)
-        LOG(ERROR, "Faild to initialize iotp_managed_mutex. rc: %d", rc);
     iotp_mutex_inited = 1;
 #endif
 
 }
 
-/* Initialize DM Action Topics for managed device or managed gateway */
-static IOTPRC iotp_init_dmActionTopics(IoTPClientType type, char *typeId, char *deviceId)
+/* free DM action topics of a managed client */
+static void iotp_free_dmActionTopics(IoTPManagedClient *managedClient)
+{
+    int i = 0;
+    for (i = IoTP_DMResponse; i <= IoTP_DMActions; i++) {
+        iotp_utils_freePtr((void *)managedClient->dmTopics[i]);
+        managedClient->dmTopics[i] = NULL;
+    }
+    iotp_utils_freePtr((void *)managedClient->dmPrefix);
+    managedClient->dmPrefix = NULL;
+}
+
+/*
+ * Initialize DM Action Topics of a managed device or managed gateway, and the prefix of DM topics
+ * published by the client. Topics of a managed gateway are of the gateway device type and ID.
+ */
+static IOTPRC iotp_init_dmActionTopics(IoTPManagedClient *managedClient, IoTPClientType type, char *typeId, char *deviceId)
 {
     IOTPRC rc = IOTPRC_SUCCESS;
-    int prefixLen = 0;
-    int tlen = 0;
+    size_t prefixLen = 0;
+    size_t dmPrefixLen = 0;
     char *prefix = NULL;
-    char *topic = NULL;
+    int i = 0;
 
     if ( type != IoTPClient_managed_device && type != IoTPClient_managed_gateway ) {
         rc = IOTPRC_INVALID_ARGS;
@@ -100,9 +111,8 @@ static IOTPRC iotp_init_dmActionTopics(IoTPClientType type, char *typeId, char *
     }
 
     if ( type == IoTPClient_managed_device ) {
-        prefixLen = strlen(DM_ACTION_DEVICE_PREFIXFMT) + 1;
-        prefix = (char *) malloc(prefixLen);
-        snprintf(prefix, prefixLen, DM_ACTION_DEVICE_PREFIXFMT);
+        prefix = strdup(DM_ACTION_DEVICE_PREFIXFMT);
+        managedClient->dmPrefix = strdup(DM_DEVICE_TOPIC_PREFIXFMT);
     } else {
         if ( typeId == NULL || deviceId == NULL ) {
             rc = IOTPRC_ARGS_NULL_VALUE;
@@ -112,73 +122,80 @@ static IOTPRC iotp_init_dmActionTopics(IoTPClientType type, char *typeId, char *
 
         prefixLen = strlen(DM_ACTION_GATEWAY_PREFIXFMT) + strlen(typeId) + strlen(deviceId) + 1;
         prefix = (char *) malloc(prefixLen);
-        snprintf(prefix, prefixLen, DM_ACTION_GATEWAY_PREFIXFMT, typeId, deviceId);
-    }
-
-    tlen = strlen(DM_ACTION_RESPONSE);
-    topic = (char *) malloc(prefixLen + tlen + 1);
-    snprintf(topic, tlen, "%s%s", prefix, DM_ACTION_RESPONSE);
-    dmActionTopics[IoTP_DMResponse].topic = topic;
-
-    tlen = strlen(DM_ACTION_UPDATE);
-    topic = (char *) malloc(prefixLen + tlen + 1);
-    snprintf(topic, tlen, "%s%s", prefix, DM_ACTION_UPDATE);
-    dmActionTopics[IoTP_DMResponse].topic = topic;
-
-    tlen = strlen(DM_ACTION_OBSERVE);
-    topic = (char *) malloc(prefixLen + tlen + 1);
-    snprintf(topic, tlen, "%s%s", prefix, DM_ACTION_OBSERVE);
-    dmActionTopics[IoTP_DMObserve].topic = topic;
-
-    tlen = strlen(DM_ACTION_CANCEL);
-    topic = (char *) malloc(prefixLen + tlen + 1);
-    snprintf(topic, tlen, "%s%s", prefix, DM_ACTION_CANCEL);
-    dmActionTopics[IoTP_DMCancel].topic = topic;
-
-    tlen = strlen(DM_ACTION_FACTORYRESET);
-    topic = (char *) malloc(prefixLen + tlen + 1);
-    snprintf(topic, tlen, "%s%s", prefix, DM_ACTION_FACTORYRESET);
-    dmActionTopics[IoTP_DMFactoryReset].topic = topic;
-
-    tlen = strlen(DM_ACTION_REBOOT);
-    topic = (char *) malloc(prefixLen + tlen + 1);
-    snprintf(topic, tlen, "%s%s", prefix, DM_ACTION_REBOOT);
-    dmActionTopics[IoTP_DMReboot].topic = topic;
-
-    tlen = strlen(DM_ACTION_FIRMWAREDOWNLOAD);
-    topic = (char *) malloc(prefixLen + tlen + 1);
-    snprintf(topic, tlen, "%s%s", prefix, DM_ACTION_FIRMWAREDOWNLOAD);
-    dmActionTopics[IoTP_DMFirmwareDownload].topic = topic;
-
-    tlen = strlen(DM_ACTION_FIRMWAREUPDATE);
-    topic = (char *) malloc(prefixLen + tlen + 1);
-    snprintf(topic, tlen, "%s%s", prefix, DM_ACTION_FIRMWAREUPDATE);
-    dmActionTopics[IoTP_DMFirmwareUpdate].topic = topic;
-
-    tlen = strlen(DM_ACTION_ALL);
-    topic = (char *) malloc(prefixLen + tlen + 1);
-    snprintf(topic, tlen, "%s%s", prefix, DM_ACTION_ALL);
-    dmActionTopics[IoTP_DMActions].topic = topic;
+        if ( prefix )
+            snprintf(prefix, prefixLen, DM_ACTION_GATEWAY_PREFIXFMT, typeId, deviceId);
+        dmPrefixLen = strlen(DM_GATEWAY_TOPIC_PREFIXFMT) + strlen(typeId) + strlen(deviceId) + 1;
+        managedClient->dmPrefix = (char *) malloc(dmPrefixLen);
+        if ( managedClient->dmPrefix )
+            snprintf(managedClient->dmPrefix, dmPrefixLen, DM_GATEWAY_TOPIC_PREFIXFMT, typeId, deviceId);
+    }
+
+    for (i = IoTP_DMResponse; i <= IoTP_DMActions && prefix && managedClient->dmPrefix; i++) {
+        size_t tlen = strlen(prefix) + strlen(dmActionTopics[i]) + 1;
+        managedClient->dmTopics[i] = (char *) malloc(tlen);
+        if ( managedClient->dmTopics[i] == NULL )
+            break;
+        snprintf(managedClient->dmTopics[i], tlen, "%s%s", prefix, dmActionTopics[i]);
+    }
+    if ( i <= IoTP_DMActions ) {
+        rc = IOTPRC_NOMEM;
+        LOG(ERROR, "Failed to allocate DM action topics. rc: %d", rc);
+        iotp_free_dmActionTopics(managedClient);
+    }
+    iotp_utils_freePtr((void *)prefix);
 
     return rc;
 }
 
-/* free DM action topics */
-static void iotp_free_dmActionTopics(void)
+/* Returns prefix of DM messages published by the client e.g. iotdevice-1/type/<typeId>/id/<deviceId>/ */
+static const char * iotp_client_dmPrefix(IoTPClient *client)
 {
-    int i = 0;
-    for (i=1; i<=IoTP_DMActions; i++) {
-        if ( dmActionTopics[IoTP_DMActions].topic != NULL ) {
-            free((void *)dmActionTopics[IoTP_DMActions].topic);
-            dmActionTopics[IoTP_DMActions].topic = NULL;
-        }
+    if ( client->managedClient && client->managedClient->dmPrefix )
+        return client->managedClient->dmPrefix;
+    return DM_DEVICE_TOPIC_PREFIXFMT;
+}
+
+/* Returns size of buffer of a DM topic published by the client */
+#define iotp_client_dmTopicLen(client, topic)  (strlen(iotp_client_dmPrefix(client)) + strlen(topic) + 1)
+
+/* Returns topic of a DM message published by the client, in buf of size len */
+static char * iotp_client_dmTopic(IoTPClient *client, char *buf, size_t len, const char *topic)
+{
+    snprintf(buf, len, "%s%s", iotp_client_dmPrefix(client), topic);
+    return buf;
+}
+
+/* Frees a managed client */
+static void iotp_client_freeManagedClient(IoTPManagedClient *managedClient)
+{
+    if ( managedClient == NULL ) {
+        return;
     }
+    iotp_free_dmActionTopics(managedClient);
+    pthread_mutex_destroy(&managedClient->lock);
+    iotp_utils_freePtr((void *)managedClient->reqID);
+    iotp_utils_freePtr((void *)managedClient->deviceFirmware.version);
+    iotp_utils_freePtr((void *)managedClient->deviceFirmware.name);
+    iotp_utils_freePtr((void *)managedClient->deviceFirmware.uri);
+    iotp_utils_freePtr((void *)managedClient->deviceFirmware.verifier);
+    iotp_utils_freePtr((void *)managedClient->deviceFirmware.updatedDateTime);
+    free(managedClient);
+}
+
+/* Frees a callback handler */
+static void iotp_free_handler(IoTPHandler * handler)
+{
+    iotp_utils_freePtr((void *)handler->topic);
+    free(handler);
 }
 
-/* Add callback handler to the handler list */
+/* Add callback handler to the handler list. Handler is freed, if it can not be added. */
 static IOTPRC iotp_add_handler(IoTPHandlers * handlers, IoTPHandler * handler) 
 {
     IOTPRC rc = IOTPRC_SUCCESS;
+    int savedId = handlers->id;
+    int savedSlots = handlers->slots;
+    int savedIds[3] = { handlers->allCommandsId, handlers->allDMActionsId, handlers->eventCallback };
     int i = 0;
 
     /* Initialize handlers table */
@@ -188,14 +205,14 @@ static IOTPRC iotp_add_handler(IoTPHandlers * handlers, IoTPHandler * handler)
         handlers->nalloc = handlers->nalloc == 0 ? 8 : handlers->nalloc * 2;
         tmp = realloc(handlers->entries, sizeof(IoTPHandler *) * handlers->nalloc);
         if (tmp == NULL) {
+            handlers->nalloc = firstSlot;
+            iotp_free_handler(handler);
             return IOTPRC_NOMEM;
         }
         handlers->entries = tmp;
         for (i = firstSlot; i < handlers->nalloc; i++)
             handlers->entries[i] = NULL;
         handlers->slots = handlers->count;
-        handlers->allCommandsId = 0;
-        handlers->allDMActionsId = 0;
     }
 
     /* Add handler entry */
@@ -221,38 +238,66 @@ static IOTPRC iotp_add_handler(IoTPHandlers * handlers, IoTPHandler * handler)
         }
     }
 
+    /* Index topic filter of the handler */
+    if ( handler->topic ) {
+        rc = iotp_trie_insert(&handlers->trie, handler->topic, handlers->id + 1);
+        if ( rc != IOTPRC_SUCCESS ) {
+            /* remove the entry, and restore ids of the table */
+            handlers->entries[handlers->id] = NULL;
+            handlers->count--;
+            handlers->slots = savedSlots;
+            handlers->id = savedId;
+            handlers->allCommandsId = savedIds[0];
+            handlers->allDMActionsId = savedIds[1];
+            handlers->eventCallback = savedIds[2];
+            iotp_free_handler(handler);
+        }
+    }
+
     return rc;
 }
 
-/* Find callback handler */
-static IoTPHandler * iotp_client_getHandler(IoTPHandlers * handlers, char * topic, int isEventCallback) {
-    int i = 0;
+/*
+ * Find callback handler. Handlers can be set by other threads, so the handler is copied under
+ * read lock of the handlers. Returns the handler entry, to identify the handler, or NULL.
+ */
+static IoTPHandler * iotp_client_getHandler(IoTPHandlers * handlers, char * topic, int isEventCallback, IoTPHandler * copy) {
     IoTPHandler * handler = NULL;
+
+    pthread_rwlock_rdlock(&handlers->lock);
     /* check for event callback handler */
     if ( isEventCallback == 1 ) {
         if ( handlers->eventCallback != 0 ) {
             handler = handlers->entries[handlers->eventCallback - 1];
         }
-        return handler;
-    }
-    if (topic && strncmp(topic, COMMAND_ROOTTOPIC, COMMAND_ROOTTOPIC_LEN) == 0 && handlers->allCommandsId != 0 ) {
+    } else if (topic && strncmp(topic, COMMAND_ROOTTOPIC, COMMAND_ROOTTOPIC_LEN) == 0 && handlers->allCommandsId != 0 ) {
         handler = handlers->entries[handlers->allCommandsId - 1];
     } else if (topic && strncmp(topic, DM_ACTION_ROOTTOPIC, DM_ACTION_ROOTTOPIC_LEN) == 0 && handlers->allDMActionsId != 0 ) {
         handler = handlers->entries[handlers->allDMActionsId - 1];
     } else {
-        int found = 0;
-        for (i = 0; i < handlers->count; i++) {
-            handler = handlers->entries[i];
-            if (topic && handler->topic && (iotp_match_mqttTopic(topic, handler->topic) == 1)) {
-                found = 1;
-                break;
-            }
-        }
-        if ( found == 0 ) handler = NULL;
+        /* first handler added, with a topic filter matching the topic */
+        int entnum = topic ? iotp_trie_match(&handlers->trie, topic, strlen(topic)) : 0;
+        handler = (entnum > 0) ? handlers->entries[entnum - 1] : NULL;
+    }
+    if ( handler ) {
+        *copy = *handler;
     }
+    pthread_rwlock_unlock(&handlers->lock);
+
     return handler;
 }
 
+/* Returns number of handlers, or of batch handlers if batch is set */
+static int iotp_client_countHandlers(IoTPHandlers * handlers, int batch) {
+    int count = 0;
+
+    pthread_rwlock_rdlock(&handlers->lock);
+    count = batch ? handlers->batchHandlers : handlers->count;
+    pthread_rwlock_unlock(&handlers->lock);
+
+    return count;
+}
+
 /* Returns handler type string */
 static char * iotp_client_getHandlerTypeStr(IoTP_Handler_type_t type)
 {
@@ -410,7 +455,7 @@ static IOTPRC iotp_validate_config(int type, IoTPConfig *config)
     }
         
     /* Validate application related config items */
-    if ( type == IoTPClient_application ) {
+    if ( type == IoTPClient_application || type == IoTPClient_Application ) {
         /* appiId, authToken and API key can not be empty */
         if (config->identity->appId == NULL || ( config->identity->appId && *config->identity->appId == '\0')) {
             rc = IOTPRC_PARAM_NULL_VALUE;
@@ -435,16 +480,91 @@ static IOTPRC iotp_validate_config(int type, IoTPConfig *config)
     return rc;
 }
 
+/* Updates connection state of a client, and invokes state handler if state is changed */
+static void iotp_client_setState(IoTPClient *client, IoTPConnectionState state, char *reason)
+{
+    IoTPConnectionStateHandler cb = NULL;
+    void *cbContext = NULL;
+
+    Thread_lock_mutex(iotp_client_mutex);
+    if ( client->state != state ) {
+        __atomic_store_n(&client->state, state, __ATOMIC_RELEASE);
+        cb = client->stateCB;
+        cbContext = client->stateContext;
+    }
+    Thread_unlock_mutex(iotp_client_mutex);
+
+    if ( cb != NULL ) {
+        (*cb)(client->clientId, state, reason, cbContext);
+    }
+}
+
+/*
+ * Returns 1 if publish requests can be accepted, i.e. client is connected, or connection is
+ * lost and client is reconnecting in background. Called without lock from publishing threads.
+ */
+static int iotp_client_canPublish(IoTPClient *client)
+{
+    return (__atomic_load_n(&client->connected, __ATOMIC_ACQUIRE) == 1 ||
+            __atomic_load_n(&client->state, __ATOMIC_ACQUIRE) == IoTPConnection_Reconnecting);
+}
+
 /* Callback function to process successful connection */
 void onConnect(void *context, MQTTAsync_successData5 *response)
 {
     char *clientId = NULL;
     IoTPClient *client = (IoTPClient *)context;
+    int serverMaxAliases = 0;
+    /* Topic aliases are valid for the new connection, upto the maximum returned by the server */
+    if ( response && MQTTProperties_hasProperty(&response->properties, MQTTPROPERTY_CODE_TOPIC_ALIAS_MAXIMUM) ) {
+        serverMaxAliases = MQTTProperties_getNumericValue(&response->properties, MQTTPROPERTY_CODE_TOPIC_ALIAS_MAXIMUM);
+    }
+    iotp_alias_reset(&client->aliases, serverMaxAliases);
     Thread_lock_mutex(iotp_client_mutex);
-    client->connected = 1;
+    __atomic_store_n(&client->connected, 1, __ATOMIC_RELEASE);
     clientId = client->clientId;
     LOG(INFO, "Client is connected. clientId: %s", clientId? clientId:"NULL");
     Thread_unlock_mutex(iotp_client_mutex);
+    iotp_client_setState(client, IoTPConnection_Connected, NULL);
+}
+
+/* Callback function to process connection established by MQTT client, including automatic reconnect */
+static void iotp_client_connected(void *context, char *cause)
+{
+    char *clientId = NULL;
+    IoTPClient *client = (IoTPClient *)context;
+    /* Aliases of previous connection are not valid. Automatic reconnect keeps negotiated maximum. */
+    iotp_alias_reset(&client->aliases, -1);
+    Thread_lock_mutex(iotp_client_mutex);
+    __atomic_store_n(&client->connected, 1, __ATOMIC_RELEASE);
+    clientId = client->clientId;
+    LOG(INFO, "Client is connected. clientId: %s | cause: %s", clientId? clientId:"NULL", cause? cause:"");
+    Thread_unlock_mutex(iotp_client_mutex);
+    iotp_client_setState(client, IoTPConnection_Connected, cause);
+}
+
+/* Callback function to process connection lost. MQTT client reconnects in background, if automatic reconnect is set */
+static void iotp_client_connectionLost(void *context, char *cause)
+{
+    char *clientId = NULL;
+    IoTPClient *client = (IoTPClient *)context;
+    IoTPConfig *config = (IoTPConfig *)client->config;
+    Thread_lock_mutex(iotp_client_mutex);
+    __atomic_store_n(&client->connected, 0, __ATOMIC_RELEASE);
+    clientId = client->clientId;
+    LOG(WARN, "Connection is lost. clientId: %s | cause: %s", clientId? clientId:"NULL", cause? cause:"");
+    Thread_unlock_mutex(iotp_client_mutex);
+    iotp_alias_reset(&client->aliases, -1);
+    /* subscribe to command responses again with next request, if session is not resumed */
+    pthread_mutex_lock(&client->requests.lock);
+    client->requests.subscribed = IOTP_RPC_UNSUBSCRIBED;
+    pthread_cond_broadcast(&client->requests.subscribeCond);
+    pthread_mutex_unlock(&client->requests.lock);
+    if ( config && config->automaticReconnect == 1 ) {
+        iotp_client_setState(client, IoTPConnection_Reconnecting, cause);
+    } else {
+        iotp_client_setState(client, IoTPConnection_Disconnected, cause);
+    }
 }
 
 /* Callback function to process connection failure */
@@ -471,10 +591,11 @@ void onDisconnect(void *context, MQTTAsync_successData5 *response)
     char *clientId = NULL;
     IoTPClient *client = (IoTPClient *)context;
     Thread_lock_mutex(iotp_client_mutex);
-    client->connected = 0;
+    __atomic_store_n(&client->connected, 0, __ATOMIC_RELEASE);
     clientId = client->clientId;
     LOG(INFO, "Client is disconnected. clientId: %s", clientId? clientId:"NULL");
     Thread_unlock_mutex(iotp_client_mutex);
+    iotp_client_setState(client, IoTPConnection_Disconnected, NULL);
 }
 
 /* Callback function to process disconnection failure */
@@ -495,6 +616,18 @@ void onDisconnectFailure(void* context, MQTTAsync_failureData5 *response)
     Thread_unlock_mutex(iotp_client_mutex);
 }
 
+/* Invokes event callback handler, if set, with the status of a publish request */
+static void iotp_client_eventCallback(IoTPClient *client, int rc, void *success, void *failure)
+{
+    IoTPHandler sub;
+    if ( iotp_client_getHandler(client->handlers, NULL, 1, &sub) != NULL ) {
+        IoTPEventCallbackHandler cb = (IoTPEventCallbackHandler)sub.cbFunc;
+        if ( cb != NULL ) {
+            (*cb)(client->clientId, rc, success, failure);
+        }
+    }
+}
+
 /* Callback function to process successful send */
 void onSend(void *context, MQTTAsync_successData5 *response)
 {
@@ -502,14 +635,7 @@ void onSend(void *context, MQTTAsync_successData5 *response)
     char *clientId = client->clientId;
     LOG(DEBUG, "Event is sent. clientId: %s", clientId? clientId:"NULL");
     /* Check if callback is set */
-    IoTPHandler * sub = iotp_client_getHandler(client->handlers, NULL, 1);
-    if ( sub != NULL ) {
-        IoTPEventCallbackHandler cb = (IoTPEventCallbackHandler)sub->cbFunc;
-        if ( cb != NULL ) {
-            int rc = IOTPRC_SUCCESS;
-            (*cb)(clientId, rc, (void *)response, NULL);
-        }
-    }
+    iotp_client_eventCallback(client, IOTPRC_SUCCESS, (void *)response, NULL);
 }
 
 /* Callback function to process send failure */
@@ -523,14 +649,252 @@ void onSendFailure(void *context, MQTTAsync_failureData5 *response)
         LOG(WARN, "Failed to send event. clientId: %s | rc: | respmsg: ", clientId? clientId:"NULL");
     }
     /* Check if callback is set */
-    IoTPHandler * sub = iotp_client_getHandler(client->handlers, NULL, 1);
-    if ( sub != NULL ) {
-        IoTPEventCallbackHandler cb = (IoTPEventCallbackHandler)sub->cbFunc;
-        if ( cb != NULL ) {
-            int rc = IOTPRC_FAILURE;
-            (*cb)(clientId, rc, NULL, (void *)response);
+    iotp_client_eventCallback(client, IOTPRC_FAILURE, NULL, (void *)response);
+}
+
+/* Initializes an outbound in-flight window */
+static void iotp_client_initLaneWindow(IoTPWindow *window, int maxInflight, size_t maxBytes, int timeout)
+{
+    window->maxInflight = maxInflight;
+    window->maxBytes = maxBytes;
+    window->timeout = timeout;
+    window->enabled = (window->maxInflight > 0 || window->maxBytes > 0);
+    if ( window->enabled ) {
+        pthread_mutex_init(&window->lock, NULL);
+        iotp_utils_initCond(&window->cond);
+    }
+}
+
+/*
+ * Initializes outbound in-flight windows of bulk and control lanes of a client from configuration.
+ * Bulk lane of a managed client is always bounded, so that device management messages are sent
+ * ahead of buffered events.
+ */
+static void iotp_client_initWindow(IoTPClient *client, IoTPConfig *config)
+{
+    int maxInflight = config->mqttopts->maxInflight;
+
+    if ( maxInflight <= 0 && (client->type == IoTPClient_managed_device || client->type == IoTPClient_managed_gateway) )
+        maxInflight = IOTP_MANAGED_MAX_INFLIGHT;
+    iotp_client_initLaneWindow(&client->window, maxInflight,
+        (size_t)config->mqttopts->maxBufferedBytes, config->mqttopts->publishTimeout);
+    iotp_client_initLaneWindow(&client->controlWindow, config->mqttopts->controlMaxInflight,
+        0, config->mqttopts->publishTimeout);
+}
+
+/*
+ * Returns lane of a publish topic. Device management messages (iotdevice-1/...) are
+ * published in control lane, events and commands (iot-2/...) in bulk lane.
+ */
+static IoTPLane iotp_client_getLane(const char *topic)
+{
+    if ( topic && strncmp(topic, "iot-2/", 6) ) {
+        return IoTPLane_control;
+    }
+    return IoTPLane_bulk;
+}
+
+/*
+ * Returns number of MQTT client in-flight slots reserved for control lane, in addition to
+ * bulk lane window. The MQTT client sends messages in submit order, so a control message is
+ * sent after at most the bulk lane window of bulk messages, and the reserved slots let it be
+ * sent without waiting for their acknowledgements.
+ */
+static int iotp_client_controlReserve(IoTPClient *client)
+{
+    if ( client->controlWindow.maxInflight > 0 ) {
+        return client->controlWindow.maxInflight;
+    }
+    return 16;
+}
+
+/* Returns statistics of a lane */
+static IoTPLaneStats * iotp_client_laneStats(IoTPClient *client, IoTPLane lane)
+{
+    return (lane == IoTPLane_control) ? &client->stats.control : &client->stats.bulk;
+}
+
+/* Updates lane statistics of publish requests submitted to MQTT client */
+static void iotp_client_laneSubmitted(IoTPClient *client, IoTPLane lane, int count)
+{
+    IoTPLaneStats *stats = iotp_client_laneStats(client, lane);
+    uint64_t depth = __atomic_add_fetch(&stats->depth, count, __ATOMIC_RELAXED);
+    uint64_t maxDepth = __atomic_load_n(&stats->maxDepth, __ATOMIC_RELAXED);
+
+    while ( depth > maxDepth &&
+            !__atomic_compare_exchange_n(&stats->maxDepth, &maxDepth, depth, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+        ;
+}
+
+/* Updates lane statistics of a completed publish request */
+static void iotp_client_laneCompleted(IoTPClient *client, IoTPLane lane, uint64_t submitTime, int success)
+{
+    IoTPLaneStats *stats = iotp_client_laneStats(client, lane);
+    uint64_t now = iotp_utils_timeMicros();
+    uint64_t latency = (now > submitTime) ? now - submitTime : 0;
+    uint64_t maxLatency = __atomic_load_n(&stats->maxLatency, __ATOMIC_RELAXED);
+
+    __atomic_sub_fetch(&stats->depth, 1, __ATOMIC_RELAXED);
+    if ( success ) {
+        __atomic_add_fetch(&stats->published, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_add_fetch(&stats->failed, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_add_fetch(&stats->totalLatency, latency, __ATOMIC_RELAXED);
+    while ( latency > maxLatency &&
+            !__atomic_compare_exchange_n(&stats->maxLatency, &maxLatency, latency, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+        ;
+}
+
+/* 
+ * Reserves space for publish requests in the outbound in-flight window.
+ * If window is full, waits for publish requests to complete for upto publishTimeout
+ * milliseconds. Request is always accepted if window is empty, so that a request
+ * larger than the window can be sent.
+ */
+static IOTPRC iotp_client_acquireWindow(IoTPClient *client, IoTPLane lane, int count, size_t bytes)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+    IoTPWindow *window = (lane == IoTPLane_control) ? &client->controlWindow : &client->window;
+    struct timespec deadline;
+    int waiting = 0;
+
+
+    if ( window->enabled == 0 )
+        return rc;
+
+    pthread_mutex_lock(&window->lock);
+    while ( window->inflight > 0 &&
+            ((window->maxInflight > 0 && window->inflight + count > window->maxInflight) ||
+             (window->maxBytes > 0 && window->bytes + bytes > window->maxBytes)) ) {
+        if ( window->timeout <= 0 ) {
+            rc = IOTPRC_WOULDBLOCK;
+            break;
+        }
+        if ( waiting == 0 ) {
+            iotp_utils_deadline(iotp_utils_timeMicros() + (uint64_t)window->timeout * 1000, &deadline);
+            waiting = 1;
+        }
+        if ( pthread_cond_timedwait(&window->cond, &window->lock, &deadline) == ETIMEDOUT ) {
+            rc = IOTPRC_WOULDBLOCK;
+            break;
         }
     }
+    if ( rc == IOTPRC_SUCCESS ) {
+        window->inflight += count;
+        window->bytes += bytes;
+    }
+    pthread_mutex_unlock(&window->lock);
+
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(DEBUG, "In-flight window is full. clientId: %s | inflight: %d | bytes: %lu", client->clientId, window->inflight, (unsigned long)window->bytes);
+    }
+
+    return rc;
+}
+
+/* Acquires tokens of rate limiter for publish requests, and updates statistics */
+static IOTPRC iotp_client_acquireRate(IoTPClient *client, const char *topic, int count)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+    int delayed = 0;
+
+    if ( client->limiter.enabled == 0 )
+        return rc;
+
+    rc = iotp_ratelimit_acquire(&client->limiter, topic, count, &delayed);
+    if ( rc != IOTPRC_SUCCESS ) {
+        __atomic_add_fetch(&client->stats.publishesRejected, count, __ATOMIC_RELAXED);
+        LOG(DEBUG, "Publish rate limit is exceeded. clientId: %s | topic: %s | count: %d", client->clientId, topic? topic:"", count);
+    } else if ( delayed ) {
+        __atomic_add_fetch(&client->stats.publishesDelayed, count, __ATOMIC_RELAXED);
+    }
+
+    return rc;
+}
+
+/* Waits for publish rate limit of client and of the devices of a batch of topics */
+static IOTPRC iotp_client_acquireTopicsRate(IoTPClient *client, char **topics, int count)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+    int delayed = 0;
+
+    if ( client->limiter.enabled == 0 )
+        return rc;
+
+    rc = iotp_ratelimit_acquireTopics(&client->limiter, topics, count, &delayed);
+    if ( rc != IOTPRC_SUCCESS ) {
+        __atomic_add_fetch(&client->stats.publishesRejected, count, __ATOMIC_RELAXED);
+        LOG(DEBUG, "Publish rate limit is exceeded. clientId: %s | count: %d | rc: %d", client->clientId, count, rc);
+    } else if ( delayed ) {
+        __atomic_add_fetch(&client->stats.publishesDelayed, count, __ATOMIC_RELAXED);
+    }
+
+    return rc;
+}
+
+/* Releases space of completed publish requests in the outbound in-flight window */
+static void iotp_client_releaseWindow(IoTPClient *client, IoTPLane lane, int count, size_t bytes)
+{
+    IoTPWindow *window = (lane == IoTPLane_control) ? &client->controlWindow : &client->window;
+
+    if ( window->enabled == 0 || count == 0 )
+        return;
+
+    pthread_mutex_lock(&window->lock);
+    window->inflight -= count;
+    window->bytes -= bytes;
+    pthread_cond_broadcast(&window->cond);
+    pthread_mutex_unlock(&window->lock);
+}
+
+/* Returns user buffer of a completed publish request, and frees request context */
+static void iotp_client_releasePublishContext(IoTPPublishContext *pubctx)
+{
+    iotp_client_releaseWindow(pubctx->client, pubctx->lane, 1, pubctx->payloadlen);
+    if ( pubctx->releaseCB != NULL ) {
+        (*pubctx->releaseCB)(pubctx->payload, pubctx->payloadlen, pubctx->releaseContext);
+    }
+    free(pubctx);
+}
+
+/* Invokes delivery callback of a publish request, if set, with the status of the request */
+static void iotp_client_deliveryCallback(IoTPPublishContext *pubctx, int token, int rc, int reasonCode)
+{
+    if ( pubctx->deliveryCB != NULL ) {
+        IoTPDeliveryInfo info;
+        info.token = token;
+        info.rc = rc;
+        info.reasonCode = reasonCode;
+        info.submitTime = pubctx->submitTime;
+        info.ackTime = iotp_utils_timeMicros();
+        (*pubctx->deliveryCB)(&info, pubctx->deliveryContext);
+    }
+}
+
+/* Callback function to process successful send of a tracked publish request */
+void onSendBuffer(void *context, MQTTAsync_successData5 *response)
+{
+    IoTPPublishContext *pubctx = (IoTPPublishContext *)context;
+    /* event rejected by the server is not received by subscribers, next event of the stream is sent in full */
+    if ( response && response->reasonCode >= MQTTREASONCODE_UNSPECIFIED_ERROR )
+        iotp_delta_invalidate(&pubctx->client->delta, pubctx->deltaTopic);
+    onSend(pubctx->client, response);
+    iotp_client_laneCompleted(pubctx->client, pubctx->lane, pubctx->submitTime, 1);
+    iotp_client_deliveryCallback(pubctx, response? response->token:0, IOTPRC_SUCCESS, response? response->reasonCode:0);
+    iotp_client_releasePublishContext(pubctx);
+}
+
+/* Callback function to process send failure of a tracked publish request */
+void onSendBufferFailure(void *context, MQTTAsync_failureData5 *response)
+{
+    IoTPPublishContext *pubctx = (IoTPPublishContext *)context;
+    iotp_delta_invalidate(&pubctx->client->delta, pubctx->deltaTopic);
+    onSendFailure(pubctx->client, response);
+    iotp_client_laneCompleted(pubctx->client, pubctx->lane, pubctx->submitTime, 0);
+    int rc = (response && response->code != 0)? response->code : IOTPRC_FAILURE;
+    iotp_client_deliveryCallback(pubctx, response? response->token:0, rc, response? response->reasonCode:0);
+    iotp_client_releasePublishContext(pubctx);
 }
 
 /* Callback function to process successful subscription */
@@ -650,6 +1014,13 @@ IOTPRC iotp_client_create(void **iotpClient, IoTPConfig *config, IoTPClientType
     LOG(INFO, "Create client. clientId: %s | connectionURI: %s | port: %d", clientId, connectionURI, port );
 
     IoTPClient *client = (IoTPClient *)calloc(1, sizeof(IoTPClient));
+    if ( client == NULL ) {
+        rc = IOTPRC_NOMEM;
+        LOG(ERROR, "Failed to allocate client. rc: %d", rc);
+        iotp_utils_freePtr((void *)clientId);
+        iotp_utils_freePtr((void *)connectionURI);
+        return rc;
+    }
     client->type = type;
     client->config = (void *)config;
     client->clientId = clientId;
@@ -658,10 +1029,30 @@ IOTPRC iotp_client_create(void **iotpClient, IoTPConfig *config, IoTPClientType
     client->handlers = (IoTPHandlers *) calloc(1, sizeof(IoTPHandlers));
     client->managed = 0;
     client->managedClient = NULL;
+    if ( client->handlers == NULL ) {
+        rc = IOTPRC_NOMEM;
+        LOG(ERROR, "Failed to allocate handlers. rc: %d", rc);
+        iotp_client_free(client);
+        return rc;
+    }
+    pthread_rwlock_init(&client->handlers->lock, NULL);
 
     /* Set Managed client fields */
     if ( type == IoTPClient_managed_device  || type == IoTPClient_managed_gateway ) {
         client->managedClient = (IoTPManagedClient *)calloc(1, sizeof(IoTPManagedClient));
+        if ( client->managedClient == NULL ) {
+            rc = IOTPRC_NOMEM;
+            LOG(ERROR, "Failed to allocate managed client. rc: %d", rc);
+            iotp_client_free(client);
+            return rc;
+        }
+        pthread_mutex_init(&client->managedClient->lock, NULL);
+        rc = iotp_init_dmActionTopics(client->managedClient, type, iotp_client_getDeviceType(client), iotp_client_getDeviceId(client));
+        if ( rc != IOTPRC_SUCCESS ) {
+            LOG(ERROR, "Failed to set device management topics. rc: %d", rc);
+            iotp_client_free(client);
+            return rc;
+        }
     }
 
     /* create MQTT Async client handle */
@@ -672,10 +1063,72 @@ IOTPRC iotp_client_create(void **iotpClient, IoTPConfig *config, IoTPClientType
     create_opts.MQTTVersion = MQTTVERSION_5;
     create_opts.sendWhileDisconnected = 1;
 
-    rc = MQTTAsync_createWithOptions(&mqttClient, client->connectionURI, client->clientId, MQTTCLIENT_PERSISTENCE_NONE, NULL, &create_opts);
+    /* Bound outbound window */
+    iotp_client_initWindow(client, config);
+    if ( client->window.maxInflight > 0 ) {
+        create_opts.maxBufferedMessages = client->window.maxInflight + iotp_client_controlReserve(client);
+    }
+
+    /* Limit publish rate of client and devices */
+    iotp_ratelimit_init(&client->limiter, config->mqttopts->rateLimit, config->mqttopts->rateBurst,
+        config->mqttopts->deviceRateLimit, config->mqttopts->rateLimitTimeout);
+
+    /*
+     * Use topic aliases for repeated publish topics. QoS1/QoS2 messages carry the topic, if they may be
+     * resent on a new connection, from persistent session or store, after the aliases are reset.
+     */
+    iotp_alias_init(&client->aliases, config->mqttopts->topicAliasMaximum,
+        (config->mqttopts->persistencePath != NULL ||
+         (port != 1883 && (config->mqttopts->cleanStart == 0 || config->mqttopts->sessionExpiry > 0))));
+
+    /* Publish changed fields of events, with full state every heartbeat interval */
+    iotp_delta_init(&client->delta, config->mqttopts->deltaHeartbeat, config->mqttopts->deltaDeadband);
+
+    /* Encode JSON payload of events and commands in CBOR format, and decode received CBOR payload */
+    client->cborTranscode = config->mqttopts->cborTranscode;
+
+    /* Coalesce events published within a time window */
+    iotp_client_initCoalescer(client, config);
+
+    /* Submit events from publishing threads through lock-free queue */
+    iotp_client_initSubmitQueue(client, config);
+
+    /* Table of command requests waiting for a response */
+    iotp_rpc_init(&client->requests);
+
+    /* Invoke callbacks of received messages on dispatch workers - a bounded inbound queue and batches need a worker */
+    int workers = config->mqttopts->dispatchWorkers;
+    if ( workers == 0 && (config->mqttopts->inboundQueueSize > 0 || config->mqttopts->batchSize > 1) )
+        workers = 1;
+    rc = iotp_dispatch_init(&client->dispatcher, workers, config->mqttopts->inboundQueueSize,
+             (IoTPInboundOverflow)config->mqttopts->inboundOverflow, config->mqttopts->batchSize,
+             config->mqttopts->batchWait, iotp_client_dispatchMessages, client);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to start dispatch workers. Callbacks are invoked by MQTT client thread. rc: %d", rc);
+        rc = IOTPRC_SUCCESS;
+    } else if ( client->dispatcher.enabled ) {
+        LOG(INFO, "Dispatch workers are started. workers: %d | inboundQueueSize: %d | inboundOverflow: %s | batchSize: %d", client->dispatcher.count,
+            client->dispatcher.maxQueued, iotp_dispatch_overflowName((IoTPInboundOverflow)client->dispatcher.overflow), client->dispatcher.batchSize);
+    }
+
+    /* Persistent store of QoS1/QoS2 messages, to retain messages across restarts */
+    int persistenceType = MQTTCLIENT_PERSISTENCE_NONE;
+    void *persistenceContext = NULL;
+    if ( config->mqttopts->persistencePath != NULL ) {
+        rc = iotp_persist_init(&client->persistence, config->mqttopts->persistencePath, (size_t)config->mqttopts->persistenceMaxBytes, config->mqttopts->persistenceSync);
+        if ( rc != IOTPRC_SUCCESS ) {
+            iotp_client_free(client);
+            return rc;
+        }
+        persistenceType = MQTTCLIENT_PERSISTENCE_USER;
+        persistenceContext = &client->persistence;
+        create_opts.persistQoS0 = 0;
+    }
+
+    rc = MQTTAsync_createWithOptions(&mqttClient, client->connectionURI, client->clientId, persistenceType, persistenceContext, &create_opts);
     if ( rc != MQTTASYNC_SUCCESS ) {
         LOG(ERROR, "MQTTAsync_createWithOptions failed. clientType: %d |  clientId: %s |  connectionURI: %s", client->type, client->clientId, client->connectionURI);
-        iotp_client_destroy(client);
+        iotp_client_free(client);
         client = NULL;
         return rc;
     }
@@ -773,51 +1226,114 @@ IOTPRC iotp_client_setMQTTLogHandler(void *iotpClient, IoTPLogHandler *cb)
 }
  
 
-/* Destroy IoTP Async client */
-IOTPRC iotp_client_destroy(void *iotpClient)
+/* Frees callback handlers */
+static void iotp_client_freeHandlers(IoTPHandlers *handlers)
 {
-    IOTPRC rc = IOTPRC_SUCCESS;
-    IoTPClient *client = (IoTPClient *)iotpClient;
-    IoTPHandlers *handlers = NULL;
     int i = 0;
 
-    /* Check if client handle is valid */
-    if ( client == NULL || (client && client->mqttClient == NULL)) {
-        rc = IOTPRC_INVALID_HANDLE;
-        LOG(ERROR, "Invalid or NULL client handle or configuration");
-        return rc;
-    } 
+    if ( handlers == NULL ) {
+        return;
+    }
+    for (i=0; i<handlers->slots; i++)
+    {
+        IoTPHandler * sub = handlers->entries[i];
+        if ( sub ) {
+            iotp_utils_freePtr((void *)sub->topic);
+            iotp_utils_freePtr((void *)sub);
+        }
+    }
+
+    iotp_trie_free(&handlers->trie);
+    iotp_utils_freePtr((void *)handlers->entries);
+    pthread_rwlock_destroy(&handlers->lock);
+    iotp_utils_freePtr((void *)handlers);
+}
+
+/*
+ * Frees IoTP Async client. Threads of the client are stopped before MQTT client is destroyed,
+ * and resources used by callbacks are freed after MQTT client is destroyed. Also used to clean up
+ * a partially created client, when MQTT client is not yet created.
+ */
+static void iotp_client_free(IoTPClient *client)
+{
+    /* stop coalescer - events not yet published are discarded */
+    iotp_client_stopCoalescer(client);
+
+    /* stop sender thread - requests not yet submitted are discarded */
+    iotp_client_stopSubmitQueue(client);
+
+    /* stop dispatch workers - after queued messages are processed */
+    iotp_dispatch_stop(&client->dispatcher);
+
+    /* complete pending command requests - after dispatch workers, that complete requests with responses */
+    iotp_rpc_stop(&client->requests);
+
+    /* destroy MQTT client - also closes persistent store */
+    if ( client->mqttClient ) {
+        MQTTAsync mqttClient = (MQTTAsync)client->mqttClient;
+        MQTTAsync_destroy(&mqttClient);
+        client->mqttClient = NULL;
+    }
+
+    /* handlers shared in a group are freed with the client that owns them */
+    if ( client->sharedHandlers == 0 )
+        iotp_client_freeHandlers(client->handlers);
+    client->handlers = NULL;
 
     iotp_utils_freePtr((void *)client->clientId);
     iotp_utils_freePtr((void *)client->connectionURI);
-    handlers = client->handlers;
+    iotp_client_freeManagedClient(client->managedClient);
+    client->managedClient = NULL;
 
-    for (i=0; i<handlers->count; i++)
-    {
-        IoTPHandler * sub = handlers->entries[i];
-        iotp_utils_freePtr((void *)sub->topic);
+    iotp_ratelimit_free(&client->limiter);
+    iotp_alias_free(&client->aliases);
+    iotp_delta_free(&client->delta);
+
+    if ( client->window.enabled ) {
+        pthread_cond_destroy(&client->window.cond);
+        pthread_mutex_destroy(&client->window.lock);
+    }
+    if ( client->controlWindow.enabled ) {
+        pthread_cond_destroy(&client->controlWindow.cond);
+        pthread_mutex_destroy(&client->controlWindow.lock);
     }
 
-    iotp_utils_freePtr((void *)handlers);
+    iotp_persist_free(&client->persistence);
 
     /* set client config to NULL - so that config object is not affected */
     client->config = NULL;
     iotp_utils_freePtr((void *)client);
-    client = NULL;
-
-    return rc;
 }
 
-/* Connect MQTT Async client */
-IOTPRC iotp_client_connect(void *iotpClient)
+/* Destroy IoTP Async client */
+IOTPRC iotp_client_destroy(void *iotpClient)
 {
     IOTPRC rc = IOTPRC_SUCCESS;
     IoTPClient *client = (IoTPClient *)iotpClient;
 
-    /* Sanity check */
+    /* Check if client handle is valid */
     if ( client == NULL || (client && client->mqttClient == NULL)) {
         rc = IOTPRC_INVALID_HANDLE;
-        LOG(ERROR, "Invalid client handle");
+        LOG(ERROR, "Invalid or NULL client handle or configuration");
+        return rc;
+    } 
+
+    iotp_client_free(client);
+    client = NULL;
+
+    return rc;
+}
+
+/* Connect MQTT Async client */
+IOTPRC iotp_client_connect(void *iotpClient)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+    IoTPClient *client = (IoTPClient *)iotpClient;
+
+    /* Sanity check */
+    if ( client == NULL || (client && client->mqttClient == NULL)) {
+        rc = IOTPRC_INVALID_HANDLE;
+        LOG(ERROR, "Invalid client handle");
         return rc;
     }
 
@@ -836,96 +1352,1336 @@ IOTPRC iotp_client_connect(void *iotpClient)
     /* MQTTAsync_disconnectOptions disc_opts = MQTTAsync_disconnectOptions_initializer; */
     /* MQTTAsync_willOptions       will_opts = MQTTAsync_willOptions_initializer; */
 
-    int port = config->mqttopts->port;
+    int port = config->mqttopts->port;
+
+    /* set connection options */
+    conn_opts.keepAliveInterval = config->mqttopts->keepalive;
+    conn_opts.onSuccess5 = onConnect;
+    conn_opts.onFailure5 = onConnectFailure;
+    conn_opts.MQTTVersion = MQTTVERSION_5;
+    conn_opts.context = client;
+    conn_opts.automaticReconnect = config->automaticReconnect;
+    if ( client->window.maxInflight > 0 ) {
+        conn_opts.maxInflight = client->window.maxInflight + iotp_client_controlReserve(client);
+    }
+    if ( port == 1883 ) {
+        conn_opts.cleanstart = 1;
+        conn_opts.cleansession = 0;
+    } else {
+        conn_opts.cleanstart = config->mqttopts->cleanStart;
+        conn_opts.cleansession = 0;
+        if ( config->mqttopts->sessionExpiry > 0 ) {
+            property.identifier = MQTTPROPERTY_CODE_SESSION_EXPIRY_INTERVAL;
+            property.value.integer4 = config->mqttopts->sessionExpiry;
+            MQTTProperties_add(&props, &property);
+            conn_opts.connectProperties = &props;
+        }
+    }
+
+    /* set authentication credentials */
+    ssl_opts.enableServerCertAuth = 0;
+
+    if ( port == 8883 || port == 443 ) {
+        /* set ssl */
+        conn_opts.ssl = &ssl_opts;
+
+        if ( client->type == IoTPClient_application || client->type == IoTPClient_Application ) {
+            conn_opts.username = config->auth->key;
+            conn_opts.password = config->auth->token;
+            LOG(DEBUG, "key: %s | token: %s", config->auth->key, config->auth->token);
+        } else if ( client->type == IoTPClient_device || client->type == IoTPClient_managed_device ||
+            client->type == IoTPClient_gateway || client->type == IoTPClient_managed_gateway ) {
+            if ( config->auth->token ) {
+                conn_opts.username = "use-token-auth";
+                conn_opts.password = config->auth->token;
+                LOG(DEBUG, "key: %s | token: %s", config->auth->key, config->auth->token);
+            }
+            if ( config->auth->keyStore ) {
+                conn_opts.ssl->enableServerCertAuth = 1;
+                conn_opts.ssl->trustStore = config->mqttopts->caFile;
+                conn_opts.ssl->keyStore = config->auth->keyStore;
+                conn_opts.ssl->privateKey = config->auth->privateKey;
+                conn_opts.ssl->privateKeyPassword = config->auth->privateKeyPassword;
+            }
+        }
+    }
+    
+    /* Set callbacks */
+    MQTTAsync_setCallbacks((MQTTAsync *)client->mqttClient, (void *)client, iotp_client_connectionLost, iotp_client_messageArrived, NULL);
+    MQTTAsync_setConnected((MQTTAsync *)client->mqttClient, (void *)client, iotp_client_connected);
+    
+    /* Invoke MQTTAsync_connect */
+    LOG(INFO, "MQTTAsync_connect. clientId=%s | connectionURI=%s", client->clientId, client->connectionURI);
+    rc = MQTTAsync_connect((MQTTAsync *)client->mqttClient, &conn_opts);
+    /* connect properties are copied by MQTT client, also for automatic reconnect */
+    MQTTProperties_free(&props);
+    if ( rc == MQTTASYNC_SUCCESS ) {
+        int cycle = 0;
+        int isConnected = 0;
+        while ( isConnected == 0 ) {
+            iotp_utils_delay(3000);
+            Thread_lock_mutex(iotp_client_mutex);
+            isConnected =  client->connected;
+            Thread_unlock_mutex(iotp_client_mutex);
+            if (isConnected == 1) {
+                break;
+            }
+            if ( isConnected < 0 ) {
+                rc = (0 - isConnected);
+                Thread_lock_mutex(iotp_client_mutex);
+                client->connected = 0;
+                Thread_unlock_mutex(iotp_client_mutex);
+                break;
+            }
+            LOG(INFO, "Wait for client to connect. cycle=%d", cycle);
+            if ( cycle > 40 )  {
+                rc = IOTPRC_TIMEOUT;
+                break;
+            }
+            cycle++;
+        }
+
+    }
+
+    return rc;
+}
+
+
+/* Publishes message to a topic with specified QoS, and MQTTProperties */
+IOTPRC iotp_client_publish(void *iotpClient, char *topic, char *payload, int qos, MQTTProperties *props)
+{
+    size_t payloadlen = 0;
+    if ( payload && *payload != '\0' )
+        payloadlen = strlen(payload);
+
+    return iotp_client_publishBuffer(iotpClient, topic, payload, payloadlen, qos, props, NULL, NULL);
+}
+
+/*
+ * Compresses payload of an event or command, if format segment of the topic has a compression
+ * suffix (e.g. json-deflate), or if options.mqtt.compression is configured. In the later case,
+ * suffix is added to the format, and payload is sent as is if it is not reduced by compression.
+ * Returns compressed payload in *out, and topic with suffix in *outTopic, to be freed by caller.
+ */
+static IOTPRC iotp_client_compressPayload(IoTPClient *client, char *topic, void *payload, size_t payloadlen, char **outTopic, void **out, size_t *outlen)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = (IoTPConfig *)client->config;
+    IoTPCompression codec = IoTPCompression_none;
+    char *format = NULL;
+    char *p = topic;
+
+    *outTopic = NULL;
+    *out = NULL;
+    *outlen = 0;
+
+    /* get format segment */
+    while ( (p = strstr(p, "/fmt/")) != NULL ) {
+        format = p + 5;
+        p = format;
+    }
+    if ( format == NULL || *format == '\0' ) {
+        return rc;
+    }
+
+    codec = iotp_compress_fromFormat(format, strlen(format), NULL);
+    if ( codec != IoTPCompression_none ) {
+        /* compression is requested by the caller */
+        rc = iotp_compress_encode(codec, payload, payloadlen, out, outlen);
+        return rc;
+    }
+
+    codec = config->mqttopts->compression;
+    if ( codec == IoTPCompression_none || payloadlen < (size_t)config->mqttopts->compressionMinSize ) {
+        return rc;
+    }
+    rc = iotp_compress_encode(codec, payload, payloadlen, out, outlen);
+    if ( rc != IOTPRC_SUCCESS || *outlen >= payloadlen ) {
+        /* send uncompressed payload */
+        iotp_utils_freePtr(*out);
+        *out = NULL;
+        *outlen = 0;
+        return IOTPRC_SUCCESS;
+    }
+
+    const char *suffix = iotp_compress_suffix(codec);
+    size_t len = strlen(topic) + strlen(suffix) + 1;
+    *outTopic = (char *)malloc(len);
+    if ( *outTopic == NULL ) {
+        iotp_utils_freePtr(*out);
+        *out = NULL;
+        *outlen = 0;
+        return IOTPRC_NOMEM;
+    }
+    snprintf(*outTopic, len, "%s%s", topic, suffix);
+    return rc;
+}
+
+static IOTPRC iotp_client_sendRequest(IoTPClient *client, char *topic, void *payload, size_t payloadlen, int qos, MQTTProperties *props, IoTPPublishContext *req, int *token);
+
+static void iotp_client_freeCoalesceEntry(IoTPCoalesceEntry *entry)
+{
+    iotp_utils_freePtr((void *)entry->topic);
+    iotp_utils_freePtr((void *)entry->buf);
+    iotp_utils_freePtr((void *)entry);
+}
+
+/* Publish a batch of coalesced events, and free the entry */
+static void iotp_client_publishCoalesced(IoTPClient *client, IoTPCoalesceEntry *entry)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    if ( entry->json ) {
+        entry->buf[entry->len++] = ']';
+    }
+    LOG(DEBUG, "Publish coalesced events. topic: %s | count: %d | len: %lu", entry->topic, entry->count, (unsigned long)entry->len);
+
+    /* MQTT client copies payload, so buffer is freed after request is submitted */
+    rc = iotp_client_sendRequest(client, entry->topic, entry->buf, entry->len, entry->qos, NULL, NULL, NULL);
+    if ( rc == IOTPRC_SUCCESS ) {
+        __atomic_add_fetch(&client->stats.batchesPublished, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_add_fetch(&client->stats.eventsDropped, entry->count, __ATOMIC_RELAXED);
+        LOG(ERROR, "Failed to publish coalesced events. topic: %s | count: %d | rc: %d", entry->topic, entry->count, rc);
+        /* batch of JSON events has the topic of the events */
+        if ( entry->json )
+            iotp_delta_invalidate(&client->delta, entry->topic);
+    }
+    iotp_client_freeCoalesceEntry(entry);
+}
+
+/* Coalescer thread - publishes batches when time window of the batch expires */
+static void * iotp_client_coalescerThread(void *arg)
+{
+    IoTPClient *client = (IoTPClient *)arg;
+    IoTPCoalescer *coalescer = &client->coalescer;
+
+    pthread_mutex_lock(&coalescer->lock);
+    while ( coalescer->stop == 0 ) {
+        uint64_t now = iotp_utils_timeMicros();
+        uint64_t next = 0;
+        IoTPCoalesceEntry *due = NULL;
+        IoTPCoalesceEntry **pp = &coalescer->entries;
+
+        /* collect batches with expired window */
+        while ( *pp ) {
+            IoTPCoalesceEntry *entry = *pp;
+            if ( entry->deadline <= now ) {
+                *pp = entry->next;
+                entry->next = due;
+                due = entry;
+            } else {
+                if ( next == 0 || entry->deadline < next )
+                    next = entry->deadline;
+                pp = &entry->next;
+            }
+        }
+
+        if ( due ) {
+            pthread_mutex_unlock(&coalescer->lock);
+            while ( due ) {
+                IoTPCoalesceEntry *entry = due;
+                due = entry->next;
+                iotp_client_publishCoalesced(client, entry);
+            }
+            pthread_mutex_lock(&coalescer->lock);
+            continue;
+        }
+
+        if ( next == 0 ) {
+            pthread_cond_wait(&coalescer->cond, &coalescer->lock);
+        } else {
+            struct timespec ts;
+            iotp_utils_deadline(next, &ts);
+            pthread_cond_timedwait(&coalescer->cond, &coalescer->lock, &ts);
+        }
+    }
+    pthread_mutex_unlock(&coalescer->lock);
+
+    return NULL;
+}
+
+/*
+ * Adds an event to the batch of its topic and QoS. Events in JSON format are merged into a
+ * JSON array, events in other formats are merged into frames with a 4 byte (big endian) length
+ * prefix, and published with "-batch" suffix to the format. A batch is published when its time
+ * window expires, or when the next event does not fit in coalesceMaxBytes.
+ * Returns IOTPRC_ARGS_INVALID_VALUE if event can not be coalesced.
+ */
+static IOTPRC iotp_client_coalesce(IoTPClient *client, char *topic, void *payload, size_t payloadlen, int qos)
+{
+    IoTPCoalescer *coalescer = &client->coalescer;
+    IoTPCoalesceEntry *entry = NULL;
+    IoTPCoalesceEntry *full = NULL;
+    IoTPCoalesceEntry **pp = NULL;
+    char *format = NULL;
+    char *p = topic;
+    size_t topicLen = 0;
+    size_t frameLen = 0;
+    int json = 0;
+
+    /* get format segment of event topic */
+    while ( (p = strstr(p, "/fmt/")) != NULL ) {
+        format = p + 5;
+        p = format;
+    }
+    if ( format == NULL || (payload == NULL && payloadlen > 0) ||
+         iotp_compress_fromFormat(format, strlen(format), NULL) != IoTPCompression_none ) {
+        return IOTPRC_ARGS_INVALID_VALUE;
+    }
+    json = (strcmp(format, "json") == 0);
+    frameLen = json ? payloadlen + 1 : payloadlen + 4;
+    if ( frameLen + 1 > coalescer->maxBytes ) {
+        /* event is larger than a batch */
+        return IOTPRC_ARGS_INVALID_VALUE;
+    }
+
+    if ( iotp_client_canPublish(client) == 0 ) {
+        LOG(ERROR, "Not connected");
+        return IOTPRC_NOT_CONNECTED;
+    }
+
+    topicLen = strlen(topic) + (json ? 1 : 7);
+
+    pthread_mutex_lock(&coalescer->lock);
+    for (pp = &coalescer->entries; *pp; pp = &(*pp)->next) {
+        if ( (*pp)->qos == qos && !strncmp((*pp)->topic, topic, strlen(topic)) && strlen((*pp)->topic) + 1 == topicLen ) {
+            break;
+        }
+    }
+    entry = *pp;
+    if ( entry && entry->len + frameLen + 1 > coalescer->maxBytes ) {
+        /* batch is full, publish it and start a new batch */
+        *pp = entry->next;
+        full = entry;
+        entry = NULL;
+    }
+    if ( entry == NULL ) {
+        entry = (IoTPCoalesceEntry *)calloc(1, sizeof(IoTPCoalesceEntry));
+        if ( entry ) {
+            entry->topic = (char *)malloc(topicLen);
+            entry->size = coalescer->maxBytes;
+            entry->buf = (char *)malloc(entry->size);
+        }
+        if ( entry == NULL || entry->topic == NULL || entry->buf == NULL ) {
+            if ( entry ) iotp_client_freeCoalesceEntry(entry);
+            pthread_mutex_unlock(&coalescer->lock);
+            if ( full ) iotp_client_publishCoalesced(client, full);
+            LOG(ERROR, "Failed to allocate coalescer batch. rc: %d", IOTPRC_NOMEM);
+            return IOTPRC_NOMEM;
+        }
+        snprintf(entry->topic, topicLen, "%s%s", topic, json ? "" : "-batch");
+        entry->qos = qos;
+        entry->json = json;
+        entry->deadline = iotp_utils_timeMicros() + (uint64_t)coalescer->window * 1000;
+        entry->next = coalescer->entries;
+        coalescer->entries = entry;
+        pthread_cond_signal(&coalescer->cond);
+    }
+
+    if ( json ) {
+        entry->buf[entry->len++] = entry->count ? ',' : '[';
+    } else {
+        entry->buf[entry->len++] = (char)((payloadlen >> 24) & 0xFF);
+        entry->buf[entry->len++] = (char)((payloadlen >> 16) & 0xFF);
+        entry->buf[entry->len++] = (char)((payloadlen >> 8) & 0xFF);
+        entry->buf[entry->len++] = (char)(payloadlen & 0xFF);
+    }
+    if ( payloadlen > 0 ) {
+        memcpy(entry->buf + entry->len, payload, payloadlen);
+        entry->len += payloadlen;
+    }
+    entry->count += 1;
+    pthread_mutex_unlock(&coalescer->lock);
+
+    __atomic_add_fetch(&client->stats.eventsMerged, 1, __ATOMIC_RELAXED);
+
+    if ( full ) {
+        iotp_client_publishCoalesced(client, full);
+    }
+
+    return IOTPRC_SUCCESS;
+}
+
+/*
+ * Submits a publish request to MQTT client. A repeated topic is sent with a topic alias, if topic
+ * aliases are negotiated and the request does not have a topic alias property. Once the server
+ * knows the alias, the topic is omitted.
+ */
+static int iotp_client_mqttSend(IoTPClient *client, MQTTAsync mqttClient, char *topic, void *payload, size_t payloadlen, int qos, MQTTAsync_responseOptions *opts)
+{
+    MQTTProperties userProps = opts->properties;
+    MQTTProperties props = MQTTProperties_initializer;
+    MQTTProperty property;
+    uint32_t generation = 0;
+    int omitTopic = 0;
+    int alias = 0;
+    int rc = MQTTASYNC_SUCCESS;
+
+    /* Requests buffered while reconnecting are sent on a new connection, use topic */
+    if ( client->aliases.enabled == 0 || __atomic_load_n(&client->connected, __ATOMIC_ACQUIRE) != 1 ||
+         MQTTProperties_hasProperty(&userProps, MQTTPROPERTY_CODE_TOPIC_ALIAS) ) {
+        return MQTTAsync_send(mqttClient, topic, (int)payloadlen, payload, qos, 0, opts);
+    }
+
+    alias = iotp_alias_acquire(&client->aliases, topic, qos, &omitTopic, &generation);
+    if ( alias == 0 ) {
+        return MQTTAsync_send(mqttClient, topic, (int)payloadlen, payload, qos, 0, opts);
+    }
+
+    props = MQTTProperties_copy(&userProps);
+    property.identifier = MQTTPROPERTY_CODE_TOPIC_ALIAS;
+    property.value.integer2 = alias;
+    MQTTProperties_add(&props, &property);
+    opts->properties = props;
+    rc = MQTTAsync_send(mqttClient, omitTopic? "" : topic, (int)payloadlen, payload, qos, 0, opts);
+    opts->properties = userProps;
+    MQTTProperties_free(&props);
+    iotp_alias_release(&client->aliases, alias, generation, rc == MQTTASYNC_SUCCESS);
+
+    if ( rc == MQTTASYNC_SUCCESS && omitTopic ) {
+        __atomic_add_fetch(&client->stats.topicAliasPublishes, 1, __ATOMIC_RELAXED);
+        /* topic alias property takes 3 bytes */
+        __atomic_add_fetch(&client->stats.topicAliasBytesSaved, strlen(topic) - 3, __ATOMIC_RELAXED);
+    }
+
+    return rc;
+}
+
+/* 
+ * Sends payload buffer of specified length to a topic with specified QoS, and MQTTProperties.
+ * If request callbacks are specified in req, or outbound window is enabled, publish request
+ * is tracked in a publish context till MQTT client completes the request.
+ */
+static IOTPRC iotp_client_sendRequest(IoTPClient *client, char *topic, void *payload, size_t payloadlen, int qos, MQTTProperties *props, IoTPPublishContext *req, int *token)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* Sanity check */
+    if ( !client || !client->config ) {
+        rc = IOTPRC_INVALID_HANDLE;
+        LOG(ERROR, "Invalid client handle");
+        return rc;
+    }
+    if ( (payload == NULL && payloadlen > 0) || payloadlen > IOTP_MAX_PAYLOAD_LEN ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(ERROR, "Invalid payload. payloadlen: %lu", (unsigned long)payloadlen);
+        return rc;
+    }
+
+    /* 
+     * if client is not connected, return error. If connection is lost and client is reconnecting
+     * in background, request is buffered by MQTT client - upto maxBufferedMessages requests.
+     */
+    if ( iotp_client_canPublish(client) == 0 ) {
+        rc = IOTPRC_NOT_CONNECTED;
+        LOG(ERROR, "Not connected");
+        return rc;
+    }
+
+    /* control lane is not rate limited, and has its own in-flight window */
+    IoTPLane lane = iotp_client_getLane(topic);
+
+    /* wait for publish rate limit */
+    if ( lane == IoTPLane_bulk ) {
+        rc = iotp_client_acquireRate(client, topic, 1);
+        if ( rc != IOTPRC_SUCCESS ) {
+            return rc;
+        }
+    }
+
+    /* reserve space in outbound window */
+    rc = iotp_client_acquireWindow(client, lane, 1, payloadlen);
+    if ( rc != IOTPRC_SUCCESS ) {
+        return rc;
+    }
+
+    MQTTAsync_responseOptions opts = MQTTAsync_responseOptions_initializer;
+    MQTTAsync mqttClient = (MQTTAsync *)client->mqttClient;
+    IoTPPublishContext *pubctx = NULL;
+
+    /* event stream with delta encoding is reset, if request fails - topic is kept with the context */
+    size_t deltaTopicLen = (client->delta.enabled && props == NULL && lane == IoTPLane_bulk) ? strlen(topic) + 1 : 0;
+
+    /* track user buffer, delivery callback, window space and lane statistics till publish request completes */
+    pubctx = (IoTPPublishContext *)calloc(1, sizeof(IoTPPublishContext) + deltaTopicLen);
+    if ( pubctx == NULL ) {
+        iotp_client_releaseWindow(client, lane, 1, payloadlen);
+        rc = IOTPRC_NOMEM;
+        LOG(ERROR, "Failed to allocate publish context. rc: %d", rc);
+        return rc;
+    }
+    if ( req != NULL )
+        *pubctx = *req;
+    pubctx->client = client;
+    pubctx->payload = payload;
+    pubctx->payloadlen = payloadlen;
+    pubctx->lane = lane;
+    pubctx->submitTime = iotp_utils_timeMicros();
+    if ( deltaTopicLen > 0 ) {
+        pubctx->deltaTopic = (char *)(pubctx + 1);
+        memcpy(pubctx->deltaTopic, topic, deltaTopicLen);
+    }
+    opts.onSuccess5 = onSendBuffer;
+    opts.onFailure5 = onSendBufferFailure;
+    opts.context = pubctx;
+    if (props != NULL) {
+        opts.properties = *props;
+    }
+
+    LOG(DEBUG, "Publish event. topic: %s | qos: %d | retained: %d | payloadlen: %lu",
+                    topic, qos, 0, (unsigned long)payloadlen);
+
+    /* completion callback may be invoked before MQTTAsync_send returns */
+    iotp_client_laneSubmitted(client, lane, 1);
+
+    /* MQTT client copies payload, so compressed payload is freed after the request is submitted */
+    char *ctopic = NULL;
+    void *cpayload = NULL;
+    size_t cpayloadlen = 0;
+    rc = iotp_client_compressPayload(client, topic, payload, payloadlen, &ctopic, &cpayload, &cpayloadlen);
+    if ( rc == IOTPRC_SUCCESS ) {
+        if ( cpayload != NULL ) {
+            rc = iotp_client_mqttSend(client, mqttClient, ctopic? ctopic:topic, cpayload, cpayloadlen, qos, &opts);
+            iotp_utils_freePtr((void *)ctopic);
+            iotp_utils_freePtr(cpayload);
+        } else {
+            rc = iotp_client_mqttSend(client, mqttClient, topic, payload, payloadlen, qos, &opts);
+        }
+    }
+    if ( rc == MQTTASYNC_MAX_BUFFERED_MESSAGES ) {
+        /* MQTT client buffer for messages sent while reconnecting is full */
+        rc = IOTPRC_WOULDBLOCK;
+    } else if ( rc != MQTTASYNC_SUCCESS ) {
+        LOG(ERROR, "MQTTAsync_send returned error: rc=%d", rc);
+    }
+
+    /* Request is not accepted, buffer is still owned by the caller */
+    if ( rc != MQTTASYNC_SUCCESS ) {
+        __atomic_sub_fetch(&iotp_client_laneStats(client, lane)->depth, 1, __ATOMIC_RELAXED);
+        iotp_client_releaseWindow(client, lane, 1, payloadlen);
+        free(pubctx);
+    } else if ( token != NULL ) {
+        *token = opts.token;
+    }
+
+    return rc;
+}
+
+/* Initialize coalescer, and start the thread to publish batches when time window expires */
+static void iotp_client_initCoalescer(IoTPClient *client, IoTPConfig *config)
+{
+    IoTPCoalescer *coalescer = &client->coalescer;
+
+    coalescer->window = config->mqttopts->coalesceWindow;
+    coalescer->maxBytes = (size_t)config->mqttopts->coalesceMaxBytes;
+    if ( coalescer->window <= 0 ) {
+        return;
+    }
+
+    pthread_mutex_init(&coalescer->lock, NULL);
+    iotp_utils_initCond(&coalescer->cond);
+    if ( pthread_create(&coalescer->thread, NULL, iotp_client_coalescerThread, client) != 0 ) {
+        LOG(ERROR, "Failed to start coalescer thread. Events are not coalesced. clientId: %s", client->clientId);
+        pthread_cond_destroy(&coalescer->cond);
+        pthread_mutex_destroy(&coalescer->lock);
+        return;
+    }
+    coalescer->enabled = 1;
+    LOG(INFO, "Event coalescer is started. window: %d ms | maxBytes: %lu", coalescer->window, (unsigned long)coalescer->maxBytes);
+}
+
+/* Stop coalescer thread, and discard events that are not published */
+static void iotp_client_stopCoalescer(IoTPClient *client)
+{
+    IoTPCoalescer *coalescer = &client->coalescer;
+    IoTPCoalesceEntry *entry = NULL;
+
+    if ( coalescer->enabled == 0 ) {
+        return;
+    }
+
+    pthread_mutex_lock(&coalescer->lock);
+    coalescer->stop = 1;
+    pthread_cond_signal(&coalescer->cond);
+    pthread_mutex_unlock(&coalescer->lock);
+    pthread_join(coalescer->thread, NULL);
+
+    entry = coalescer->entries;
+    while ( entry ) {
+        IoTPCoalesceEntry *next = entry->next;
+        __atomic_add_fetch(&client->stats.eventsDropped, entry->count, __ATOMIC_RELAXED);
+        if ( entry->json )
+            iotp_delta_invalidate(&client->delta, entry->topic);
+        iotp_client_freeCoalesceEntry(entry);
+        entry = next;
+    }
+    coalescer->entries = NULL;
+    coalescer->enabled = 0;
+    pthread_cond_destroy(&coalescer->cond);
+    pthread_mutex_destroy(&coalescer->lock);
+}
+
+/* Publish all buffered events */
+static void iotp_client_flushCoalescer(IoTPClient *client)
+{
+    IoTPCoalescer *coalescer = &client->coalescer;
+    IoTPCoalesceEntry *entry = NULL;
+
+    if ( coalescer->enabled == 0 ) {
+        return;
+    }
+
+    pthread_mutex_lock(&coalescer->lock);
+    entry = coalescer->entries;
+    coalescer->entries = NULL;
+    pthread_mutex_unlock(&coalescer->lock);
+
+    while ( entry ) {
+        IoTPCoalesceEntry *next = entry->next;
+        iotp_client_publishCoalesced(client, entry);
+        entry = next;
+    }
+}
+
+/* Returns user buffer of a submission queue entry, and frees allocated copy of topic and payload */
+static void iotp_client_freeSubmitEntry(IoTPSubmitEntry *entry)
+{
+    if ( entry->releaseCB != NULL ) {
+        (*entry->releaseCB)(entry->payload, entry->payloadlen, entry->releaseContext);
+        entry->releaseCB = NULL;
+    }
+    if ( entry->data != NULL ) {
+        free(entry->data);
+        entry->data = NULL;
+    }
+}
+
+/*
+ * Claims a slot of submission queue. Returns NULL if queue is full. Producers claim a position
+ * with compare-and-swap on tail, fill the entry of the slot, and publish it with iotp_client_submitPublish().
+ */
+static IoTPSubmitSlot * iotp_client_submitClaim(IoTPSubmitQueue *queue, uint64_t *position)
+{
+    uint64_t pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    IoTPSubmitSlot *slot = NULL;
+
+    for (;;) {
+        slot = &queue->slots[pos & (queue->size - 1)];
+        uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        int64_t dif = (int64_t)(seq - pos);
+        if ( dif == 0 ) {
+            if ( __atomic_compare_exchange_n(&queue->tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+                break;
+        } else if ( dif < 0 ) {
+            /* slot is not yet consumed - queue is full */
+            return NULL;
+        } else {
+            pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+        }
+    }
+    *position = pos;
+
+    return slot;
+}
+
+/* Publishes a filled slot to sender thread, and wakes the thread if it sleeps */
+static void iotp_client_submitPublish(IoTPSubmitQueue *queue, IoTPSubmitSlot *slot, uint64_t pos)
+{
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+    /* pairs with the fence of sender thread, after it sets sleeping flag and before it checks the queue */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if ( __atomic_load_n(&queue->sleeping, __ATOMIC_RELAXED) ) {
+        pthread_mutex_lock(&queue->lock);
+        __atomic_store_n(&queue->sleeping, 0, __ATOMIC_RELAXED);
+        pthread_cond_signal(&queue->cond);
+        pthread_mutex_unlock(&queue->lock);
+    }
+}
+
+/* Returns next filled slot of submission queue, or NULL if next entry is not yet published */
+static IoTPSubmitSlot * iotp_client_submitPeek(IoTPSubmitQueue *queue)
+{
+    IoTPSubmitSlot *slot = &queue->slots[queue->head & (queue->size - 1)];
+
+    if ( __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != queue->head + 1 ) {
+        return NULL;
+    }
+    return slot;
+}
+
+/* Releases a slot returned by iotp_client_submitPeek() for reuse by producers */
+static void iotp_client_submitRelease(IoTPSubmitQueue *queue, IoTPSubmitSlot *slot)
+{
+    __atomic_store_n(&slot->seq, queue->head + queue->size, __ATOMIC_RELEASE);
+    queue->head += 1;
+}
+
+/* Submits a dequeued publish request to MQTT client, and frees the entry */
+static void iotp_client_submitEntry(IoTPClient *client, IoTPSubmitEntry *entry)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    if ( entry->releaseCB != NULL ) {
+        /* user buffer is returned when publish request completes */
+        IoTPPublishContext req = { 0 };
+        req.releaseCB = entry->releaseCB;
+        req.releaseContext = entry->releaseContext;
+        rc = iotp_client_sendRequest(client, entry->topic, entry->payload, entry->payloadlen, entry->qos, NULL, &req, NULL);
+        if ( rc == IOTPRC_SUCCESS )
+            entry->releaseCB = NULL;
+    } else {
+        rc = iotp_client_sendRequest(client, entry->topic, entry->payload, entry->payloadlen, entry->qos, NULL, NULL, NULL);
+    }
+    if ( rc != IOTPRC_SUCCESS ) {
+        __atomic_add_fetch(&client->stats.submitFailed, 1, __ATOMIC_RELAXED);
+        LOG(ERROR, "Failed to submit queued publish request. topic: %s | rc: %d | reason: %s", entry->topic, rc, IOTPRC_toString(rc));
+        iotp_delta_invalidate(&client->delta, entry->topic);
+    }
+    iotp_client_freeSubmitEntry(entry);
+    __atomic_sub_fetch(&client->submitQueue.pending, 1, __ATOMIC_RELEASE);
+}
+
+/* Sender thread - submits publish requests in submission queue to MQTT client */
+static void * iotp_client_senderThread(void *arg)
+{
+    IoTPClient *client = (IoTPClient *)arg;
+    IoTPSubmitQueue *queue = &client->submitQueue;
+    IoTPSubmitSlot *slot = NULL;
+    struct timespec ts;
+
+    while ( __atomic_load_n(&queue->stop, __ATOMIC_ACQUIRE) == 0 ) {
+        if ( (slot = iotp_client_submitPeek(queue)) != NULL ) {
+            iotp_client_submitEntry(client, &slot->entry);
+            iotp_client_submitRelease(queue, slot);
+            continue;
+        }
+
+        /*
+         * Set sleeping flag before checking the queue again. A producer that publishes an entry
+         * after the check sees the flag, and wakes the thread. The wait is bounded, in case the
+         * next entry is still being filled by a producer.
+         */
+        __atomic_store_n(&queue->sleeping, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if ( iotp_client_submitPeek(queue) == NULL ) {
+            pthread_mutex_lock(&queue->lock);
+            if ( __atomic_load_n(&queue->sleeping, __ATOMIC_RELAXED) && __atomic_load_n(&queue->stop, __ATOMIC_ACQUIRE) == 0 ) {
+                iotp_utils_deadline(iotp_utils_timeMicros() + 100000, &ts);
+                pthread_cond_timedwait(&queue->cond, &queue->lock, &ts);
+            }
+            pthread_mutex_unlock(&queue->lock);
+        }
+        __atomic_store_n(&queue->sleeping, 0, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+/*
+ * Enqueues an event in submission queue. Topic and payload are copied, unless a release
+ * handler is specified - then the user buffer is returned when publish request completes.
+ * The copy is stored in the slot if it fits, so small requests are enqueued without allocating memory.
+ */
+static IOTPRC iotp_client_enqueue(IoTPClient *client, char *topic, void *payload, size_t payloadlen, int qos, IoTPBufferReleaseHandler releaseCB, void *releaseContext)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+    IoTPSubmitQueue *queue = &client->submitQueue;
+    IoTPSubmitSlot *slot = NULL;
+    char *data = NULL;
+    char *buf = NULL;
+    uint64_t pos = 0;
+    size_t topicLen = 0;
+    size_t copyLen = 0;
+
+    /* Sanity check */
+    if ( topic == NULL || (payload == NULL && payloadlen > 0) || payloadlen > IOTP_MAX_PAYLOAD_LEN ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(ERROR, "Invalid topic or payload. payloadlen: %lu", (unsigned long)payloadlen);
+        return rc;
+    }
+    if ( iotp_client_canPublish(client) == 0 ) {
+        rc = IOTPRC_NOT_CONNECTED;
+        LOG(ERROR, "Not connected");
+        return rc;
+    }
+
+    topicLen = strlen(topic) + 1;
+    copyLen = (releaseCB == NULL) ? payloadlen : 0;
+    if ( topicLen + copyLen > IOTP_SUBMIT_SLOT_DATA ) {
+        data = (char *)malloc(topicLen + copyLen);
+        if ( data == NULL ) {
+            rc = IOTPRC_NOMEM;
+            LOG(ERROR, "Failed to allocate submission queue entry. rc: %d", rc);
+            return rc;
+        }
+    }
+
+    __atomic_add_fetch(&queue->pending, 1, __ATOMIC_RELAXED);
+    slot = iotp_client_submitClaim(queue, &pos);
+    if ( slot == NULL ) {
+        /* buffer is still owned by the caller */
+        __atomic_sub_fetch(&queue->pending, 1, __ATOMIC_RELAXED);
+        iotp_utils_freePtr((void *)data);
+        LOG(DEBUG, "Submission queue is full. clientId: %s", client->clientId);
+        return IOTPRC_WOULDBLOCK;
+    }
+
+    buf = data ? data : slot->buf;
+    slot->entry.data = data;
+    slot->entry.topic = buf;
+    memcpy(buf, topic, topicLen);
+    if ( releaseCB == NULL ) {
+        slot->entry.payload = buf + topicLen;
+        if ( payloadlen > 0 )
+            memcpy(slot->entry.payload, payload, payloadlen);
+    } else {
+        slot->entry.payload = payload;
+    }
+    slot->entry.payloadlen = payloadlen;
+    slot->entry.qos = qos;
+    slot->entry.releaseCB = releaseCB;
+    slot->entry.releaseContext = releaseContext;
+
+    __atomic_add_fetch(&client->stats.submitQueued, 1, __ATOMIC_RELAXED);
+    iotp_client_submitPublish(queue, slot, pos);
+
+    return rc;
+}
+
+/* Initialize submission queue, and start the sender thread */
+static void iotp_client_initSubmitQueue(IoTPClient *client, IoTPConfig *config)
+{
+    IoTPSubmitQueue *queue = &client->submitQueue;
+    uint64_t size = 1;
+    uint64_t i;
+
+    if ( config->mqttopts->submitQueueSize <= 0 ) {
+        return;
+    }
+    while ( size < (uint64_t)config->mqttopts->submitQueueSize )
+        size <<= 1;
+
+    queue->slots = (IoTPSubmitSlot *)calloc(size, sizeof(IoTPSubmitSlot));
+    if ( queue->slots == NULL ) {
+        LOG(ERROR, "Failed to allocate submission queue. Events are submitted by publishing threads. size: %lu", (unsigned long)size);
+        return;
+    }
+    for (i = 0; i < size; i++)
+        queue->slots[i].seq = i;
+    queue->size = size;
+    pthread_mutex_init(&queue->lock, NULL);
+    iotp_utils_initCond(&queue->cond);
+    if ( pthread_create(&queue->thread, NULL, iotp_client_senderThread, client) != 0 ) {
+        LOG(ERROR, "Failed to start sender thread. Events are submitted by publishing threads. clientId: %s", client->clientId);
+        pthread_cond_destroy(&queue->cond);
+        pthread_mutex_destroy(&queue->lock);
+        iotp_utils_freePtr((void *)queue->slots);
+        queue->slots = NULL;
+        return;
+    }
+    queue->enabled = 1;
+    LOG(INFO, "Submission queue is started. size: %lu", (unsigned long)size);
+}
+
+/* Wait for sender thread to submit all enqueued publish requests */
+static void iotp_client_drainSubmitQueue(IoTPClient *client)
+{
+    uint64_t pending = 0;
+    int cycle = 0;
+
+    if ( client->submitQueue.enabled == 0 ) {
+        return;
+    }
+    while ( (pending = __atomic_load_n(&client->submitQueue.pending, __ATOMIC_ACQUIRE)) > 0 && cycle < IOTP_SUBMIT_DRAIN_TIMEOUT ) {
+        iotp_utils_delay(1);
+        cycle++;
+    }
+    if ( pending > 0 ) {
+        LOG(WARN, "Queued publish requests are not yet submitted. clientId: %s | pending: %lu", client->clientId, (unsigned long)pending);
+    }
+}
+
+/* Stop sender thread, and discard publish requests that are not submitted */
+static void iotp_client_stopSubmitQueue(IoTPClient *client)
+{
+    IoTPSubmitQueue *queue = &client->submitQueue;
+    IoTPSubmitSlot *slot = NULL;
+    unsigned long discarded = 0;
+
+    if ( queue->enabled == 0 ) {
+        return;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    __atomic_store_n(&queue->stop, 1, __ATOMIC_RELEASE);
+    pthread_cond_signal(&queue->cond);
+    pthread_mutex_unlock(&queue->lock);
+    pthread_join(queue->thread, NULL);
+
+    while ( (slot = iotp_client_submitPeek(queue)) != NULL ) {
+        __atomic_add_fetch(&client->stats.submitFailed, 1, __ATOMIC_RELAXED);
+        iotp_delta_invalidate(&client->delta, slot->entry.topic);
+        iotp_client_freeSubmitEntry(&slot->entry);
+        iotp_client_submitRelease(queue, slot);
+        __atomic_sub_fetch(&queue->pending, 1, __ATOMIC_RELAXED);
+        discarded += 1;
+    }
+    if ( discarded > 0 ) {
+        LOG(WARN, "Discarded queued publish requests that are not submitted. clientId: %s | discarded: %lu", client->clientId ? client->clientId : "NULL", discarded);
+    }
+    pthread_cond_destroy(&queue->cond);
+    pthread_mutex_destroy(&queue->lock);
+    iotp_utils_freePtr((void *)queue->slots);
+    queue->slots = NULL;
+    queue->enabled = 0;
+}
+
+/* Publishes payload buffer through coalescer, submission queue or directly, as configured */
+static IOTPRC iotp_client_submitBuffer(IoTPClient *client, char *topic, void *payload, size_t payloadlen, int qos, MQTTProperties *props, IoTPBufferReleaseHandler releaseCB, void *releaseContext)
+{
+    /* Events without MQTT properties are merged by coalescer, if enabled */
+    if ( client && client->coalescer.enabled && props == NULL && iotp_client_getLane(topic) == IoTPLane_bulk ) {
+        IOTPRC rc = iotp_client_coalesce(client, topic, payload, payloadlen, qos);
+        if ( rc != IOTPRC_ARGS_INVALID_VALUE ) {
+            /* payload is copied by coalescer */
+            if ( rc == IOTPRC_SUCCESS && releaseCB != NULL )
+                (*releaseCB)(payload, payloadlen, releaseContext);
+            return rc;
+        }
+    }
+
+    /* Events without MQTT properties are submitted by sender thread, if submission queue is enabled */
+    if ( client && client->submitQueue.enabled && props == NULL && iotp_client_getLane(topic) == IoTPLane_bulk ) {
+        return iotp_client_enqueue(client, topic, payload, payloadlen, qos, releaseCB, releaseContext);
+    }
+
+    if ( releaseCB != NULL ) {
+        IoTPPublishContext req = { 0 };
+        req.releaseCB = releaseCB;
+        req.releaseContext = releaseContext;
+        return iotp_client_sendRequest(client, topic, payload, payloadlen, qos, props, &req, NULL);
+    }
+
+    return iotp_client_sendRequest(client, topic, payload, payloadlen, qos, props, NULL, NULL);
+}
+
+/* Returns 1 if topic is of an event or command in CBOR format, and payload is a JSON object or array */
+static int iotp_client_isJsonForCbor(const char *topic, const void *payload, size_t payloadlen)
+{
+    const char *p = (const char *)payload;
+    const char *end = p + payloadlen;
+    size_t len = topic ? strlen(topic) : 0;
+
+    if ( len < 9 || strcmp(topic + len - 9, "/fmt/cbor") || payload == NULL ) {
+        return 0;
+    }
+    if ( strstr(topic, "/evt/") == NULL && strstr(topic, "/cmd/") == NULL ) {
+        return 0;
+    }
+    while ( p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') )
+        p++;
+    return (p < end && (*p == '{' || *p == '['));
+}
+
+/* 
+ * Publishes payload buffer of specified length to a topic with specified QoS, and MQTTProperties.
+ * The buffer is passed as is to MQTT client. If a release callback is specified, the buffer
+ * is returned to the caller using the callback when publish request completes.
+ */
+IOTPRC iotp_client_publishBuffer(void *iotpClient, char *topic, void *payload, size_t payloadlen, int qos, MQTTProperties *props, IoTPBufferReleaseHandler releaseCB, void *releaseContext)
+{
+    IoTPClient *client = (IoTPClient *)iotpClient;
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* JSON payload of events and commands in CBOR format is encoded as CBOR, if enabled */
+    if ( client && client->cborTranscode && iotp_client_isJsonForCbor(topic, payload, payloadlen) ) {
+        void *cbor = NULL;
+        size_t cborlen = 0;
+
+        rc = iotp_cbor_fromJson(payload, payloadlen, &cbor, &cborlen);
+        if ( rc != IOTPRC_SUCCESS ) {
+            LOG(ERROR, "Failed to encode JSON payload as CBOR. topic: %s | rc: %d", topic, rc);
+            return rc;
+        }
+        /* CBOR payload is copied by MQTT client, coalescer or submission queue */
+        rc = iotp_client_submitBuffer(client, topic, cbor, cborlen, qos, props, NULL, NULL);
+        iotp_utils_freePtr(cbor);
+        if ( rc == IOTPRC_SUCCESS && releaseCB != NULL )
+            (*releaseCB)(payload, payloadlen, releaseContext);
+        return rc;
+    }
+
+    /* Events in JSON format without MQTT properties are reduced to changed fields, if enabled */
+    if ( client && client->delta.enabled && props == NULL && iotp_client_getLane(topic) == IoTPLane_bulk ) {
+        void *delta = NULL;
+        size_t deltalen = 0;
+
+        if ( iotp_client_canPublish(client) == 0 ) {
+            rc = IOTPRC_NOT_CONNECTED;
+            LOG(ERROR, "Not connected");
+            return rc;
+        }
+
+        switch ( iotp_delta_filter(&client->delta, topic, payload, payloadlen, &delta, &deltalen) ) {
+        case IoTPDelta_unchanged:
+            __atomic_add_fetch(&client->stats.deltaSkipped, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&client->stats.deltaBytesSaved, payloadlen, __ATOMIC_RELAXED);
+            if ( releaseCB != NULL )
+                (*releaseCB)(payload, payloadlen, releaseContext);
+            return rc;
+
+        case IoTPDelta_changed:
+            /* changed fields are copied by MQTT client, coalescer or submission queue */
+            rc = iotp_client_submitBuffer(client, topic, delta, deltalen, qos, NULL, NULL, NULL);
+            iotp_utils_freePtr(delta);
+            if ( rc == IOTPRC_SUCCESS ) {
+                __atomic_add_fetch(&client->stats.deltaPublishes, 1, __ATOMIC_RELAXED);
+                __atomic_add_fetch(&client->stats.deltaBytesSaved, payloadlen - deltalen, __ATOMIC_RELAXED);
+                if ( releaseCB != NULL )
+                    (*releaseCB)(payload, payloadlen, releaseContext);
+            } else {
+                iotp_delta_invalidate(&client->delta, topic);
+            }
+            return rc;
+
+        default:
+            rc = iotp_client_submitBuffer(client, topic, payload, payloadlen, qos, NULL, releaseCB, releaseContext);
+            if ( rc != IOTPRC_SUCCESS )
+                iotp_delta_invalidate(&client->delta, topic);
+            return rc;
+        }
+    }
+
+    rc = iotp_client_submitBuffer(client, topic, payload, payloadlen, qos, props, releaseCB, releaseContext);
+
+    /* Events with MQTT properties are sent outside the delta stream - next event is sent in full */
+    if ( client && client->delta.enabled && props != NULL )
+        iotp_delta_invalidate(&client->delta, topic);
+
+    return rc;
+}
+
+/* 
+ * Publishes payload buffer of specified length to a topic with specified QoS, and MQTTProperties.
+ * Returns delivery token of the publish request. If a delivery callback is specified, it is invoked
+ * with the delivery token, status and acknowledgement time when publish request completes.
+ * Payload is sent in full, so delta stream of the topic is reset.
+ */
+IOTPRC iotp_client_publishAsync(void *iotpClient, char *topic, void *payload, size_t payloadlen, int qos, MQTTProperties *props, IoTPDeliveryHandler deliveryCB, void *deliveryContext, int *token)
+{
+    IoTPClient *client = (IoTPClient *)iotpClient;
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    if ( deliveryCB != NULL ) {
+        IoTPPublishContext req = { 0 };
+        req.deliveryCB = deliveryCB;
+        req.deliveryContext = deliveryContext;
+        rc = iotp_client_sendRequest(client, topic, payload, payloadlen, qos, props, &req, token);
+    } else {
+        rc = iotp_client_sendRequest(client, topic, payload, payloadlen, qos, props, NULL, token);
+    }
+
+    /* Event is sent outside the delta stream of the topic - next event is sent in full */
+    if ( client && client->delta.enabled && topic )
+        iotp_delta_invalidate(&client->delta, topic);
+
+    return rc;
+}
+
+/* Completes one event of a batch, and invokes batch callback once all events are completed */
+static void iotp_client_completeBatchEvent(IoTPBatchContext *batchctx)
+{
+    if ( __atomic_sub_fetch(&batchctx->pending, 1, __ATOMIC_ACQ_REL) == 0 ) {
+        iotp_client_releaseWindow(batchctx->client, IoTPLane_bulk, batchctx->windowCount, batchctx->windowBytes);
+        if ( batchctx->callback != NULL )
+            (*batchctx->callback)(batchctx->count, batchctx->succeeded, batchctx->failed, batchctx->context);
+        free(batchctx);
+    }
+}
+
+/* Callback function to process successful send of an event in a batch */
+void onSendBatch(void *context, MQTTAsync_successData5 *response)
+{
+    IoTPBatchContext *batchctx = (IoTPBatchContext *)context;
+    iotp_client_laneCompleted(batchctx->client, IoTPLane_bulk, batchctx->submitTime, 1);
+    __atomic_add_fetch(&batchctx->succeeded, 1, __ATOMIC_RELAXED);
+    iotp_client_completeBatchEvent(batchctx);
+}
+
+/* Callback function to process send failure of an event in a batch */
+void onSendBatchFailure(void *context, MQTTAsync_failureData5 *response)
+{
+    IoTPBatchContext *batchctx = (IoTPBatchContext *)context;
+    char *clientId = batchctx->client->clientId;
+    LOG(WARN, "Failed to send event of a batch. clientId: %s | rc: %d | respmsg: %s", clientId? clientId:"NULL",
+        response? response->code:0, (response && response->message)? response->message:"");
+    iotp_client_laneCompleted(batchctx->client, IoTPLane_bulk, batchctx->submitTime, 0);
+    __atomic_add_fetch(&batchctx->failed, 1, __ATOMIC_RELAXED);
+    iotp_client_completeBatchEvent(batchctx);
+}
+
+/* Copies a topic level to topic buffer, and returns pointer to the end of the copied string */
+static char * iotp_topic_append(char *dst, const char *src, size_t len)
+{
+    memcpy(dst, src, len);
+    return dst + len;
+}
+
+/* Sets status of the events of a batch that is not sent, if not already set */
+static void iotp_client_rejectBatch(IoTPEventBatch *batch, IOTPRC rc)
+{
+    int i;
+
+    for (i = 0; i < batch->count; i++) {
+        if ( batch->events[i].rc == IOTPRC_SUCCESS )
+            batch->events[i].rc = rc;
+    }
+}
+
+/* 
+ * Publishes a batch of events. All events are validated before any event is sent.
+ * Device and managed device clients publish own events. Other clients publish events
+ * on behalf of the devices specified in the event records.
+ *
+ * Status of each event is returned in its record. Returns IOTPRC_SUCCESS if all events are
+ * accepted, IOTPRC_PARTIAL_FAILURE if some events are accepted, or error if no event is sent.
+ * Events bypass the coalescer and the submission queue. JSON payload of events in cbor format
+ * is encoded as CBOR, and events are sent in full - delta stream of each topic is reset.
+ */
+IOTPRC iotp_client_publishEvents(void *iotpClient, IoTPEventBatch *batch)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+    IoTPClient *client = (IoTPClient *)iotpClient;
+    int i;
+
+    /* Sanity check */
+    if ( !client || !client->config ) {
+        rc = IOTPRC_INVALID_HANDLE;
+        LOG(ERROR, "Invalid client handle");
+        return rc;
+    }
+    if ( !batch || !batch->events || batch->count <= 0 ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(ERROR, "Invalid or empty event batch. rc: %d", rc);
+        return rc;
+    }
+    if ( batch->qos != QoS0 && batch->qos != QoS1 && batch->qos != QoS2 ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(ERROR, "Invalid QoS. qos: %d | rc: %d", batch->qos, rc);
+        return rc;
+    }
+
+    int deviceTopic = (client->type == IoTPClient_device || client->type == IoTPClient_managed_device);
+    IoTPConfig *config = (IoTPConfig *)client->config;
+    char *defTypeId = config->identity->typeId;
+    char *defDeviceId = config->identity->deviceId;
+
+    /* Validate all events, and get size of the largest topic */
+    size_t maxTopicLen = 0;
+    size_t totalBytes = 0;
+    for (i = 0; i < batch->count; i++) {
+        IoTPEventRecord *ev = &batch->events[i];
+        size_t tlen = 0;
+
+        ev->rc = IOTPRC_SUCCESS;
+        if ( !ev->eventId || *ev->eventId == '\0' || !ev->format || *ev->format == '\0' || (!ev->payload && ev->payloadlen > 0) ) {
+            ev->rc = IOTPRC_ARGS_NULL_VALUE;
+        } else if ( ev->payloadlen > IOTP_MAX_PAYLOAD_LEN ) {
+            ev->rc = IOTPRC_ARGS_INVALID_VALUE;
+        } else if ( deviceTopic ) {
+            /* iot-2/evt/<eventId>/fmt/<format> */
+            tlen = 15 + strlen(ev->eventId) + strlen(ev->format);
+        } else {
+            /* iot-2/type/<typeId>/id/<deviceId>/evt/<eventId>/fmt/<format> */
+            char *typeId = ev->typeId? ev->typeId : defTypeId;
+            char *deviceId = ev->deviceId? ev->deviceId : defDeviceId;
+            if ( !typeId || *typeId == '\0' || !deviceId || *deviceId == '\0' ) {
+                ev->rc = IOTPRC_ARGS_NULL_VALUE;
+            } else {
+                tlen = 25 + strlen(typeId) + strlen(deviceId) + strlen(ev->eventId) + strlen(ev->format);
+            }
+        }
+        if ( ev->rc != IOTPRC_SUCCESS ) {
+            if ( rc == IOTPRC_SUCCESS )
+                rc = ev->rc;
+            LOG(ERROR, "Invalid event in batch. index: %d | rc: %d | reason: %s", i, ev->rc, IOTPRC_toString(ev->rc));
+            continue;
+        }
+        if ( tlen > maxTopicLen )
+            maxTopicLen = tlen;
+        totalBytes += ev->payloadlen;
+    }
+
+    /* Valid events are not sent either, if any event is invalid */
+    if ( rc != IOTPRC_SUCCESS ) {
+        iotp_client_rejectBatch(batch, IOTPRC_FAILURE);
+        return rc;
+    }
+
+    /* if client is not connected and not reconnecting, return error */
+    if ( iotp_client_canPublish(client) == 0 ) {
+        rc = IOTPRC_NOT_CONNECTED;
+        LOG(ERROR, "Not connected");
+        iotp_client_rejectBatch(batch, rc);
+        return rc;
+    }
+
+    /* Encode topic of each event - topics are needed for the device rate limits */
+    char **topics = (char **)malloc((size_t)batch->count * (sizeof(char *) + maxTopicLen + 1));
+    if ( topics == NULL ) {
+        rc = IOTPRC_NOMEM;
+        LOG(ERROR, "Failed to allocate batch topics. rc: %d", rc);
+        iotp_client_rejectBatch(batch, rc);
+        return rc;
+    }
+    char *topicbuf = (char *)(topics + batch->count);
+    for (i = 0; i < batch->count; i++) {
+        IoTPEventRecord *ev = &batch->events[i];
+        char *p = topics[i] = topicbuf + (size_t)i * (maxTopicLen + 1);
 
-    /* set connection options */
-    conn_opts.keepAliveInterval = config->mqttopts->keepalive;
-    conn_opts.onSuccess5 = onConnect;
-    conn_opts.onFailure5 = onConnectFailure;
-    conn_opts.MQTTVersion = MQTTVERSION_5;
-    conn_opts.context = client;
-    conn_opts.automaticReconnect = config->automaticReconnect;
-    if ( port == 1883 ) {
-        conn_opts.cleanstart = 1;
-        conn_opts.cleansession = 0;
-    } else {
-        conn_opts.cleanstart = config->mqttopts->cleanStart;
-        conn_opts.cleansession = 0;
-        if ( config->mqttopts->sessionExpiry > 0 ) {
-            property.identifier = MQTTPROPERTY_CODE_SESSION_EXPIRY_INTERVAL;
-            property.value.integer4 = config->mqttopts->sessionExpiry;
-            MQTTProperties_add(&props, &property);
-            conn_opts.connectProperties = &props;
+        if ( deviceTopic ) {
+            p = iotp_topic_append(p, "iot-2/evt/", 10);
+        } else {
+            char *typeId = ev->typeId? ev->typeId : defTypeId;
+            char *deviceId = ev->deviceId? ev->deviceId : defDeviceId;
+            p = iotp_topic_append(p, "iot-2/type/", 11);
+            p = iotp_topic_append(p, typeId, strlen(typeId));
+            p = iotp_topic_append(p, "/id/", 4);
+            p = iotp_topic_append(p, deviceId, strlen(deviceId));
+            p = iotp_topic_append(p, "/evt/", 5);
         }
+        p = iotp_topic_append(p, ev->eventId, strlen(ev->eventId));
+        p = iotp_topic_append(p, "/fmt/", 5);
+        p = iotp_topic_append(p, ev->format, strlen(ev->format));
+        *p = '\0';
     }
 
-    /* set authentication credentials */
-    ssl_opts.enableServerCertAuth = 0;
+    /* wait for publish rate limit of client and of each device, for all events */
+    rc = iotp_client_acquireTopicsRate(client, topics, batch->count);
+    if ( rc != IOTPRC_SUCCESS ) {
+        iotp_client_rejectBatch(batch, rc);
+        iotp_utils_freePtr((void *)topics);
+        return rc;
+    }
 
-    if ( port == 8883 || port == 443 ) {
-        /* set ssl */
-        conn_opts.ssl = &ssl_opts;
+    /* reserve space for all events in outbound window */
+    rc = iotp_client_acquireWindow(client, IoTPLane_bulk, batch->count, totalBytes);
+    if ( rc != IOTPRC_SUCCESS ) {
+        iotp_client_rejectBatch(batch, rc);
+        iotp_utils_freePtr((void *)topics);
+        return rc;
+    }
 
-        if ( client->type == IoTPClient_application || client->type == IoTPClient_Application ) {
-            conn_opts.username = config->auth->key;
-            conn_opts.password = config->auth->token;
-            LOG(DEBUG, "key: %s | token: %s", config->auth->key, config->auth->token);
-        } else if ( client->type == IoTPClient_device || client->type == IoTPClient_managed_device ||
-            client->type == IoTPClient_gateway || client->type == IoTPClient_managed_gateway ) {
-            if ( config->auth->token ) {
-                conn_opts.username = "use-token-auth";
-                conn_opts.password = config->auth->token;
-                LOG(DEBUG, "key: %s | token: %s", config->auth->key, config->auth->token);
-            }
-            if ( config->auth->keyStore ) {
-                conn_opts.ssl->enableServerCertAuth = 1;
-                conn_opts.ssl->trustStore = config->mqttopts->caFile;
-                conn_opts.ssl->keyStore = config->auth->keyStore;
-                conn_opts.ssl->privateKey = config->auth->privateKey;
-                conn_opts.ssl->privateKeyPassword = config->auth->privateKeyPassword;
-            }
-        }
+    MQTTAsync_responseOptions opts = MQTTAsync_responseOptions_initializer;
+    MQTTAsync mqttClient = (MQTTAsync *)client->mqttClient;
+    IoTPBatchContext *batchctx = NULL;
+
+    /* track batch callback, window space and lane statistics till all events complete */
+    batchctx = (IoTPBatchContext *)calloc(1, sizeof(IoTPBatchContext));
+    if ( batchctx == NULL ) {
+        iotp_client_releaseWindow(client, IoTPLane_bulk, batch->count, totalBytes);
+        iotp_utils_freePtr((void *)topics);
+        rc = IOTPRC_NOMEM;
+        LOG(ERROR, "Failed to allocate batch context. rc: %d", rc);
+        iotp_client_rejectBatch(batch, rc);
+        return rc;
     }
-    
-    /* Set callbacks */
-    MQTTAsync_setCallbacks((MQTTAsync *)client->mqttClient, (void *)client, NULL, iotp_client_messageArrived, NULL);
-    
-    /* Invoke MQTTAsync_connect */
-    LOG(INFO, "MQTTAsync_connect. clientId=%s | connectionURI=%s", client->clientId, client->connectionURI);
-    if ((rc = MQTTAsync_connect((MQTTAsync *)client->mqttClient, &conn_opts)) == MQTTASYNC_SUCCESS) {
-        int cycle = 0;
-        int isConnected = 0;
-        while ( isConnected == 0 ) {
-            iotp_utils_delay(3000);
-            Thread_lock_mutex(iotp_client_mutex);
-            isConnected =  client->connected;
-            Thread_unlock_mutex(iotp_client_mutex);
-            if (isConnected == 1) {
-                break;
-            }
-            if ( isConnected < 0 ) {
-                rc = (0 - isConnected);
-                Thread_lock_mutex(iotp_client_mutex);
-                client->connected = 0;
-                Thread_unlock_mutex(iotp_client_mutex);
-                break;
-            }
-            LOG(INFO, "Wait for client to connect. cycle=%d", cycle);
-            if ( cycle > 40 )  {
-                rc = IOTPRC_TIMEOUT;
-                break;
+    batchctx->client = client;
+    batchctx->count = batch->count;
+    batchctx->callback = batch->callback;
+    batchctx->context = batch->context;
+    batchctx->submitTime = iotp_utils_timeMicros();
+    /* Hold a reference till all events are submitted */
+    batchctx->pending = 1;
+    opts.onSuccess5 = onSendBatch;
+    opts.onFailure5 = onSendBatchFailure;
+    opts.context = batchctx;
+
+    LOG(DEBUG, "Publish event batch. count: %d | qos: %d", batch->count, batch->qos);
+
+    /* Pipeline events to MQTT client */
+    int accepted = 0;
+    for (i = 0; i < batch->count; i++) {
+        IoTPEventRecord *ev = &batch->events[i];
+        char *topic = topics[i];
+
+        __atomic_add_fetch(&batchctx->pending, 1, __ATOMIC_RELAXED);
+        iotp_client_laneSubmitted(client, IoTPLane_bulk, 1);
+
+        char *ctopic = NULL;
+        void *cpayload = NULL;
+        size_t cpayloadlen = 0;
+        void *payload = ev->payload;
+        size_t payloadlen = ev->payloadlen;
+        void *cbor = NULL;
+        int sendrc = IOTPRC_SUCCESS;
+
+        /* JSON payload of events in CBOR format is encoded as CBOR, if enabled */
+        if ( client->cborTranscode && iotp_client_isJsonForCbor(topic, payload, payloadlen) ) {
+            sendrc = iotp_cbor_fromJson(payload, payloadlen, &cbor, &payloadlen);
+            if ( sendrc == IOTPRC_SUCCESS )
+                payload = cbor;
+            else
+                LOG(ERROR, "Failed to encode JSON payload as CBOR. topic: %s | rc: %d", topic, sendrc);
+        }
+        if ( sendrc == IOTPRC_SUCCESS )
+            sendrc = iotp_client_compressPayload(client, topic, payload, payloadlen, &ctopic, &cpayload, &cpayloadlen);
+        if ( sendrc == IOTPRC_SUCCESS ) {
+            if ( cpayload != NULL ) {
+                sendrc = iotp_client_mqttSend(client, mqttClient, ctopic? ctopic:topic, cpayload, cpayloadlen, batch->qos, &opts);
+                iotp_utils_freePtr((void *)ctopic);
+                iotp_utils_freePtr(cpayload);
+            } else {
+                sendrc = iotp_client_mqttSend(client, mqttClient, topic, payload, payloadlen, batch->qos, &opts);
             }
-            cycle++;
         }
+        iotp_utils_freePtr(cbor);
+
+        /* Event is sent in full, outside the delta stream of the topic - next event is sent in full */
+        if ( client->delta.enabled )
+            iotp_delta_invalidate(&client->delta, topic);
+
+        if ( sendrc == MQTTASYNC_MAX_BUFFERED_MESSAGES )
+            sendrc = IOTPRC_WOULDBLOCK;
+        if ( sendrc != MQTTASYNC_SUCCESS ) {
+            ev->rc = sendrc;
+            if ( rc == IOTPRC_SUCCESS )
+                rc = sendrc;
+            __atomic_sub_fetch(&batchctx->pending, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&batchctx->failed, 1, __ATOMIC_RELAXED);
+            __atomic_sub_fetch(&client->stats.bulk.depth, 1, __ATOMIC_RELAXED);
+        } else {
+            accepted += 1;
+            batchctx->windowBytes += ev->payloadlen;
+        }
+    }
+
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to send some events of the batch. count: %d | accepted: %d | rc: %d", batch->count, accepted, rc);
+        if ( accepted > 0 )
+            rc = IOTPRC_PARTIAL_FAILURE;
+    }
 
+    iotp_utils_freePtr((void *)topics);
+
+    /* Release window space of events not accepted by MQTT client */
+    batchctx->windowCount = accepted;
+    iotp_client_releaseWindow(client, IoTPLane_bulk, batch->count - accepted, totalBytes - batchctx->windowBytes);
+
+    /* Release submit reference - invokes callback if all events are already completed */
+    if ( accepted == 0 ) {
+        free(batchctx);
+    } else {
+        iotp_client_completeBatchEvent(batchctx);
     }
 
     return rc;
 }
 
-
-/* Publishes message to a topic with specified QoS, and MQTTProperties */
-IOTPRC iotp_client_publish(void *iotpClient, char *topic, char *payload, int qos, MQTTProperties *props)
+/* Creates a handle for a publish topic. The topic is validated and copied once. */
+IOTPRC iotp_client_prepareTopic(void *iotpClient, const char *topic, IoTPTopic **topicHandle)
 {
     IOTPRC rc = IOTPRC_SUCCESS;
     IoTPClient *client = (IoTPClient *)iotpClient;
@@ -936,48 +2692,106 @@ IOTPRC iotp_client_publish(void *iotpClient, char *topic, char *payload, int qos
         LOG(ERROR, "Invalid client handle");
         return rc;
     }
+    if ( !topic || *topic == '\0' || !topicHandle ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(ERROR, "Invalid or NULL argument. rc: %d", rc);
+        return rc;
+    }
 
-    /* if client is not connected, return error */
-    if ( client->connected == 0 ) {
-        rc = IOTPRC_NOT_CONNECTED;
-        LOG(ERROR, "Not connected");
+    /* publish topic can not have wild card characters, and must fit in an MQTT string */
+    size_t len = strlen(topic);
+    if ( len > 65535 || strpbrk(topic, "+#") != NULL ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(ERROR, "Invalid publish topic. topic: %s | rc: %d", topic, rc);
         return rc;
     }
 
-    MQTTAsync_responseOptions opts = MQTTAsync_responseOptions_initializer;
-    MQTTAsync_message pubmsg = MQTTAsync_message_initializer;
-    MQTTAsync mqttClient = (MQTTAsync *)client->mqttClient;
+    /* allocate handle and topic string in one buffer */
+    IoTPTopic *tp = (IoTPTopic *)malloc(sizeof(IoTPTopic) + len + 1);
+    if ( tp == NULL ) {
+        rc = IOTPRC_NOMEM;
+        LOG(ERROR, "Failed to allocate topic handle. rc: %d", rc);
+        return rc;
+    }
+    tp->client = client;
+    tp->topicLen = (int)len;
+    tp->topic = (char *)(tp + 1);
+    memcpy(tp->topic, topic, len + 1);
 
-    opts.onSuccess5 = onSend;
-    opts.onFailure5 = onSendFailure;
-    opts.context = client;
-    if (props != NULL) {
-        opts.properties = *props;
+    LOG(DEBUG, "Topic handle is created. topic: %s", tp->topic);
+
+    *topicHandle = tp;
+    return rc;
+}
+
+/* Publishes payload buffer to a pre-built topic */
+IOTPRC IoTPTopic_publish(IoTPTopic *topic, void *buffer, size_t bufferlen, QoS qos, MQTTProperties *props)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* Sanity check */
+    if ( !topic || (!buffer && bufferlen > 0) ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Received NULL argument. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+    if ( qos != QoS0 && qos != QoS1 && qos != QoS2 ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(WARN, "Invalid QoS. qos: %d | rc: %d | reason: %s", qos, rc, IOTPRC_toString(rc));
+        return rc;
     }
 
-    int payloadlen = 0;
-    if ( payload && *payload != '\0' )
-        payloadlen = strlen(payload);
+    rc = iotp_client_publishBuffer(topic->client, topic->topic, buffer, bufferlen, qos, props, NULL, NULL);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to publish. topic: %s | rc: %d | reason: %s", topic->topic, rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
+/* Publishes payload buffer to a pre-built topic, and returns delivery token */
+IOTPRC IoTPTopic_publishAsync(IoTPTopic *topic, void *buffer, size_t bufferlen, QoS qos, MQTTProperties *props, IoTPDeliveryHandler deliveryCB, void *context, int *token)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
 
-    pubmsg.payload = payload;
-    pubmsg.payloadlen = payloadlen;
-    pubmsg.qos = qos;
-    pubmsg.retained = 0;
+    /* Sanity check */
+    if ( !topic || (!buffer && bufferlen > 0) ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Received NULL argument. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+    if ( qos != QoS0 && qos != QoS1 && qos != QoS2 ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(WARN, "Invalid QoS. qos: %d | rc: %d | reason: %s", qos, rc, IOTPRC_toString(rc));
+        return rc;
+    }
 
-    LOG(DEBUG, "Publish event. topic: %s | qos: %d | retained: %d | payloadlen: %d | payload: %s",
-                    topic, pubmsg.qos, pubmsg.retained, pubmsg.payloadlen, payload);
+    rc = iotp_client_publishAsync(topic->client, topic->topic, buffer, bufferlen, qos, props, deliveryCB, context, token);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to publish. topic: %s | rc: %d | reason: %s", topic->topic, rc, IOTPRC_toString(rc));
+    }
 
-    rc = MQTTAsync_send(mqttClient, topic, payloadlen, payload, qos, 0, &opts);
-    if ( rc != MQTTASYNC_SUCCESS && rc != IOTPRC_INVALID_HANDLE ) {
-        LOG(ERROR, "MQTTAsync_send returned error: rc=%d", rc);
-        IoTPConfig *config = client->config;
-        if ( config->automaticReconnect == 1 ) {
-            LOG(WARN, "Connection is lost, retry connection and republish message.");
-            iotp_client_retry_connection(mqttClient);
-            rc = MQTTAsync_send(mqttClient, topic, payloadlen, payload, qos, 0, &opts);
-        }
+    return rc;
+}
+
+/* Returns topic string of a topic handle */
+const char * IoTPTopic_getString(IoTPTopic *topic)
+{
+    return topic ? topic->topic : NULL;
+}
+
+/* Destroys a topic handle */
+IOTPRC IoTPTopic_destroy(IoTPTopic *topic)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    if ( topic == NULL ) {
+        rc = IOTPRC_INVALID_HANDLE;
+        LOG(WARN, "Invalid topic handle. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
     }
 
+    free(topic);
     return rc;
 }
 
@@ -1085,6 +2899,7 @@ IOTPRC iotp_client_setEventCallbackHandler(void *iotpClient, int type, IoTPEvent
         return rc;
     }
 
+    pthread_rwlock_wrlock(&client->handlers->lock);
     if ( client->handlers->eventCallback == 0 ) {
         /* Add handler to the list. */
         IoTPHandler * handler = (IoTPHandler *)calloc(1, sizeof(IoTPHandler));
@@ -1094,7 +2909,6 @@ IOTPRC iotp_client_setEventCallbackHandler(void *iotpClient, int type, IoTPEvent
         rc = iotp_add_handler(client->handlers, handler);
         if ( rc == IOTPRC_SUCCESS ) {
             LOG(INFO, "Added Event callback handler.");
-            client->handlers->eventCallback = 1;
         } else {
             LOG(INFO, "Failed to add Event callback handler. rc: %d", rc);
         }
@@ -1109,13 +2923,17 @@ IOTPRC iotp_client_setEventCallbackHandler(void *iotpClient, int type, IoTPEvent
             LOG(INFO, "Invalid type for event callback update. type: %d", type);
         }
     }
+    pthread_rwlock_unlock(&client->handlers->lock);
 
     return rc;
 }
 
 
-/* Sets the callback handler. This must be set if you want to recieve commands */
-IOTPRC iotp_client_setHandler(void *iotpClient, char *topic, int type, IoTPCallbackHandler cbFunc)
+/*
+ * Adds or updates a callback handler. Message handler is invoked with a message descriptor, if descriptor
+ * is set, and batch handler with an array of message descriptors, if batch is set.
+ */
+static IOTPRC iotp_client_addHandler(void *iotpClient, char *topic, int type, void *cbFunc, int descriptor, int batch, void *context)
 {
     IOTPRC rc = IOTPRC_SUCCESS;
     IoTPClient *client = (IoTPClient *)iotpClient;
@@ -1132,36 +2950,33 @@ IOTPRC iotp_client_setHandler(void *iotpClient, char *topic, int type, IoTPCallb
         topic = "iot-2/cmd/#";
     }
 
+    /* handlers can be shared by clients of a group, and read by their receiving and worker threads */
+    pthread_rwlock_wrlock(&client->handlers->lock);
+
     /* Check if command handler is set for all commands */
     if ( client->handlers->allCommandsId != 0 ) {
         if ( type == IoTP_Handler_Commands ) {
             IoTPHandler * handler = client->handlers->entries[client->handlers->allCommandsId - 1];
             if ( handler->type == IoTP_Handler_Commands ) {
+                client->handlers->batchHandlers += batch - handler->batch;
                 handler->cbFunc = cbFunc;
+                handler->descriptor = descriptor;
+                handler->batch = batch;
+                handler->context = context;
                 LOG(INFO, "Callback for all commands is updated.");
-                return rc;
             } else {
                 rc = IOTPRC_FAILURE;
                 LOG(WARN, "Incorrect type to set callback for all commands. type: %d", handler->type);
-                return rc;
             }
         } else {
             rc = IOTPRC_FAILURE;
             LOG(WARN, "Callback for all commands is already set. Can not set callback for topic: %s", topic);
-            return rc;
         }
+        goto handler_set;
     }
 
-    /* Loop thru all set callbacks, update or add */
-    int found = 0;
-    int i=0;
-    for (i = 0; i < client->handlers->count; i++) {
-        IoTPHandler *handler = client->handlers->entries[i];
-        if (topic && handler->topic && iotp_match_mqttTopic(topic, handler->topic) == 1) {
-            found = 1;
-            break;
-        }
-    }
+    /* Update callback of a handler with matching topic filter, or add handler */
+    int found = iotp_trie_match(&client->handlers->trie, topic, strlen(topic));
     if ( found == 0 ) {
         /* Add handler */
         IoTPHandler * handler = (IoTPHandler *)calloc(1, sizeof(IoTPHandler));
@@ -1171,8 +2986,12 @@ IOTPRC iotp_client_setHandler(void *iotpClient, char *topic, int type, IoTPCallb
             handler->topic = strdup(topic);
         }
         handler->cbFunc = cbFunc;
+        handler->descriptor = descriptor;
+        handler->batch = batch;
+        handler->context = context;
         rc = iotp_add_handler(client->handlers, handler);
         if ( rc == IOTPRC_SUCCESS ) {
+            client->handlers->batchHandlers += batch;
             LOG(INFO, "Handler (type=%s) is added. Topic=%s", iotp_client_getHandlerTypeStr(type), topic? topic:"NULL");
         } else {
             LOG(INFO, "Failed to add handler (type=%s) for topic=%s rc=%d", iotp_client_getHandlerTypeStr(type), topic? topic:"NULL", rc);
@@ -1180,20 +2999,73 @@ IOTPRC iotp_client_setHandler(void *iotpClient, char *topic, int type, IoTPCallb
 
     } else {
         /* Update handler */
-        IoTPHandler * handler = client->handlers->entries[i];
+        IoTPHandler * handler = client->handlers->entries[found - 1];
         if ( handler->type == type ) {
+            client->handlers->batchHandlers += batch - handler->batch;
             handler->cbFunc = cbFunc;
+            handler->descriptor = descriptor;
+            handler->batch = batch;
+            handler->context = context;
             LOG(INFO, "Callback is updated for topic: %s", topic);
         } else {
             rc = IOTPRC_FAILURE;
             LOG(INFO, "Callback update is requested for invalid type: %d topic=%s", type, topic);
         }
     }
-    
+
+handler_set:
+    pthread_rwlock_unlock(&client->handlers->lock);
+
     return rc;
 }
 
 
+/* Sets the callback handler. This must be set if you want to recieve commands */
+IOTPRC iotp_client_setHandler(void *iotpClient, char *topic, int type, IoTPCallbackHandler cbFunc)
+{
+    return iotp_client_addHandler(iotpClient, topic, type, (void *)cbFunc, 0, 0, NULL);
+}
+
+/* Sets the message handler, invoked with a message descriptor and user context */
+IOTPRC iotp_client_setMessageHandler(void *iotpClient, char *topic, int type, IoTPMessageHandler cbFunc, void *context)
+{
+    return iotp_client_addHandler(iotpClient, topic, type, (void *)cbFunc, 1, 0, context);
+}
+
+/* Sets the batch handler, invoked with an array of message descriptors and user context */
+IOTPRC iotp_client_setBatchHandler(void *iotpClient, char *topic, int type, IoTPBatchHandler cbFunc, void *context)
+{
+    return iotp_client_addHandler(iotpClient, topic, type, (void *)cbFunc, 1, 1, context);
+}
+
+/*
+ * Uses handlers of another client of a group, so that a handler set once is invoked for messages
+ * received on any connection of the group. Handlers of the client, if any, are discarded.
+ */
+IOTPRC iotp_client_shareHandlers(void *iotpClient, void *ownerClient)
+{
+    IoTPClient *client = (IoTPClient *)iotpClient;
+    IoTPClient *owner = (IoTPClient *)ownerClient;
+
+    /* Sanity check */
+    if ( client == NULL || client->config == NULL || owner == NULL || owner->config == NULL || client == owner ) {
+        LOG(ERROR, "Invalid client handle");
+        return IOTPRC_INVALID_HANDLE;
+    }
+    if ( client->connected || owner->sharedHandlers ) {
+        LOG(ERROR, "Handlers can not be shared. connected: %d", client->connected);
+        return IOTPRC_ARGS_INVALID_VALUE;
+    }
+
+    if ( client->sharedHandlers == 0 )
+        iotp_client_freeHandlers(client->handlers);
+    client->handlers = owner->handlers;
+    client->sharedHandlers = 1;
+
+    return IOTPRC_SUCCESS;
+}
+
+
 /* Set the DM Action Handler - callback function */
 IOTPRC iotp_client_setActionHandler(void *iotpClient, IoTP_DMAction_type_t type, IoTPDMActionHandler cbFunc)
 {
@@ -1209,17 +3081,24 @@ IOTPRC iotp_client_setActionHandler(void *iotpClient, IoTP_DMAction_type_t type,
     }
 
     /* Get topic of the DM Action */
-    if ( type < IoTP_DMResponse && type > IoTP_DMActions ) {
+    if ( type < IoTP_DMResponse || type > IoTP_DMActions ) {
         rc = IOTPRC_HANDLER_INVALID;
         LOG(ERROR, "Invalid handle. type: %d", type);
         return rc;
     }
+    if ( client->managedClient == NULL || client->managedClient->dmTopics[type] == NULL ) {
+        rc = IOTPRC_INVALID_HANDLE;
+        LOG(ERROR, "Not a managed client");
+        return rc;
+    }
 
     /* Get topic string for the handle type */
-    topic = dmActionTopics[type].topic;
+    topic = client->managedClient->dmTopics[type];
 
     LOG(DEBUG, "Set DM Action callback. topic: %s", topic);
 
+    pthread_rwlock_wrlock(&client->handlers->lock);
+
     /* Check if action handler is set for all DM actions */
     if ( client->handlers->allDMActionsId != 0 ) {
         if ( type == IoTP_DMActions ) {
@@ -1227,17 +3106,15 @@ IOTPRC iotp_client_setActionHandler(void *iotpClient, IoTP_DMAction_type_t type,
             if ( handler->type == IoTP_Handler_DMActions ) {
                 handler->cbFunc = cbFunc;
                 LOG(INFO, "Callback for all DM actions is updated.");
-                return rc;
             } else {
                 rc = IOTPRC_FAILURE;
                 LOG(WARN, "Incorrect type to set callback for all DM actions. type: %d", handler->type);
-                return rc;
             }
         } else {
             rc = IOTPRC_FAILURE;
             LOG(WARN, "Callback for all DM actions is already set. topic: %s", topic);
-            return rc;
         }
+        goto action_set;
     }
 
     /* Loop thru all set callbacks, update or add */
@@ -1277,29 +3154,168 @@ IOTPRC iotp_client_setActionHandler(void *iotpClient, IoTP_DMAction_type_t type,
         }
     }
 
+action_set:
+    pthread_rwlock_unlock(&client->handlers->lock);
+
     return rc;
 }
 
 
 /* Handle received messages - invoke the callback. */
-static int iotp_client_messageArrived(void *context, char *topicName, int topicLen, MQTTAsync_message * message)
+/* Returns NUL terminated copy of a slice of the topic in buf, or NULL if the slice is not set */
+static char * iotp_client_sliceString(char *buf, const IoTPMessage *msg, const char *slice, size_t len)
 {
-    IOTPRC rc = IOTPRC_SUCCESS;
-    IoTPClient *client = (IoTPClient *)context;
+    if ( slice == NULL ) {
+        return NULL;
+    }
+    if ( slice < msg->topic || slice > msg->topic + msg->topicLen ) {
+        /* not in topic, e.g. format of decoded payload */
+        return (char *)slice;
+    }
+    buf[(slice - msg->topic) + len] = '\0';
+    return buf + (slice - msg->topic);
+}
 
-    if ( topicLen > 0 ) {
-        LOG(DEBUG, "Message Received. topic: %s | topicLen: %d", topicName? topicName:"", topicLen);
+/*
+ * Invokes IoTPCallbackHandler, that expects NUL terminated topic levels and payload. Topic is copied
+ * once, and levels are terminated in the copy. Payload received from MQTT client is copied, if copyPayload
+ * is set, as its buffer has no space for the terminator. Small messages are copied to stack.
+ */
+static void iotp_client_invokeCallback(IoTPCallbackHandler cb, const IoTPMessage *msg, int copyPayload)
+{
+    char stackbuf[512];
+    char *buf = stackbuf;
+    size_t need = msg->topicLen + 1 + (copyPayload ? msg->payloadlen + 1 : 0);
+    void *payload = (void *)msg->payload;
+    char *type = NULL;
+    char *id = NULL;
+    char *command = NULL;
+    char *format = NULL;
+
+    if ( need > sizeof(stackbuf) ) {
+        buf = (char *)malloc(need);
+        if ( buf == NULL ) {
+            LOG(ERROR, "Failed to allocate buffer for message. topic: %.*s", (int)msg->topicLen, msg->topic);
+            return;
+        }
+    }
+    memcpy(buf, msg->topic, msg->topicLen);
+    buf[msg->topicLen] = '\0';
+    type = iotp_client_sliceString(buf, msg, msg->type, msg->typeLen);
+    id = iotp_client_sliceString(buf, msg, msg->id, msg->idLen);
+    command = iotp_client_sliceString(buf, msg, msg->command, msg->commandLen);
+    format = iotp_client_sliceString(buf, msg, msg->format, msg->formatLen);
+    if ( copyPayload ) {
+        payload = buf + msg->topicLen + 1;
+        memcpy(payload, msg->payload, msg->payloadlen);
+        ((char *)payload)[msg->payloadlen] = '\0';
     }
 
-    /* sanity check */
-    if (client == NULL || (client && client->config == NULL)) {
-        rc = IOTPRC_INVALID_HANDLE;
-        LOG(ERROR, "Invalid client handle");
-        goto msg_processed;
+    (*cb)(type, id, command, format, payload, msg->payloadlen);
+
+    if ( buf != stackbuf )
+        free(buf);
+}
+
+/*
+ * Decompresses payload of a received message and removes compression suffix from format, and decodes
+ * CBOR payload as JSON, if enabled. Decoded payloads are returned in *plain and *json, to be freed by caller.
+ */
+static IOTPRC iotp_client_decodeMessage(IoTPClient *client, IoTPMessage *msg, void **plain, char **json)
+{
+    size_t baseLen = 0;
+    IoTPCompression codec = iotp_compress_fromFormat(msg->format, msg->formatLen, &baseLen);
+
+    if ( codec != IoTPCompression_none ) {
+        size_t plainlen = 0;
+        IOTPRC drc = iotp_compress_decode(codec, msg->payload, msg->payloadlen, plain, &plainlen);
+        if ( drc != IOTPRC_SUCCESS ) {
+            LOG(ERROR, "Failed to decompress message. topic: %.*s | rc: %d", (int)msg->topicLen, msg->topic, drc);
+            return drc;
+        }
+        msg->formatLen = baseLen;
+        msg->payload = *plain;
+        msg->payloadlen = plainlen;
+    }
+
+    /* Decode CBOR payload as JSON, if enabled */
+    if ( client->cborTranscode && msg->formatLen == 4 && !strncmp(msg->format, "cbor", 4) ) {
+        size_t jsonlen = 0;
+        IOTPRC jrc = iotp_cbor_toJson(msg->payload, msg->payloadlen, json, &jsonlen);
+        if ( jrc == IOTPRC_SUCCESS ) {
+            msg->format = "json";
+            msg->payload = *json;
+            msg->payloadlen = jsonlen;
+        } else {
+            LOG(WARN, "Failed to decode CBOR message, message is delivered as is. topic: %.*s | rc: %d", (int)msg->topicLen, msg->topic, jrc);
+        }
+    }
+
+    return IOTPRC_SUCCESS;
+}
+
+/*
+ * Completes a command request, if a received message is a response event with correlation data
+ * of a pending request. Returns IOTPRC_NOT_FOUND, if the message is not a response of a request.
+ */
+static IOTPRC iotp_client_completeCommandRequest(IoTPClient *client, char *topicName, int topicLen, MQTTAsync_message * message, uint64_t arrivalTime)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+    MQTTProperty *correlation = MQTTProperties_getProperty(&message->properties, MQTTPROPERTY_CODE_CORRELATION_DATA);
+    size_t eventLen = (size_t)client->requests.eventLen;
+    uint64_t request = 0;
+    IoTPMessage msg;
+    void *plain = NULL;
+    char *json = NULL;
+    int i;
+
+    if ( correlation == NULL || correlation->value.data.len != 8 ) {
+        return IOTPRC_NOT_FOUND;
+    }
+    iotp_topic_parse(topicName, topicLen > 0 ? (size_t)topicLen : strlen(topicName), &msg);
+    if ( msg.type == NULL || msg.id == NULL || msg.command == NULL || msg.commandLen != eventLen ||
+         strncmp(msg.command, client->requests.event, eventLen) || strncmp(msg.command - 4, "evt/", 4) ) {
+        return IOTPRC_NOT_FOUND;
+    }
+    for (i = 0; i < 8; i++)
+        request = (request << 8) | (unsigned char)correlation->value.data.data[i];
+
+    msg.payload = message->payload;
+    msg.payloadlen = (size_t)message->payloadlen;
+    msg.qos = message->qos;
+    msg.retained = message->retained;
+    msg.properties = &message->properties;
+    msg.arrivalTime = arrivalTime;
+    rc = iotp_client_decodeMessage(client, &msg, &plain, &json);
+    if ( rc == IOTPRC_SUCCESS ) {
+        rc = iotp_rpc_complete(&client->requests, request, iotp_rpc_deviceHash(msg.type, msg.typeLen, msg.id, msg.idLen), &msg);
+        if ( rc != IOTPRC_SUCCESS ) {
+            LOG(WARN, "Response does not match a pending command request. topic: %.*s | request: %llx", (int)msg.topicLen, msg.topic, (unsigned long long)request);
+        }
+    }
+    iotp_utils_freePtr(json);
+    iotp_utils_freePtr(plain);
+
+    return rc;
+}
+
+/*
+ * Invokes callback of a received message. Payload is NUL terminated if payloadTerminated is set,
+ * otherwise it is copied before invoking a callback that expects a NUL terminated payload.
+ */
+static int iotp_client_processMessage(IoTPClient *client, char *topicName, int topicLen, MQTTAsync_message * message, int payloadTerminated, uint64_t arrivalTime)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+    void *context = (void *)client;
+
+    /* Responses of command requests are matched by correlation data, before callbacks */
+    if ( topicName && message->properties.count > 0 && __atomic_load_n(&client->requests.started, __ATOMIC_ACQUIRE) ) {
+        if ( iotp_client_completeCommandRequest(client, topicName, topicLen, message, arrivalTime) == IOTPRC_SUCCESS )
+            goto msg_processed;
     }
 
     /* check for callbacks */
-    if ( client->handlers->count == 0 ) {
+    if ( iotp_client_countHandlers(client->handlers, 0) == 0 ) {
         /* no callback is configured */
         rc = IOTPRC_HANDLER_NOT_FOUND;
         LOG(ERROR, "No callback is found");
@@ -1308,13 +3324,14 @@ static int iotp_client_messageArrived(void *context, char *topicName, int topicL
 
     /* Check if this message is from device management component */
     if ( topicName && strncmp(topicName, DM_ACTION_ROOTTOPIC, DM_ACTION_ROOTTOPIC_LEN) == 0 ) {
-        int rc = iotp_client_dmMessageArrived(context, topicName, topicLen, message);
-        return rc;
+        /* request is consumed - failures are logged, and reported to the platform by DM responses */
+        iotp_client_dmMessageArrived(context, topicName, message->payload, message->payloadlen);
+        goto msg_processed;
     }
 
     /* get callback */
-    IoTPHandler * sub = iotp_client_getHandler(client->handlers, topicName, 0);
-    if ( sub == NULL ) {
+    IoTPHandler sub;
+    if ( iotp_client_getHandler(client->handlers, topicName, 0, &sub) == NULL ) {
         /* no callback is configured */
         rc = IOTPRC_HANDLER_NOT_FOUND;
         LOG(ERROR, "Callback not found for topic. topic: %s", topicName? topicName:"");
@@ -1322,53 +3339,40 @@ static int iotp_client_messageArrived(void *context, char *topicName, int topicL
     }
 
     /* Processing gateway/device commands - Callback type should be greater than IoTP_Handler_Commands */
-    if ( sub->type < IoTP_Handler_Commands ) {
+    if ( sub.type < IoTP_Handler_Commands ) {
         rc = IOTPRC_HANDLER_INVALID;
         goto msg_processed;
     }
 
-    /* Set callback */
-    IoTPCallbackHandler cb = (IoTPCallbackHandler)sub->cbFunc;
-
     /* Process incoming message if callback is defined */
-    if (cb != 0) {
-        char topic[4096];
-        void *payload = message->payload;
-        size_t payloadlen = message->payloadlen;
-        char *type = NULL;
-        char *id = NULL;
-        char *commandName = NULL;
-        char *format = NULL;
-        char *pl = (char *)payload;
-
-        snprintf(topic,4096, "%s", topicName);
-        pl[payloadlen] = '\0';
-        LOG(INFO, "Context: %x | Topic: %s | TopicLen: %d | PayloadLen: %d | Payload: %s", context, topic, topicLen, payloadlen, payload);
-        if ( strncmp(topicName, "iot-2/cmd/", 10) == 0 ) {
-
-            strtok(topic, "/");
-            strtok(NULL, "/");
-            commandName = strtok(NULL, "/");
-            strtok(NULL, "/");
-            format = strtok(NULL, "/");
-
+    if ( sub.cbFunc != NULL ) {
+        IoTPMessage msg;
+        void *plain = NULL;
+        char *json = NULL;
+
+        msg.payload = message->payload;
+        msg.payloadlen = (size_t)message->payloadlen;
+        iotp_topic_parse(topicName, topicLen > 0 ? (size_t)topicLen : strlen(topicName), &msg);
+        msg.qos = message->qos;
+        msg.retained = message->retained;
+        msg.properties = &message->properties;
+        msg.arrivalTime = arrivalTime;
+        LOG(INFO, "Context: %x | Topic: %.*s | TopicLen: %d | PayloadLen: %d", context, (int)msg.topicLen, msg.topic, topicLen, (int)msg.payloadlen);
+
+        /* message can not be processed, if payload can not be decompressed, discard it */
+        if ( iotp_client_decodeMessage(client, &msg, &plain, &json) != IOTPRC_SUCCESS )
+            goto msg_processed;
+
+        LOG(DEBUG, "Invoke callabck to process message: cmd/%.*s | format: %.*s", (int)msg.commandLen, msg.command ? msg.command : "", (int)msg.formatLen, msg.format ? msg.format : "");
+        if ( sub.batch ) {
+            (*(IoTPBatchHandler)sub.cbFunc)(&msg, 1, sub.context);
+        } else if ( sub.descriptor ) {
+            (*(IoTPMessageHandler)sub.cbFunc)(&msg, sub.context);
         } else {
-
-            strtok(topic, "/");
-            strtok(NULL, "/");
-
-            type = strtok(NULL, "/");
-            strtok(NULL, "/");
-            id = strtok(NULL, "/");
-            strtok(NULL, "/");
-            commandName = strtok(NULL, "/");
-            strtok(NULL, "/");
-            format = strtok(NULL, "/");
-
+            iotp_client_invokeCallback((IoTPCallbackHandler)sub.cbFunc, &msg, msg.payload == message->payload && !payloadTerminated);
         }
-
-        LOG(DEBUG, "Invoke callabck to process message: cmd/%s | format: %s", commandName, format);
-        (*cb)(type, id, commandName, format, payload, payloadlen);
+        iotp_utils_freePtr(json);
+        iotp_utils_freePtr(plain);
     } else {
         LOG(DEBUG, "No registered callback function is found to process the arrived message.");
     }
@@ -1380,6 +3384,150 @@ msg_processed:
     return 0;
 }
 
+/* Invokes batch handler of messages collected for a batch, and frees decoded payloads */
+static void iotp_client_deliverBatch(IoTPHandler *handler, IoTPMessage *messages, void **decoded, int count)
+{
+    int i;
+
+    if ( count == 0 ) {
+        return;
+    }
+    LOG(DEBUG, "Invoke batch callback to process messages. count: %d", count);
+    (*(IoTPBatchHandler)handler->cbFunc)(messages, count, handler->context);
+    for (i = 0; i < count * 2; i++) {
+        iotp_utils_freePtr(decoded[i]);
+        decoded[i] = NULL;
+    }
+}
+
+/*
+ * Processes received messages on a dispatch worker thread. Consecutive messages of a batch handler
+ * are passed to the handler with one call, other messages are processed one at a time, in the order
+ * received. Entries are freed by the worker after this returns, so topics, payloads and properties of
+ * the messages are valid till the batch handler returns.
+ */
+static void iotp_client_dispatchMessages(void *context, IoTPDispatchEntry *entries, int count)
+{
+    IoTPClient *client = (IoTPClient *)context;
+    IoTPDispatchEntry *entry = NULL;
+    IoTPHandler *batchHandler = NULL;
+    IoTPHandler batchCopy;
+    IoTPMessage *messages = NULL;
+    void **decoded = NULL;
+    int batched = 0;
+
+    memset(&batchCopy, 0, sizeof(batchCopy));
+
+    /* a message with no batch handler is processed as is */
+    if ( count > 1 && iotp_client_countHandlers(client->handlers, 1) > 0 ) {
+        messages = (IoTPMessage *)malloc((size_t)count * (sizeof(IoTPMessage) + 2 * sizeof(void *)));
+        if ( messages ) {
+            decoded = (void **)(messages + count);
+            memset(decoded, 0, (size_t)count * 2 * sizeof(void *));
+        }
+    }
+
+    for (entry = entries; entry; entry = entry->next) {
+        MQTTAsync_message message = MQTTAsync_message_initializer;
+        IoTPHandler *sub = NULL;
+        IoTPHandler copy;
+
+        /* responses of command requests and device management requests are not batched */
+        if ( messages && !(entry->properties.count > 0 && __atomic_load_n(&client->requests.started, __ATOMIC_ACQUIRE)) &&
+             strncmp(entry->topic, DM_ACTION_ROOTTOPIC, DM_ACTION_ROOTTOPIC_LEN) ) {
+            sub = iotp_client_getHandler(client->handlers, entry->topic, 0, &copy);
+        }
+
+        if ( sub && copy.batch && copy.cbFunc && copy.type >= IoTP_Handler_Commands ) {
+            IoTPMessage *msg = &messages[batched];
+
+            /* a batch has messages of one handler */
+            if ( sub != batchHandler ) {
+                iotp_client_deliverBatch(&batchCopy, messages, decoded, batched);
+                batched = 0;
+                msg = &messages[0];
+                batchHandler = sub;
+                batchCopy = copy;
+            }
+            msg->payload = entry->payload;
+            msg->payloadlen = (size_t)entry->payloadlen;
+            iotp_topic_parse(entry->topic, (size_t)entry->topicLen, msg);
+            msg->qos = entry->qos;
+            msg->retained = entry->retained;
+            msg->properties = &entry->properties;
+            msg->arrivalTime = entry->arrival;
+            /* message can not be processed, if payload can not be decompressed, discard it */
+            if ( iotp_client_decodeMessage(client, msg, &decoded[batched * 2], (char **)&decoded[batched * 2 + 1]) == IOTPRC_SUCCESS ) {
+                batched += 1;
+            } else {
+                iotp_utils_freePtr(decoded[batched * 2]);
+                iotp_utils_freePtr(decoded[batched * 2 + 1]);
+                decoded[batched * 2] = NULL;
+                decoded[batched * 2 + 1] = NULL;
+            }
+            continue;
+        }
+
+        /* messages of the batch are received before this message */
+        iotp_client_deliverBatch(&batchCopy, messages, decoded, batched);
+        batched = 0;
+        batchHandler = NULL;
+
+        message.payload = entry->payload;
+        message.payloadlen = entry->payloadlen;
+        message.qos = entry->qos;
+        message.retained = entry->retained;
+        message.properties = entry->properties;
+        iotp_client_processMessage(client, entry->topic, entry->topicLen, &message, 1, entry->arrival);
+    }
+    iotp_client_deliverBatch(&batchCopy, messages, decoded, batched);
+
+    iotp_utils_freePtr((void *)messages);
+}
+
+static int iotp_client_messageArrived(void *context, char *topicName, int topicLen, MQTTAsync_message * message)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+    IoTPClient *client = (IoTPClient *)context;
+    int processed = 0;
+
+    if ( topicLen > 0 ) {
+        LOG(DEBUG, "Message Received. topic: %s | topicLen: %d", topicName? topicName:"", topicLen);
+    }
+
+    /* sanity check */
+    if (client == NULL || (client && client->config == NULL)) {
+        rc = IOTPRC_INVALID_HANDLE;
+        LOG(ERROR, "Invalid client handle");
+        return 0;
+    }
+
+    /* Callbacks are invoked by the dispatch worker of the device, if workers are configured */
+    if ( client->dispatcher.enabled ) {
+        rc = iotp_dispatch_enqueue(&client->dispatcher, topicName, topicLen, message->payload, message->payloadlen,
+                 message->qos, message->retained, &message->properties);
+        if ( rc == IOTPRC_WOULDBLOCK ) {
+            /* queue of the worker is still full - MQTT client keeps the message, and delivers it again */
+            LOG(DEBUG, "Queue of dispatch worker is full, message is returned to MQTT client. topic: %s", topicName? topicName:"");
+            return 0;
+        }
+        if ( rc != IOTPRC_SUCCESS ) {
+            LOG(ERROR, "Failed to queue message for dispatch worker. topic: %s | rc: %d", topicName? topicName:"", rc);
+            return 0;
+        }
+        processed = 1;
+    } else {
+        processed = iotp_client_processMessage(client, topicName, topicLen, message, 0, iotp_utils_timeMicros());
+    }
+
+    /* message is owned by the client, once it is reported as processed */
+    if ( processed ) {
+        MQTTAsync_freeMessage(&message);
+        MQTTAsync_free(topicName);
+    }
+    return processed;
+}
+
 
 /* Disconnect from the IBM Watson IoT service */
 IOTPRC iotp_client_disconnect(void *iotpClient)
@@ -1402,12 +3550,29 @@ IOTPRC iotp_client_disconnect(void *iotpClient)
     disc_opts.onFailure5 = onDisconnectFailure;
     disc_opts.context = client;
 
+    /* Disconnect also stops background reconnect of MQTT client */
     int isConnected = client->connected;
+    if ( isConnected != 1 && client->state == IoTPConnection_Reconnecting ) {
+        LOG(INFO, "Stop reconnect and disconnect client.");
+        if ( MQTTAsync_disconnect(mqttClient, &disc_opts) == MQTTASYNC_SUCCESS ) {
+            /* wait for disconnect callback, client handle could be destroyed after return */
+            while ( client->state != IoTPConnection_Disconnected && cycle < 100 ) {
+                iotp_utils_delay(100);
+                cycle++;
+            }
+            cycle = 0;
+        }
+        iotp_client_setState(client, IoTPConnection_Disconnected, NULL);
+    }
     if ( isConnected == 1 ) {
+        /* publish events buffered by coalescer, and events in submission queue */
+        iotp_client_flushCoalescer(client);
+        iotp_client_drainSubmitQueue(client);
+
         LOG(INFO, "Disconnect client.");
         int mqttRC = 0;
         mqttRC = MQTTAsync_disconnect(mqttClient, &disc_opts);
-        if ( mqttRC == MQTTASYNC_DISCONNECTED ) {
+        if ( mqttRC == MQTTASYNC_SUCCESS || mqttRC == MQTTASYNC_DISCONNECTED ) {
             rc = IOTPRC_SUCCESS;
         } else {
             rc = mqttRC;
@@ -1443,32 +3608,41 @@ IOTPRC iotp_client_disconnect(void *iotpClient)
         }
     }
 
-    /* Free DM action topics, if set*/
-    iotp_free_dmActionTopics();
-
     return rc;
 }
 
 
-/* increase delay amount based on tries */
-static int reconnect_delay(int i)
+/* 
+ * Retry connection. Requests MQTT client to reconnect in background, and returns
+ * without waiting for the connection to complete.
+ */
+IOTPRC iotp_client_retry_connection(void *iotpClient)
 {
-    if (i < 10) {
-        return 3; /* first 10 attempts try every 3 seconds */
+    IOTPRC rc = IOTPRC_SUCCESS;
+    IoTPClient *client = (IoTPClient *)iotpClient;
+
+    /* Sanity check */
+    if (client == NULL || (client && client->config == NULL)) {
+        rc = IOTPRC_INVALID_HANDLE;
+        LOG(ERROR, "Invalid client handle");
+        return rc;
     }
-    if (i < 20) {
-        return 60; /* next 10 attempts retry after every 1 minute */
+
+    if ( client->connected != 1 ) {
+        rc = MQTTAsync_reconnect((MQTTAsync *)client->mqttClient);
+        if ( rc != MQTTASYNC_SUCCESS ) {
+            LOG(WARN, "Failed to start reconnect. clientId: %s | rc: %d", client->clientId, rc);
+        }
     }
 
-    return 600; /* after 20 attempts, retry every 10 minutes */
+    return rc;
 }
 
-/* Retry connection */
-IOTPRC iotp_client_retry_connection(void *iotpClient)
+/* Sets connection state handler */
+IOTPRC iotp_client_setConnectionStateHandler(void *iotpClient, IoTPConnectionStateHandler cb, void *context)
 {
     IOTPRC rc = IOTPRC_SUCCESS;
     IoTPClient *client = (IoTPClient *)iotpClient;
-    int retry = 1;
 
     /* Sanity check */
     if (client == NULL || (client && client->config == NULL)) {
@@ -1477,12 +3651,313 @@ IOTPRC iotp_client_retry_connection(void *iotpClient)
         return rc;
     }
 
-    while((rc = iotp_client_connect(iotpClient)) != MQTTASYNC_SUCCESS)
-    {
-        int delay = reconnect_delay(retry++);
-        LOG(DEBUG, "Connect retry. attempt: %d | delay: %d", retry, delay);
-        iotp_utils_delay(1000*delay);
+    Thread_lock_mutex(iotp_client_mutex);
+    client->stateCB = cb;
+    client->stateContext = context;
+    Thread_unlock_mutex(iotp_client_mutex);
+
+    LOG(INFO, "Connection state handler is %s.", cb? "set":"cleared");
+
+    return rc;
+}
+
+/* Copies statistics of a lane */
+static void iotp_client_copyLaneStats(IoTPLaneStats *dst, IoTPLaneStats *src)
+{
+    dst->published = __atomic_load_n(&src->published, __ATOMIC_RELAXED);
+    dst->failed = __atomic_load_n(&src->failed, __ATOMIC_RELAXED);
+    dst->depth = __atomic_load_n(&src->depth, __ATOMIC_RELAXED);
+    dst->maxDepth = __atomic_load_n(&src->maxDepth, __ATOMIC_RELAXED);
+    dst->totalLatency = __atomic_load_n(&src->totalLatency, __ATOMIC_RELAXED);
+    dst->maxLatency = __atomic_load_n(&src->maxLatency, __ATOMIC_RELAXED);
+}
+
+/* Returns client statistics */
+IOTPRC iotp_client_getStats(void *iotpClient, IoTPStats *stats)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+    IoTPClient *client = (IoTPClient *)iotpClient;
+
+    /* Sanity check */
+    if (client == NULL || (client && client->config == NULL)) {
+        rc = IOTPRC_INVALID_HANDLE;
+        LOG(ERROR, "Invalid client handle");
+        return rc;
+    }
+    if ( stats == NULL ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Received NULL argument. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    stats->eventsMerged = __atomic_load_n(&client->stats.eventsMerged, __ATOMIC_RELAXED);
+    stats->batchesPublished = __atomic_load_n(&client->stats.batchesPublished, __ATOMIC_RELAXED);
+    stats->eventsDropped = __atomic_load_n(&client->stats.eventsDropped, __ATOMIC_RELAXED);
+    stats->publishesDelayed = __atomic_load_n(&client->stats.publishesDelayed, __ATOMIC_RELAXED);
+    stats->publishesRejected = __atomic_load_n(&client->stats.publishesRejected, __ATOMIC_RELAXED);
+    stats->submitQueued = __atomic_load_n(&client->stats.submitQueued, __ATOMIC_RELAXED);
+    stats->submitFailed = __atomic_load_n(&client->stats.submitFailed, __ATOMIC_RELAXED);
+    stats->topicAliasPublishes = __atomic_load_n(&client->stats.topicAliasPublishes, __ATOMIC_RELAXED);
+    stats->topicAliasBytesSaved = __atomic_load_n(&client->stats.topicAliasBytesSaved, __ATOMIC_RELAXED);
+    stats->deltaPublishes = __atomic_load_n(&client->stats.deltaPublishes, __ATOMIC_RELAXED);
+    stats->deltaSkipped = __atomic_load_n(&client->stats.deltaSkipped, __ATOMIC_RELAXED);
+    stats->deltaBytesSaved = __atomic_load_n(&client->stats.deltaBytesSaved, __ATOMIC_RELAXED);
+    iotp_client_copyLaneStats(&stats->control, &client->stats.control);
+    iotp_client_copyLaneStats(&stats->bulk, &client->stats.bulk);
+    iotp_rpc_getStats(&client->requests, stats);
+    iotp_dispatch_getStats(&client->dispatcher, stats);
+
+    return rc;
+}
+
+/* Callback of successful subscription to command responses */
+static void iotp_client_onResponseSubscribe(void* context, MQTTAsync_successData5 *response)
+{
+    IoTPClient *client = (IoTPClient *)context;
+    IoTPRequests *requests = &client->requests;
+
+    pthread_mutex_lock(&requests->lock);
+    if ( requests->subscribed == IOTP_RPC_SUBSCRIBING ) {
+        if ( response && response->reasonCode >= MQTTREASONCODE_UNSPECIFIED_ERROR ) {
+            LOG(WARN, "Subscription to command responses is rejected. clientId: %s | reasonCode: %d", client->clientId, response->reasonCode);
+            requests->subscribed = IOTP_RPC_UNSUBSCRIBED;
+        } else {
+            LOG(DEBUG, "Subscribed to command responses. clientId: %s | event: %s", client->clientId, requests->event);
+            requests->subscribed = IOTP_RPC_SUBSCRIBED;
+        }
+    }
+    pthread_cond_broadcast(&requests->subscribeCond);
+    pthread_mutex_unlock(&requests->lock);
+}
+
+/* Callback of failed subscription to command responses */
+static void iotp_client_onResponseSubscribeFailure(void* context, MQTTAsync_failureData5 *response)
+{
+    IoTPClient *client = (IoTPClient *)context;
+    IoTPRequests *requests = &client->requests;
+
+    LOG(WARN, "Failed to subscribe to command responses. clientId: %s | rc: %d", client->clientId, response ? response->code : IOTPRC_FAILURE);
+    pthread_mutex_lock(&requests->lock);
+    if ( requests->subscribed == IOTP_RPC_SUBSCRIBING )
+        requests->subscribed = IOTP_RPC_UNSUBSCRIBED;
+    pthread_cond_broadcast(&requests->subscribeCond);
+    pthread_mutex_unlock(&requests->lock);
+}
+
+/*
+ * Subscribes to command responses of the connection, if not yet subscribed, and waits until the
+ * subscription is acknowledged, so that a response can not be sent before the subscription is made.
+ * Only one thread subscribes, other threads wait for its subscription.
+ */
+static IOTPRC iotp_client_subscribeResponses(IoTPClient *client)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+    IoTPRequests *requests = &client->requests;
+    uint64_t deadline = 0;
+    struct timespec ts;
+
+    pthread_mutex_lock(&requests->lock);
+    if ( requests->subscribed == IOTP_RPC_SUBSCRIBED ) {
+        pthread_mutex_unlock(&requests->lock);
+        return rc;
     }
+    if ( requests->subscribed == IOTP_RPC_UNSUBSCRIBED ) {
+        MQTTAsync_responseOptions opts = MQTTAsync_responseOptions_initializer;
+        int len = strlen("iot-2/type/+/id/+/evt//fmt/+") + requests->eventLen + 1;
+        char topic[len];
+
+        snprintf(topic, len, "iot-2/type/+/id/+/evt/%s/fmt/+", requests->event);
+        opts.onSuccess5 = iotp_client_onResponseSubscribe;
+        opts.onFailure5 = iotp_client_onResponseSubscribeFailure;
+        opts.context = client;
+        requests->subscribed = IOTP_RPC_SUBSCRIBING;
+        pthread_mutex_unlock(&requests->lock);
+
+        LOG(DEBUG, "Subscribe to command responses. topic: %s", topic);
+        rc = MQTTAsync_subscribe((MQTTAsync)client->mqttClient, topic, QoS1, &opts);
+
+        pthread_mutex_lock(&requests->lock);
+        if ( rc != MQTTASYNC_SUCCESS ) {
+            LOG(ERROR, "Failed to subscribe to command responses. rc: %d", rc);
+            if ( requests->subscribed == IOTP_RPC_SUBSCRIBING )
+                requests->subscribed = IOTP_RPC_UNSUBSCRIBED;
+            pthread_cond_broadcast(&requests->subscribeCond);
+            pthread_mutex_unlock(&requests->lock);
+            return rc;
+        }
+    }
+
+    deadline = iotp_utils_timeMicros() + (uint64_t)IOTP_RPC_SUBSCRIBE_TIMEOUT * 1000;
+    iotp_utils_deadline(deadline, &ts);
+    while ( requests->subscribed == IOTP_RPC_SUBSCRIBING ) {
+        if ( pthread_cond_timedwait(&requests->subscribeCond, &requests->lock, &ts) == ETIMEDOUT )
+            break;
+    }
+    if ( requests->subscribed == IOTP_RPC_SUBSCRIBING ) {
+        rc = IOTPRC_TIMEOUT;
+        LOG(ERROR, "Subscription to command responses is not acknowledged. rc: %d", rc);
+    } else if ( requests->subscribed != IOTP_RPC_SUBSCRIBED ) {
+        rc = IOTPRC_FAILURE;
+    }
+    pthread_mutex_unlock(&requests->lock);
+
+    return rc;
+}
+
+/*
+ * Sends a command with Response Topic and Correlation Data properties, and adds a request that is
+ * completed by the response event of the device, or times out. Responses of all devices are received
+ * using one subscription, that is made and acknowledged before the first request of a connection is sent.
+ */
+IOTPRC iotp_client_sendCommandRequest(void *iotpClient, char *topic, char *typeId, char *deviceId, void *payload, size_t payloadlen, int qos, MQTTProperties *props, int timeout, IoTPCommandResponseHandler cb, void *context, uint64_t *request)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+    IoTPClient *client = (IoTPClient *)iotpClient;
+    MQTTProperties reqProps = MQTTProperties_initializer;
+    MQTTProperty property;
+    unsigned char correlation[8];
+    uint64_t handle = 0;
+    const char *format = NULL;
+    int i;
+
+    /* Sanity check */
+    if ( client == NULL || (client && client->config == NULL) ) {
+        rc = IOTPRC_INVALID_HANDLE;
+        LOG(ERROR, "Invalid client handle");
+        return rc;
+    }
+    if ( __atomic_load_n(&client->connected, __ATOMIC_ACQUIRE) != 1 ) {
+        rc = IOTPRC_NOT_CONNECTED;
+        LOG(ERROR, "Not connected");
+        return rc;
+    }
+
+    rc = iotp_client_subscribeResponses(client);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to subscribe to command responses. rc: %d", rc);
+        return rc;
+    }
+
+    rc = iotp_rpc_add(&client->requests, iotp_rpc_deviceHash(typeId, strlen(typeId), deviceId, strlen(deviceId)), timeout, cb, context, &handle);
+    if ( rc != IOTPRC_SUCCESS ) {
+        return rc;
+    }
+
+    /* Response is an event of the device, named after the connection, in format of the command */
+    format = strrchr(topic, '/') + 1;
+    int len = strlen("iot-2/evt//fmt/") + client->requests.eventLen + strlen(format) + 1;
+    char responseTopic[len];
+    snprintf(responseTopic, len, "iot-2/evt/%s/fmt/%s", client->requests.event, format);
+
+    /* Correlation data is the request handle, in network byte order */
+    for (i = 0; i < 8; i++)
+        correlation[i] = (unsigned char)(handle >> (56 - 8 * i));
+
+    if ( props != NULL )
+        reqProps = MQTTProperties_copy(props);
+    property.identifier = MQTTPROPERTY_CODE_RESPONSE_TOPIC;
+    property.value.data.data = responseTopic;
+    property.value.data.len = (int)strlen(responseTopic);
+    MQTTProperties_add(&reqProps, &property);
+    property.identifier = MQTTPROPERTY_CODE_CORRELATION_DATA;
+    property.value.data.data = (char *)correlation;
+    property.value.data.len = 8;
+    MQTTProperties_add(&reqProps, &property);
+
+    /* response can be received before publish returns */
+    if ( request != NULL )
+        *request = handle;
+
+    LOG(DEBUG, "Send command request. topic: %s | request: %llx | timeout: %d", topic, (unsigned long long)handle, timeout);
+    rc = iotp_client_publishBuffer(iotpClient, topic, payload, payloadlen, qos, &reqProps, NULL, NULL);
+    MQTTProperties_free(&reqProps);
+    if ( rc != IOTPRC_SUCCESS ) {
+        iotp_rpc_cancel(&client->requests, handle);
+    }
+
+    return rc;
+}
+
+/* Cancels a command request. Handler of the request is not invoked. */
+IOTPRC iotp_client_cancelCommandRequest(void *iotpClient, uint64_t request)
+{
+    IoTPClient *client = (IoTPClient *)iotpClient;
+
+    /* Sanity check */
+    if ( client == NULL || (client && client->config == NULL) ) {
+        LOG(ERROR, "Invalid client handle");
+        return IOTPRC_INVALID_HANDLE;
+    }
+
+    return iotp_rpc_cancel(&client->requests, request);
+}
+
+/*
+ * Sends response of a command to the Response Topic of the command, with its Correlation Data.
+ * A gateway sends response of a command of an attached device, as an event of the device.
+ */
+IOTPRC iotp_client_sendCommandResponse(void *iotpClient, const IoTPMessage *command, void *payload, size_t payloadlen, int qos)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+    IoTPClient *client = (IoTPClient *)iotpClient;
+    MQTTProperties *cmdProps = NULL;
+    MQTTProperties respProps = MQTTProperties_initializer;
+    MQTTProperty *responseTopic = NULL;
+    MQTTProperty *correlation = NULL;
+    char *topic = NULL;
+    int len = 0;
+
+    /* Sanity check */
+    if ( client == NULL || (client && client->config == NULL) ) {
+        rc = IOTPRC_INVALID_HANDLE;
+        LOG(ERROR, "Invalid client handle");
+        return rc;
+    }
+    if ( command == NULL ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Received NULL argument. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    cmdProps = (MQTTProperties *)command->properties;
+    if ( cmdProps != NULL )
+        responseTopic = MQTTProperties_getProperty(cmdProps, MQTTPROPERTY_CODE_RESPONSE_TOPIC);
+    if ( responseTopic == NULL || responseTopic->value.data.len <= 0 ) {
+        rc = IOTPRC_NOT_FOUND;
+        LOG(WARN, "Command has no response topic. topic: %.*s | rc: %d", (int)command->topicLen, command->topic, rc);
+        return rc;
+    }
+
+    len = responseTopic->value.data.len;
+    if ( (client->type == IoTPClient_gateway || client->type == IoTPClient_managed_gateway) && command->type && command->id &&
+         len > 10 && !strncmp(responseTopic->value.data.data, "iot-2/evt/", 10) ) {
+        len += (int)(command->typeLen + command->idLen) + 10;
+        topic = (char *)malloc((size_t)len + 1);
+        if ( topic )
+            snprintf(topic, (size_t)len + 1, "iot-2/type/%.*s/id/%.*s/%.*s", (int)command->typeLen, command->type, (int)command->idLen, command->id,
+                responseTopic->value.data.len - 6, responseTopic->value.data.data + 6);
+    } else {
+        topic = (char *)malloc((size_t)len + 1);
+        if ( topic ) {
+            memcpy(topic, responseTopic->value.data.data, (size_t)len);
+            topic[len] = '\0';
+        }
+    }
+    if ( topic == NULL ) {
+        return IOTPRC_NOMEM;
+    }
+
+    correlation = MQTTProperties_getProperty(cmdProps, MQTTPROPERTY_CODE_CORRELATION_DATA);
+    if ( correlation != NULL )
+        MQTTProperties_add(&respProps, correlation);
+
+    LOG(DEBUG, "Send command response. topic: %s", topic);
+    rc = iotp_client_publishBuffer(iotpClient, topic, payload, payloadlen, qos, &respProps, NULL, NULL);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to send command response. topic: %s | rc: %d | Reason: %s", topic, rc, IOTPRC_toString(rc));
+    }
+    MQTTProperties_free(&respProps);
+    iotp_utils_freePtr(topic);
 
     return rc;
 }
@@ -1538,16 +4013,10 @@ IOTPRC iotp_client_manage(void *iotpClient)
     IoTPManagedClient *managedClient = NULL;
     MQTTProperties *props = NULL;
     char uuid_str[64];
-    char *payload;
-    int plLen = 0;
+    char buffer[512];
+    IoTPJsonWriter json;
+    const char *payload = NULL;
     char *reqId = NULL;
-    char *dInfo = NULL;
-    char *mData = NULL;
-    int reqIdLen = 0;
-    int dInfoLen = 0;
-    int mDataLen = 0;
-    char *plFormat = "{\"d\":{\"metadata\":%s ,\"lifetime\":%ld,\"supports\":{\"deviceActions\":%d,\"firmwareActions\":%d},\"deviceInfo\":%s},\"reqId\":\"%s\"}";
-    int fmLen = strlen(plFormat);
 
     /* verify handle */
     if ( !client || client->managedClient == NULL ) {
@@ -1564,76 +4033,50 @@ IOTPRC iotp_client_manage(void *iotpClient)
 
     managedClient = client->managedClient;
 
-    /* set request ID */
+    /* set request ID - responses are matched with request ID by receiving thread */
+    pthread_mutex_lock(&managedClient->lock);
     if ( managedClient->reqID == NULL ) {
         iotp_utils_generateUUID(uuid_str);
         managedClient->reqID = strdup(uuid_str);
     }
     reqId = managedClient->reqID;
-    reqIdLen = strlen(reqId);
-    if ( managedClient->metadata != NULL ) {
-        mData = managedClient->metadata;
-    } else {
-        mData = "{}";
-    }
-    mDataLen = strlen(mData);
-    if ( managedClient->deviceInfo != NULL ) {
-        dInfo = managedClient->deviceInfo;
-    } else {
-        dInfo = "{}";
-    }
-    dInfoLen = strlen(dInfo);
-
-    plLen = fmLen + mDataLen + dInfoLen + reqIdLen + 10;
-    payload = (char *)calloc(1, plLen);
-
-    snprintf(payload, plLen, plFormat, mData, managedClient->lifetime, managedClient->supportsDeviceActions,
-        managedClient->supportsFirmwareActions, dInfo, reqId);
- 
-    if ( client->type == IoTPClient_managed_gateway ) {
-        char *typeId = iotp_client_getDeviceType(client);
-        char *deviceId = iotp_client_getDeviceId(client);
-
-        /* Initialize DM action topics */
-        iotp_init_dmActionTopics(IoTPClient_managed_gateway, typeId, deviceId);
-
-        rc = iotp_client_subscribe(iotpClient, "iotdm-1/#", QoS0);
-        if ( rc == IOTPRC_SUCCESS ) {
-            int prefixLen = strlen(DM_GATEWAY_TOPIC_PREFIXFMT) + strlen(typeId) + strlen(deviceId) + 1;
-            int pubtopicLen = prefixLen + strlen(DM_MANAGE) + 1;
-            char prefix[prefixLen];
-            char pubtopic[pubtopicLen];
-            snprintf(prefix, prefixLen, DM_GATEWAY_TOPIC_PREFIXFMT, typeId, deviceId); 
-            snprintf(pubtopic, pubtopicLen, "%s%s", prefix, DM_MANAGE); 
-            rc = iotp_client_publish(iotpClient, pubtopic, payload, QoS1, props);
-            if ( rc == IOTPRC_SUCCESS ) {
-                LOG(INFO, "Managed Gateway request sent. reqId: %s", reqId);
-                client->managed = 1;
-            } else {
-                LOG(INFO, "Failed to send Managed Gateway request");
-            }
-        }
 
-    } else {
-
-        /* Initialize DM action topics */
-        iotp_init_dmActionTopics(IoTPClient_managed_device, NULL, NULL);
+    /* metadata and deviceInfo are set by the user as JSON objects */
+    IoTPJsonWriter_init(&json, buffer, sizeof(buffer));
+    IoTPJsonWriter_beginObject(&json, NULL);
+    IoTPJsonWriter_beginObject(&json, "d");
+    IoTPJsonWriter_addRaw(&json, "metadata", managedClient->metadata ? managedClient->metadata : "{}");
+    IoTPJsonWriter_addInt(&json, "lifetime", managedClient->lifetime);
+    IoTPJsonWriter_beginObject(&json, "supports");
+    IoTPJsonWriter_addInt(&json, "deviceActions", managedClient->supportsDeviceActions);
+    IoTPJsonWriter_addInt(&json, "firmwareActions", managedClient->supportsFirmwareActions);
+    IoTPJsonWriter_endObject(&json);
+    IoTPJsonWriter_addRaw(&json, "deviceInfo", managedClient->deviceInfo ? managedClient->deviceInfo : "{}");
+    IoTPJsonWriter_endObject(&json);
+    IoTPJsonWriter_addString(&json, "reqId", reqId);
+    IoTPJsonWriter_endObject(&json);
+    pthread_mutex_unlock(&managedClient->lock);
+    rc = IoTPJsonWriter_getString(&json, &payload, NULL);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to build manage request. rc: %d", rc);
+        IoTPJsonWriter_free(&json);
+        return rc;
+    }
 
-        rc = iotp_client_subscribe(iotpClient, "iotdm-1/#", QoS0);
+    /* Manage request of a managed gateway is published to the topic of the gateway device */
+    rc = iotp_client_subscribe(iotpClient, "iotdm-1/#", QoS0);
+    if ( rc == IOTPRC_SUCCESS ) {
+        char pubtopic[iotp_client_dmTopicLen(client, DM_MANAGE)];
+        rc = iotp_client_publish(iotpClient, iotp_client_dmTopic(client, pubtopic, sizeof(pubtopic), DM_MANAGE), (char *)payload, QoS1, props);
         if ( rc == IOTPRC_SUCCESS ) {
-            int pubtopicLen = strlen(DM_DEVICE_TOPIC_PREFIXFMT) + strlen(DM_MANAGE) + 1;
-            char pubtopic[pubtopicLen];
-            snprintf(pubtopic, pubtopicLen, "%s%s", DM_DEVICE_TOPIC_PREFIXFMT, DM_MANAGE); 
-            rc = iotp_client_publish(iotpClient, pubtopic, payload, QoS1, props);
-            if ( rc == IOTPRC_SUCCESS ) {
-                LOG(INFO, "Managed Device request sent. reqId: %s", reqId);
-                client->managed = 1;
-            } else {
-                LOG(INFO, "Failed to send Managed Device request");
-            }
+            LOG(INFO, "%s request sent. topic: %s", client->type == IoTPClient_managed_gateway ? "Managed Gateway" : "Managed Device", pubtopic);
+            client->managed = 1;
+        } else {
+            LOG(INFO, "Failed to send %s request", client->type == IoTPClient_managed_gateway ? "Managed Gateway" : "Managed Device");
         }
     }
 
+    IoTPJsonWriter_free(&json);
     return rc;
 }
 
@@ -1646,7 +4089,9 @@ IOTPRC iotp_client_unmanage(void *iotpClient, char *reqId)
     MQTTProperties *props = NULL;
 
     char uuid_str[40];
-    char data[96];
+    char buffer[128];
+    IoTPJsonWriter json;
+    const char *data = NULL;
 
     /* verify handle */
     if ( !client || client->managedClient == NULL ) {
@@ -1663,9 +4108,9 @@ IOTPRC iotp_client_unmanage(void *iotpClient, char *reqId)
 
     managedClient = client->managedClient;
 
-    /* set request ID */
+    /* set request ID - responses are matched with request ID by receiving thread */
+    pthread_mutex_lock(&managedClient->lock);
     if ( reqId != NULL && *reqId != '\0' ) {
-        snprintf(data, 96, "{\"reqId\":\"%s\"}", reqId);
         if ( managedClient->reqID != NULL ) {
             iotp_utils_freePtr((void *)managedClient->reqID);
         }
@@ -1675,14 +4120,23 @@ IOTPRC iotp_client_unmanage(void *iotpClient, char *reqId)
             iotp_utils_generateUUID(uuid_str);
             managedClient->reqID = strdup(uuid_str);
         }
-        snprintf(data, 96, "{\"reqId\":\"%s\"}", managedClient->reqID);
     }
 
-    rc = iotp_client_publish(iotpClient, DM_UNMANAGE, data, QoS0, props);
+    IoTPJsonWriter_init(&json, buffer, sizeof(buffer));
+    IoTPJsonWriter_beginObject(&json, NULL);
+    IoTPJsonWriter_addString(&json, "reqId", managedClient->reqID);
+    IoTPJsonWriter_endObject(&json);
+    pthread_mutex_unlock(&managedClient->lock);
+    rc = IoTPJsonWriter_getString(&json, &data, NULL);
+    if ( rc == IOTPRC_SUCCESS ) {
+        char topic[iotp_client_dmTopicLen(client, DM_UNMANAGE)];
+        rc = iotp_client_publish(iotpClient, iotp_client_dmTopic(client, topic, sizeof(topic), DM_UNMANAGE), (char *)data, QoS0, props);
+    }
     if (rc == IOTPRC_SUCCESS) {
-        LOG(DEBUG, "reqId = %s", managedClient->reqID);
+        LOG(DEBUG, "Unmanage request sent. request: %s", data);
         client->managed = 0;
     }
+    IoTPJsonWriter_free(&json);
 
     return rc;
 }
@@ -1692,18 +4146,17 @@ static IoTPDMActionHandler iotp_getActionCallback(IoTPClient *client, char *topi
     IoTPDMActionHandler cb = NULL;
 
     /* check if callbacks are set */
-    if ( client->handlers->count == 0 ) {
+    if ( iotp_client_countHandlers(client->handlers, 0) == 0 ) {
         /* no callback is configured */
         LOG(ERROR, "No callbacks are set for this client.");
         return NULL;
     }
 
     /* get DM Action callback */
-    IoTPHandler * sub = iotp_client_getHandler(client->handlers, topicName, 0);
-    if ( sub == NULL ) {
+    IoTPHandler sub;
+    if ( iotp_client_getHandler(client->handlers, topicName, 0, &sub) == NULL ) {
         /* check if action handler for all actions are set */
-        sub = iotp_client_getHandler(client->handlers, DM_ACTION_ALL, 0);
-        if ( sub == NULL ) {
+        if ( iotp_client_getHandler(client->handlers, DM_ACTION_ALL, 0, &sub) == NULL ) {
             /* no callback is configured */
             LOG(ERROR, "Callback not found. topic: %s", topicName? topicName:"");
             return NULL;
@@ -1711,18 +4164,42 @@ static IoTPDMActionHandler iotp_getActionCallback(IoTPClient *client, char *topi
     }
 
     /* Callback type for DM actions should be less than IoTP_Handler_Commands */
-    if ( sub->type >= IoTP_Handler_Commands ) {
+    if ( sub.type >= IoTP_Handler_Commands ) {
         LOG(ERROR, "Invalid callback set. topic: %s", topicName? topicName:"");
         return NULL;
     }
 
     /* Set callback */
-    cb = (IoTPDMActionHandler)sub->cbFunc;
+    cb = (IoTPDMActionHandler)sub.cbFunc;
     LOG(DEBUG, "Device Management action callback found for topic: %s", topicName? topicName:"");
 
     return cb;
 }
 
+/* Send response of a device management action */
+static IOTPRC iotp_client_sendDMResponse(IoTPClient *client, int status, char *reqID)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+    char buffer[128];
+    IoTPJsonWriter json;
+    const char *response = NULL;
+
+    IoTPJsonWriter_init(&json, buffer, sizeof(buffer));
+    IoTPJsonWriter_beginObject(&json, NULL);
+    IoTPJsonWriter_addInt(&json, "rc", status);
+    IoTPJsonWriter_addString(&json, "reqId", reqID);
+    IoTPJsonWriter_endObject(&json);
+    rc = IoTPJsonWriter_getString(&json, &response, NULL);
+    if ( rc == IOTPRC_SUCCESS ) {
+        char topic[iotp_client_dmTopicLen(client, DM_RESPONSE)];
+        LOG(DEBUG,"Response: %s", response);
+        rc = iotp_client_publish(client, iotp_client_dmTopic(client, topic, sizeof(topic), DM_RESPONSE), (char *)response, QoS1, NULL);
+    }
+    IoTPJsonWriter_free(&json);
+
+    return rc;
+}
+
 /* Update device location */
 static int iotp_updateLocationData(IoTPClient *client, char *reqID, int loc, int max, IoTP_json_parse_t *pobj)
 {
@@ -1755,11 +4232,27 @@ static int iotp_updateLocationData(IoTPClient *client, char *reqID, int loc, int
         loc++;
     }
 
-    char data[1024];
-    snprintf(data, 1024, "{\"d\":{\"longitude\":%f,\"latitude\":%f,\"elevation\":%f,\"measuredDateTime\":\"%s\",\"updatedDateTime\":\"%s\",\"accuracy\":%f},\"reqId\":\"%s\"}",
-        latitude, longitude, elevation, measuredDateTime?measuredDateTime:"", updatedDateTime?updatedDateTime:"", accuracy, reqID);
-
-    iotp_client_publish(client, DM_UPDATE_LOCATION, data, QoS1, NULL);
+    char buffer[512];
+    IoTPJsonWriter json;
+    const char *data = NULL;
+
+    IoTPJsonWriter_init(&json, buffer, sizeof(buffer));
+    IoTPJsonWriter_beginObject(&json, NULL);
+    IoTPJsonWriter_beginObject(&json, "d");
+    IoTPJsonWriter_addDouble(&json, "longitude", longitude);
+    IoTPJsonWriter_addDouble(&json, "latitude", latitude);
+    IoTPJsonWriter_addDouble(&json, "elevation", elevation);
+    IoTPJsonWriter_addString(&json, "measuredDateTime", measuredDateTime ? measuredDateTime : "");
+    IoTPJsonWriter_addString(&json, "updatedDateTime", updatedDateTime ? updatedDateTime : "");
+    IoTPJsonWriter_addDouble(&json, "accuracy", accuracy);
+    IoTPJsonWriter_endObject(&json);
+    IoTPJsonWriter_addString(&json, "reqId", reqID);
+    IoTPJsonWriter_endObject(&json);
+    if ( IoTPJsonWriter_getString(&json, &data, NULL) == IOTPRC_SUCCESS ) {
+        char topic[iotp_client_dmTopicLen(client, DM_UPDATE_LOCATION)];
+        iotp_client_publish(client, iotp_client_dmTopic(client, topic, sizeof(topic), DM_UPDATE_LOCATION), (char *)data, QoS1, NULL);
+    }
+    IoTPJsonWriter_free(&json);
     return loc;
 }
 
@@ -1767,8 +4260,7 @@ static int iotp_updateLocationData(IoTPClient *client, char *reqID, int loc, int
 /* Update firmware data */
 static int iotp_updateFirmwareData(IoTPClient *client, IoTPManagedClient *managedClient, char *reqID, int loc, int max, IoTP_json_parse_t *pobj)
 {
-    char response[128];
-
+    pthread_mutex_lock(&managedClient->lock);
     while ( loc <= max ) {
         IoTP_json_entry_t * ent = pobj->ent+loc;
         if ( ent->objtype == JSON_Object || ent->objtype == JSON_Array ) break;
@@ -1803,11 +4295,9 @@ static int iotp_updateFirmwareData(IoTPClient *client, IoTPManagedClient *manage
 
         loc++;
     }
+    pthread_mutex_unlock(&managedClient->lock);
 
-    sprintf(response, "{\"rc\":%d,\"reqId\":\"%s\"}", DM_ACTION_RC_UPDATE_SUCCESS, reqID);
-    LOG(DEBUG,"Response: %s", response);
-
-    iotp_client_publish(client, DM_RESPONSE, response, QoS1, NULL);
+    iotp_client_sendDMResponse(client, DM_ACTION_RC_UPDATE_SUCCESS, reqID);
 
     return loc;
 }
@@ -1823,7 +4313,7 @@ static int iotp_client_dmProcessReponse(IoTPClient *client, IoTPManagedClient *m
     char *status = iotp_json_getString(pobj, "status");
 
     if ( cb != 0 ) {
-        /* Invoke callback if returned request ID matches with request ID of the client */
+        /* Invoke callback - returned request ID matches with request ID of the client */
         LOG(DEBUG, "Invoke registered callback. reqID: %s | status: %s", reqID, status?status:"");
         (*cb)(IoTP_DMResponse, (char *)reqID, pl, payloadlen);
     } else {
@@ -1831,19 +4321,20 @@ static int iotp_client_dmProcessReponse(IoTPClient *client, IoTPManagedClient *m
         LOG(WARN, "No registered callback found. reqID: %s | status: %s", reqID, status?status:"");
     }
 
-    if ( rc == IOTPRC_SUCCESS )
-        return 1;
-
-    return 0;
+    return rc;
 }
 
 /* Handle firmware download message */
 static int iotp_client_dmProcessFirmwareDownload(IoTPClient *client, IoTPManagedClient *managedClient, char *topicName, int payloadlen, char *pl, IoTP_json_parse_t *pobj, char *reqID)
 {
     IOTPRC rc = IOTPRC_SUCCESS;
+    int state = FIRMWARESTATE_IDLE;
 
     /* check firmware state */
-    if (managedClient != NULL && managedClient->deviceFirmware.state != FIRMWARESTATE_IDLE) {
+    pthread_mutex_lock(&managedClient->lock);
+    state = managedClient->deviceFirmware.state;
+    pthread_mutex_unlock(&managedClient->lock);
+    if ( state != FIRMWARESTATE_IDLE ) {
         rc = DM_ACTION_RC_BAD_REQUEST;
         LOG(ERROR,"Device is not in the idle state");
         return rc;
@@ -1854,9 +4345,7 @@ static int iotp_client_dmProcessFirmwareDownload(IoTPClient *client, IoTPManaged
 
     LOG(DEBUG,"Initiate Firmware Download. reqID: %s", reqID);
 
-    char respmsg[128];
-    snprintf(respmsg, 128, "{\"rc\":%d,\"reqId\":%s}", DM_ACTION_RC_RESPONSE_ACCEPTED, reqID);
-    iotp_client_publish(client, DM_RESPONSE, respmsg, QoS1, NULL);
+    iotp_client_sendDMResponse(client, DM_ACTION_RC_RESPONSE_ACCEPTED, reqID);
 
     if ( cb != 0 ) {
         (*cb)(IoTP_DMFirmwareDownload, reqID, pl, payloadlen);
@@ -1872,10 +4361,13 @@ static int iotp_client_dmProcessFirmwareDownload(IoTPClient *client, IoTPManaged
 static int iotp_client_dmProcessFirmwareUpdate(IoTPClient *client, IoTPManagedClient *managedClient, char *topicName, int payloadlen, char *pl, IoTP_json_parse_t *pobj, char *reqID)
 {
     IOTPRC rc = IOTPRC_SUCCESS;
+    int state = FIRMWARESTATE_IDLE;
 
     /* check managed node firmware state */
-    managedClient = client->managedClient;
-    if (managedClient != NULL && managedClient->deviceFirmware.state != FIRMWARESTATE_DOWNLOADED) {
+    pthread_mutex_lock(&managedClient->lock);
+    state = managedClient->deviceFirmware.state;
+    pthread_mutex_unlock(&managedClient->lock);
+    if ( state != FIRMWARESTATE_DOWNLOADED ) {
         rc = DM_ACTION_RC_BAD_REQUEST;
         LOG(ERROR,"The firmware image is not downloaded yet");
         return rc;
@@ -1886,10 +4378,7 @@ static int iotp_client_dmProcessFirmwareUpdate(IoTPClient *client, IoTPManagedCl
 
     LOG(DEBUG, "Initiate Firmware Update. reqId: %s", reqID);
 
-    char respmsg[128];
-    snprintf(respmsg, 128, "{\"rc\":%d,\"reqId\":%s}", DM_ACTION_RC_RESPONSE_ACCEPTED, reqID);
-
-    iotp_client_publish(client, DM_RESPONSE, respmsg, QoS1, NULL);
+    iotp_client_sendDMResponse(client, DM_ACTION_RC_RESPONSE_ACCEPTED, reqID);
 
     if ( cb != 0 ) {
         (*cb)(IoTP_DMFirmwareUpdate, reqID, pl, payloadlen);
@@ -1927,7 +4416,7 @@ static int iotp_client_dmProcessUpdate(IoTPClient *client, IoTPManagedClient *ma
                     entnum = iotp_updateLocationData(client, reqID, entnum, max, pobj);
                 }
             } else if ( ent->value && !strcmp("mgmt.firmware", ent->value)) {
-                printf("Update firmware data.\n");
+                LOG(DEBUG,"Update firmware data.");
                 entnum++;
                 IoTP_json_entry_t * nent = pobj->ent+entnum;
                 if ( nent->name && !strcmp("value", nent->name)) {
@@ -1976,10 +4465,31 @@ static int iotp_client_dmProcessObserve(IoTPClient *client, char *reqID)
 
     LOG(DEBUG, "Initiate observ. reqId: %s", reqID);
 
-    char respmsg[256];
-    char *plFormat = "{\"rc\":%d,\"reqId\":\"%s\",\"d\":{\"fields\":[{\"field\":\"mgmt.firmware\",\"value\":{\"state\":0,\"updateStatus\":0}}]}}";
-    snprintf(respmsg, 256, plFormat, DM_ACTION_RC_RESPONSE_SUCCESS, reqID);
-    iotp_client_publish(client, DM_RESPONSE, respmsg, QoS1, NULL);
+    char buffer[256];
+    IoTPJsonWriter json;
+    const char *respmsg = NULL;
+
+    IoTPJsonWriter_init(&json, buffer, sizeof(buffer));
+    IoTPJsonWriter_beginObject(&json, NULL);
+    IoTPJsonWriter_addInt(&json, "rc", DM_ACTION_RC_RESPONSE_SUCCESS);
+    IoTPJsonWriter_addString(&json, "reqId", reqID);
+    IoTPJsonWriter_beginObject(&json, "d");
+    IoTPJsonWriter_beginArray(&json, "fields");
+    IoTPJsonWriter_beginObject(&json, NULL);
+    IoTPJsonWriter_addString(&json, "field", "mgmt.firmware");
+    IoTPJsonWriter_beginObject(&json, "value");
+    IoTPJsonWriter_addInt(&json, "state", 0);
+    IoTPJsonWriter_addInt(&json, "updateStatus", 0);
+    IoTPJsonWriter_endObject(&json);
+    IoTPJsonWriter_endObject(&json);
+    IoTPJsonWriter_endArray(&json);
+    IoTPJsonWriter_endObject(&json);
+    IoTPJsonWriter_endObject(&json);
+    if ( IoTPJsonWriter_getString(&json, &respmsg, NULL) == IOTPRC_SUCCESS ) {
+        char topic[iotp_client_dmTopicLen(client, DM_RESPONSE)];
+        iotp_client_publish(client, iotp_client_dmTopic(client, topic, sizeof(topic), DM_RESPONSE), (char *)respmsg, QoS1, NULL);
+    }
+    IoTPJsonWriter_free(&json);
 
     return rc;
 }
@@ -2003,10 +4513,10 @@ static int iotp_client_dmProcessCancel(IoTPClient *client, IoTPManagedClient *ma
         if ( ent->name && !strcmp("field", ent->name)) {
             if ( ent->value && !strcmp("mgmt.firmware", ent->value)) {
                 LOG(DEBUG, "Reset managed client observe flag.");
+                pthread_mutex_lock(&managedClient->lock);
                 managedClient->observe = 0;
-                char respmsg[128];
-                sprintf(respmsg,"{\"rc\":%d,\"reqId\":%s}", DM_ACTION_RC_RESPONSE_SUCCESS, reqID);
-                iotp_client_publish(client, DM_RESPONSE, respmsg, QoS1, NULL);
+                pthread_mutex_unlock(&managedClient->lock);
+                iotp_client_sendDMResponse(client, DM_ACTION_RC_RESPONSE_SUCCESS, reqID);
                 break;
             }
         }
@@ -2018,8 +4528,8 @@ static int iotp_client_dmProcessCancel(IoTPClient *client, IoTPManagedClient *ma
 }
 
 
-/* Handle received messages - invoke the callback. */
-static int iotp_client_dmMessageArrived(void *context, char *topicName, int topicLen, MQTTAsync_message * message)
+/* Handle received device management messages - invoke the callback. */
+IOTPRC iotp_client_dmMessageArrived(void *context, char *topicName, void *payload, size_t payloadlen)
 {
     IOTPRC rc = IOTPRC_SUCCESS;
     IoTPClient *client = (IoTPClient *)context;
@@ -2027,13 +4537,10 @@ static int iotp_client_dmMessageArrived(void *context, char *topicName, int topi
     IoTP_json_parse_t *pobj = NULL;
     char *pl = NULL;
 
-    Thread_lock_mutex(iotp_managed_mutex);
-
     /* sanity check */
     if (client == NULL || (client && client->config == NULL)) {
         rc = IOTPRC_INVALID_HANDLE;
         LOG(ERROR, "Invalid client handle");
-        Thread_unlock_mutex(iotp_managed_mutex);
         return rc;
     }
 
@@ -2042,13 +4549,10 @@ static int iotp_client_dmMessageArrived(void *context, char *topicName, int topi
     if ( managedClient == NULL ) {
         rc = IOTPRC_INVALID_HANDLE;
         LOG(ERROR, "Not a managed client");
-        Thread_unlock_mutex(iotp_managed_mutex);
         return rc;
     }
 
     /* Set JSON object */
-    void *payload = message->payload;
-    size_t payloadlen = message->payloadlen;
     pl = (char *) malloc(payloadlen+1);
 
     memset(pl, 0, payloadlen+1);
@@ -2072,20 +4576,22 @@ static int iotp_client_dmMessageArrived(void *context, char *topicName, int topi
             LOG(ERROR, "NULL reqID in response");
             goto endDMAction;
         }
-        if ( managedClient && managedClient->reqID == NULL && reqID != NULL ) {
+        /* check if reqID is the current request ID set for this managedClient - callback is invoked without the lock */
+        pthread_mutex_lock(&managedClient->lock);
+        if ( managedClient->reqID && strcmp(managedClient->reqID, reqID) != 0 ) {
+            rc = IOTPRC_DM_RESPONSE_INVALID_REQID;
+            LOG(ERROR, "Invalid request ID. reqID: %s |  expectedReqID: %s", reqID, managedClient->reqID);
+            pthread_mutex_unlock(&managedClient->lock);
+            goto endDMAction;
+        }
+        if ( managedClient->reqID == NULL ) {
             managedClient->reqID = strdup(reqID);
         }
+        pthread_mutex_unlock(&managedClient->lock);
         rc = iotp_client_dmProcessReponse(client, managedClient, topicName, payloadlen, pl, pobj, reqID);
         goto endDMAction;
     }
 
-    /* check if reqID is the current request ID set for this managedClient */
-    if (managedClient && managedClient->reqID && !strcmp(managedClient->reqID, reqID)) {
-        rc = IOTPRC_DM_RESPONSE_INVALID_REQID;
-        LOG(ERROR, "Invalid request ID. reqID: %s |  expectedReqID: %s", reqID?reqID:"", managedClient->reqID? managedClient->reqID:"");
-        goto endDMAction;
-    } 
-
     if (strstr(topicName, DM_ACTION_FIRMWAREDOWNLOAD)) {
         iotp_client_dmProcessFirmwareDownload(client, managedClient, topicName, payloadlen, pl, pobj, reqID);
     } else if (strstr(topicName, DM_ACTION_FIRMWAREUPDATE)) {
@@ -2108,7 +4614,6 @@ endDMAction:
     if (pl) 
         free(pl);
 
-    Thread_unlock_mutex(iotp_managed_mutex);
     return rc;
 }
 
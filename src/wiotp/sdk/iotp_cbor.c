@@ -0,0 +1,849 @@
+/*******************************************************************************
+ * Copyright (c) 2019 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *
+ * Contrinutors:
+ *    Ranjan Dasgupta         - Initial drop
+ *
+ *******************************************************************************/
+
+/*
+ * CBOR (RFC 8949) encoder and decoder.
+ *
+ * The decoder returns the same entry array as the JSON parser (IoTP_json_parse_t),
+ * so that iotp_json_get*() functions can be used for both formats. Values are
+ * converted as specified for CBOR to JSON conversion:
+ *
+ *   integer          - JSON_Integer, or JSON_Number if it has 10 or more digits
+ *   float            - JSON_Number, JSON_Integer if integral. NaN and infinity are null.
+ *   text string      - JSON_String
+ *   byte string      - JSON_String, base64url encoded without padding
+ *   map              - JSON_Object. Integer keys are converted to text.
+ *   tag              - tagged value, tag is ignored
+ *   undefined, other simple values - JSON_Null
+ *
+ * The encoder writes an entry array (from either parser) as CBOR, using the
+ * shortest encoding of integers, and single precision floats if there is no loss.
+ */
+
+#include "iotp_utils.h"
+#include "iotp_internal.h"
+
+/* Maximum nesting of arrays and maps, same as JSON parser */
+#define IOTP_CBOR_MAX_DEPTH     255
+
+/* CBOR major types */
+#define CBOR_UINT       0
+#define CBOR_NEGINT     1
+#define CBOR_BYTES      2
+#define CBOR_TEXT       3
+#define CBOR_ARRAY      4
+#define CBOR_MAP        5
+#define CBOR_TAG        6
+#define CBOR_SIMPLE     7
+
+/* Argument of an indefinite length item */
+#define CBOR_INDEFINITE ((uint64_t)-1)
+
+static const char iotp_cbor_base64url[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+/*
+ * Decoder state. Strings of entries are stored in an arena, which becomes the source
+ * of the parse object. Entries refer to strings by offset + 1 till the arena is final.
+ */
+typedef struct IoTPCborDecoder {
+    const uint8_t     * p;
+    const uint8_t     * end;
+    IoTP_json_parse_t * pobj;
+    char              * arena;
+    size_t              alen;
+    size_t              asize;
+    int                 rc;
+} IoTPCborDecoder;
+
+/* Encoder buffer */
+typedef struct IoTPCborEncoder {
+    uint8_t           * buf;
+    size_t              len;
+    size_t              size;
+    int                 rc;
+} IoTPCborEncoder;
+
+
+/* Reserves space of len bytes in the arena. Returns offset of the space. */
+static size_t iotp_cbor_reserve(IoTPCborDecoder *d, size_t len)
+{
+    size_t off = d->alen;
+
+    if ( d->alen + len > d->asize ) {
+        size_t size = d->asize ? d->asize : 256;
+        char *arena = NULL;
+        while ( size < d->alen + len )
+            size *= 2;
+        arena = (char *)realloc(d->arena, size);
+        if ( arena == NULL ) {
+            d->rc = IOTPRC_NOMEM;
+            return 0;
+        }
+        d->arena = arena;
+        d->asize = size;
+    }
+    d->alen += len;
+    return off;
+}
+
+/* Adds a NUL terminated string to the arena. Returns offset + 1, or 0 on error. */
+static size_t iotp_cbor_addString(IoTPCborDecoder *d, const char *str, size_t len)
+{
+    size_t off = iotp_cbor_reserve(d, len + 1);
+    if ( d->rc != IOTPRC_SUCCESS ) {
+        return 0;
+    }
+    memcpy(d->arena + off, str, len);
+    d->arena[off + len] = '\0';
+    return off + 1;
+}
+
+/* Adds an entry. Name and value are arena offsets + 1, or 0. Returns entry number, or -1 on error. */
+static int iotp_cbor_newEnt(IoTPCborDecoder *d, int objtype, size_t name, size_t value, int level)
+{
+    IoTP_json_parse_t *pobj = d->pobj;
+    IoTP_json_entry_t *ent = NULL;
+
+    if ( pobj->ent_count >= pobj->ent_alloc ) {
+        int newalloc = (pobj->ent_alloc < 25) ? 100 : pobj->ent_alloc * 4;
+        IoTP_json_entry_t *entries = (IoTP_json_entry_t *)realloc(pobj->free_ent ? pobj->ent : NULL, (size_t)newalloc * sizeof(IoTP_json_entry_t));
+        if ( entries == NULL ) {
+            d->rc = IOTPRC_NOMEM;
+            return -1;
+        }
+        pobj->ent = entries;
+        pobj->ent_alloc = newalloc;
+        pobj->free_ent = 1;
+    }
+    ent = pobj->ent + pobj->ent_count;
+    memset(ent, 0, sizeof(IoTP_json_entry_t));
+    ent->objtype = objtype;
+    ent->name = (const char *)(uintptr_t)name;
+    ent->value = (const char *)(uintptr_t)value;
+    ent->level = level;
+    ent->line = 1;
+    return pobj->ent_count++;
+}
+
+/* Reads initial byte and argument of an item */
+static int iotp_cbor_head(IoTPCborDecoder *d, int *major, int *info, uint64_t *arg)
+{
+    int i;
+    int n = 0;
+
+    if ( d->p >= d->end ) {
+        return -1;
+    }
+    *major = *d->p >> 5;
+    *info = *d->p & 0x1F;
+    d->p++;
+
+    if ( *info < 24 ) {
+        *arg = (uint64_t)*info;
+        return 0;
+    }
+    switch ( *info ) {
+        case 24: n = 1; break;
+        case 25: n = 2; break;
+        case 26: n = 4; break;
+        case 27: n = 8; break;
+        case 31:
+            /* indefinite length, or break */
+            if ( *major == CBOR_UINT || *major == CBOR_NEGINT || *major == CBOR_TAG ) {
+                return -1;
+            }
+            *arg = CBOR_INDEFINITE;
+            return 0;
+        default:
+            return -1;
+    }
+    if ( d->end - d->p < n ) {
+        return -1;
+    }
+    *arg = 0;
+    for (i = 0; i < n; i++) {
+        *arg = (*arg << 8) | *d->p++;
+    }
+    return 0;
+}
+
+/* Returns 1, and skips the break code, if next byte is a break */
+static int iotp_cbor_isBreak(IoTPCborDecoder *d)
+{
+    if ( d->p < d->end && *d->p == 0xFF ) {
+        d->p++;
+        return 1;
+    }
+    return 0;
+}
+
+/* Reads a text or byte string, including indefinite length string. Returns arena offset + 1, or 0 on error. */
+static size_t iotp_cbor_string(IoTPCborDecoder *d, int major, uint64_t arg)
+{
+    size_t start = d->alen;
+    size_t len = 0;
+
+    if ( arg != CBOR_INDEFINITE ) {
+        if ( arg > (uint64_t)(d->end - d->p) ) {
+            return 0;
+        }
+        iotp_cbor_reserve(d, (size_t)arg);
+        if ( d->rc != IOTPRC_SUCCESS ) {
+            return 0;
+        }
+        memcpy(d->arena + start, d->p, (size_t)arg);
+        d->p += arg;
+    } else {
+        /* chunks of definite length strings of the same type */
+        while ( !iotp_cbor_isBreak(d) ) {
+            int cmajor = 0;
+            int cinfo = 0;
+            uint64_t carg = 0;
+            size_t off = 0;
+            if ( iotp_cbor_head(d, &cmajor, &cinfo, &carg) != 0 || cmajor != major || carg == CBOR_INDEFINITE ||
+                 carg > (uint64_t)(d->end - d->p) ) {
+                return 0;
+            }
+            off = iotp_cbor_reserve(d, (size_t)carg);
+            if ( d->rc != IOTPRC_SUCCESS ) {
+                return 0;
+            }
+            memcpy(d->arena + off, d->p, (size_t)carg);
+            d->p += carg;
+        }
+    }
+    len = d->alen - start;
+
+    if ( major == CBOR_BYTES ) {
+        /* base64url, without padding */
+        size_t outlen = (len / 3) * 4 + ((len % 3) ? (len % 3) + 1 : 0);
+        size_t off = iotp_cbor_reserve(d, outlen + 1);
+        const uint8_t *in = NULL;
+        char *out = NULL;
+        size_t i;
+        if ( d->rc != IOTPRC_SUCCESS ) {
+            return 0;
+        }
+        in = (const uint8_t *)d->arena + start;
+        out = d->arena + off;
+        for (i = 0; i + 2 < len; i += 3) {
+            *out++ = iotp_cbor_base64url[in[i] >> 2];
+            *out++ = iotp_cbor_base64url[((in[i] & 0x03) << 4) | (in[i + 1] >> 4)];
+            *out++ = iotp_cbor_base64url[((in[i + 1] & 0x0F) << 2) | (in[i + 2] >> 6)];
+            *out++ = iotp_cbor_base64url[in[i + 2] & 0x3F];
+        }
+        if ( len - i == 1 ) {
+            *out++ = iotp_cbor_base64url[in[i] >> 2];
+            *out++ = iotp_cbor_base64url[(in[i] & 0x03) << 4];
+        } else if ( len - i == 2 ) {
+            *out++ = iotp_cbor_base64url[in[i] >> 2];
+            *out++ = iotp_cbor_base64url[((in[i] & 0x03) << 4) | (in[i + 1] >> 4)];
+            *out++ = iotp_cbor_base64url[(in[i + 1] & 0x0F) << 2];
+        }
+        *out = '\0';
+        /* move encoded string over raw bytes */
+        memmove(d->arena + start, d->arena + off, outlen + 1);
+        d->alen = start + outlen + 1;
+        return start + 1;
+    }
+
+    iotp_cbor_reserve(d, 1);
+    if ( d->rc != IOTPRC_SUCCESS ) {
+        return 0;
+    }
+    d->arena[start + len] = '\0';
+    return start + 1;
+}
+
+/* Adds an integer or number entry from its text */
+static int iotp_cbor_numberEnt(IoTPCborDecoder *d, const char *text, size_t name, int level)
+{
+    size_t value = iotp_cbor_addString(d, text, strlen(text));
+    int entnum = 0;
+    int integer = (strpbrk(text, ".eE") == NULL && strlen(text) < 10);
+
+    if ( value == 0 ) {
+        return -1;
+    }
+    entnum = iotp_cbor_newEnt(d, integer ? JSON_Integer : JSON_Number, name, value, level);
+    if ( entnum >= 0 && integer ) {
+        d->pobj->ent[entnum].count = (int)strtol(text, NULL, 10);
+    }
+    return entnum;
+}
+
+/* Converts half precision float. Sets special to 1 for NaN and infinity. */
+static double iotp_cbor_half(uint16_t half, int *special)
+{
+    int exp = (half >> 10) & 0x1F;
+    int mant = half & 0x3FF;
+    double value = 0;
+
+    *special = 0;
+    if ( exp == 31 ) {
+        *special = 1;
+        return 0;
+    }
+    if ( exp == 0 ) {
+        /* subnormal - mant * 2^-24 */
+        value = (double)mant / 16777216.0;
+    } else {
+        /* (1024 + mant) * 2^(exp - 25) */
+        value = (double)(mant + 1024);
+        for (; exp > 25; exp--)
+            value *= 2;
+        for (; exp < 25; exp++)
+            value /= 2;
+    }
+    return (half & 0x8000) ? -value : value;
+}
+
+/* Formats a float with the shortest precision that reads back as the same value */
+static void iotp_cbor_formatFloat(char *text, size_t size, double value, int single)
+{
+    int precision = single ? 6 : 15;
+    int maxPrecision = single ? 9 : 17;
+    char *p = NULL;
+
+    for (; precision <= maxPrecision; precision++) {
+        snprintf(text, size, "%.*g", precision, value);
+        if ( single ? ((float)strtod(text, NULL) == (float)value) : (strtod(text, NULL) == value) )
+            break;
+    }
+    /* decimal separator of current locale */
+    for (p = text; *p; p++) {
+        if ( *p == ',' )
+            *p = '.';
+    }
+}
+
+/* Decodes an item, and adds its entries */
+static int iotp_cbor_item(IoTPCborDecoder *d, size_t name, int level)
+{
+    int major = 0;
+    int info = 0;
+    uint64_t arg = 0;
+    char text[48];
+    int entnum = 0;
+
+    if ( level > IOTP_CBOR_MAX_DEPTH ) {
+        return -1;
+    }
+    /* Tags are skipped in a loop, and the tagged item is decoded */
+    do {
+        if ( iotp_cbor_head(d, &major, &info, &arg) != 0 ) {
+            return -1;
+        }
+    } while ( major == CBOR_TAG );
+
+    switch ( major ) {
+    case CBOR_UINT:
+        snprintf(text, sizeof(text), "%llu", (unsigned long long)arg);
+        return iotp_cbor_numberEnt(d, text, name, level);
+
+    case CBOR_NEGINT:
+        /* value is -1 - arg */
+        if ( arg == UINT64_MAX ) {
+            snprintf(text, sizeof(text), "-18446744073709551616");
+        } else {
+            snprintf(text, sizeof(text), "-%llu", (unsigned long long)(arg + 1));
+        }
+        return iotp_cbor_numberEnt(d, text, name, level);
+
+    case CBOR_BYTES:
+    case CBOR_TEXT:
+    {
+        size_t value = iotp_cbor_string(d, major, arg);
+        if ( value == 0 ) {
+            return -1;
+        }
+        return iotp_cbor_newEnt(d, JSON_String, name, value, level);
+    }
+
+    case CBOR_ARRAY:
+    case CBOR_MAP:
+    {
+        uint64_t i;
+        entnum = iotp_cbor_newEnt(d, major == CBOR_MAP ? JSON_Object : JSON_Array, name, 0, level);
+        if ( entnum < 0 ) {
+            return -1;
+        }
+        for (i = 0; arg == CBOR_INDEFINITE || i < arg; i++) {
+            size_t key = 0;
+            if ( arg == CBOR_INDEFINITE && iotp_cbor_isBreak(d) ) {
+                break;
+            }
+            if ( major == CBOR_MAP ) {
+                /* keys are text, or integers converted to text */
+                int kmajor = 0;
+                int kinfo = 0;
+                uint64_t karg = 0;
+                if ( iotp_cbor_head(d, &kmajor, &kinfo, &karg) != 0 ) {
+                    return -1;
+                }
+                if ( kmajor == CBOR_TEXT ) {
+                    key = iotp_cbor_string(d, kmajor, karg);
+                } else if ( kmajor == CBOR_UINT ) {
+                    snprintf(text, sizeof(text), "%llu", (unsigned long long)karg);
+                    key = iotp_cbor_addString(d, text, strlen(text));
+                } else if ( kmajor == CBOR_NEGINT && karg != UINT64_MAX ) {
+                    snprintf(text, sizeof(text), "-%llu", (unsigned long long)(karg + 1));
+                    key = iotp_cbor_addString(d, text, strlen(text));
+                }
+                if ( key == 0 ) {
+                    return -1;
+                }
+            }
+            if ( iotp_cbor_item(d, key, level + 1) < 0 ) {
+                return -1;
+            }
+        }
+        d->pobj->ent[entnum].count = d->pobj->ent_count - entnum - 1;
+        return entnum;
+    }
+
+    default:
+        switch ( info ) {
+        case 20:
+            return iotp_cbor_newEnt(d, JSON_False, name, 0, level);
+        case 21:
+            return iotp_cbor_newEnt(d, JSON_True, name, 0, level);
+        case 25:
+        case 26:
+        case 27:
+        {
+            double value = 0;
+            int special = 0;
+            if ( info == 25 ) {
+                value = iotp_cbor_half((uint16_t)arg, &special);
+            } else if ( info == 26 ) {
+                uint32_t bits = (uint32_t)arg;
+                float f;
+                memcpy(&f, &bits, sizeof(f));
+                value = (double)f;
+                special = (f != f || f - f != 0);
+            } else {
+                memcpy(&value, &arg, sizeof(value));
+                special = (value != value || value - value != 0);
+            }
+            if ( special ) {
+                return iotp_cbor_newEnt(d, JSON_Null, name, 0, level);
+            }
+            iotp_cbor_formatFloat(text, sizeof(text), value, info != 27);
+            return iotp_cbor_numberEnt(d, text, name, level);
+        }
+        case 31:
+            /* unexpected break */
+            return -1;
+        default:
+            /* null, undefined and unassigned simple values */
+            return iotp_cbor_newEnt(d, JSON_Null, name, 0, level);
+        }
+    }
+}
+
+/*
+ * Parses a CBOR message into entries. Source of the parse object is the CBOR message,
+ * and is replaced by the strings of entries. Returns 0 on success.
+ */
+int iotp_cbor_parse(IoTP_json_parse_t * pobj)
+{
+    IoTPCborDecoder d;
+    int i;
+
+    memset(&d, 0, sizeof(d));
+    d.p = (const uint8_t *)pobj->source;
+    d.end = d.p + pobj->src_len;
+    d.pobj = pobj;
+    pobj->ent_count = 0;
+
+    /* outer item is a map or an array, as in JSON parser */
+    if ( d.p >= d.end || ((*d.p >> 5) != CBOR_MAP && (*d.p >> 5) != CBOR_ARRAY) ||
+         iotp_cbor_item(&d, 0, 0) < 0 || d.p != d.end ) {
+        iotp_utils_freePtr((void *)d.arena);
+        if ( !pobj->rc )
+            pobj->rc = (d.rc != IOTPRC_SUCCESS) ? 1 : 2;
+        return pobj->rc;
+    }
+
+    /* entries refer to the final arena */
+    for (i = 0; i < pobj->ent_count; i++) {
+        IoTP_json_entry_t *ent = pobj->ent + i;
+        if ( ent->name )
+            ent->name = d.arena + ((uintptr_t)ent->name - 1);
+        if ( ent->value )
+            ent->value = d.arena + ((uintptr_t)ent->value - 1);
+    }
+    if ( pobj->free_source )
+        free(pobj->source);
+    pobj->source = d.arena;
+    pobj->src_len = (int)d.alen;
+    pobj->free_source = 1;
+
+    return 0;
+}
+
+/* Initialize parse object from a CBOR message. Free it with iotp_json_free(). */
+IoTP_json_parse_t * iotp_cbor_init(int payloadlen, char *payload)
+{
+    IoTP_json_parse_t *pobj = NULL;
+    int rc = 0;
+
+    if ( payloadlen < 1 || payload == NULL ) {
+        LOG(ERROR, "Invalid CBOR message. len=%d", payloadlen);
+        return NULL;
+    }
+
+    pobj = (IoTP_json_parse_t *)calloc(1, sizeof(IoTP_json_parse_t));
+    if ( pobj == NULL ) {
+        return NULL;
+    }
+    /* message is not copied - it is replaced by the strings of entries */
+    pobj->source = payload;
+    pobj->src_len = payloadlen;
+
+    rc = iotp_cbor_parse(pobj);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Could not parse CBOR message. rc=%d len=%d", rc, payloadlen);
+        if ( pobj->free_ent )
+            free(pobj->ent);
+        free(pobj);
+        return NULL;
+    }
+
+    return pobj;
+}
+
+
+static void iotp_cbor_write(IoTPCborEncoder *e, const void *data, size_t len)
+{
+    if ( e->rc != IOTPRC_SUCCESS ) {
+        return;
+    }
+    if ( e->len + len > e->size ) {
+        size_t size = e->size ? e->size : 256;
+        uint8_t *buf = NULL;
+        while ( size < e->len + len )
+            size *= 2;
+        buf = (uint8_t *)realloc(e->buf, size);
+        if ( buf == NULL ) {
+            e->rc = IOTPRC_NOMEM;
+            return;
+        }
+        e->buf = buf;
+        e->size = size;
+    }
+    memcpy(e->buf + e->len, data, len);
+    e->len += len;
+}
+
+/* Writes initial byte and argument, with the shortest encoding */
+static void iotp_cbor_writeHead(IoTPCborEncoder *e, int major, uint64_t arg)
+{
+    uint8_t head[9];
+    int n = 0;
+    int i;
+
+    if ( arg < 24 ) {
+        head[0] = (uint8_t)((major << 5) | (int)arg);
+        iotp_cbor_write(e, head, 1);
+        return;
+    }
+    if ( arg <= 0xFF ) {
+        head[0] = (uint8_t)((major << 5) | 24);
+        n = 1;
+    } else if ( arg <= 0xFFFF ) {
+        head[0] = (uint8_t)((major << 5) | 25);
+        n = 2;
+    } else if ( arg <= 0xFFFFFFFFu ) {
+        head[0] = (uint8_t)((major << 5) | 26);
+        n = 4;
+    } else {
+        head[0] = (uint8_t)((major << 5) | 27);
+        n = 8;
+    }
+    for (i = 0; i < n; i++) {
+        head[n - i] = (uint8_t)(arg >> (8 * i));
+    }
+    iotp_cbor_write(e, head, (size_t)n + 1);
+}
+
+static void iotp_cbor_writeText(IoTPCborEncoder *e, const char *text)
+{
+    size_t len = text ? strlen(text) : 0;
+    iotp_cbor_writeHead(e, CBOR_TEXT, len);
+    if ( len > 0 )
+        iotp_cbor_write(e, text, len);
+}
+
+/* Writes a number from its text - as integer if possible, else as float */
+static void iotp_cbor_writeNumber(IoTPCborEncoder *e, const char *text)
+{
+    char *endptr = NULL;
+    double value = 0;
+    float single = 0;
+
+    if ( text == NULL || *text == '\0' ) {
+        e->rc = IOTPRC_ARGS_INVALID_VALUE;
+        return;
+    }
+    if ( strpbrk(text, ".eE") == NULL ) {
+        errno = 0;
+        if ( *text == '-' ) {
+            long long v = strtoll(text, &endptr, 10);
+            if ( errno == 0 && *endptr == '\0' ) {
+                iotp_cbor_writeHead(e, CBOR_NEGINT, (uint64_t)(-1 - v));
+                return;
+            }
+        } else {
+            unsigned long long v = strtoull(text, &endptr, 10);
+            if ( errno == 0 && *endptr == '\0' ) {
+                iotp_cbor_writeHead(e, CBOR_UINT, (uint64_t)v);
+                return;
+            }
+        }
+    }
+
+    value = strtod(text, &endptr);
+    if ( *endptr != '\0' ) {
+        e->rc = IOTPRC_ARGS_INVALID_VALUE;
+        return;
+    }
+    single = (float)value;
+    if ( (double)single == value ) {
+        uint32_t bits;
+        uint8_t buf[5];
+        memcpy(&bits, &single, sizeof(bits));
+        buf[0] = (CBOR_SIMPLE << 5) | 26;
+        buf[1] = (uint8_t)(bits >> 24);
+        buf[2] = (uint8_t)(bits >> 16);
+        buf[3] = (uint8_t)(bits >> 8);
+        buf[4] = (uint8_t)bits;
+        iotp_cbor_write(e, buf, sizeof(buf));
+    } else {
+        uint64_t bits;
+        uint8_t buf[9];
+        int i;
+        memcpy(&bits, &value, sizeof(bits));
+        buf[0] = (CBOR_SIMPLE << 5) | 27;
+        for (i = 0; i < 8; i++) {
+            buf[8 - i] = (uint8_t)(bits >> (8 * i));
+        }
+        iotp_cbor_write(e, buf, sizeof(buf));
+    }
+}
+
+/* Writes an entry, and its children. Returns the next entry number. */
+static int iotp_cbor_writeEnt(IoTPCborEncoder *e, IoTP_json_parse_t *pobj, int entnum)
+{
+    IoTP_json_entry_t *ent = pobj->ent + entnum;
+    uint8_t simple = 0;
+
+    switch ( ent->objtype ) {
+    case JSON_Object:
+    case JSON_Array:
+    {
+        int last = entnum + ent->count;
+        int count = 0;
+        int i = entnum + 1;
+
+        /* count children, skipping their descendants */
+        while ( i <= last ) {
+            IoTP_json_entry_t *child = pobj->ent + i;
+            count++;
+            i += (child->objtype == JSON_Object || child->objtype == JSON_Array) ? child->count + 1 : 1;
+        }
+        iotp_cbor_writeHead(e, ent->objtype == JSON_Object ? CBOR_MAP : CBOR_ARRAY, (uint64_t)count);
+        i = entnum + 1;
+        while ( i <= last && e->rc == IOTPRC_SUCCESS ) {
+            if ( ent->objtype == JSON_Object )
+                iotp_cbor_writeText(e, pobj->ent[i].name);
+            i = iotp_cbor_writeEnt(e, pobj, i);
+        }
+        return last + 1;
+    }
+    case JSON_String:
+        iotp_cbor_writeText(e, ent->value);
+        break;
+    case JSON_Integer:
+        if ( ent->count < 0 ) {
+            iotp_cbor_writeHead(e, CBOR_NEGINT, (uint64_t)(-1 - (int64_t)ent->count));
+        } else {
+            iotp_cbor_writeHead(e, CBOR_UINT, (uint64_t)ent->count);
+        }
+        break;
+    case JSON_Number:
+        iotp_cbor_writeNumber(e, ent->value);
+        break;
+    case JSON_True:
+        simple = (CBOR_SIMPLE << 5) | 21;
+        iotp_cbor_write(e, &simple, 1);
+        break;
+    case JSON_False:
+        simple = (CBOR_SIMPLE << 5) | 20;
+        iotp_cbor_write(e, &simple, 1);
+        break;
+    default:
+        simple = (CBOR_SIMPLE << 5) | 22;
+        iotp_cbor_write(e, &simple, 1);
+        break;
+    }
+    return entnum + 1;
+}
+
+/* Encodes entries of a parse object as CBOR. Returned buffer should be freed by the caller. */
+IOTPRC iotp_cbor_encode(IoTP_json_parse_t * pobj, void **out, size_t *outlen)
+{
+    IoTPCborEncoder e;
+
+    if ( pobj == NULL || out == NULL || outlen == NULL ) {
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+    *out = NULL;
+    *outlen = 0;
+    if ( pobj->ent_count == 0 ) {
+        return IOTPRC_ARGS_INVALID_VALUE;
+    }
+
+    memset(&e, 0, sizeof(e));
+    iotp_cbor_writeEnt(&e, pobj, 0);
+    if ( e.rc != IOTPRC_SUCCESS ) {
+        iotp_utils_freePtr((void *)e.buf);
+        LOG(ERROR, "Failed to encode CBOR message. rc=%d", e.rc);
+        return e.rc;
+    }
+    *out = e.buf;
+    *outlen = e.len;
+    return IOTPRC_SUCCESS;
+}
+
+
+/* Writes an entry, and its children, as JSON. Returns the next entry number. */
+static int iotp_cbor_writeJson(IoTPJsonWriter *writer, IoTP_json_parse_t *pobj, int entnum, const char *name)
+{
+    IoTP_json_entry_t *ent = pobj->ent + entnum;
+
+    switch ( ent->objtype ) {
+    case JSON_Object:
+    case JSON_Array:
+    {
+        int last = entnum + ent->count;
+        int object = (ent->objtype == JSON_Object);
+        int i = entnum + 1;
+
+        if ( object ) {
+            IoTPJsonWriter_beginObject(writer, name);
+        } else {
+            IoTPJsonWriter_beginArray(writer, name);
+        }
+        while ( i <= last && writer->rc == IOTPRC_SUCCESS ) {
+            i = iotp_cbor_writeJson(writer, pobj, i, object ? pobj->ent[i].name : NULL);
+        }
+        if ( object ) {
+            IoTPJsonWriter_endObject(writer);
+        } else {
+            IoTPJsonWriter_endArray(writer);
+        }
+        return last + 1;
+    }
+    case JSON_String:
+        IoTPJsonWriter_addString(writer, name, ent->value);
+        break;
+    case JSON_Integer:
+    case JSON_Number:
+        IoTPJsonWriter_addRaw(writer, name, ent->value);
+        break;
+    case JSON_True:
+    case JSON_False:
+        IoTPJsonWriter_addBool(writer, name, ent->objtype == JSON_True);
+        break;
+    default:
+        IoTPJsonWriter_addNull(writer, name);
+        break;
+    }
+    return entnum + 1;
+}
+
+/* Converts a JSON message to CBOR. Returned buffer should be freed by the caller. */
+IOTPRC iotp_cbor_fromJson(const void *json, size_t jsonlen, void **cbor, size_t *cborlen)
+{
+    IoTP_json_parse_t *pobj = NULL;
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    if ( json == NULL || cbor == NULL || cborlen == NULL ) {
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+    *cbor = NULL;
+    *cborlen = 0;
+    if ( jsonlen > INT32_MAX ) {
+        return IOTPRC_ARGS_INVALID_VALUE;
+    }
+
+    pobj = iotp_json_init((int)jsonlen, (char *)json);
+    if ( pobj == NULL ) {
+        return IOTPRC_ARGS_INVALID_VALUE;
+    }
+    rc = iotp_cbor_encode(pobj, cbor, cborlen);
+    iotp_json_free(pobj);
+
+    return rc;
+}
+
+/* Converts a CBOR message to JSON. Returned string is NUL terminated, and should be freed by the caller. */
+IOTPRC iotp_cbor_toJson(const void *cbor, size_t cborlen, char **json, size_t *jsonlen)
+{
+    IoTP_json_parse_t pobj;
+    IoTPJsonWriter writer;
+    const char *str = NULL;
+    size_t len = 0;
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    if ( cbor == NULL || json == NULL || jsonlen == NULL ) {
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+    *json = NULL;
+    *jsonlen = 0;
+    if ( cborlen == 0 || cborlen > INT32_MAX ) {
+        return IOTPRC_ARGS_INVALID_VALUE;
+    }
+
+    memset(&pobj, 0, sizeof(pobj));
+    pobj.source = (char *)cbor;
+    pobj.src_len = (int)cborlen;
+    if ( iotp_cbor_parse(&pobj) != 0 ) {
+        if ( pobj.free_ent )
+            free(pobj.ent);
+        return IOTPRC_ARGS_INVALID_VALUE;
+    }
+
+    IoTPJsonWriter_init(&writer, NULL, 0);
+    iotp_cbor_writeJson(&writer, &pobj, 0, NULL);
+    rc = IoTPJsonWriter_getString(&writer, &str, &len);
+    if ( rc == IOTPRC_SUCCESS ) {
+        /* writer always allocates its buffer, when initialized without a buffer */
+        *json = writer.buffer;
+        *jsonlen = len;
+        writer.allocated = 0;
+    }
+    IoTPJsonWriter_free(&writer);
+    if ( pobj.free_ent )
+        free(pobj.ent);
+    iotp_utils_freePtr((void *)pobj.source);
+
+    return rc;
+}
@@ -0,0 +1,273 @@
+/*******************************************************************************
+ * Copyright (c) 2019 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *
+ * Contrinutors:
+ *    Ranjan Dasgupta         - Initial drop
+ *
+ *******************************************************************************/
+
+/*
+ * Payload compression of events and commands.
+ *
+ * Compressed payloads are identified by a suffix to the format segment of
+ * the topic, e.g. json-deflate. The "+" character can not be used as a
+ * separator, as it is a wildcard character in MQTT topics.
+ *
+ * deflate - zlib format (RFC 1950)
+ * lz4     - LZ4 block, prefixed with 4 byte (little endian) uncompressed length.
+ *           Available if client library is built with IOTP_HAVE_LZ4.
+ */
+
+#include <zlib.h>
+#ifdef IOTP_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#include "iotp_utils.h"
+#include "iotp_internal.h"
+
+/* Upper limit of size of decompressed payload */
+#define IOTP_COMPRESS_MAX_SIZE  (256 * 1024 * 1024)
+
+static struct {
+    IoTPCompression  codec;
+    char           * name;
+    char           * suffix;
+} iotp_codecs[] = {
+    { IoTPCompression_deflate, "deflate", "-deflate" },
+    { IoTPCompression_lz4,     "lz4",     "-lz4"     }
+};
+
+#define IOTP_CODEC_COUNT (sizeof(iotp_codecs) / sizeof(iotp_codecs[0]))
+
+/* Returns codec for a name configured in options.mqtt.compression, or -1 if not supported */
+int iotp_compress_fromName(const char *name)
+{
+    size_t i;
+
+    if ( name == NULL || *name == '\0' || !strcasecmp(name, "none") ) {
+        return IoTPCompression_none;
+    }
+    for (i = 0; i < IOTP_CODEC_COUNT; i++) {
+        if ( !strcasecmp(name, iotp_codecs[i].name) ) {
+#ifndef IOTP_HAVE_LZ4
+            if ( iotp_codecs[i].codec == IoTPCompression_lz4 ) {
+                return -1;
+            }
+#endif
+            return iotp_codecs[i].codec;
+        }
+    }
+    return -1;
+}
+
+/* Returns name of a codec */
+const char * iotp_compress_name(IoTPCompression codec)
+{
+    size_t i;
+    for (i = 0; i < IOTP_CODEC_COUNT; i++) {
+        if ( iotp_codecs[i].codec == codec ) {
+            return iotp_codecs[i].name;
+        }
+    }
+    return "none";
+}
+
+/* Returns format suffix of a codec */
+const char * iotp_compress_suffix(IoTPCompression codec)
+{
+    size_t i;
+    for (i = 0; i < IOTP_CODEC_COUNT; i++) {
+        if ( iotp_codecs[i].codec == codec ) {
+            return iotp_codecs[i].suffix;
+        }
+    }
+    return "";
+}
+
+/* Returns codec of a format string with compression suffix, and length of format without suffix */
+IoTPCompression iotp_compress_fromFormat(const char *format, size_t formatLen, size_t *baseLen)
+{
+    size_t i;
+
+    if ( baseLen ) *baseLen = formatLen;
+    if ( format == NULL ) {
+        return IoTPCompression_none;
+    }
+    for (i = 0; i < IOTP_CODEC_COUNT; i++) {
+        size_t slen = strlen(iotp_codecs[i].suffix);
+        if ( formatLen > slen && !strncmp(format + formatLen - slen, iotp_codecs[i].suffix, slen) ) {
+            if ( baseLen ) *baseLen = formatLen - slen;
+            return iotp_codecs[i].codec;
+        }
+    }
+    return IoTPCompression_none;
+}
+
+/* Compress payload. Returned buffer should be freed by the caller. */
+IOTPRC iotp_compress_encode(IoTPCompression codec, const void *in, size_t inlen, void **out, size_t *outlen)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* Sanity check */
+    if ( (in == NULL && inlen > 0) || out == NULL || outlen == NULL ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Received NULL argument. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+    *out = NULL;
+    *outlen = 0;
+
+    if ( codec == IoTPCompression_deflate ) {
+        uLongf len = compressBound((uLong)inlen);
+        Bytef *buf = (Bytef *)malloc(len);
+        if ( buf == NULL ) {
+            return IOTPRC_NOMEM;
+        }
+        if ( compress2(buf, &len, (const Bytef *)in, (uLong)inlen, Z_DEFAULT_COMPRESSION) != Z_OK ) {
+            free(buf);
+            rc = IOTPRC_FAILURE;
+            LOG(ERROR, "Failed to compress payload. codec: deflate | len: %zu", inlen);
+            return rc;
+        }
+        *out = buf;
+        *outlen = (size_t)len;
+#ifdef IOTP_HAVE_LZ4
+    } else if ( codec == IoTPCompression_lz4 ) {
+        int bound = 0;
+        int len = 0;
+        unsigned char *buf = NULL;
+        if ( inlen > LZ4_MAX_INPUT_SIZE ) {
+            return IOTPRC_ARGS_INVALID_VALUE;
+        }
+        bound = LZ4_compressBound((int)inlen);
+        buf = (unsigned char *)malloc((size_t)bound + 4);
+        if ( buf == NULL ) {
+            return IOTPRC_NOMEM;
+        }
+        buf[0] = (unsigned char)(inlen & 0xFF);
+        buf[1] = (unsigned char)((inlen >> 8) & 0xFF);
+        buf[2] = (unsigned char)((inlen >> 16) & 0xFF);
+        buf[3] = (unsigned char)((inlen >> 24) & 0xFF);
+        len = LZ4_compress_default((const char *)in, (char *)buf + 4, (int)inlen, bound);
+        if ( len <= 0 ) {
+            free(buf);
+            rc = IOTPRC_FAILURE;
+            LOG(ERROR, "Failed to compress payload. codec: lz4 | len: %zu", inlen);
+            return rc;
+        }
+        *out = buf;
+        *outlen = (size_t)len + 4;
+#endif
+    } else {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(WARN, "Compression codec is not supported. codec: %d | rc: %d", codec, rc);
+    }
+
+    return rc;
+}
+
+/* Decompress payload. Returned buffer is NUL terminated, and should be freed by the caller. */
+IOTPRC iotp_compress_decode(IoTPCompression codec, const void *in, size_t inlen, void **out, size_t *outlen)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* Sanity check */
+    if ( (in == NULL && inlen > 0) || out == NULL || outlen == NULL ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Received NULL argument. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+    *out = NULL;
+    *outlen = 0;
+
+    if ( codec == IoTPCompression_deflate ) {
+        z_stream strm;
+        size_t size = inlen * 4 + 64;
+        unsigned char *buf = NULL;
+        int zrc = Z_OK;
+
+        memset(&strm, 0, sizeof(strm));
+        if ( inflateInit(&strm) != Z_OK ) {
+            return IOTPRC_FAILURE;
+        }
+        strm.next_in = (Bytef *)in;
+        strm.avail_in = (uInt)inlen;
+        while ( zrc == Z_OK ) {
+            unsigned char *tmp = (unsigned char *)realloc(buf, size + 1);
+            if ( tmp == NULL ) {
+                rc = IOTPRC_NOMEM;
+                break;
+            }
+            buf = tmp;
+            strm.next_out = buf + strm.total_out;
+            strm.avail_out = (uInt)(size - strm.total_out);
+            zrc = inflate(&strm, Z_NO_FLUSH);
+            if ( zrc == Z_OK && strm.avail_out == 0 ) {
+                if ( size >= IOTP_COMPRESS_MAX_SIZE ) {
+                    zrc = Z_BUF_ERROR;
+                    break;
+                }
+                size *= 2;
+            } else if ( zrc == Z_OK ) {
+                /* Input is consumed, but stream is not complete */
+                zrc = Z_DATA_ERROR;
+            }
+        }
+        if ( rc == IOTPRC_SUCCESS && zrc != Z_STREAM_END ) {
+            rc = IOTPRC_FAILURE;
+        }
+        if ( rc == IOTPRC_SUCCESS ) {
+            buf[strm.total_out] = '\0';
+            *out = buf;
+            *outlen = (size_t)strm.total_out;
+        } else {
+            iotp_utils_freePtr((void *)buf);
+            LOG(WARN, "Failed to decompress payload. codec: deflate | len: %zu | zrc: %d", inlen, zrc);
+        }
+        inflateEnd(&strm);
+#ifdef IOTP_HAVE_LZ4
+    } else if ( codec == IoTPCompression_lz4 ) {
+        const unsigned char *p = (const unsigned char *)in;
+        size_t size = 0;
+        char *buf = NULL;
+        int len = 0;
+        if ( inlen < 4 ) {
+            return IOTPRC_FAILURE;
+        }
+        size = (size_t)p[0] | ((size_t)p[1] << 8) | ((size_t)p[2] << 16) | ((size_t)p[3] << 24);
+        if ( size > IOTP_COMPRESS_MAX_SIZE ) {
+            return IOTPRC_FAILURE;
+        }
+        buf = (char *)malloc(size + 1);
+        if ( buf == NULL ) {
+            return IOTPRC_NOMEM;
+        }
+        len = LZ4_decompress_safe((const char *)p + 4, buf, (int)(inlen - 4), (int)size);
+        if ( len < 0 || (size_t)len != size ) {
+            free(buf);
+            rc = IOTPRC_FAILURE;
+            LOG(WARN, "Failed to decompress payload. codec: lz4 | len: %zu", inlen);
+            return rc;
+        }
+        buf[size] = '\0';
+        *out = buf;
+        *outlen = size;
+#endif
+    } else {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(WARN, "Compression codec is not supported. codec: %d | rc: %d", codec, rc);
+    }
+
+    return rc;
+}
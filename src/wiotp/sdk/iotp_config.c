@@ -94,6 +94,31 @@ IOTPRC IoTPConfig_create(IoTPConfig **config, const char * configFileName)
     mqttopts->keepalive = 60;
     mqttopts->sessionExpiry = 3600;
     mqttopts->sharedSubscription = 0;
+    mqttopts->maxInflight = 0;
+    mqttopts->maxBufferedBytes = 0;
+    mqttopts->publishTimeout = 0;
+    mqttopts->persistencePath = NULL;
+    mqttopts->persistenceMaxBytes = 0;
+    mqttopts->persistenceSync = 1;
+    mqttopts->compression = IoTPCompression_none;
+    mqttopts->compressionMinSize = 128;
+    mqttopts->coalesceWindow = 0;
+    mqttopts->coalesceMaxBytes = 16384;
+    mqttopts->rateLimit = 0;
+    mqttopts->rateBurst = 0;
+    mqttopts->deviceRateLimit = 0;
+    mqttopts->rateLimitTimeout = 0;
+    mqttopts->controlMaxInflight = 0;
+    mqttopts->submitQueueSize = 0;
+    mqttopts->topicAliasMaximum = 0;
+    mqttopts->deltaHeartbeat = 0;
+    mqttopts->deltaDeadband = 0;
+    mqttopts->cborTranscode = 0;
+    mqttopts->dispatchWorkers = 0;
+    mqttopts->inboundQueueSize = 0;
+    mqttopts->inboundOverflow = IoTPInboundOverflow_block;
+    mqttopts->batchSize = 0;
+    mqttopts->batchWait = 0;
     mqttopts->validateServerCert = 1;
 
 
@@ -165,6 +190,7 @@ IOTPRC IoTPConfig_clear(IoTPConfig *config)
             mqttopts_t *mqttopts = config->mqttopts;
             iotp_utils_freePtr((void *)mqttopts->transport);
             iotp_utils_freePtr((void *)mqttopts->caFile);
+            iotp_utils_freePtr((void *)mqttopts->persistencePath);
             iotp_utils_freePtr((void *)config->mqttopts);
         }
 
@@ -500,6 +526,268 @@ IOTPRC IoTPConfig_setProperty(IoTPConfig *config, const char * name, const char
             goto setPropDone;
         }
 
+        /* Process options.mqtt.maxInflight */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_maxInflight)) {
+            if (argptr && (argint > 0 || !strcmp(argptr, "0")) && argint <= 65535) {
+                config->mqttopts->maxInflight = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.maxBufferedBytes */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_maxBufferedBytes)) {
+            if (argptr && (argint > 0 || !strcmp(argptr, "0"))) {
+                config->mqttopts->maxBufferedBytes = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.publishTimeout */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_publishTimeout)) {
+            if (argptr && (argint > 0 || !strcmp(argptr, "0"))) {
+                config->mqttopts->publishTimeout = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.persistence.path */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_persistence_path)) {
+            if ( config->mqttopts->persistencePath ) 
+                iotp_utils_freePtr((void *)config->mqttopts->persistencePath);
+            config->mqttopts->persistencePath = NULL;
+            if ( argptr && *argptr != '\0' ) 
+                config->mqttopts->persistencePath = strdup(argptr);
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.persistence.maxBytes */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_persistence_maxBytes)) {
+            if (argptr && (argint > 0 || !strcmp(argptr, "0"))) {
+                config->mqttopts->persistenceMaxBytes = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.persistence.sync */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_persistence_sync)) {
+            if (argptr && (*argptr == '0' || *argptr == '1')) {
+                config->mqttopts->persistenceSync = argint;
+            } else if (argptr && !strcmp(argptr,"true")) {
+                config->mqttopts->persistenceSync = 1;
+            } else if (argptr && !strcmp(argptr,"false")) {
+                config->mqttopts->persistenceSync = 0;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.compression */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_compression)) {
+            int codec = iotp_compress_fromName(argptr);
+            if ( codec >= 0 ) {
+                config->mqttopts->compression = codec;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.compressionMinSize */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_compressionMinSize)) {
+            if (argptr && (argint > 0 || !strcmp(argptr, "0"))) {
+                config->mqttopts->compressionMinSize = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.coalesceWindow */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_coalesceWindow)) {
+            if (argptr && (argint > 0 || !strcmp(argptr, "0"))) {
+                config->mqttopts->coalesceWindow = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.coalesceMaxBytes */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_coalesceMaxBytes)) {
+            if (argptr && argint > 0) {
+                config->mqttopts->coalesceMaxBytes = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.rateLimit */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_rateLimit)) {
+            if (argptr && (argint > 0 || !strcmp(argptr, "0"))) {
+                config->mqttopts->rateLimit = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.rateBurst */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_rateBurst)) {
+            if (argptr && (argint > 0 || !strcmp(argptr, "0"))) {
+                config->mqttopts->rateBurst = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.deviceRateLimit */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_deviceRateLimit)) {
+            if (argptr && (argint > 0 || !strcmp(argptr, "0"))) {
+                config->mqttopts->deviceRateLimit = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.rateLimitTimeout */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_rateLimitTimeout)) {
+            if (argptr && (argint > 0 || !strcmp(argptr, "0"))) {
+                config->mqttopts->rateLimitTimeout = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.controlMaxInflight */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_controlMaxInflight)) {
+            if (argptr && (argint > 0 || !strcmp(argptr, "0")) && argint <= 65535) {
+                config->mqttopts->controlMaxInflight = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.submitQueueSize */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_submitQueueSize)) {
+            if (argptr && (argint > 0 || !strcmp(argptr, "0")) && argint <= 1048576) {
+                config->mqttopts->submitQueueSize = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.topicAliasMaximum */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_topicAliasMaximum)) {
+            if (argptr && (argint > 0 || !strcmp(argptr, "0")) && argint <= 65535) {
+                config->mqttopts->topicAliasMaximum = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.deltaHeartbeat */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_deltaHeartbeat)) {
+            if (argptr && (argint > 0 || !strcmp(argptr, "0")) && argint <= 86400) {
+                config->mqttopts->deltaHeartbeat = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.deltaDeadband */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_deltaDeadband)) {
+            char *endptr = NULL;
+            double argdbl = argptr ? strtod(argptr, &endptr) : -1;
+            if (argptr && *argptr != '\0' && endptr && *endptr == '\0' && argdbl >= 0 && argdbl < 1e300) {
+                config->mqttopts->deltaDeadband = argdbl;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.cborTranscode */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_cborTranscode)) {
+            if (argptr && (*argptr == '0' || *argptr == '1')) {
+                config->mqttopts->cborTranscode = argint;
+            } else if (argptr && !strcmp(argptr,"true")) {
+                config->mqttopts->cborTranscode = 1;
+            } else if (argptr && !strcmp(argptr,"false")) {
+                config->mqttopts->cborTranscode = 0;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.dispatchWorkers */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_dispatchWorkers)) {
+            if (argptr && (argint > 0 || !strcmp(argptr, "0")) && argint <= IOTP_MAX_DISPATCH_WORKERS) {
+                config->mqttopts->dispatchWorkers = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.inboundQueueSize */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_inboundQueueSize)) {
+            if (argptr && (argint > 0 || !strcmp(argptr, "0")) && argint <= 1048576) {
+                config->mqttopts->inboundQueueSize = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.inboundOverflow */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_inboundOverflow)) {
+            int overflow = iotp_dispatch_overflowFromName(argptr);
+            if ( overflow >= 0 ) {
+                config->mqttopts->inboundOverflow = overflow;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.batchSize */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_batchSize)) {
+            if (argptr && (argint > 0 || !strcmp(argptr, "0")) && argint <= IOTP_MAX_BATCH_SIZE) {
+                config->mqttopts->batchSize = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
+        /* Process options.mqtt.batchWait */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_batchWait)) {
+            if (argptr && (argint > 0 || !strcmp(argptr, "0")) && argint <= 10000000) {
+                config->mqttopts->batchWait = argint;
+            } else {
+                rc = IOTPRC_PARAM_INVALID_VALUE;
+            }
+            goto setPropDone;
+        }
+
         /* Process options.mqtt.sharedSubscription */
         if ( !strcasecmp(name, IoTPConfig_options_mqtt_sharedSubscription)) {
             if (argptr && (*argptr == '0' || *argptr == '1')) {
@@ -945,6 +1233,164 @@ IOTPRC IoTPConfig_getProperty(IoTPConfig *config, const char * name, char ** val
             goto getPropDone;
         }
 
+        /* Process options.mqtt.maxInflight */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_maxInflight)) {
+            snprintf(*value, len, "%d", config->mqttopts->maxInflight);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.maxBufferedBytes */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_maxBufferedBytes)) {
+            snprintf(*value, len, "%d", config->mqttopts->maxBufferedBytes);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.publishTimeout */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_publishTimeout)) {
+            snprintf(*value, len, "%d", config->mqttopts->publishTimeout);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.persistence.path */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_persistence_path)) {
+            snprintf(*value, len, "%s", config->mqttopts->persistencePath ? config->mqttopts->persistencePath : "");
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.persistence.maxBytes */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_persistence_maxBytes)) {
+            snprintf(*value, len, "%d", config->mqttopts->persistenceMaxBytes);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.persistence.sync */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_persistence_sync)) {
+            if (config->mqttopts->persistenceSync == 0) {
+                snprintf(*value, len, "false");
+            } else if (config->mqttopts->persistenceSync == 1) {
+                snprintf(*value, len, "true");
+            }
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.compression */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_compression)) {
+            snprintf(*value, len, "%s", iotp_compress_name(config->mqttopts->compression));
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.compressionMinSize */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_compressionMinSize)) {
+            snprintf(*value, len, "%d", config->mqttopts->compressionMinSize);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.coalesceWindow */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_coalesceWindow)) {
+            snprintf(*value, len, "%d", config->mqttopts->coalesceWindow);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.coalesceMaxBytes */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_coalesceMaxBytes)) {
+            snprintf(*value, len, "%d", config->mqttopts->coalesceMaxBytes);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.rateLimit */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_rateLimit)) {
+            snprintf(*value, len, "%d", config->mqttopts->rateLimit);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.rateBurst */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_rateBurst)) {
+            snprintf(*value, len, "%d", config->mqttopts->rateBurst);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.deviceRateLimit */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_deviceRateLimit)) {
+            snprintf(*value, len, "%d", config->mqttopts->deviceRateLimit);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.rateLimitTimeout */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_rateLimitTimeout)) {
+            snprintf(*value, len, "%d", config->mqttopts->rateLimitTimeout);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.controlMaxInflight */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_controlMaxInflight)) {
+            snprintf(*value, len, "%d", config->mqttopts->controlMaxInflight);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.submitQueueSize */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_submitQueueSize)) {
+            snprintf(*value, len, "%d", config->mqttopts->submitQueueSize);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.topicAliasMaximum */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_topicAliasMaximum)) {
+            snprintf(*value, len, "%d", config->mqttopts->topicAliasMaximum);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.deltaHeartbeat */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_deltaHeartbeat)) {
+            snprintf(*value, len, "%d", config->mqttopts->deltaHeartbeat);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.deltaDeadband */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_deltaDeadband)) {
+            snprintf(*value, len, "%g", config->mqttopts->deltaDeadband);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.cborTranscode */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_cborTranscode)) {
+            if (config->mqttopts->cborTranscode == 0) {
+                snprintf(*value, len, "false");
+            } else {
+                snprintf(*value, len, "true");
+            }
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.dispatchWorkers */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_dispatchWorkers)) {
+            snprintf(*value, len, "%d", config->mqttopts->dispatchWorkers);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.inboundQueueSize */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_inboundQueueSize)) {
+            snprintf(*value, len, "%d", config->mqttopts->inboundQueueSize);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.inboundOverflow */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_inboundOverflow)) {
+            snprintf(*value, len, "%s", iotp_dispatch_overflowName(config->mqttopts->inboundOverflow));
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.batchSize */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_batchSize)) {
+            snprintf(*value, len, "%d", config->mqttopts->batchSize);
+            goto getPropDone;
+        }
+
+        /* Process options.mqtt.batchWait */
+        if ( !strcasecmp(name, IoTPConfig_options_mqtt_batchWait)) {
+            snprintf(*value, len, "%d", config->mqttopts->batchWait);
+            goto getPropDone;
+        }
+
         /* Process options.mqtt.sharedSubscription */
         if ( !strcasecmp(name, IoTPConfig_options_mqtt_sharedSubscription)) {
             if (config->mqttopts->sharedSubscription == 0) {
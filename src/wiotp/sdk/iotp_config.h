@@ -111,6 +111,31 @@ typedef enum {
 #define IoTPConfig_options_mqtt_keepalive               "options.mqtt.keepalive"
 #define IoTPConfig_options_mqtt_sharedSubscription      "options.mqtt.sharedSubscription"
 #define IoTPConfig_options_mqtt_validateServerCert      "options.mqtt.validateServerCert"
+#define IoTPConfig_options_mqtt_maxInflight             "options.mqtt.maxInflight"
+#define IoTPConfig_options_mqtt_maxBufferedBytes        "options.mqtt.maxBufferedBytes"
+#define IoTPConfig_options_mqtt_publishTimeout          "options.mqtt.publishTimeout"
+#define IoTPConfig_options_mqtt_persistence_path        "options.mqtt.persistence.path"
+#define IoTPConfig_options_mqtt_persistence_maxBytes    "options.mqtt.persistence.maxBytes"
+#define IoTPConfig_options_mqtt_persistence_sync        "options.mqtt.persistence.sync"
+#define IoTPConfig_options_mqtt_compression             "options.mqtt.compression"
+#define IoTPConfig_options_mqtt_compressionMinSize      "options.mqtt.compressionMinSize"
+#define IoTPConfig_options_mqtt_coalesceWindow          "options.mqtt.coalesceWindow"
+#define IoTPConfig_options_mqtt_coalesceMaxBytes        "options.mqtt.coalesceMaxBytes"
+#define IoTPConfig_options_mqtt_rateLimit               "options.mqtt.rateLimit"
+#define IoTPConfig_options_mqtt_rateBurst               "options.mqtt.rateBurst"
+#define IoTPConfig_options_mqtt_deviceRateLimit         "options.mqtt.deviceRateLimit"
+#define IoTPConfig_options_mqtt_rateLimitTimeout        "options.mqtt.rateLimitTimeout"
+#define IoTPConfig_options_mqtt_controlMaxInflight      "options.mqtt.controlMaxInflight"
+#define IoTPConfig_options_mqtt_submitQueueSize         "options.mqtt.submitQueueSize"
+#define IoTPConfig_options_mqtt_topicAliasMaximum       "options.mqtt.topicAliasMaximum"
+#define IoTPConfig_options_mqtt_deltaHeartbeat          "options.mqtt.deltaHeartbeat"
+#define IoTPConfig_options_mqtt_deltaDeadband           "options.mqtt.deltaDeadband"
+#define IoTPConfig_options_mqtt_cborTranscode           "options.mqtt.cborTranscode"
+#define IoTPConfig_options_mqtt_dispatchWorkers         "options.mqtt.dispatchWorkers"
+#define IoTPConfig_options_mqtt_inboundQueueSize        "options.mqtt.inboundQueueSize"
+#define IoTPConfig_options_mqtt_inboundOverflow         "options.mqtt.inboundOverflow"
+#define IoTPConfig_options_mqtt_batchSize               "options.mqtt.batchSize"
+#define IoTPConfig_options_mqtt_batchWait               "options.mqtt.batchWait"
 
 #ifdef HTTP_IMPLEMENTED
 #define IoTPConfig_options_http_caFile                  "options.http.caFile"
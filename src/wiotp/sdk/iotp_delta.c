@@ -0,0 +1,473 @@
+/*******************************************************************************
+ * Copyright (c) 2019 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *
+ * Contrinutors:
+ *    Ranjan Dasgupta         - Initial drop
+ *
+ *******************************************************************************/
+
+/*
+ * Report-by-exception publishing of events in JSON format.
+ *
+ * The cache keeps the last published state of each event stream, i.e. event topic
+ * (iot-2/.../evt/<eventId>/fmt/json), which identifies the device and the event.
+ * Fields of a JSON object event are compared with the last published value of the
+ * field. Only changed fields are published, and an event with no changed field is
+ * not published. A numeric field is changed if it differs from the last published
+ * value by more than the dead-band. Other fields are compared as JSON text.
+ *
+ * The event is published as is, i.e. full state, if it is the first event of the
+ * stream, if the heartbeat interval has expired since the last full state, or if
+ * a field of the last state is missing from the event.
+ */
+
+#include "iotp_utils.h"
+#include "iotp_internal.h"
+
+/* Streams not published within heartbeat are evicted, once the cache has these many streams */
+#define IOTP_DELTA_MAX_STREAMS  4096
+
+/* Events with more fields are published as is */
+#define IOTP_DELTA_MAX_FIELDS   64
+
+/* Name and value of a field of JSON object, as JSON text */
+typedef struct IoTPDeltaField {
+    const char * name;      /* including quotes */
+    size_t       nameLen;
+    const char * value;
+    size_t       valueLen;
+} IoTPDeltaField;
+
+static uint32_t iotp_delta_hash(const char *topic)
+{
+    uint32_t h = 2166136261u;
+    const unsigned char *p = (const unsigned char *)topic;
+    while ( *p ) {
+        h ^= *p++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static const char * iotp_delta_skipSpace(const char *p, const char *end)
+{
+    while ( p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') )
+        p++;
+    return p;
+}
+
+/* Returns end of JSON string starting at p, or NULL if string is not terminated */
+static const char * iotp_delta_skipString(const char *p, const char *end)
+{
+    for (p++; p < end; p++) {
+        if ( *p == '\\' ) {
+            p++;
+        } else if ( *p == '"' ) {
+            return p + 1;
+        }
+    }
+    return NULL;
+}
+
+/* Returns end of JSON value starting at p, or NULL if value is not valid */
+static const char * iotp_delta_skipValue(const char *p, const char *end)
+{
+    const char *start = p;
+    int depth = 0;
+
+    if ( p >= end ) {
+        return NULL;
+    }
+    if ( *p == '"' ) {
+        return iotp_delta_skipString(p, end);
+    }
+    if ( *p == '{' || *p == '[' ) {
+        while ( p < end ) {
+            if ( *p == '"' ) {
+                if ( (p = iotp_delta_skipString(p, end)) == NULL )
+                    return NULL;
+                continue;
+            }
+            if ( *p == '{' || *p == '[' ) {
+                depth++;
+            } else if ( *p == '}' || *p == ']' ) {
+                if ( --depth == 0 )
+                    return p + 1;
+            }
+            p++;
+        }
+        return NULL;
+    }
+    /* number, true, false or null */
+    while ( p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n' )
+        p++;
+    return (p > start) ? p : NULL;
+}
+
+/*
+ * Splits a JSON object into fields. Returns number of fields, or -1 if text is not a JSON
+ * object, or has more than maxFields fields.
+ */
+static int iotp_delta_scan(const char *json, size_t len, IoTPDeltaField *fields, int maxFields)
+{
+    const char *end = json + len;
+    const char *p = NULL;
+    int count = 0;
+
+    /* ignore NUL terminator included in payload length */
+    while ( end > json && *(end - 1) == '\0' )
+        end--;
+
+    p = iotp_delta_skipSpace(json, end);
+    if ( p >= end || *p != '{' ) {
+        return -1;
+    }
+    p = iotp_delta_skipSpace(p + 1, end);
+    if ( p < end && *p == '}' ) {
+        p = iotp_delta_skipSpace(p + 1, end);
+        return (p == end) ? 0 : -1;
+    }
+
+    for (;;) {
+        IoTPDeltaField *field = &fields[count];
+        if ( count >= maxFields || p >= end || *p != '"' ) {
+            return -1;
+        }
+        field->name = p;
+        if ( (p = iotp_delta_skipString(p, end)) == NULL ) {
+            return -1;
+        }
+        field->nameLen = (size_t)(p - field->name);
+        p = iotp_delta_skipSpace(p, end);
+        if ( p >= end || *p != ':' ) {
+            return -1;
+        }
+        p = iotp_delta_skipSpace(p + 1, end);
+        field->value = p;
+        if ( (p = iotp_delta_skipValue(p, end)) == NULL ) {
+            return -1;
+        }
+        field->valueLen = (size_t)(p - field->value);
+        count++;
+        p = iotp_delta_skipSpace(p, end);
+        if ( p < end && *p == ',' ) {
+            p = iotp_delta_skipSpace(p + 1, end);
+            continue;
+        }
+        if ( p < end && *p == '}' ) {
+            p = iotp_delta_skipSpace(p + 1, end);
+            return (p == end) ? count : -1;
+        }
+        return -1;
+    }
+}
+
+/* Returns 1 if value is a JSON number, and sets the number */
+static int iotp_delta_number(const IoTPDeltaField *field, double *number)
+{
+    char *endptr = NULL;
+
+    if ( field->valueLen == 0 || !(*field->value == '-' || (*field->value >= '0' && *field->value <= '9')) ) {
+        return 0;
+    }
+    /* value is always followed by a delimiter within the JSON text */
+    *number = strtod(field->value, &endptr);
+    return (endptr == field->value + field->valueLen);
+}
+
+/* Returns 1 if value of a field is changed from the last published value */
+static int iotp_delta_changed(IoTPDeltaCache *cache, const IoTPDeltaField *last, const IoTPDeltaField *field)
+{
+    double a = 0;
+    double b = 0;
+
+    if ( iotp_delta_number(last, &a) && iotp_delta_number(field, &b) ) {
+        double diff = (a > b) ? a - b : b - a;
+        return (diff > cache->deadband);
+    }
+    return (last->valueLen != field->valueLen || memcmp(last->value, field->value, field->valueLen));
+}
+
+/* Returns index of field of the last state with the name of a field, or -1 if not found */
+static int iotp_delta_find(const IoTPDeltaField *last, int lastCount, const IoTPDeltaField *field, int hint)
+{
+    int i;
+
+    if ( hint < lastCount && last[hint].nameLen == field->nameLen && !memcmp(last[hint].name, field->name, field->nameLen) ) {
+        return hint;
+    }
+    for (i = 0; i < lastCount; i++) {
+        if ( last[i].nameLen == field->nameLen && !memcmp(last[i].name, field->name, field->nameLen) ) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Appends name of a field, with a value, to JSON object text */
+static char * iotp_delta_appendField(char *p, const IoTPDeltaField *field, const IoTPDeltaField *value, int first)
+{
+    if ( !first )
+        *p++ = ',';
+    memcpy(p, field->name, field->nameLen);
+    p += field->nameLen;
+    *p++ = ':';
+    memcpy(p, value->value, value->valueLen);
+    p += value->valueLen;
+    return p;
+}
+
+/* Removes stream of a topic from cache. Called with lock held. */
+static void iotp_delta_remove(IoTPDeltaCache *cache, const char *topic, uint32_t hash)
+{
+    IoTPDeltaEntry **pp = &cache->buckets[hash % IOTP_DELTA_BUCKETS];
+
+    while ( *pp ) {
+        IoTPDeltaEntry *entry = *pp;
+        if ( entry->hash == hash && !strcmp(entry->topic, topic) ) {
+            *pp = entry->next;
+            iotp_utils_freePtr((void *)entry->topic);
+            iotp_utils_freePtr((void *)entry->state);
+            iotp_utils_freePtr((void *)entry);
+            cache->count -= 1;
+            return;
+        }
+        pp = &entry->next;
+    }
+}
+
+/* Evicts streams with expired heartbeat interval. Called with lock held. */
+static void iotp_delta_evict(IoTPDeltaCache *cache, uint64_t now)
+{
+    int i;
+
+    for (i = 0; i < IOTP_DELTA_BUCKETS; i++) {
+        IoTPDeltaEntry **pp = &cache->buckets[i];
+        while ( *pp ) {
+            IoTPDeltaEntry *entry = *pp;
+            if ( now - entry->lastFull >= cache->heartbeat ) {
+                *pp = entry->next;
+                iotp_utils_freePtr((void *)entry->topic);
+                iotp_utils_freePtr((void *)entry->state);
+                iotp_utils_freePtr((void *)entry);
+                cache->count -= 1;
+            } else {
+                pp = &entry->next;
+            }
+        }
+    }
+}
+
+/* Returns 1 if topic is an event topic in JSON format */
+static int iotp_delta_isJsonEvent(const char *topic)
+{
+    size_t len = strlen(topic);
+    return (len > 9 && !strcmp(topic + len - 9, "/fmt/json") && strstr(topic, "/evt/") != NULL);
+}
+
+/* Initializes report-by-exception cache. Heartbeat is in seconds. */
+void iotp_delta_init(IoTPDeltaCache *cache, int heartbeat, double deadband)
+{
+    memset(cache, 0, sizeof(IoTPDeltaCache));
+    if ( heartbeat <= 0 ) {
+        return;
+    }
+
+    cache->heartbeat = (uint64_t)heartbeat * 1000000;
+    cache->deadband = deadband;
+    pthread_mutex_init(&cache->lock, NULL);
+    cache->enabled = 1;
+}
+
+/* Frees streams of report-by-exception cache */
+void iotp_delta_free(IoTPDeltaCache *cache)
+{
+    int i;
+
+    if ( cache->enabled == 0 ) {
+        return;
+    }
+    for (i = 0; i < IOTP_DELTA_BUCKETS; i++) {
+        IoTPDeltaEntry *entry = cache->buckets[i];
+        while ( entry ) {
+            IoTPDeltaEntry *next = entry->next;
+            iotp_utils_freePtr((void *)entry->topic);
+            iotp_utils_freePtr((void *)entry->state);
+            iotp_utils_freePtr((void *)entry);
+            entry = next;
+        }
+        cache->buckets[i] = NULL;
+    }
+    cache->count = 0;
+    pthread_mutex_destroy(&cache->lock);
+    cache->enabled = 0;
+}
+
+/*
+ * Compares an event with the last published state of its stream, and updates the state.
+ * Returns IoTPDelta_changed with a JSON object of changed fields in delta, that should be
+ * freed by the caller, IoTPDelta_unchanged if event should not be published, or
+ * IoTPDelta_full if event should be published as is.
+ */
+IoTPDeltaResult iotp_delta_filter(IoTPDeltaCache *cache, const char *topic, const void *payload, size_t payloadlen, void **delta, size_t *deltalen)
+{
+    IoTPDeltaField fields[IOTP_DELTA_MAX_FIELDS];
+    IoTPDeltaField last[IOTP_DELTA_MAX_FIELDS];
+    int lastIndex[IOTP_DELTA_MAX_FIELDS];
+    char fieldChanged[IOTP_DELTA_MAX_FIELDS];
+    IoTPDeltaEntry *entry = NULL;
+    uint32_t hash = 0;
+    uint64_t now = 0;
+    int count = 0;
+    int lastCount = 0;
+    int changed = 0;
+    int i;
+
+    *delta = NULL;
+    *deltalen = 0;
+    if ( cache->enabled == 0 || topic == NULL || payload == NULL || !iotp_delta_isJsonEvent(topic) ) {
+        return IoTPDelta_full;
+    }
+
+    hash = iotp_delta_hash(topic);
+    count = iotp_delta_scan((const char *)payload, payloadlen, fields, IOTP_DELTA_MAX_FIELDS);
+
+    pthread_mutex_lock(&cache->lock);
+    if ( count < 0 ) {
+        /* not a JSON object - state of the stream is not known */
+        iotp_delta_remove(cache, topic, hash);
+        pthread_mutex_unlock(&cache->lock);
+        return IoTPDelta_full;
+    }
+
+    now = iotp_utils_timeMicros();
+    for (entry = cache->buckets[hash % IOTP_DELTA_BUCKETS]; entry; entry = entry->next) {
+        if ( entry->hash == hash && !strcmp(entry->topic, topic) )
+            break;
+    }
+
+    if ( entry && now - entry->lastFull < cache->heartbeat ) {
+        int matched = 0;
+        lastCount = iotp_delta_scan(entry->state, entry->stateLen, last, IOTP_DELTA_MAX_FIELDS);
+        for (i = 0; i < count && lastCount >= 0; i++) {
+            lastIndex[i] = iotp_delta_find(last, lastCount, &fields[i], i);
+            fieldChanged[i] = (lastIndex[i] < 0 || iotp_delta_changed(cache, &last[lastIndex[i]], &fields[i]));
+            if ( lastIndex[i] >= 0 )
+                matched++;
+            if ( fieldChanged[i] )
+                changed++;
+        }
+
+        /* a field removed from the event can not be published as a change */
+        if ( lastCount >= 0 && matched == lastCount ) {
+            char *state = NULL;
+            char *out = NULL;
+            char *sp = NULL;
+            char *dp = NULL;
+            size_t size = 2;
+
+            if ( changed == 0 ) {
+                pthread_mutex_unlock(&cache->lock);
+                return IoTPDelta_unchanged;
+            }
+
+            for (i = 0; i < count; i++) {
+                size_t valueLen = fields[i].valueLen;
+                if ( lastIndex[i] >= 0 && last[lastIndex[i]].valueLen > valueLen )
+                    valueLen = last[lastIndex[i]].valueLen;
+                size += fields[i].nameLen + valueLen + 2;
+            }
+            state = (char *)malloc(size + 1);
+            out = (char *)malloc(size + 1);
+            if ( state == NULL || out == NULL ) {
+                iotp_utils_freePtr((void *)state);
+                iotp_utils_freePtr((void *)out);
+                iotp_delta_remove(cache, topic, hash);
+                pthread_mutex_unlock(&cache->lock);
+                return IoTPDelta_full;
+            }
+
+            /* state keeps last published value of unchanged fields, so that small changes add up */
+            sp = state;
+            dp = out;
+            *sp++ = '{';
+            *dp++ = '{';
+            for (i = 0; i < count; i++) {
+                if ( fieldChanged[i] ) {
+                    dp = iotp_delta_appendField(dp, &fields[i], &fields[i], dp == out + 1);
+                }
+                sp = iotp_delta_appendField(sp, &fields[i], fieldChanged[i] ? &fields[i] : &last[lastIndex[i]], i == 0);
+            }
+            *sp++ = '}';
+            *sp = '\0';
+            *dp++ = '}';
+            *dp = '\0';
+
+            iotp_utils_freePtr((void *)entry->state);
+            entry->state = state;
+            entry->stateLen = (size_t)(sp - state);
+            pthread_mutex_unlock(&cache->lock);
+
+            *delta = out;
+            *deltalen = (size_t)(dp - out);
+            return IoTPDelta_changed;
+        }
+    }
+
+    /* publish full state, and keep it as state of the stream */
+    if ( entry == NULL ) {
+        if ( cache->count >= IOTP_DELTA_MAX_STREAMS ) {
+            iotp_delta_evict(cache, now);
+        }
+        if ( cache->count < IOTP_DELTA_MAX_STREAMS ) {
+            entry = (IoTPDeltaEntry *)calloc(1, sizeof(IoTPDeltaEntry));
+            if ( entry && (entry->topic = strdup(topic)) == NULL ) {
+                iotp_utils_freePtr((void *)entry);
+                entry = NULL;
+            }
+            if ( entry ) {
+                entry->hash = hash;
+                entry->next = cache->buckets[hash % IOTP_DELTA_BUCKETS];
+                cache->buckets[hash % IOTP_DELTA_BUCKETS] = entry;
+                cache->count += 1;
+            }
+        }
+    }
+    if ( entry ) {
+        char *state = (char *)malloc(payloadlen + 1);
+        if ( state == NULL ) {
+            iotp_delta_remove(cache, topic, hash);
+        } else {
+            memcpy(state, payload, payloadlen);
+            state[payloadlen] = '\0';
+            iotp_utils_freePtr((void *)entry->state);
+            entry->state = state;
+            entry->stateLen = payloadlen;
+            entry->lastFull = now;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    return IoTPDelta_full;
+}
+
+/* Removes stream of a topic from cache, if event could not be published. Next event is published as is. */
+void iotp_delta_invalidate(IoTPDeltaCache *cache, const char *topic)
+{
+    if ( cache->enabled == 0 || topic == NULL ) {
+        return;
+    }
+    pthread_mutex_lock(&cache->lock);
+    iotp_delta_remove(cache, topic, iotp_delta_hash(topic));
+    pthread_mutex_unlock(&cache->lock);
+}
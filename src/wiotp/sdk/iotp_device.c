@@ -87,11 +87,18 @@ IOTPRC IoTPDevice_disconnect(IoTPDevice *device)
 
 /* Sends an event */
 IOTPRC IoTPDevice_sendEvent(IoTPDevice *device, char *eventId, char *data, char *formatString, QoS qos, MQTTProperties *props)
+{
+    size_t datalen = data ? strlen(data) : 0;
+    return IoTPDevice_sendEventBuffer(device, eventId, data, datalen, formatString, qos, props, NULL, NULL);
+}
+
+/* Sends an event using payload buffer of specified length */
+IOTPRC IoTPDevice_sendEventBuffer(IoTPDevice *device, char *eventId, void *buffer, size_t bufferlen, char *formatString, QoS qos, MQTTProperties *props, IoTPBufferReleaseHandler releaseCB, void *context)
 {
     IOTPRC rc = IOTPRC_SUCCESS;
 
     /* Sanity check */
-    if ( !device || !eventId || *eventId == '\0' || !formatString || *formatString == '\0' ) {
+    if ( !device || !eventId || *eventId == '\0' || !formatString || *formatString == '\0' || (!buffer && bufferlen > 0) ) {
         rc = IOTPRC_ARGS_NULL_VALUE;
         LOG(WARN, "Received NULL argument. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
         return rc;
@@ -111,7 +118,39 @@ IOTPRC IoTPDevice_sendEvent(IoTPDevice *device, char *eventId, char *data, char
 
     LOG(DEBUG,"Send event. topic: %s", topic);
 
-    rc = iotp_client_publish((void *)device, topic, data, qos, props);
+    rc = iotp_client_publishBuffer((void *)device, topic, buffer, bufferlen, qos, props, releaseCB, context);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to send. event: %s | rc: %d | reason: %s", eventId, rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
+/* Sends an event, and returns delivery token of the publish request */
+IOTPRC IoTPDevice_sendEventAsync(IoTPDevice *device, char *eventId, void *buffer, size_t bufferlen, char *formatString, QoS qos, MQTTProperties *props, IoTPDeliveryHandler deliveryCB, void *context, int *token)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* Sanity check */
+    if ( !device || !eventId || *eventId == '\0' || !formatString || *formatString == '\0' || (!buffer && bufferlen > 0) ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Received NULL argument. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+    if ( qos != QoS0 && qos != QoS1 && qos != QoS2 ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(WARN, "Invalid QoS. qos: %d | rc: %d | reason: %s", qos, rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    /* Set topic string */
+    int len = strlen(eventId) + strlen(formatString) + 16;
+    char topic[len];
+    snprintf(topic, len, "iot-2/evt/%s/fmt/%s", eventId, formatString);
+
+    LOG(DEBUG,"Send event. topic: %s", topic);
+
+    rc = iotp_client_publishAsync((void *)device, topic, buffer, bufferlen, qos, props, deliveryCB, context, token);
     if ( rc != IOTPRC_SUCCESS ) {
         LOG(ERROR, "Failed to send. event: %s | rc: %d | reason: %s", eventId, rc, IOTPRC_toString(rc));
     }
@@ -119,6 +158,76 @@ IOTPRC IoTPDevice_sendEvent(IoTPDevice *device, char *eventId, char *data, char
     return rc;
 }
 
+/* Sends response of a command to the Response Topic of the command */
+IOTPRC IoTPDevice_sendCommandResponse(IoTPDevice *device, const IoTPMessage *command, void *buffer, size_t bufferlen, QoS qos)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* Sanity check */
+    if ( !device || !command || (!buffer && bufferlen > 0) ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Received NULL argument. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+    if ( qos != QoS0 && qos != QoS1 && qos != QoS2 ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(WARN, "Invalid QoS. qos: %d | rc: %d | reason: %s", qos, rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    return iotp_client_sendCommandResponse((void *)device, command, buffer, bufferlen, qos);
+}
+
+/* Sends a batch of events */
+IOTPRC IoTPDevice_sendEvents(IoTPDevice *device, IoTPEventBatch *batch)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* Sanity check */
+    if ( !device || !batch ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Received NULL argument. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    rc = iotp_client_publishEvents((void *)device, batch);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to send event batch. count: %d | rc: %d | reason: %s", batch->count, rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
+/* Creates a topic handle for an event */
+IOTPRC IoTPDevice_prepareEventTopic(IoTPDevice *device, char *eventId, char *formatString, IoTPTopic **topic)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* Sanity check */
+    if ( !device || !eventId || *eventId == '\0' || !formatString || *formatString == '\0' || !topic ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Received NULL argument. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+    if ( !iotp_topic_isValidLevel(eventId) || !iotp_topic_isValidLevel(formatString) ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(WARN, "Invalid event id or format. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    /* Set topic string */
+    int len = strlen(eventId) + strlen(formatString) + 16;
+    char eventTopic[len];
+    snprintf(eventTopic, len, "iot-2/evt/%s/fmt/%s", eventId, formatString);
+
+    rc = iotp_client_prepareTopic((void *)device, eventTopic, topic);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to prepare event topic. event: %s | rc: %d | reason: %s", eventId, rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
 /* Set event callback */
 IOTPRC IoTPDevice_setEventCallback(IoTPDevice *device, IoTPEventCallbackHandler cb) 
 {
@@ -132,6 +241,32 @@ IOTPRC IoTPDevice_setEventCallback(IoTPDevice *device, IoTPEventCallbackHandler
     return rc;
 }
 
+/* Sets connection state handler */
+IOTPRC IoTPDevice_setConnectionStateHandler(IoTPDevice *device, IoTPConnectionStateHandler cb, void *context)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    rc = iotp_client_setConnectionStateHandler((void *)device, cb, context);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to set connection state handler. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
+/* Returns client statistics */
+IOTPRC IoTPDevice_getStats(IoTPDevice *device, IoTPStats *stats)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    rc = iotp_client_getStats((void *)device, stats);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to get client statistics. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
 /* Sets a handler for all commands */
 IOTPRC IoTPDevice_setCommandsHandler(IoTPDevice *device, IoTPCallbackHandler cb)
 {
@@ -145,6 +280,19 @@ IOTPRC IoTPDevice_setCommandsHandler(IoTPDevice *device, IoTPCallbackHandler cb)
     return rc;
 }
 
+/* Sets global command handler, invoked with message descriptor */
+IOTPRC IoTPDevice_setMessageHandler(IoTPDevice *device, IoTPMessageHandler cb, void *context)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    rc = iotp_client_setMessageHandler((void *)device, NULL, IoTP_Handler_Commands, cb, context);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to set global command handler. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
 
 /* Subscribes to command */
 IOTPRC IoTPDevice_subscribeToCommands(IoTPDevice *device, char *commandId, char *formatString)
@@ -174,8 +322,8 @@ IOTPRC IoTPDevice_subscribeToCommands(IoTPDevice *device, char *commandId, char
     return rc;
 }
 
-/* Sets a callback handler and subscribe to a command */
-IOTPRC IoTPDevice_setCommandHandler(IoTPDevice *device, IoTPCallbackHandler cb, char *commandId, char *formatString)
+/* Sets a callback handler (IoTPCallbackHandler or IoTPMessageHandler) and subscribe to a command */
+static IOTPRC iotp_device_setCommandHandler(IoTPDevice *device, void *cb, int descriptor, void *context, char *commandId, char *formatString)
 {
     IOTPRC rc = IOTPRC_SUCCESS;
 
@@ -193,18 +341,22 @@ IOTPRC IoTPDevice_setCommandHandler(IoTPDevice *device, IoTPCallbackHandler cb,
         return rc;
     }
 
-    /* set handler */
-    rc = iotp_client_setHandler((void *)device, commandId, IoTP_Handler_Command, cb);
-    if ( rc != IOTPRC_SUCCESS ) {
-        LOG(ERROR, "Failed to set command handler. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
-    }
-
     /* Set topic string */
     char *format = "iot-2/cmd/%s/fmt/%s";
     int len = strlen(format) + strlen(commandId) + strlen(formatString) - 3;
     char topic[len];
     snprintf(topic, len, format, commandId, formatString);
 
+    /* set handler - for the command topic, so that received commands are matched with the handler */
+    if ( descriptor ) {
+        rc = iotp_client_setMessageHandler((void *)device, topic, IoTP_Handler_Command, (IoTPMessageHandler)cb, context);
+    } else {
+        rc = iotp_client_setHandler((void *)device, topic, IoTP_Handler_Command, (IoTPCallbackHandler)cb);
+    }
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to set command handler. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+    }
+
     LOG(DEBUG,"Subscribe command. topic: %s", topic);
 
     rc = iotp_client_subscribe((void *)device, topic, QoS0);
@@ -215,6 +367,18 @@ IOTPRC IoTPDevice_setCommandHandler(IoTPDevice *device, IoTPCallbackHandler cb,
     return rc;
 }
 
+/* Sets a callback handler and subscribe to a command */
+IOTPRC IoTPDevice_setCommandHandler(IoTPDevice *device, IoTPCallbackHandler cb, char *commandId, char *formatString)
+{
+    return iotp_device_setCommandHandler(device, (void *)cb, 0, NULL, commandId, formatString);
+}
+
+/* Sets a message handler with a user context and subscribe to a command */
+IOTPRC IoTPDevice_setCommandMessageHandler(IoTPDevice *device, IoTPMessageHandler cb, void *context, char *commandId, char *formatString)
+{
+    return iotp_device_setCommandHandler(device, (void *)cb, 1, context, commandId, formatString);
+}
+
 /* Unsubscribe from a command */
 IOTPRC IoTPDevice_unsubscribeFromCommands(IoTPDevice *device, char *commandId, char *formatString)
 {
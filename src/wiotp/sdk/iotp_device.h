@@ -113,6 +113,18 @@ DLLExport IOTPRC IoTPDevice_disconnect(IoTPDevice *device);
  */
 DLLExport IOTPRC IoTPDevice_setCommandsHandler(IoTPDevice *device, IoTPCallbackHandler cb);
 
+/**
+ * The IoTPDevice_setMessageHandler() API sets the Command Callback function, that is invoked
+ * with a message descriptor and a user context. Topic and payload of the commands are
+ * not copied. It replaces the callback set by IoTPDevice_setCommandsHandler().
+ *
+ * @param device         - A pointer to IoTP device handle.
+ * @param cb             - A Function pointer to the IoTPMessageHandler.
+ * @param context        - User context passed to the callback.
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPDevice_setMessageHandler(IoTPDevice *device, IoTPMessageHandler cb, void *context);
+
 /**
  * The IoTPDevice_subscribeToCommands() API subscribe to commands for the device.
  * To receive command specified by "commandId" paramete, a command callback handler
@@ -139,6 +151,21 @@ DLLExport IOTPRC IoTPDevice_subscribeToCommands(IoTPDevice *device, char *comman
  */
 DLLExport IOTPRC IoTPDevice_setCommandHandler(IoTPDevice *device, IoTPCallbackHandler cb, char *commandId, char *formatString);
 
+/**
+ * The IoTPDevice_setCommandMessageHandler() API subscribes to a specific command and
+ * sets a message handler for the command. The handler is invoked with a message descriptor
+ * and the user context.
+ *
+ * @param device         - A pointer to IoTP device handle.
+ * @param cb             - A Function pointer to the IoTPMessageHandler.
+ * @param context        - User context passed to the handler.
+ * @param commandId      - ID of command. The command ID can be any string that is valid in
+ *                         MQTT protocol.
+ * @param formatString   - Reponse format. e.g. json, xml, txt, csv. Also accepts MQTT wild card character "+"
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPDevice_setCommandMessageHandler(IoTPDevice *device, IoTPMessageHandler cb, void *context, char *commandId, char *formatString);
+
 /**
  * The IoTPDevice_unsubscribeFromCommands() API unsubscribes from commands for the device.
  *
@@ -163,6 +190,93 @@ DLLExport IOTPRC IoTPDevice_unsubscribeFromCommands(IoTPDevice *device, char *co
  */
 DLLExport IOTPRC IoTPDevice_sendEvent(IoTPDevice *device, char *eventId, char *data, char *formatString, QoS qos, MQTTProperties *props);
 
+/**
+ * The IoTPDevice_sendEventBuffer() API sends an event from the device to the IBM Watson IoT service,
+ * using a payload buffer of specified length. The buffer can contain binary data (e.g. CBOR, protobuf,
+ * or compressed data). The buffer is handed to the MQTT client without being scanned or copied by
+ * the IoTP client. If releaseCB is specified, the buffer must not be modified or freed by the caller
+ * until releaseCB is invoked on completion of the publish request. If this API returns an error,
+ * releaseCB is not invoked and the buffer is still owned by the caller.
+ *
+ * @param device         - A pointer to IoTP device handle.
+ * @param eventId        - Event id to be published e.g status, gps
+ * @param buffer         - Payload buffer of the event
+ * @param bufferlen      - Size of payload buffer
+ * @param formatString   - Format of the event e.g json, cbor, bin
+ * @param qos            - QoS for the publish event. Supported values : QoS0, QoS1, QoS2
+ * @param props          - MQTT V5 properties
+ * @param releaseCB      - Optional. A function pointer to the IoTPBufferReleaseHandler.
+ * @param context        - Optional. User context passed to the release callback.
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPDevice_sendEventBuffer(IoTPDevice *device, char *eventId, void *buffer, size_t bufferlen, char *formatString, QoS qos, MQTTProperties *props, IoTPBufferReleaseHandler releaseCB, void *context);
+
+/**
+ * The IoTPDevice_sendEventAsync() API sends an event from the device to the IBM Watson IoT service,
+ * and returns the delivery token of the publish request. If deliveryCB is specified, it is invoked
+ * once the publish request completes, with the delivery token, status of the request, and the time
+ * the request was submitted and acknowledged. The payload buffer can be reused as soon as the API returns.
+ *
+ * @param device         - A pointer to IoTP device handle.
+ * @param eventId        - Event id to be published e.g status, gps
+ * @param buffer         - Payload buffer of the event
+ * @param bufferlen      - Size of payload buffer
+ * @param formatString   - Format of the event e.g json, cbor, bin
+ * @param qos            - QoS for the publish event. Supported values : QoS0, QoS1, QoS2
+ * @param props          - MQTT V5 properties
+ * @param deliveryCB     - Optional. A function pointer to the IoTPDeliveryHandler.
+ * @param context        - Optional. User context passed to the delivery callback.
+ * @param token          - Optional. Returned delivery token.
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPDevice_sendEventAsync(IoTPDevice *device, char *eventId, void *buffer, size_t bufferlen, char *formatString, QoS qos, MQTTProperties *props, IoTPDeliveryHandler deliveryCB, void *context, int *token);
+
+/**
+ * The IoTPDevice_sendCommandResponse() API sends response of a command, that is received with a message
+ * handler (e.g. IoTPDevice_setCommandMessageHandler()). The response is published to the MQTT V5 Response
+ * Topic of the command, with Correlation Data of the command. Commands sent by an application using
+ * IoTPApplication_sendCommandRequest() have a Response Topic.
+ *
+ * @param device         - A pointer to IoTP device handle.
+ * @param command        - Descriptor of the command, passed to the message handler.
+ * @param buffer         - Payload buffer of the response
+ * @param bufferlen      - Size of payload buffer
+ * @param qos            - QoS for the publish response. Supported values : QoS0, QoS1, QoS2
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess, IOTPRC_NOT_FOUND if the command has no
+ *                         Response Topic, or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPDevice_sendCommandResponse(IoTPDevice *device, const IoTPMessage *command, void *buffer, size_t bufferlen, QoS qos);
+
+/**
+ * The IoTPDevice_sendEvents() API sends a batch of events from the device to the IBM Watson IoT service.
+ * All events in the batch are validated before any event is sent, and are then pipelined to the MQTT client.
+ * The typeId and deviceId fields of the event records are ignored. The batch callback, if set, is invoked
+ * once all events accepted for delivery complete. The status of each event submission is returned in the
+ * rc field of the event record. If the batch is not sent, the rc field of valid events is set to
+ * IOTPRC_FAILURE, or to the error of the batch. Events of a batch are not coalesced, are not queued in
+ * the submission queue, and are sent in full if options.mqtt.deltaHeartbeat is set.
+ *
+ * @param device         - A pointer to IoTP device handle.
+ * @param batch          - A pointer to the IoTPEventBatch.
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS if all events are accepted for delivery, IOTPRC_PARTIAL_FAILURE
+ *                         if some events are accepted, or IOTPRC_* on error if no event is sent
+ */
+DLLExport IOTPRC IoTPDevice_sendEvents(IoTPDevice *device, IoTPEventBatch *batch);
+
+/**
+ * The IoTPDevice_prepareEventTopic() API creates a topic handle for an event. The event topic is built
+ * and validated once, and can be reused to publish events using IoTPTopic_publish() API, without formatting
+ * the topic string for every event. The topic handle must be destroyed using IoTPTopic_destroy() API,
+ * before the device handle is destroyed.
+ *
+ * @param device         - A pointer to IoTP device handle.
+ * @param eventId        - Event id e.g status, gps
+ * @param formatString   - Format of the event e.g json, cbor, bin
+ * @param topic          - Returned topic handle
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPDevice_prepareEventTopic(IoTPDevice *device, char *eventId, char *formatString, IoTPTopic **topic);
+
 /**
  * The IoTPDevice_setEventCallback() API sets event callback to get notifications on event delivery status. 
  *
@@ -172,6 +286,28 @@ DLLExport IOTPRC IoTPDevice_sendEvent(IoTPDevice *device, char *eventId, char *d
  */
 DLLExport IOTPRC IoTPDevice_setEventCallback(IoTPDevice *device, IoTPEventCallbackHandler cb);
 
+/**
+ * The IoTPDevice_setConnectionStateHandler() API sets handler to get notifications on connection
+ * state changes. If connection is lost and automatic reconnect is enabled, client reconnects in
+ * background, and events sent while reconnecting are buffered by MQTT client.
+ *
+ * @param device         - A pointer to IoTP device handle.
+ * @param cb             - A Function pointer to the IoTPConnectionStateHandler. Set to NULL to clear handler.
+ * @param context        - User context passed to the handler
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPDevice_setConnectionStateHandler(IoTPDevice *device, IoTPConnectionStateHandler cb, void *context);
+
+/**
+ * The IoTPDevice_getStats() API returns client statistics, e.g. number of events merged
+ * by event coalescer (options.mqtt.coalesceWindow) and number of batches published.
+ *
+ * @param device         - A pointer to IoTP device handle.
+ * @param stats          - A pointer to IoTPStats, filled in by the API.
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPDevice_getStats(IoTPDevice *device, IoTPStats *stats);
+
 
 #if defined(__cplusplus)
  }
@@ -0,0 +1,398 @@
+/*******************************************************************************
+ * Copyright (c) 2019 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *
+ * Contrinutors:
+ *    Ranjan Dasgupta         - Initial drop
+ *
+ *******************************************************************************/
+
+/*
+ * Dispatch workers of received messages.
+ *
+ * Callbacks of received messages are invoked by a pool of worker threads, instead of
+ * the receiving thread of MQTT client, so that a slow callback does not delay messages
+ * of other devices. Each worker has its own queue. A message is assigned to a worker
+ * by hash of device type and ID in its topic (iot-2/type/<typeId>/id/<deviceId>/... or
+ * iotdm-1/type/<typeId>/id/<deviceId>/...), so messages of a device are processed in
+ * the order received. Messages with no device in topic (commands and device management
+ * requests of a device) are processed by the same worker.
+ *
+ * Queue of a worker can be bounded. When the queue is full, the receiving thread waits for space
+ * in the queue (block), or the oldest queued message (dropOldest) or the received message
+ * (dropNewest) is discarded. The receiving thread waits for up to IOTP_DISPATCH_BLOCK_WAIT at a
+ * time, and then returns the message to the MQTT client as not processed, so that the MQTT client
+ * can process acknowledgements and keep alive. The MQTT client keeps the message at the head of
+ * its inbound queue, and delivers it again. While the receiving thread waits, it does not read
+ * from the network, so the server is slowed down by TCP flow control. MQTT client acknowledges
+ * QoS1 and QoS2 messages when they are received, so messages it has already read are held in
+ * its memory till they are delivered.
+ *
+ * If batches are enabled, a worker takes up to batchSize queued messages at a time, and
+ * waits for more messages till batchWait microseconds after arrival of the first message,
+ * so that the handler processes a batch with one call.
+ */
+
+#include "iotp_utils.h"
+#include "iotp_internal.h"
+
+/* Time the receiving thread waits for space in a full queue, before returning the message to MQTT client */
+#define IOTP_DISPATCH_BLOCK_WAIT  100000
+
+static const char * iotp_dispatch_overflowNames[] = { "block", "dropOldest", "dropNewest" };
+
+/* Returns inbound overflow policy from name, or -1 if name is not valid */
+int iotp_dispatch_overflowFromName(const char *name)
+{
+    int i;
+
+    if ( name == NULL ) {
+        return -1;
+    }
+    for (i = 0; i < 3; i++) {
+        if ( !strcasecmp(name, iotp_dispatch_overflowNames[i]) )
+            return i;
+    }
+    return -1;
+}
+
+/* Returns name of inbound overflow policy */
+const char * iotp_dispatch_overflowName(IoTPInboundOverflow overflow)
+{
+    if ( overflow < IoTPInboundOverflow_block || overflow > IoTPInboundOverflow_dropNewest ) {
+        return "";
+    }
+    return iotp_dispatch_overflowNames[overflow];
+}
+
+/* Frees a queue entry */
+static void iotp_dispatch_freeEntry(IoTPDispatchEntry *entry)
+{
+    if ( entry->properties.count > 0 )
+        MQTTProperties_free(&entry->properties);
+    free(entry);
+}
+
+/* Returns hash of <typeId>/id/<deviceId> in topic, or of an empty key if topic has no device */
+static uint32_t iotp_dispatch_hash(const char *topic, int topicLen)
+{
+    uint32_t h = 2166136261u;
+    const char *end = topic + topicLen;
+    const char *p = (const char *)memchr(topic, '/', (size_t)topicLen);
+    const char *key = NULL;
+    int level = 1;
+
+    if ( p == NULL || end - p < 6 || strncmp(p + 1, "type/", 5) ) {
+        return h;
+    }
+    key = p + 6;
+    /* key ends before the level after device ID */
+    for (p = key; p < end; p++) {
+        if ( *p == '/' && ++level == 4 )
+            break;
+    }
+    if ( level < 3 || strncmp(key + strcspn(key, "/"), "/id/", 4) ) {
+        return 2166136261u;
+    }
+    for (; key < p; key++) {
+        h ^= (unsigned char)*key;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Moves up to max entries from the queue to the end of a batch. Called with the worker lock held. */
+static int iotp_dispatch_take(IoTPDispatchWorker *worker, IoTPDispatchEntry **first, IoTPDispatchEntry **last, int max)
+{
+    int count = 0;
+
+    while ( worker->head && count < max ) {
+        IoTPDispatchEntry *entry = worker->head;
+        worker->head = entry->next;
+        entry->next = NULL;
+        if ( *last )
+            (*last)->next = entry;
+        else
+            *first = entry;
+        *last = entry;
+        worker->queued -= 1;
+        count += 1;
+    }
+    if ( worker->head == NULL )
+        worker->tail = NULL;
+    /* wake receiving thread waiting for space */
+    if ( count > 0 )
+        pthread_cond_signal(&worker->space);
+
+    return count;
+}
+
+/* Worker thread - processes queued messages, until stopped and the queue is empty */
+static void * iotp_dispatch_thread(void *arg)
+{
+    IoTPDispatchWorker *worker = (IoTPDispatchWorker *)arg;
+    IoTPDispatcher *dispatcher = worker->dispatcher;
+
+    for (;;) {
+        IoTPDispatchEntry *first = NULL;
+        IoTPDispatchEntry *last = NULL;
+        IoTPDispatchEntry *entry = NULL;
+        int count = 0;
+
+        pthread_mutex_lock(&worker->lock);
+        while ( worker->head == NULL && worker->stop == 0 )
+            pthread_cond_wait(&worker->cond, &worker->lock);
+        if ( worker->head == NULL ) {
+            pthread_mutex_unlock(&worker->lock);
+            break;
+        }
+        /* a batch is the queued entries, and entries that arrive within batchWait of the first entry */
+        for (;;) {
+            uint64_t deadline = 0;
+            struct timespec ts;
+
+            count += iotp_dispatch_take(worker, &first, &last, dispatcher->batchSize - count);
+            if ( count >= dispatcher->batchSize || dispatcher->batchWait == 0 || worker->stop )
+                break;
+            deadline = first->arrival + (uint64_t)dispatcher->batchWait;
+            if ( iotp_utils_timeMicros() >= deadline )
+                break;
+            iotp_utils_deadline(deadline, &ts);
+            if ( pthread_cond_timedwait(&worker->cond, &worker->lock, &ts) == ETIMEDOUT ) {
+                count += iotp_dispatch_take(worker, &first, &last, dispatcher->batchSize - count);
+                break;
+            }
+        }
+        pthread_mutex_unlock(&worker->lock);
+
+        (*dispatcher->handler)(dispatcher->context, first, count);
+
+        uint64_t now = iotp_utils_timeMicros();
+        __atomic_add_fetch(&worker->stats.processed, (uint64_t)count, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&worker->stats.batches, 1, __ATOMIC_RELAXED);
+        for (entry = first; entry; ) {
+            IoTPDispatchEntry *next = entry->next;
+            uint64_t latency = now - entry->arrival;
+            __atomic_add_fetch(&worker->stats.totalLatency, latency, __ATOMIC_RELAXED);
+            if ( latency > __atomic_load_n(&worker->stats.maxLatency, __ATOMIC_RELAXED) )
+                __atomic_store_n(&worker->stats.maxLatency, latency, __ATOMIC_RELAXED);
+            __atomic_sub_fetch(&worker->stats.depth, 1, __ATOMIC_RELAXED);
+            iotp_dispatch_freeEntry(entry);
+            entry = next;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Starts dispatch workers. Callbacks are invoked by the caller, if workers is 0.
+ * Queue of each worker is bounded to maxQueued messages, if maxQueued is not 0.
+ * Handler is invoked with batches of up to batchSize messages, if batchSize is greater than 1.
+ */
+IOTPRC iotp_dispatch_init(IoTPDispatcher *dispatcher, int workers, int maxQueued, IoTPInboundOverflow overflow, int batchSize, int batchWait, IoTPDispatchHandler handler, void *context)
+{
+    int i;
+
+    dispatcher->enabled = 0;
+    if ( workers <= 0 ) {
+        return IOTPRC_SUCCESS;
+    }
+
+    dispatcher->workers = (IoTPDispatchWorker *)calloc((size_t)workers, sizeof(IoTPDispatchWorker));
+    if ( dispatcher->workers == NULL ) {
+        return IOTPRC_NOMEM;
+    }
+    dispatcher->handler = handler;
+    dispatcher->context = context;
+    dispatcher->maxQueued = maxQueued > 0 ? maxQueued : 0;
+    dispatcher->overflow = overflow;
+    dispatcher->batchSize = batchSize > 1 ? batchSize : 1;
+    dispatcher->batchWait = batchSize > 1 && batchWait > 0 ? batchWait : 0;
+
+    for (i = 0; i < workers; i++) {
+        IoTPDispatchWorker *worker = &dispatcher->workers[i];
+        worker->dispatcher = dispatcher;
+        pthread_mutex_init(&worker->lock, NULL);
+        iotp_utils_initCond(&worker->cond);
+        iotp_utils_initCond(&worker->space);
+        if ( pthread_create(&worker->thread, NULL, iotp_dispatch_thread, worker) != 0 ) {
+            pthread_cond_destroy(&worker->space);
+            pthread_cond_destroy(&worker->cond);
+            pthread_mutex_destroy(&worker->lock);
+            /* stop workers already started */
+            iotp_dispatch_stop(dispatcher);
+            return IOTPRC_FAILURE;
+        }
+        dispatcher->count = i + 1;
+    }
+    dispatcher->enabled = 1;
+
+    return IOTPRC_SUCCESS;
+}
+
+/* Stops dispatch workers, after messages already queued are processed */
+void iotp_dispatch_stop(IoTPDispatcher *dispatcher)
+{
+    int i;
+
+    dispatcher->enabled = 0;
+    for (i = 0; i < dispatcher->count; i++) {
+        IoTPDispatchWorker *worker = &dispatcher->workers[i];
+        pthread_mutex_lock(&worker->lock);
+        worker->stop = 1;
+        pthread_cond_signal(&worker->cond);
+        pthread_cond_broadcast(&worker->space);
+        pthread_mutex_unlock(&worker->lock);
+    }
+    for (i = 0; i < dispatcher->count; i++) {
+        IoTPDispatchWorker *worker = &dispatcher->workers[i];
+        pthread_join(worker->thread, NULL);
+        pthread_cond_destroy(&worker->space);
+        pthread_cond_destroy(&worker->cond);
+        pthread_mutex_destroy(&worker->lock);
+    }
+    iotp_utils_freePtr((void *)dispatcher->workers);
+    dispatcher->workers = NULL;
+    dispatcher->count = 0;
+}
+
+/*
+ * Queues a copy of a received message for the worker of its device. If the queue is full and overflow
+ * policy is block, waits for space for up to IOTP_DISPATCH_BLOCK_WAIT microseconds, and returns
+ * IOTPRC_WOULDBLOCK if the queue is still full - the message is not queued.
+ */
+IOTPRC iotp_dispatch_enqueue(IoTPDispatcher *dispatcher, const char *topic, int topicLen, const void *payload, int payloadlen, int qos, int retained, MQTTProperties *properties)
+{
+    IoTPDispatchWorker *worker = NULL;
+    IoTPDispatchEntry *entry = NULL;
+    uint64_t depth = 0;
+    uint64_t now = iotp_utils_timeMicros();
+
+    if ( topicLen <= 0 )
+        topicLen = (int)strlen(topic);
+    if ( payloadlen < 0 )
+        payloadlen = 0;
+
+    worker = &dispatcher->workers[iotp_dispatch_hash(topic, topicLen) % (uint32_t)dispatcher->count];
+
+    /* wait for space, and return message to MQTT client before it is copied, if it can not be queued */
+    pthread_mutex_lock(&worker->lock);
+    if ( dispatcher->maxQueued > 0 && worker->queued >= dispatcher->maxQueued && worker->stop == 0 &&
+         dispatcher->overflow == IoTPInboundOverflow_block ) {
+        struct timespec ts;
+
+        __atomic_add_fetch(&dispatcher->blocked, 1, __ATOMIC_RELAXED);
+        if ( worker->deferredSince == 0 )
+            worker->deferredSince = now;
+        iotp_utils_deadline(now + IOTP_DISPATCH_BLOCK_WAIT, &ts);
+        while ( worker->queued >= dispatcher->maxQueued && worker->stop == 0 ) {
+            if ( pthread_cond_timedwait(&worker->space, &worker->lock, &ts) == ETIMEDOUT )
+                break;
+        }
+        if ( worker->queued >= dispatcher->maxQueued && worker->stop == 0 ) {
+            pthread_mutex_unlock(&worker->lock);
+            return IOTPRC_WOULDBLOCK;
+        }
+        now = iotp_utils_timeMicros();
+    }
+    pthread_mutex_unlock(&worker->lock);
+
+    /* entry, topic and payload are in one allocation */
+    entry = (IoTPDispatchEntry *)malloc(sizeof(IoTPDispatchEntry) + (size_t)topicLen + (size_t)payloadlen + 2);
+    if ( entry == NULL ) {
+        return IOTPRC_NOMEM;
+    }
+    entry->next = NULL;
+    entry->topic = (char *)(entry + 1);
+    memcpy(entry->topic, topic, (size_t)topicLen);
+    entry->topic[topicLen] = '\0';
+    entry->topicLen = topicLen;
+    entry->payload = entry->topic + topicLen + 1;
+    if ( payloadlen > 0 )
+        memcpy(entry->payload, payload, (size_t)payloadlen);
+    ((char *)entry->payload)[payloadlen] = '\0';
+    entry->payloadlen = payloadlen;
+    entry->qos = qos;
+    entry->retained = retained;
+    if ( properties && properties->count > 0 ) {
+        entry->properties = MQTTProperties_copy(properties);
+    } else {
+        MQTTProperties empty = MQTTProperties_initializer;
+        entry->properties = empty;
+    }
+    entry->arrival = now;
+
+    /* only the receiving thread of the client queues messages, so the queue is not filled meanwhile */
+    pthread_mutex_lock(&worker->lock);
+    if ( dispatcher->maxQueued > 0 && worker->queued >= dispatcher->maxQueued ) {
+        if ( dispatcher->overflow == IoTPInboundOverflow_dropNewest ) {
+            pthread_mutex_unlock(&worker->lock);
+            __atomic_add_fetch(&dispatcher->droppedNewest, 1, __ATOMIC_RELAXED);
+            iotp_dispatch_freeEntry(entry);
+            return IOTPRC_SUCCESS;
+        } else if ( dispatcher->overflow == IoTPInboundOverflow_dropOldest ) {
+            IoTPDispatchEntry *oldest = worker->head;
+            worker->head = oldest->next;
+            if ( worker->head == NULL )
+                worker->tail = NULL;
+            worker->queued -= 1;
+            __atomic_sub_fetch(&worker->stats.depth, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&dispatcher->droppedOldest, 1, __ATOMIC_RELAXED);
+            iotp_dispatch_freeEntry(oldest);
+        } else if ( worker->stop ) {
+            /* worker may have finished, message is discarded as client is destroyed */
+            pthread_mutex_unlock(&worker->lock);
+            iotp_dispatch_freeEntry(entry);
+            return IOTPRC_SUCCESS;
+        }
+    }
+    if ( worker->deferredSince != 0 ) {
+        __atomic_add_fetch(&dispatcher->blockedTime, now - worker->deferredSince, __ATOMIC_RELAXED);
+        worker->deferredSince = 0;
+    }
+    worker->queued += 1;
+    if ( worker->tail )
+        worker->tail->next = entry;
+    else
+        worker->head = entry;
+    worker->tail = entry;
+    depth = __atomic_add_fetch(&worker->stats.depth, 1, __ATOMIC_RELAXED);
+    if ( depth > worker->stats.maxDepth )
+        __atomic_store_n(&worker->stats.maxDepth, depth, __ATOMIC_RELAXED);
+    pthread_cond_signal(&worker->cond);
+    pthread_mutex_unlock(&worker->lock);
+
+    return IOTPRC_SUCCESS;
+}
+
+/* Returns statistics of dispatch workers */
+void iotp_dispatch_getStats(IoTPDispatcher *dispatcher, IoTPStats *stats)
+{
+    int i;
+
+    stats->inboundBlocked = __atomic_load_n(&dispatcher->blocked, __ATOMIC_RELAXED);
+    stats->inboundBlockedTime = __atomic_load_n(&dispatcher->blockedTime, __ATOMIC_RELAXED);
+    stats->inboundDroppedOldest = __atomic_load_n(&dispatcher->droppedOldest, __ATOMIC_RELAXED);
+    stats->inboundDroppedNewest = __atomic_load_n(&dispatcher->droppedNewest, __ATOMIC_RELAXED);
+    stats->dispatchWorkers = dispatcher->count;
+    for (i = 0; i < dispatcher->count && i < IOTP_MAX_DISPATCH_WORKERS; i++) {
+        IoTPWorkerStats *src = &dispatcher->workers[i].stats;
+        IoTPWorkerStats *dst = &stats->workers[i];
+        dst->processed = __atomic_load_n(&src->processed, __ATOMIC_RELAXED);
+        dst->batches = __atomic_load_n(&src->batches, __ATOMIC_RELAXED);
+        dst->depth = __atomic_load_n(&src->depth, __ATOMIC_RELAXED);
+        dst->maxDepth = __atomic_load_n(&src->maxDepth, __ATOMIC_RELAXED);
+        dst->totalLatency = __atomic_load_n(&src->totalLatency, __ATOMIC_RELAXED);
+        dst->maxLatency = __atomic_load_n(&src->maxLatency, __ATOMIC_RELAXED);
+    }
+}
@@ -99,20 +99,53 @@ IOTPRC IoTPGateway_setEventCallback(IoTPGateway *gateway, IoTPEventCallbackHandl
     return rc;
 }
 
+/* Sets connection state handler */
+IOTPRC IoTPGateway_setConnectionStateHandler(IoTPGateway *gateway, IoTPConnectionStateHandler cb, void *context)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    rc = iotp_client_setConnectionStateHandler((void *)gateway, cb, context);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to set connection state handler. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
+/* Returns client statistics */
+IOTPRC IoTPGateway_getStats(IoTPGateway *gateway, IoTPStats *stats)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    rc = iotp_client_getStats((void *)gateway, stats);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to get client statistics. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
 /* Sends an event */
 IOTPRC IoTPGateway_sendEvent(IoTPGateway *gateway, char *eventId, char *data, char *formatString, QoS qos, MQTTProperties *props)
+{
+    size_t datalen = data ? strlen(data) : 0;
+    return IoTPGateway_sendEventBuffer(gateway, eventId, data, datalen, formatString, qos, props, NULL, NULL);
+}
+
+/* Sends an event using payload buffer of specified length */
+IOTPRC IoTPGateway_sendEventBuffer(IoTPGateway *gateway, char *eventId, void *buffer, size_t bufferlen, char *formatString, QoS qos, MQTTProperties *props, IoTPBufferReleaseHandler releaseCB, void *context)
 {
     IOTPRC rc = IOTPRC_SUCCESS;
 
     /* Sanity check */
-    if ( !gateway || !eventId || *eventId == '\0' || !formatString || *formatString == '\0' ) {
+    if ( !gateway || !eventId || *eventId == '\0' || !formatString || *formatString == '\0' || (!buffer && bufferlen > 0) ) {
         rc = IOTPRC_ARGS_NULL_VALUE;
         LOG(WARN, "Received NULL argument. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
         return rc;
     }
     if ( qos != QoS0 && qos != QoS1 && qos != QoS2 ) {
         rc = IOTPRC_ARGS_INVALID_VALUE;
-        LOG(WARN, "Invalid QoS. qos: %d | rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        LOG(WARN, "Invalid QoS. qos: %d | rc: %d | reason: %s", qos, rc, IOTPRC_toString(rc));
         return rc;
     }
 
@@ -133,7 +166,7 @@ IOTPRC IoTPGateway_sendEvent(IoTPGateway *gateway, char *eventId, char *data, ch
 
     LOG(DEBUG,"Send event. Topic: %s", publishTopic);
 
-    rc = iotp_client_publish((void *)gateway, publishTopic, data, qos, props);
+    rc = iotp_client_publishBuffer((void *)gateway, publishTopic, buffer, bufferlen, qos, props, releaseCB, context);
 
     if ( rc != IOTPRC_SUCCESS ) {
         LOG(ERROR, "Failed to send. event: %s | rc: %d | reason: %s", eventId, rc, IOTPRC_toString(rc));
@@ -145,11 +178,49 @@ IOTPRC IoTPGateway_sendEvent(IoTPGateway *gateway, char *eventId, char *data, ch
 
 /* Sends event on behalf of a device */
 IOTPRC IoTPGateway_sendDeviceEvent(IoTPGateway *gateway, char *typeId, char *deviceId, char *eventId, char *data, char *formatString, QoS qos, MQTTProperties *props)
+{
+    size_t datalen = data ? strlen(data) : 0;
+    return IoTPGateway_sendDeviceEventBuffer(gateway, typeId, deviceId, eventId, data, datalen, formatString, qos, props, NULL, NULL);
+}
+
+/* Sends event on behalf of a device, using payload buffer of specified length */
+IOTPRC IoTPGateway_sendDeviceEventBuffer(IoTPGateway *gateway, char *typeId, char *deviceId, char *eventId, void *buffer, size_t bufferlen, char *formatString, QoS qos, MQTTProperties *props, IoTPBufferReleaseHandler releaseCB, void *context)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* Sanity check */
+    if ( !gateway || !typeId || *typeId == '\0'|| !deviceId || *deviceId == '\0' || !eventId || *eventId == '\0' || !formatString || *formatString == '\0' || (!buffer && bufferlen > 0) ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Received NULL argument. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+    if ( qos != QoS0 && qos != QoS1 && qos != QoS2 ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(WARN, "Invalid QoS. qos: %d | rc: %d | reason: %s", qos, rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    int tlen = strlen(typeId) + strlen(deviceId) + strlen(eventId) + strlen(formatString) + 26;
+    char publishTopic[tlen];
+    snprintf(publishTopic, tlen, "iot-2/type/%s/id/%s/evt/%s/fmt/%s", typeId, deviceId, eventId, formatString);
+
+    LOG(DEBUG,"Send device event. topic: %s", publishTopic);
+
+    rc = iotp_client_publishBuffer((void *)gateway, publishTopic, buffer, bufferlen, qos, props, releaseCB, context);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to send. event: %s | rc: %d | reason: %s", eventId, rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
+/* Sends event of the gateway or on behalf of a device, and returns delivery token of the publish request */
+IOTPRC IoTPGateway_sendDeviceEventAsync(IoTPGateway *gateway, char *typeId, char *deviceId, char *eventId, void *buffer, size_t bufferlen, char *formatString, QoS qos, MQTTProperties *props, IoTPDeliveryHandler deliveryCB, void *context, int *token)
 {
     IOTPRC rc = IOTPRC_SUCCESS;
 
     /* Sanity check */
-    if ( !gateway || !typeId || *typeId == '\0'|| !deviceId || *deviceId == '\0' || !eventId || *eventId == '\0' || !formatString || *formatString == '\0' ) {
+    if ( !gateway || !eventId || *eventId == '\0' || !formatString || *formatString == '\0' || (!buffer && bufferlen > 0) ) {
         rc = IOTPRC_ARGS_NULL_VALUE;
         LOG(WARN, "Received NULL argument. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
         return rc;
@@ -160,12 +231,25 @@ IOTPRC IoTPGateway_sendDeviceEvent(IoTPGateway *gateway, char *typeId, char *dev
         return rc;
     }
 
-    char publishTopic[strlen(typeId) + strlen(deviceId) + strlen(eventId) + strlen(formatString) + 26];
-    sprintf(publishTopic, "iot-2/type/%s/id/%s/evt/%s/fmt/%s", typeId, deviceId, eventId, formatString);
+    /* use device type and id of this gateway object, if not specified */
+    if ( typeId == NULL )
+        typeId = iotp_client_getDeviceType((void *)gateway);
+    if ( deviceId == NULL )
+        deviceId = iotp_client_getDeviceId((void *)gateway);
+
+    if ( typeId == NULL || *typeId == '\0' || deviceId == NULL || *deviceId == '\0' ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "NULL device type or id. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    int tlen = strlen(typeId) + strlen(deviceId) + strlen(eventId) + strlen(formatString) + 26;
+    char publishTopic[tlen];
+    snprintf(publishTopic, tlen, "iot-2/type/%s/id/%s/evt/%s/fmt/%s", typeId, deviceId, eventId, formatString);
 
     LOG(DEBUG,"Send device event. topic: %s", publishTopic);
 
-    rc = iotp_client_publish((void *)gateway, publishTopic, data, qos, props);
+    rc = iotp_client_publishAsync((void *)gateway, publishTopic, buffer, bufferlen, qos, props, deliveryCB, context, token);
     if ( rc != IOTPRC_SUCCESS ) {
         LOG(ERROR, "Failed to send. event: %s | rc: %d | reason: %s", eventId, rc, IOTPRC_toString(rc));
     }
@@ -173,6 +257,84 @@ IOTPRC IoTPGateway_sendDeviceEvent(IoTPGateway *gateway, char *typeId, char *dev
     return rc;
 }
 
+/* Sends response of a command to the Response Topic of the command of the gateway or an attached device */
+IOTPRC IoTPGateway_sendCommandResponse(IoTPGateway *gateway, const IoTPMessage *command, void *buffer, size_t bufferlen, QoS qos)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* Sanity check */
+    if ( !gateway || !command || (!buffer && bufferlen > 0) ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Received NULL argument. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+    if ( qos != QoS0 && qos != QoS1 && qos != QoS2 ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(WARN, "Invalid QoS. qos: %d | rc: %d | reason: %s", qos, rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    return iotp_client_sendCommandResponse((void *)gateway, command, buffer, bufferlen, qos);
+}
+
+
+/* Sends a batch of events on behalf of devices */
+IOTPRC IoTPGateway_sendDeviceEvents(IoTPGateway *gateway, IoTPEventBatch *batch)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* Sanity check */
+    if ( !gateway || !batch ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Received NULL argument. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    rc = iotp_client_publishEvents((void *)gateway, batch);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to send device event batch. count: %d | rc: %d | reason: %s", batch->count, rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
+/* Creates a topic handle for events of the gateway or of a device connected via the gateway */
+IOTPRC IoTPGateway_prepareDeviceEventTopic(IoTPGateway *gateway, char *typeId, char *deviceId, char *eventId, char *formatString, IoTPTopic **topic)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    /* Sanity check */
+    if ( !gateway || !eventId || *eventId == '\0' || !formatString || *formatString == '\0' || !topic ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Received NULL argument. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    /* use device type and id of this gateway object, if not specified */
+    if ( typeId == NULL )
+        typeId = iotp_client_getDeviceType((void *)gateway);
+    if ( deviceId == NULL )
+        deviceId = iotp_client_getDeviceId((void *)gateway);
+
+    if ( !iotp_topic_isValidLevel(typeId) || !iotp_topic_isValidLevel(deviceId) ||
+         !iotp_topic_isValidLevel(eventId) || !iotp_topic_isValidLevel(formatString) ) {
+        rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(WARN, "Invalid device type, device id, event id or format. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    int tlen = strlen(typeId) + strlen(deviceId) + strlen(eventId) + strlen(formatString) + 26;
+    char eventTopic[tlen];
+    snprintf(eventTopic, tlen, "iot-2/type/%s/id/%s/evt/%s/fmt/%s", typeId, deviceId, eventId, formatString);
+
+    rc = iotp_client_prepareTopic((void *)gateway, eventTopic, topic);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to prepare device event topic. event: %s | rc: %d | reason: %s", eventId, rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
 
 /* Sets a handler for all commands */
 IOTPRC IoTPGateway_setCommandHandler(IoTPGateway *gateway, IoTPCallbackHandler cb)
@@ -187,6 +349,19 @@ IOTPRC IoTPGateway_setCommandHandler(IoTPGateway *gateway, IoTPCallbackHandler c
     return rc;
 }
 
+/* Sets global command handler, invoked with message descriptor */
+IOTPRC IoTPGateway_setMessageHandler(IoTPGateway *gateway, IoTPMessageHandler cb, void *context)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    rc = iotp_client_setMessageHandler((void *)gateway, NULL, IoTP_Handler_Commands, cb, context);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to set global command handler. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
 
 /* Subscribes to command */
 IOTPRC IoTPGateway_subscribeToCommands(IoTPGateway *gateway, char *commandId, char *formatString)
@@ -114,6 +114,18 @@ DLLExport IOTPRC IoTPGateway_disconnect(IoTPGateway *gateway);
  */
 DLLExport IOTPRC IoTPGateway_setCommandHandler(IoTPGateway *gateway, IoTPCallbackHandler cb);
 
+/**
+ * The IoTPGateway_setMessageHandler() API sets the Command Callback function, that is invoked
+ * with a message descriptor and a user context. Topic and payload of the commands are
+ * not copied. It replaces the callback set by IoTPGateway_setCommandHandler().
+ *
+ * @param gateway        - A pointer to IoTP gateway handle.
+ * @param cb             - A Function pointer to the IoTPMessageHandler.
+ * @param context        - User context passed to the callback.
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPGateway_setMessageHandler(IoTPGateway *gateway, IoTPMessageHandler cb, void *context);
+
 /**
  * The IoTPGateway_subscribeToCommands() API subscribes to commands for the gateway.
  * To receive command specified by "commandId" paramete, a command callback handler
@@ -194,6 +206,26 @@ DLLExport IOTPRC IoTPGateway_unsubscribeFromDeviceCommands(IoTPGateway *gateway,
  */
 DLLExport IOTPRC IoTPGateway_sendEvent(IoTPGateway *gateway, char *eventId, char *data, char *formatString, QoS qos, MQTTProperties *props);
 
+/**
+ * The IoTPGateway_sendEventBuffer() API sends events from the gateway to the IBM Watson IoT Platform service,
+ * using a payload buffer of specified length. The buffer can contain binary data, and is handed to the
+ * MQTT client without being scanned or copied by the IoTP client. If releaseCB is specified, the buffer
+ * must not be modified or freed by the caller until releaseCB is invoked on completion of the publish
+ * request. If this API returns an error, releaseCB is not invoked.
+ *
+ * @param gateway        - A pointer to IoTP gateway handle.
+ * @param eventId        - Event id to be published e.g status, gps
+ * @param buffer         - Payload buffer of the event
+ * @param bufferlen      - Size of payload buffer
+ * @param formatString   - Format of the event e.g json, cbor, bin
+ * @param qos            - QoS for the publish event. Supported values : QoS0, QoS1, QoS2
+ * @param props          - MQTT V5 properties
+ * @param releaseCB      - Optional. A function pointer to the IoTPBufferReleaseHandler.
+ * @param context        - Optional. User context passed to the release callback.
+ * @return IOTPRC       - Returns IOTPRC_SUCCESS on success or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPGateway_sendEventBuffer(IoTPGateway *gateway, char *eventId, void *buffer, size_t bufferlen, char *formatString, QoS qos, MQTTProperties *props, IoTPBufferReleaseHandler releaseCB, void *context);
+
 /**
  * The IoTPGateway_sendDeviceEvent() API sends events on behalf of a deviec to the IBM Watson IoT Platform service.
  *
@@ -209,6 +241,97 @@ DLLExport IOTPRC IoTPGateway_sendEvent(IoTPGateway *gateway, char *eventId, char
  */
 DLLExport IOTPRC IoTPGateway_sendDeviceEvent(IoTPGateway *gateway, char *typeId, char *deviceId, char *eventId, char *data, char *formatString, QoS qos, MQTTProperties *props);
 
+/**
+ * The IoTPGateway_sendDeviceEventBuffer() API sends events on behalf of a device to the IBM Watson IoT Platform
+ * service, using a payload buffer of specified length. Buffer ownership rules are same as
+ * IoTPGateway_sendEventBuffer() API.
+ *
+ * @param gateway        - A pointer to IoTP gateway handle.
+ * @param typeId         - Device type ID
+ * @param deviceId       - Device ID
+ * @param eventId        - Event id to be published e.g status, gps
+ * @param buffer         - Payload buffer of the event
+ * @param bufferlen      - Size of payload buffer
+ * @param formatString   - Format of the event e.g json, cbor, bin
+ * @param qos            - QoS for the publish event. Supported values : QoS0, QoS1, QoS2
+ * @param props          - MQTT V5 properties
+ * @param releaseCB      - Optional. A function pointer to the IoTPBufferReleaseHandler.
+ * @param context        - Optional. User context passed to the release callback.
+ * @return IOTPRC       - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPGateway_sendDeviceEventBuffer(IoTPGateway *gateway, char *typeId, char *deviceId, char *eventId, void *buffer, size_t bufferlen, char *formatString, QoS qos, MQTTProperties *props, IoTPBufferReleaseHandler releaseCB, void *context);
+
+/**
+ * The IoTPGateway_sendDeviceEventAsync() API sends events of the gateway, or on behalf of a device, to the
+ * IBM Watson IoT Platform service, and returns the delivery token of the publish request. If typeId or
+ * deviceId is NULL, the gateway type ID or device ID is used. If deliveryCB is specified, it is invoked
+ * once the publish request completes, with the delivery token, status of the request, and the time the
+ * request was submitted and acknowledged. The payload buffer can be reused as soon as the API returns.
+ *
+ * @param gateway        - A pointer to IoTP gateway handle.
+ * @param typeId         - Device type ID
+ * @param deviceId       - Device ID
+ * @param eventId        - Event id to be published e.g status, gps
+ * @param buffer         - Payload buffer of the event
+ * @param bufferlen      - Size of payload buffer
+ * @param formatString   - Format of the event e.g json, cbor, bin
+ * @param qos            - QoS for the publish event. Supported values : QoS0, QoS1, QoS2
+ * @param props          - MQTT V5 properties
+ * @param deliveryCB     - Optional. A function pointer to the IoTPDeliveryHandler.
+ * @param context        - Optional. User context passed to the delivery callback.
+ * @param token          - Optional. Returned delivery token.
+ * @return IOTPRC       - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPGateway_sendDeviceEventAsync(IoTPGateway *gateway, char *typeId, char *deviceId, char *eventId, void *buffer, size_t bufferlen, char *formatString, QoS qos, MQTTProperties *props, IoTPDeliveryHandler deliveryCB, void *context, int *token);
+
+/**
+ * The IoTPGateway_sendCommandResponse() API sends response of a command of the gateway or an attached device,
+ * that is received with a message handler (e.g. IoTPGateway_setMessageHandler()). The response is published
+ * to the MQTT V5 Response Topic of the command, as an event of the device the command is sent to, with
+ * Correlation Data of the command.
+ *
+ * @param gateway        - A pointer to IoTP gateway handle.
+ * @param command        - Descriptor of the command, passed to the message handler.
+ * @param buffer         - Payload buffer of the response
+ * @param bufferlen      - Size of payload buffer
+ * @param qos            - QoS for the publish response. Supported values : QoS0, QoS1, QoS2
+ * @return IOTPRC       - Returns IOTPRC_SUCCESS onsuccess, IOTPRC_NOT_FOUND if the command has no
+ *                         Response Topic, or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPGateway_sendCommandResponse(IoTPGateway *gateway, const IoTPMessage *command, void *buffer, size_t bufferlen, QoS qos);
+
+/**
+ * The IoTPGateway_sendDeviceEvents() API sends a batch of events on behalf of devices to the IBM Watson IoT
+ * Platform service. All events in the batch are validated before any event is sent, and are then pipelined
+ * to the MQTT client. If typeId or deviceId of an event record is NULL, the gateway type ID or device ID is
+ * used. The batch callback, if set, is invoked once all events accepted for delivery complete. The status of
+ * each event submission is returned in the rc field of the event record. If the batch is not sent, the rc
+ * field of valid events is set to IOTPRC_FAILURE, or to the error of the batch. Events of a batch are not
+ * coalesced, are not queued in the submission queue, and are sent in full if options.mqtt.deltaHeartbeat is set.
+ *
+ * @param gateway        - A pointer to IoTP gateway handle.
+ * @param batch          - A pointer to the IoTPEventBatch.
+ * @return IOTPRC       - Returns IOTPRC_SUCCESS if all events are accepted for delivery, IOTPRC_PARTIAL_FAILURE
+ *                         if some events are accepted, or IOTPRC_* on error if no event is sent
+ */
+DLLExport IOTPRC IoTPGateway_sendDeviceEvents(IoTPGateway *gateway, IoTPEventBatch *batch);
+
+/**
+ * The IoTPGateway_prepareDeviceEventTopic() API creates a topic handle for events of the gateway, or of a
+ * device connected via the gateway. The event topic is built and validated once, and can be reused to publish
+ * events using IoTPTopic_publish() API. If typeId or deviceId is NULL, the gateway type ID or device ID is used.
+ * The topic handle must be destroyed using IoTPTopic_destroy() API, before the gateway handle is destroyed.
+ *
+ * @param gateway        - A pointer to IoTP gateway handle.
+ * @param typeId         - Device type ID
+ * @param deviceId       - Device ID
+ * @param eventId        - Event id e.g status, gps
+ * @param formatString   - Format of the event e.g json, cbor, bin
+ * @param topic          - Returned topic handle
+ * @return IOTPRC       - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPGateway_prepareDeviceEventTopic(IoTPGateway *gateway, char *typeId, char *deviceId, char *eventId, char *formatString, IoTPTopic **topic);
+
 /**
  * The IoTPGateway_setNotificationHandler() API sets a notification callback function, 
  * to receive the notifications from IBM Watson IoT Platform service.
@@ -285,6 +408,28 @@ DLLExport IOTPRC IoTPGateway_unsubscribeFromMonitoringMessages(IoTPGateway *gate
  */
 DLLExport IOTPRC IoTPGateway_setEventCallback(IoTPGateway *gateway, IoTPEventCallbackHandler cb);
 
+/**
+ * The IoTPGateway_setConnectionStateHandler() API sets handler to get notifications on connection
+ * state changes. If connection is lost and automatic reconnect is enabled, client reconnects in
+ * background, and events sent while reconnecting are buffered by MQTT client.
+ *
+ * @param gateway        - A pointer to IoTP gateway handle.
+ * @param cb             - A Function pointer to the IoTPConnectionStateHandler. Set to NULL to clear handler.
+ * @param context        - User context passed to the handler
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPGateway_setConnectionStateHandler(IoTPGateway *gateway, IoTPConnectionStateHandler cb, void *context);
+
+/**
+ * The IoTPGateway_getStats() API returns client statistics, e.g. number of events merged
+ * by event coalescer (options.mqtt.coalesceWindow) and number of batches published.
+ *
+ * @param gateway        - A pointer to IoTP gateway handle.
+ * @param stats          - A pointer to IoTPStats, filled in by the API.
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPGateway_getStats(IoTPGateway *gateway, IoTPStats *stats);
+
 
 #if defined(__cplusplus)
  }
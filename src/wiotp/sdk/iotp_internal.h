@@ -51,8 +51,10 @@
 #include <fcntl.h>
 #include <signal.h>
 #include <ctype.h>
+#include <pthread.h>
 
 #include <MQTTProperties.h>
+#include <MQTTClientPersistence.h>
 
 #include "iotp_rc.h"
 #include "iotp_config.h"
@@ -100,6 +102,31 @@ typedef struct mqttopts_t {
     int    keepalive;
     int    sessionExpiry;
     int    sharedSubscription;
+    int    maxInflight;
+    int    maxBufferedBytes;
+    int    publishTimeout;
+    char * persistencePath;
+    int    persistenceMaxBytes;
+    int    persistenceSync;
+    int    compression;
+    int    compressionMinSize;
+    int    coalesceWindow;
+    int    coalesceMaxBytes;
+    int    rateLimit;
+    int    rateBurst;
+    int    deviceRateLimit;
+    int    rateLimitTimeout;
+    int    controlMaxInflight;
+    int    submitQueueSize;
+    int    topicAliasMaximum;
+    int    deltaHeartbeat;
+    double deltaDeadband;
+    int    cborTranscode;
+    int    dispatchWorkers;
+    int    inboundQueueSize;
+    int    inboundOverflow;
+    int    batchSize;
+    int    batchWait;
 } mqttopts_t;
 
 #ifdef HTTP_IMPLEMENTED
@@ -112,6 +139,20 @@ typedef struct httpopts_t {
 
 #endif
 
+/* Payload compression codecs */
+typedef enum IoTPCompression {
+    IoTPCompression_none     = 0,
+    IoTPCompression_deflate  = 1,
+    IoTPCompression_lz4      = 2
+} IoTPCompression;
+
+/* Policy of a full inbound queue */
+typedef enum IoTPInboundOverflow {
+    IoTPInboundOverflow_block       = 0,    /* receiving thread waits for space */
+    IoTPInboundOverflow_dropOldest  = 1,    /* oldest queued message is discarded */
+    IoTPInboundOverflow_dropNewest  = 2     /* received message is discarded */
+} IoTPInboundOverflow;
+
 /* IoTP client config object - includes optional items */
 typedef struct IoTPConfig {
     char           * domain;
@@ -170,8 +211,30 @@ typedef struct {
     int             type;            /* IoTP_Handler_type_t                  */
     char *          topic;           /* Subscription topic                   */
     void *          cbFunc;          /* Callback function pointer            */
+    int             descriptor;      /* cbFunc is IoTPMessageHandler         */
+    int             batch;           /* cbFunc is IoTPBatchHandler           */
+    void *          context;         /* User context of IoTPMessageHandler   */
 } IoTPHandler;
 
+/* Node of topic trie - a topic level of handler topic filters */
+typedef struct IoTPTopicNode {
+    struct IoTPTopicNode * parent;
+    struct IoTPTopicNode * next;     /* Next node in hash chain              */
+    struct IoTPTopicNode * plus;     /* Child for + wild card                */
+    struct IoTPTopicNode * hash;     /* Child for # wild card                */
+    char                 * level;    /* Topic level                          */
+    uint32_t               key;      /* Hash of parent and level             */
+    int                    value;    /* Handler entry number + 1, or 0       */
+} IoTPTopicNode;
+
+/* Topic trie of handler topic filters. Children are found in a hash table of (parent, level) */
+typedef struct {
+    IoTPTopicNode          root;
+    IoTPTopicNode       ** buckets;
+    int                    nbuckets;
+    int                    count;
+} IoTPTopicTrie;
+
 /* Callback Handlers */
 typedef struct {
     IoTPHandler ** entries;          /* Array of callback handlers           */
@@ -182,6 +245,9 @@ typedef struct {
     int            allCommandsId;    /* A callback for all commands is set   */
     int            allDMActionsId;   /* A callback for all DM acrions is set */
     int            eventCallback;    /* A callback to get event responses    */
+    int            batchHandlers;    /* Number of batch handlers             */
+    IoTPTopicTrie  trie;             /* Topic filters of handlers            */
+    pthread_rwlock_t lock;           /* Protects entries, trie and handlers  */
 } IoTPHandlers;
 
 /* Managed Client information */
@@ -239,8 +305,298 @@ typedef struct IoTPManagedClient {
     IoTPClientAction   deviceAction;
     char *             reqID;
     int                rc;
+    char *             dmTopics[IoTP_DMActions + 1];  /* Topics of DM actions, by IoTP_DMAction_type_t */
+    char *             dmPrefix;        /* Prefix of DM topics published by the client */
+    pthread_mutex_t    lock;            /* Protects request ID, firmware state and observe flag */
 } IoTPManagedClient;
 
+/* Outbound in-flight window - bounds publish requests not yet completed by MQTT client */
+typedef struct IoTPWindow {
+    int                 enabled;
+    int                 maxInflight;
+    size_t              maxBytes;
+    int                 timeout;
+    int                 inflight;
+    size_t              bytes;
+    pthread_mutex_t     lock;
+    pthread_cond_t      cond;
+} IoTPWindow;
+
+/* Bulk lane window of managed clients, if options.mqtt.maxInflight is not set */
+#define IOTP_MANAGED_MAX_INFLIGHT   100
+
+/* Outbound priority lanes */
+typedef enum {
+    IoTPLane_control = 0,
+    IoTPLane_bulk = 1
+} IoTPLane;
+
+/* Token bucket of rate limiter */
+typedef struct IoTPTokenBucket {
+    double              tokens;
+    uint64_t            last;       /* time of last refill, in microseconds */
+    char              * key;        /* <typeId>/id/<deviceId> of device bucket */
+    size_t              keylen;
+    uint32_t            hash;
+    struct IoTPTokenBucket * next;
+} IoTPTokenBucket;
+
+#define IOTP_RATELIMIT_BUCKETS  64
+
+/* Rate limiter of outbound publish requests, per client and per device */
+typedef struct IoTPRateLimiter {
+    int                 enabled;
+    double              rate;       /* publish requests per second, 0 - no client limit */
+    double              burst;
+    double              deviceRate; /* publish requests per second per device, 0 - no device limit */
+    double              deviceBurst;
+    int                 timeout;    /* time to wait for tokens, in milliseconds */
+    IoTPTokenBucket     client;
+    IoTPTokenBucket   * devices[IOTP_RATELIMIT_BUCKETS];
+    int                 deviceCount;
+    pthread_mutex_t     lock;
+} IoTPRateLimiter;
+
+/* Events of a topic buffered by the coalescer */
+typedef struct IoTPCoalesceEntry {
+    char              * topic;      /* topic of the batch */
+    int                 qos;
+    int                 json;       /* 1 - JSON array, 0 - length prefixed frames */
+    char              * buf;
+    size_t              len;
+    size_t              size;
+    int                 count;
+    uint64_t            deadline;   /* time to publish the batch, in microseconds */
+    struct IoTPCoalesceEntry * next;
+} IoTPCoalesceEntry;
+
+/* Event coalescer - merges events of a topic published within a time window */
+typedef struct IoTPCoalescer {
+    int                 enabled;
+    int                 window;     /* in milliseconds */
+    size_t              maxBytes;
+    int                 stop;
+    IoTPCoalesceEntry * entries;
+    pthread_t           thread;
+    pthread_mutex_t     lock;
+    pthread_cond_t      cond;
+} IoTPCoalescer;
+
+/* Size of buffer of a submission queue slot, that holds copy of topic and payload of a publish request */
+#define IOTP_SUBMIT_SLOT_DATA   256
+
+/* Time (in milliseconds) disconnect waits for sender thread to submit enqueued publish requests */
+#define IOTP_SUBMIT_DRAIN_TIMEOUT   10000
+
+/*
+ * Publish request enqueued in submission queue. Topic and payload are copied to the buffer of
+ * the slot if they fit, otherwise to an allocated buffer.
+ */
+typedef struct IoTPSubmitEntry {
+    char                     * topic;
+    void                     * payload;
+    size_t                     payloadlen;
+    int                        qos;
+    IoTPBufferReleaseHandler   releaseCB;
+    void                     * releaseContext;
+    char                     * data;    /* allocated copy of topic and payload, or NULL */
+} IoTPSubmitEntry;
+
+/*
+ * Slot of submission queue. Sequence number tells if the slot is free or filled for a position.
+ * The entry is stored in the slot, so enqueue does not allocate memory for small requests.
+ */
+typedef struct IoTPSubmitSlot {
+    uint64_t                   seq;
+    IoTPSubmitEntry            entry;
+    char                       buf[IOTP_SUBMIT_SLOT_DATA];
+} IoTPSubmitSlot;
+
+/*
+ * Lock-free bounded multi-producer single-consumer submission queue. Publishing threads enqueue
+ * requests, and the sender thread submits them to MQTT client. The sender thread sleeps only if
+ * the queue is empty, and producers wake it only if it sleeps.
+ */
+typedef struct IoTPSubmitQueue {
+    int                 enabled;
+    int                 stop;
+    uint64_t            size;       /* power of 2 */
+    IoTPSubmitSlot    * slots;
+    uint64_t            tail __attribute__((aligned(64)));  /* next position to enqueue - producers */
+    uint64_t            head __attribute__((aligned(64)));  /* next position to dequeue - sender thread */
+    uint64_t            pending;    /* requests enqueued, and not yet submitted */
+    int                 sleeping;   /* sender thread waits for requests */
+    pthread_t           thread;
+    pthread_mutex_t     lock;
+    pthread_cond_t      cond;
+} IoTPSubmitQueue;
+
+/* Topic alias of an outbound topic. Alias N is slot N-1 of the alias table. */
+typedef struct IoTPTopicAlias {
+    char              * topic;      /* NULL if alias is not assigned */
+    uint32_t            hash;
+    int                 established; /* topic is sent with the alias on current connection */
+    int                 users;      /* publish requests using the alias, not yet submitted */
+    int                 referenced; /* used since last sweep of clock hand */
+    struct IoTPTopicAlias * next;   /* hash chain */
+} IoTPTopicAlias;
+
+/* Size of filter of recently published topics, used to find repeated topics */
+#define IOTP_ALIAS_SEEN_SIZE    1024
+
+/* Outbound topic aliases (MQTT v5) of a connection */
+typedef struct IoTPTopicAliases {
+    int                 enabled;
+    int                 maxAliases; /* configured maximum */
+    int                 count;      /* negotiated - lower of configured and server maximum */
+    int                 topicRequired; /* QoS1/QoS2 requests may be resent on another connection */
+    uint32_t            generation; /* incremented when connection is reset */
+    IoTPTopicAlias    * slots;
+    IoTPTopicAlias   ** buckets;
+    int                 nbuckets;   /* power of 2 */
+    int                 hand;       /* clock hand to evict aliases */
+    int                 used;       /* assigned aliases */
+    uint32_t            seen[IOTP_ALIAS_SEEN_SIZE];
+    pthread_mutex_t     lock;
+} IoTPTopicAliases;
+
+/* Last published state of an event stream (event topic in JSON format) */
+typedef struct IoTPDeltaEntry {
+    char              * topic;
+    uint32_t            hash;
+    char              * state;      /* JSON object with last published value of each field */
+    size_t              stateLen;
+    uint64_t            lastFull;   /* time of last full state publish, in microseconds */
+    struct IoTPDeltaEntry * next;
+} IoTPDeltaEntry;
+
+#define IOTP_DELTA_BUCKETS      256
+
+/* Result of comparing an event with last published state of its stream */
+typedef enum {
+    IoTPDelta_full      = 0,    /* publish event as is */
+    IoTPDelta_changed   = 1,    /* publish changed fields */
+    IoTPDelta_unchanged = 2     /* do not publish */
+} IoTPDeltaResult;
+
+/* Report-by-exception cache of event streams */
+typedef struct IoTPDeltaCache {
+    int                 enabled;
+    uint64_t            heartbeat;  /* interval of full state publish, in microseconds */
+    double              deadband;   /* change of a numeric field that is not reported */
+    int                 count;
+    IoTPDeltaEntry    * buckets[IOTP_DELTA_BUCKETS];
+    pthread_mutex_t     lock;
+} IoTPDeltaCache;
+
+/* Received message queued for a dispatch worker - topic and payload are copied with the entry */
+typedef struct IoTPDispatchEntry {
+    struct IoTPDispatchEntry * next;
+    char              * topic;      /* NUL terminated */
+    int                 topicLen;
+    void              * payload;    /* NUL terminated, not included in payloadlen */
+    int                 payloadlen;
+    int                 qos;
+    int                 retained;
+    MQTTProperties      properties;
+    uint64_t            arrival;    /* time of arrival, in microseconds */
+} IoTPDispatchEntry;
+
+/* Processes a batch of received messages on a dispatch worker thread - entries are linked by next */
+typedef void (*IoTPDispatchHandler)(void *context, IoTPDispatchEntry *entries, int count);
+
+/* Dispatch worker - processes received messages of its devices in the order received */
+typedef struct IoTPDispatchWorker {
+    struct IoTPDispatcher * dispatcher;
+    IoTPDispatchEntry * head;
+    IoTPDispatchEntry * tail;
+    int                 queued;     /* entries in queue, not including the entry in process */
+    uint64_t            deferredSince; /* time the receiving thread first waits as the queue is full, or 0 */
+    int                 stop;
+    IoTPWorkerStats     stats;
+    pthread_t           thread;
+    pthread_mutex_t     lock;
+    pthread_cond_t      cond;
+    pthread_cond_t      space;      /* signalled when entries are taken from the queue */
+} IoTPDispatchWorker;
+
+/* Pool of dispatch workers. Messages are assigned to a worker by hash of device type and ID. */
+typedef struct IoTPDispatcher {
+    int                 enabled;
+    int                 count;
+    int                 maxQueued;  /* bound of queue of a worker, 0 - not bounded */
+    int                 overflow;   /* IoTPInboundOverflow */
+    int                 batchSize;  /* maximum entries passed to handler, 1 - batches are not enabled */
+    int                 batchWait;  /* time to wait for a batch to fill, from arrival of first entry, in microseconds */
+    IoTPDispatchWorker * workers;
+    IoTPDispatchHandler handler;
+    void              * context;
+    uint64_t            blocked;    /* messages the receiving thread waited to queue */
+    uint64_t            blockedTime; /* in microseconds */
+    uint64_t            droppedOldest;
+    uint64_t            droppedNewest;
+} IoTPDispatcher;
+
+/* Timer wheel of command requests - 4 levels of 64 slots, with a tick of 10 milliseconds */
+#define IOTP_WHEEL_LEVELS       4
+#define IOTP_WHEEL_SLOTS        64
+#define IOTP_WHEEL_BITS         6
+#define IOTP_WHEEL_TICK         10000   /* in microseconds */
+
+/* Subscription to command responses of a connection */
+#define IOTP_RPC_UNSUBSCRIBED   0
+#define IOTP_RPC_SUBSCRIBING    1
+#define IOTP_RPC_SUBSCRIBED     2
+#define IOTP_RPC_SUBSCRIBE_TIMEOUT  10000   /* in milliseconds */
+
+/* Command request waiting for a response - a slot of request table, and an entry of a timer wheel list */
+typedef struct IoTPRequestSlot {
+    uint32_t            generation; /* high 32 bits of request handle, changed when slot is freed */
+    uint32_t            next;       /* index of next slot in wheel list or free list, 0 - none */
+    uint32_t            prev;       /* index of previous slot in wheel list, 0 - head of list */
+    uint8_t             pending;
+    uint8_t             level;      /* wheel list of the slot */
+    uint8_t             wheelSlot;
+    uint32_t            device;     /* hash of device type and ID, the response is expected from */
+    uint64_t            expiry;     /* in ticks */
+    IoTPCommandResponseHandler cb;
+    void              * context;
+} IoTPRequestSlot;
+
+/* Expired command request, its handler is invoked after the table is unlocked */
+typedef struct IoTPRequestExpired {
+    uint64_t            request;
+    IoTPCommandResponseHandler cb;
+    void              * context;
+} IoTPRequestExpired;
+
+/* Table of command requests. A request handle is generation and index of its slot. */
+typedef struct IoTPRequests {
+    int                 inited;
+    int                 started;    /* timer thread is started */
+    int                 stop;
+    int                 subscribed; /* IOTP_RPC_UNSUBSCRIBED, IOTP_RPC_SUBSCRIBING or IOTP_RPC_SUBSCRIBED */
+    char                event[32];  /* response event of the connection - IOTP_COMMAND_RESPONSE_EVENT-<token> */
+    int                 eventLen;
+    IoTPRequestSlot   * slots;      /* slot 0 is not used */
+    uint32_t            size;
+    uint32_t            freeList;
+    uint32_t            pending;
+    uint32_t            wheel[IOTP_WHEEL_LEVELS][IOTP_WHEEL_SLOTS];
+    uint64_t            now;        /* next tick to process */
+    uint64_t            start;      /* time of tick 0, in microseconds */
+    IoTPRequestExpired * expired;
+    uint32_t            expiredSize;
+    uint64_t            requests;
+    uint64_t            responses;
+    uint64_t            timeouts;
+    uint64_t            unmatched;
+    pthread_t           thread;
+    pthread_mutex_t     lock;
+    pthread_cond_t      cond;
+    pthread_cond_t      subscribeCond;  /* signalled when subscription to responses completes */
+} IoTPRequests;
+
 /* Strcture for IoTP client object */
 typedef struct IoTPClient {
     int                 inited;
@@ -250,11 +606,71 @@ typedef struct IoTPClient {
     char              * connectionURI;
     void              * mqttClient;
     IoTPHandlers      * handlers;
+    int                 sharedHandlers; /* handlers are owned by another client of a group */
     int                 connected;
     int                 managed;
     IoTPManagedClient * managedClient;
+    IoTPWindow          window;         /* in-flight window of bulk lane */
+    IoTPWindow          controlWindow;  /* in-flight window of control lane */
+    IoTPConnectionState state;
+    IoTPConnectionStateHandler stateCB;
+    void              * stateContext;
+    MQTTClient_persistence persistence;
+    IoTPCoalescer       coalescer;
+    IoTPSubmitQueue     submitQueue;
+    IoTPRateLimiter     limiter;
+    IoTPTopicAliases    aliases;
+    IoTPDeltaCache      delta;
+    int                 cborTranscode;  /* convert JSON payload of fmt/cbor messages */
+    IoTPDispatcher      dispatcher;
+    IoTPRequests        requests;
+    IoTPStats           stats;
 } IoTPClient;
 
+/* Group of application clients with the same appId, that share subscriptions and handlers */
+typedef struct IoTPClientGroup {
+    int                 count;
+    void             ** members;    /* first member owns handlers */
+} IoTPClientGroup;
+
+/* Publish request context - tracked until the MQTT client completes the request */
+typedef struct IoTPPublishContext {
+    IoTPClient               * client;
+    void                     * payload;
+    size_t                     payloadlen;
+    IoTPBufferReleaseHandler   releaseCB;
+    void                     * releaseContext;
+    IoTPDeliveryHandler        deliveryCB;
+    void                     * deliveryContext;
+    uint64_t                   submitTime;
+    IoTPLane                   lane;
+    char                     * deltaTopic; /* event stream, that is reset if the request fails - delta encoding */
+} IoTPPublishContext;
+
+/* Batch publish request context - tracked until all accepted events of the batch complete */
+typedef struct IoTPBatchContext {
+    IoTPClient                    * client;
+    int                             count;
+    int                             windowCount;
+    size_t                          windowBytes;
+    int                             pending;
+    int                             succeeded;
+    int                             failed;
+    IoTPEventBatchCallbackHandler   callback;
+    void                          * context;
+    uint64_t                        submitTime;
+} IoTPBatchContext;
+
+/* Pre-built publish topic */
+struct IoTPTopic {
+    IoTPClient   * client;
+    int            topicLen;
+    char         * topic;
+};
+
+/* Maximum size of MQTT message payload */
+#define IOTP_MAX_PAYLOAD_LEN        268435455
+
 /* Device/gateway command topics */
 #define COMMAND_ROOTTOPIC       "iot-2/"
 #define COMMAND_ROOTTOPIC_LEN   6
@@ -299,16 +715,86 @@ DLLExport IOTPRC iotp_client_connect(void *client);
 DLLExport IOTPRC iotp_client_disconnect(void *client);
 DLLExport IOTPRC iotp_client_setEventCallbackHandler(void *client, int type, IoTPEventCallbackHandler cbFunc);
 DLLExport IOTPRC iotp_client_setHandler(void *client, char * topic, int type, IoTPCallbackHandler handler);
+DLLExport IOTPRC iotp_client_setMessageHandler(void *client, char * topic, int type, IoTPMessageHandler handler, void *context);
+DLLExport IOTPRC iotp_client_setBatchHandler(void *client, char * topic, int type, IoTPBatchHandler handler, void *context);
+DLLExport IOTPRC iotp_client_shareHandlers(void *client, void *owner);
 DLLExport IOTPRC iotp_client_subscribe(void *client, char *topic, int qos);
 DLLExport IOTPRC iotp_client_unsubscribe(void *client, char *topic);
 DLLExport IOTPRC iotp_client_publish(void *client, char *topic, char *payload, int qos, MQTTProperties *props);
+DLLExport IOTPRC iotp_client_publishBuffer(void *client, char *topic, void *payload, size_t payloadlen, int qos, MQTTProperties *props, IoTPBufferReleaseHandler releaseCB, void *releaseContext);
+DLLExport IOTPRC iotp_client_publishAsync(void *client, char *topic, void *payload, size_t payloadlen, int qos, MQTTProperties *props, IoTPDeliveryHandler deliveryCB, void *deliveryContext, int *token);
+DLLExport IOTPRC iotp_client_publishEvents(void *client, IoTPEventBatch *batch);
+DLLExport IOTPRC iotp_client_prepareTopic(void *client, const char *topic, IoTPTopic **topicHandle);
 DLLExport IOTPRC iotp_client_retry_connection(void *client);
+DLLExport IOTPRC iotp_client_setConnectionStateHandler(void *client, IoTPConnectionStateHandler cb, void *context);
+DLLExport IOTPRC iotp_client_getStats(void *client, IoTPStats *stats);
+DLLExport IOTPRC iotp_client_sendCommandRequest(void *client, char *topic, char *typeId, char *deviceId, void *payload, size_t payloadlen, int qos, MQTTProperties *props, int timeout, IoTPCommandResponseHandler cb, void *context, uint64_t *request);
+DLLExport IOTPRC iotp_client_cancelCommandRequest(void *client, uint64_t request);
+DLLExport IOTPRC iotp_client_sendCommandResponse(void *client, const IoTPMessage *command, void *payload, size_t payloadlen, int qos);
+
+/* Monotonic clock */
+DLLExport void iotp_utils_initCond(pthread_cond_t *cond);
+DLLExport void iotp_utils_deadline(uint64_t micros, struct timespec *ts);
+
+/* Persistent outbound store */
+DLLExport IOTPRC iotp_persist_init(MQTTClient_persistence *persistence, const char *path, size_t maxBytes, int sync);
+DLLExport void iotp_persist_free(MQTTClient_persistence *persistence);
+
+/* Rate limiter */
+DLLExport void iotp_ratelimit_init(IoTPRateLimiter *limiter, int rate, int burst, int deviceRate, int timeout);
+DLLExport void iotp_ratelimit_free(IoTPRateLimiter *limiter);
+DLLExport IOTPRC iotp_ratelimit_acquire(IoTPRateLimiter *limiter, const char *topic, int count, int *delayed);
+DLLExport IOTPRC iotp_ratelimit_acquireTopics(IoTPRateLimiter *limiter, char **topics, int count, int *delayed);
+
+/* Topic aliases */
+DLLExport void iotp_alias_init(IoTPTopicAliases *aliases, int maxAliases, int topicRequired);
+DLLExport void iotp_alias_free(IoTPTopicAliases *aliases);
+DLLExport void iotp_alias_reset(IoTPTopicAliases *aliases, int serverMax);
+DLLExport int iotp_alias_acquire(IoTPTopicAliases *aliases, const char *topic, int qos, int *omitTopic, uint32_t *generation);
+DLLExport void iotp_alias_release(IoTPTopicAliases *aliases, int alias, uint32_t generation, int sent);
+
+/* Report-by-exception */
+DLLExport void iotp_delta_init(IoTPDeltaCache *cache, int heartbeat, double deadband);
+DLLExport void iotp_delta_free(IoTPDeltaCache *cache);
+DLLExport IoTPDeltaResult iotp_delta_filter(IoTPDeltaCache *cache, const char *topic, const void *payload, size_t payloadlen, void **delta, size_t *deltalen);
+DLLExport void iotp_delta_invalidate(IoTPDeltaCache *cache, const char *topic);
+
+/* Dispatch workers */
+DLLExport int iotp_dispatch_overflowFromName(const char *name);
+DLLExport const char * iotp_dispatch_overflowName(IoTPInboundOverflow overflow);
+DLLExport IOTPRC iotp_dispatch_init(IoTPDispatcher *dispatcher, int workers, int maxQueued, IoTPInboundOverflow overflow, int batchSize, int batchWait, IoTPDispatchHandler handler, void *context);
+DLLExport void iotp_dispatch_stop(IoTPDispatcher *dispatcher);
+DLLExport IOTPRC iotp_dispatch_enqueue(IoTPDispatcher *dispatcher, const char *topic, int topicLen, const void *payload, int payloadlen, int qos, int retained, MQTTProperties *properties);
+DLLExport void iotp_dispatch_getStats(IoTPDispatcher *dispatcher, IoTPStats *stats);
+
+/* Command requests */
+DLLExport void iotp_rpc_init(IoTPRequests *requests);
+DLLExport void iotp_rpc_stop(IoTPRequests *requests);
+DLLExport uint32_t iotp_rpc_deviceHash(const char *typeId, size_t typeLen, const char *deviceId, size_t deviceLen);
+DLLExport IOTPRC iotp_rpc_add(IoTPRequests *requests, uint32_t device, int timeout, IoTPCommandResponseHandler cb, void *context, uint64_t *request);
+DLLExport IOTPRC iotp_rpc_cancel(IoTPRequests *requests, uint64_t request);
+DLLExport IOTPRC iotp_rpc_complete(IoTPRequests *requests, uint64_t request, uint32_t device, const IoTPMessage *response);
+DLLExport void iotp_rpc_getStats(IoTPRequests *requests, IoTPStats *stats);
+
+/* Topic trie */
+DLLExport void iotp_trie_free(IoTPTopicTrie *trie);
+DLLExport IOTPRC iotp_trie_insert(IoTPTopicTrie *trie, const char *filter, int value);
+DLLExport int iotp_trie_match(IoTPTopicTrie *trie, const char *topic, size_t topicLen);
+
+/* Payload compression */
+DLLExport int iotp_compress_fromName(const char *name);
+DLLExport const char * iotp_compress_name(IoTPCompression codec);
+DLLExport const char * iotp_compress_suffix(IoTPCompression codec);
+DLLExport IoTPCompression iotp_compress_fromFormat(const char *format, size_t formatLen, size_t *baseLen);
+DLLExport IOTPRC iotp_compress_encode(IoTPCompression codec, const void *in, size_t inlen, void **out, size_t *outlen);
+DLLExport IOTPRC iotp_compress_decode(IoTPCompression codec, const void *in, size_t inlen, void **out, size_t *outlen);
 DLLExport IOTPRC iotp_client_isConnected(void *client);
 DLLExport IOTPRC iotp_client_setMQTTLogHandler(void *client, IoTPLogHandler *cb);
 DLLExport IOTPRC iotp_client_manage(void * client);
 DLLExport IOTPRC iotp_client_unmanage(void * client, char *reqId);
 DLLExport IOTPRC iotp_client_setAttribute(void *client, char *name, char *value);
 DLLExport IOTPRC iotp_client_setActionHandler(void *iotpClient, IoTP_DMAction_type_t type, IoTPDMActionHandler cbFunc);
+DLLExport IOTPRC iotp_client_dmMessageArrived(void *client, char *topicName, void *payload, size_t payloadlen);
 
 
 /*
@@ -0,0 +1,421 @@
+/*******************************************************************************
+ * Copyright (c) 2019 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *
+ * Contrinutors:
+ *    Ranjan Dasgupta         - Initial drop
+ *
+ *******************************************************************************/
+
+/*
+ * Streaming JSON writer.
+ *
+ * Values are appended to a buffer as they are added - there is no document tree.
+ * The writer starts with a buffer provided by the caller (e.g. on the stack), and
+ * moves to a heap buffer if the payload does not fit. The heap buffer is kept on
+ * reset, so a writer can be reused to build payloads without further allocations.
+ *
+ * Errors are sticky: once a call fails, later calls do nothing and return the
+ * same error, so that a payload can be built without checking each call.
+ */
+
+#include <math.h>
+
+#include "iotp_utils.h"
+#include "iotp_internal.h"
+
+/* Scope flags of an open object or array */
+#define IOTP_JSON_SCOPE_OBJECT   0x01
+#define IOTP_JSON_SCOPE_MEMBERS  0x02
+
+/* Initial size of heap buffer */
+#define IOTP_JSON_MIN_ALLOC      256
+
+static const char iotp_json_digits[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const char iotp_json_hex[] = "0123456789abcdef";
+
+/* Makes room for len more bytes, and the NUL terminator */
+static IOTPRC iotp_json_reserve(IoTPJsonWriter *writer, size_t len)
+{
+    size_t need = writer->len + len + 1;
+    size_t size = 0;
+    char *buf = NULL;
+
+    if ( need <= writer->size ) {
+        return IOTPRC_SUCCESS;
+    }
+
+    size = writer->size < IOTP_JSON_MIN_ALLOC ? IOTP_JSON_MIN_ALLOC : writer->size;
+    while ( size < need )
+        size *= 2;
+
+    if ( writer->allocated ) {
+        buf = (char *)realloc(writer->buffer, size);
+    } else {
+        buf = (char *)malloc(size);
+        if ( buf && writer->len > 0 )
+            memcpy(buf, writer->buffer, writer->len);
+    }
+    if ( buf == NULL ) {
+        writer->rc = IOTPRC_NOMEM;
+        LOG(ERROR, "Failed to allocate JSON writer buffer. size: %lu", (unsigned long)size);
+        return writer->rc;
+    }
+    writer->buffer = buf;
+    writer->size = size;
+    writer->allocated = 1;
+
+    return IOTPRC_SUCCESS;
+}
+
+static IOTPRC iotp_json_append(IoTPJsonWriter *writer, const char *data, size_t len)
+{
+    if ( iotp_json_reserve(writer, len) != IOTPRC_SUCCESS ) {
+        return writer->rc;
+    }
+    memcpy(writer->buffer + writer->len, data, len);
+    writer->len += len;
+    writer->buffer[writer->len] = '\0';
+    return IOTPRC_SUCCESS;
+}
+
+/* Appends a quoted and escaped string */
+static IOTPRC iotp_json_appendString(IoTPJsonWriter *writer, const char *str)
+{
+    const unsigned char *p = (const unsigned char *)str;
+    const unsigned char *run = p;
+
+    if ( iotp_json_append(writer, "\"", 1) != IOTPRC_SUCCESS ) {
+        return writer->rc;
+    }
+
+    for (;;) {
+        unsigned char c = *p;
+        char esc[6];
+        size_t elen = 2;
+
+        if ( c >= 0x20 && c != '"' && c != '\\' ) {
+            p++;
+            continue;
+        }
+
+        /* copy characters that do not need escaping */
+        if ( p > run && iotp_json_append(writer, (const char *)run, (size_t)(p - run)) != IOTPRC_SUCCESS ) {
+            return writer->rc;
+        }
+        if ( c == '\0' ) {
+            break;
+        }
+
+        esc[0] = '\\';
+        switch ( c ) {
+            case '"':  esc[1] = '"';  break;
+            case '\\': esc[1] = '\\'; break;
+            case '\b': esc[1] = 'b';  break;
+            case '\f': esc[1] = 'f';  break;
+            case '\n': esc[1] = 'n';  break;
+            case '\r': esc[1] = 'r';  break;
+            case '\t': esc[1] = 't';  break;
+            default:
+                esc[1] = 'u';
+                esc[2] = '0';
+                esc[3] = '0';
+                esc[4] = iotp_json_hex[c >> 4];
+                esc[5] = iotp_json_hex[c & 0x0F];
+                elen = 6;
+                break;
+        }
+        if ( iotp_json_append(writer, esc, elen) != IOTPRC_SUCCESS ) {
+            return writer->rc;
+        }
+        p++;
+        run = p;
+    }
+
+    return iotp_json_append(writer, "\"", 1);
+}
+
+/* Formats an integer, two digits at a time. Returns number of characters written to the end of buf. */
+static size_t iotp_json_formatInt(char *end, int64_t value)
+{
+    uint64_t v = value < 0 ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+    char *p = end;
+
+    while ( v >= 100 ) {
+        unsigned int i = (unsigned int)(v % 100) * 2;
+        v /= 100;
+        *--p = iotp_json_digits[i + 1];
+        *--p = iotp_json_digits[i];
+    }
+    if ( v >= 10 ) {
+        unsigned int i = (unsigned int)v * 2;
+        *--p = iotp_json_digits[i + 1];
+        *--p = iotp_json_digits[i];
+    } else {
+        *--p = (char)('0' + v);
+    }
+    if ( value < 0 )
+        *--p = '-';
+
+    return (size_t)(end - p);
+}
+
+/*
+ * Checks that a value can be added in current scope, and writes the separator and
+ * member name. Name is required in an object, and must be NULL in an array or at top level.
+ */
+static IOTPRC iotp_json_beginValue(IoTPJsonWriter *writer, const char *name)
+{
+    unsigned char *scope = NULL;
+
+    if ( writer == NULL ) {
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+    if ( writer->rc != IOTPRC_SUCCESS ) {
+        return writer->rc;
+    }
+
+    if ( writer->depth == 0 ) {
+        /* single value at top level */
+        if ( writer->len > 0 || name != NULL ) {
+            writer->rc = IOTPRC_ARGS_INVALID_VALUE;
+            LOG(ERROR, "Invalid JSON value at top level. name: %s", name ? name : "");
+            return writer->rc;
+        }
+        return IOTPRC_SUCCESS;
+    }
+
+    scope = &writer->scope[writer->depth - 1];
+    if ( (*scope & IOTP_JSON_SCOPE_OBJECT) != 0 && name == NULL ) {
+        writer->rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(ERROR, "JSON object member name is NULL");
+        return writer->rc;
+    }
+    if ( (*scope & IOTP_JSON_SCOPE_OBJECT) == 0 && name != NULL ) {
+        writer->rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(ERROR, "JSON array element can not have a name. name: %s", name);
+        return writer->rc;
+    }
+    if ( (*scope & IOTP_JSON_SCOPE_MEMBERS) != 0 && iotp_json_append(writer, ",", 1) != IOTPRC_SUCCESS ) {
+        return writer->rc;
+    }
+    *scope |= IOTP_JSON_SCOPE_MEMBERS;
+    if ( name != NULL ) {
+        if ( iotp_json_appendString(writer, name) != IOTPRC_SUCCESS || iotp_json_append(writer, ":", 1) != IOTPRC_SUCCESS ) {
+            return writer->rc;
+        }
+    }
+
+    return IOTPRC_SUCCESS;
+}
+
+static IOTPRC iotp_json_beginScope(IoTPJsonWriter *writer, const char *name, int object)
+{
+    if ( iotp_json_beginValue(writer, name) != IOTPRC_SUCCESS ) {
+        return writer ? writer->rc : IOTPRC_ARGS_NULL_VALUE;
+    }
+    if ( writer->depth >= IOTP_JSON_MAX_DEPTH ) {
+        writer->rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(ERROR, "JSON nesting is too deep. maxDepth: %d", IOTP_JSON_MAX_DEPTH);
+        return writer->rc;
+    }
+    writer->scope[writer->depth] = object ? IOTP_JSON_SCOPE_OBJECT : 0;
+    writer->depth += 1;
+    return iotp_json_append(writer, object ? "{" : "[", 1);
+}
+
+static IOTPRC iotp_json_endScope(IoTPJsonWriter *writer, int object)
+{
+    if ( writer == NULL ) {
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+    if ( writer->rc != IOTPRC_SUCCESS ) {
+        return writer->rc;
+    }
+    if ( writer->depth == 0 || ((writer->scope[writer->depth - 1] & IOTP_JSON_SCOPE_OBJECT) != 0) != (object != 0) ) {
+        writer->rc = IOTPRC_ARGS_INVALID_VALUE;
+        LOG(ERROR, "JSON %s is not open", object ? "object" : "array");
+        return writer->rc;
+    }
+    writer->depth -= 1;
+    return iotp_json_append(writer, object ? "}" : "]", 1);
+}
+
+/* Initialize a JSON writer */
+IOTPRC IoTPJsonWriter_init(IoTPJsonWriter *writer, char *buffer, size_t size)
+{
+    if ( writer == NULL ) {
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+    memset(writer, 0, sizeof(IoTPJsonWriter));
+    if ( buffer != NULL && size > 0 ) {
+        writer->buffer = buffer;
+        writer->size = size;
+        writer->buffer[0] = '\0';
+    }
+    return IOTPRC_SUCCESS;
+}
+
+/* Reset a JSON writer to build a new payload - buffer is reused */
+IOTPRC IoTPJsonWriter_reset(IoTPJsonWriter *writer)
+{
+    if ( writer == NULL ) {
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+    writer->len = 0;
+    writer->depth = 0;
+    writer->rc = IOTPRC_SUCCESS;
+    if ( writer->buffer != NULL )
+        writer->buffer[0] = '\0';
+    return IOTPRC_SUCCESS;
+}
+
+/* Free heap buffer of a JSON writer */
+IOTPRC IoTPJsonWriter_free(IoTPJsonWriter *writer)
+{
+    if ( writer == NULL ) {
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+    if ( writer->allocated ) {
+        iotp_utils_freePtr((void *)writer->buffer);
+    }
+    memset(writer, 0, sizeof(IoTPJsonWriter));
+    return IOTPRC_SUCCESS;
+}
+
+IOTPRC IoTPJsonWriter_beginObject(IoTPJsonWriter *writer, const char *name)
+{
+    return iotp_json_beginScope(writer, name, 1);
+}
+
+IOTPRC IoTPJsonWriter_endObject(IoTPJsonWriter *writer)
+{
+    return iotp_json_endScope(writer, 1);
+}
+
+IOTPRC IoTPJsonWriter_beginArray(IoTPJsonWriter *writer, const char *name)
+{
+    return iotp_json_beginScope(writer, name, 0);
+}
+
+IOTPRC IoTPJsonWriter_endArray(IoTPJsonWriter *writer)
+{
+    return iotp_json_endScope(writer, 0);
+}
+
+IOTPRC IoTPJsonWriter_addString(IoTPJsonWriter *writer, const char *name, const char *value)
+{
+    if ( iotp_json_beginValue(writer, name) != IOTPRC_SUCCESS ) {
+        return writer ? writer->rc : IOTPRC_ARGS_NULL_VALUE;
+    }
+    if ( value == NULL ) {
+        return iotp_json_append(writer, "null", 4);
+    }
+    return iotp_json_appendString(writer, value);
+}
+
+IOTPRC IoTPJsonWriter_addInt(IoTPJsonWriter *writer, const char *name, int64_t value)
+{
+    char num[24];
+    size_t len = 0;
+
+    if ( iotp_json_beginValue(writer, name) != IOTPRC_SUCCESS ) {
+        return writer ? writer->rc : IOTPRC_ARGS_NULL_VALUE;
+    }
+    len = iotp_json_formatInt(num + sizeof(num), value);
+    return iotp_json_append(writer, num + sizeof(num) - len, len);
+}
+
+/*
+ * Adds a double. Integral values are written as integers. Other values are written with
+ * the shortest of 15 or 17 significant digits that reads back as the same value.
+ * NaN and infinity can not be represented in JSON, and are written as null.
+ */
+IOTPRC IoTPJsonWriter_addDouble(IoTPJsonWriter *writer, const char *name, double value)
+{
+    char num[32];
+    size_t len = 0;
+    size_t i;
+
+    if ( iotp_json_beginValue(writer, name) != IOTPRC_SUCCESS ) {
+        return writer ? writer->rc : IOTPRC_ARGS_NULL_VALUE;
+    }
+    if ( isnan(value) || isinf(value) ) {
+        return iotp_json_append(writer, "null", 4);
+    }
+    if ( value > -1e15 && value < 1e15 && value == (double)(int64_t)value ) {
+        len = iotp_json_formatInt(num + sizeof(num), (int64_t)value);
+        return iotp_json_append(writer, num + sizeof(num) - len, len);
+    }
+
+    len = (size_t)snprintf(num, sizeof(num), "%.15g", value);
+    if ( strtod(num, NULL) != value )
+        len = (size_t)snprintf(num, sizeof(num), "%.17g", value);
+    /* decimal separator of current locale */
+    for (i = 0; i < len; i++) {
+        if ( num[i] == ',' )
+            num[i] = '.';
+    }
+    return iotp_json_append(writer, num, len);
+}
+
+IOTPRC IoTPJsonWriter_addBool(IoTPJsonWriter *writer, const char *name, int value)
+{
+    if ( iotp_json_beginValue(writer, name) != IOTPRC_SUCCESS ) {
+        return writer ? writer->rc : IOTPRC_ARGS_NULL_VALUE;
+    }
+    return value ? iotp_json_append(writer, "true", 4) : iotp_json_append(writer, "false", 5);
+}
+
+IOTPRC IoTPJsonWriter_addNull(IoTPJsonWriter *writer, const char *name)
+{
+    if ( iotp_json_beginValue(writer, name) != IOTPRC_SUCCESS ) {
+        return writer ? writer->rc : IOTPRC_ARGS_NULL_VALUE;
+    }
+    return iotp_json_append(writer, "null", 4);
+}
+
+/* Adds a value that is already JSON encoded e.g. metadata set by the user */
+IOTPRC IoTPJsonWriter_addRaw(IoTPJsonWriter *writer, const char *name, const char *json)
+{
+    if ( iotp_json_beginValue(writer, name) != IOTPRC_SUCCESS ) {
+        return writer ? writer->rc : IOTPRC_ARGS_NULL_VALUE;
+    }
+    if ( json == NULL || *json == '\0' ) {
+        return iotp_json_append(writer, "null", 4);
+    }
+    return iotp_json_append(writer, json, strlen(json));
+}
+
+/* Returns the JSON payload. Fails if an error occurred, or an object or array is not closed. */
+IOTPRC IoTPJsonWriter_getString(IoTPJsonWriter *writer, const char **json, size_t *len)
+{
+    if ( writer == NULL || json == NULL ) {
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+    *json = NULL;
+    if ( len ) *len = 0;
+    if ( writer->rc != IOTPRC_SUCCESS ) {
+        return writer->rc;
+    }
+    if ( writer->depth != 0 || writer->len == 0 ) {
+        LOG(ERROR, "JSON payload is not complete. depth: %d", writer->depth);
+        return IOTPRC_ARGS_INVALID_VALUE;
+    }
+    *json = writer->buffer;
+    if ( len ) *len = writer->len;
+    return IOTPRC_SUCCESS;
+}
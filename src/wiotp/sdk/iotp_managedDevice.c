@@ -101,6 +101,32 @@ IOTPRC IoTPManagedDevice_setEventCallback(IoTPManagedDevice *managedDevice, IoTP
     return rc;
 }
 
+/* Sets connection state handler */
+IOTPRC IoTPManagedDevice_setConnectionStateHandler(IoTPManagedDevice *managedDevice, IoTPConnectionStateHandler cb, void *context)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    rc = iotp_client_setConnectionStateHandler((void *)managedDevice, cb, context);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to set connection state handler. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
+/* Returns client statistics */
+IOTPRC IoTPManagedDevice_getStats(IoTPManagedDevice *managedDevice, IoTPStats *stats)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    rc = iotp_client_getStats((void *)managedDevice, stats);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to get client statistics. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
 /* Sends event to WIoTP */
 IOTPRC IoTPManagedDevice_sendEvent(IoTPManagedDevice *managedDevice, char *eventId, char *data, char *formatString, QoS qos, MQTTProperties *props)
 {
@@ -149,6 +175,19 @@ IOTPRC IoTPManagedDevice_setCommandHandler(IoTPManagedDevice *managedDevice, IoT
     return rc;
 }
 
+/* Sets global command handler, invoked with message descriptor */
+IOTPRC IoTPManagedDevice_setMessageHandler(IoTPManagedDevice *managedDevice, IoTPMessageHandler cb, void *context)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    rc = iotp_client_setMessageHandler((void *)managedDevice, NULL, IoTP_Handler_Commands, cb, context);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to set IoTPManagedDevice global command handler: rc=%d", rc);
+    }
+
+    return rc;
+}
+
 
 IOTPRC IoTPManagedDevice_subscribeToCommands(IoTPManagedDevice *managedDevice, char *commandId, char *formatString)
 {
@@ -316,12 +355,23 @@ IOTPRC IoTPManagedDevice_addErrorCode(IoTPManagedDevice *managedDevice, char *re
 
     /* Set topic string */
     char *topic = "iotdevice-1/add/diag/errorCodes";
-    char message[256];
-    snprintf(message, 256, "{\"d\":{\"errorCode\":%d},\"reqId\":\"%s\"}", errorCode, reqId); 
-
-    LOG(DEBUG,"Notify errorCode: %s", message);
-
-    rc = iotp_client_publish((void *)managedDevice, topic, message, 1, NULL);
+    char buffer[256];
+    IoTPJsonWriter json;
+    const char *message = NULL;
+
+    IoTPJsonWriter_init(&json, buffer, sizeof(buffer));
+    IoTPJsonWriter_beginObject(&json, NULL);
+    IoTPJsonWriter_beginObject(&json, "d");
+    IoTPJsonWriter_addInt(&json, "errorCode", errorCode);
+    IoTPJsonWriter_endObject(&json);
+    IoTPJsonWriter_addString(&json, "reqId", reqId);
+    IoTPJsonWriter_endObject(&json);
+    rc = IoTPJsonWriter_getString(&json, &message, NULL);
+    if ( rc == IOTPRC_SUCCESS ) {
+        LOG(DEBUG,"Notify errorCode: %s", message);
+        rc = iotp_client_publish((void *)managedDevice, topic, (char *)message, 1, NULL);
+    }
+    IoTPJsonWriter_free(&json);
 
     if ( rc != IOTPRC_SUCCESS ) {
         LOG(ERROR, "Failed to notify errorCode:%d reqId:%s rc=%d", errorCode, reqId, rc);
@@ -345,12 +395,21 @@ IOTPRC IoTPManagedDevice_clearErrorCode(IoTPManagedDevice *managedDevice, char *
 
     /* Set topic string */
     char *topic = "iotdevice-1/clear/diag/errorCodes";
-    char message[256];
-    snprintf(message, 256, "{\"reqId\":\"%s\"}", reqId); 
+    char buffer[256];
+    IoTPJsonWriter json;
+    const char *message = NULL;
 
     LOG(DEBUG,"Clear error codes. reqId:%s", reqId);
 
-    rc = iotp_client_publish((void *)managedDevice, topic, message, 1, NULL);
+    IoTPJsonWriter_init(&json, buffer, sizeof(buffer));
+    IoTPJsonWriter_beginObject(&json, NULL);
+    IoTPJsonWriter_addString(&json, "reqId", reqId);
+    IoTPJsonWriter_endObject(&json);
+    rc = IoTPJsonWriter_getString(&json, &message, NULL);
+    if ( rc == IOTPRC_SUCCESS ) {
+        rc = iotp_client_publish((void *)managedDevice, topic, (char *)message, 1, NULL);
+    }
+    IoTPJsonWriter_free(&json);
 
     if ( rc != IOTPRC_SUCCESS ) {
         LOG(ERROR, "Failed to clear errorCodes. reqId:%s rc=%d", reqId, rc);
@@ -374,26 +433,26 @@ IOTPRC IoTPManagedDevice_addLogEntry(IoTPManagedDevice *managedDevice, char *req
 
     /* Set topic string */
     char *topic = "iotdevice-1/add/diag/log";
-    char *logmsg = NULL;
-    char *logmsgformat = "{\"d\":{\"message\":\"%s\",\"timestamp\":\"%s\",\"data\":\"%s\",\"severity\":%d},\"reqId\":\"%s\"}";
-    int logmsglen = 0;
-    int  msglen = 0;
-    int  tslen = 0;
-    int  datalen = 0;
-    int reqidlen = 0;
-
-    if ( message ) msglen = strlen(message);
-    if ( timestamp ) tslen = strlen(timestamp);
-    if ( data ) datalen = strlen(data);
-    if ( reqId ) reqidlen = strlen(reqId);
-    
-    logmsglen = strlen(logmsgformat) + msglen + tslen + datalen + reqidlen + 16;
-    logmsg = (char *)malloc(logmsglen);
-    snprintf(logmsg, logmsglen, logmsgformat, message?message:"", timestamp?timestamp:"", data?data:"", severity, reqId);
-
-    LOG(DEBUG,"Add log: %s", logmsg);
-
-    rc = iotp_client_publish((void *)managedDevice, topic, logmsg, 1, NULL);
+    char buffer[512];
+    IoTPJsonWriter json;
+    const char *logmsg = NULL;
+
+    IoTPJsonWriter_init(&json, buffer, sizeof(buffer));
+    IoTPJsonWriter_beginObject(&json, NULL);
+    IoTPJsonWriter_beginObject(&json, "d");
+    IoTPJsonWriter_addString(&json, "message", message ? message : "");
+    IoTPJsonWriter_addString(&json, "timestamp", timestamp ? timestamp : "");
+    IoTPJsonWriter_addString(&json, "data", data ? data : "");
+    IoTPJsonWriter_addInt(&json, "severity", severity);
+    IoTPJsonWriter_endObject(&json);
+    IoTPJsonWriter_addString(&json, "reqId", reqId);
+    IoTPJsonWriter_endObject(&json);
+    rc = IoTPJsonWriter_getString(&json, &logmsg, NULL);
+    if ( rc == IOTPRC_SUCCESS ) {
+        LOG(DEBUG,"Add log: %s", logmsg);
+        rc = iotp_client_publish((void *)managedDevice, topic, (char *)logmsg, 1, NULL);
+    }
+    IoTPJsonWriter_free(&json);
 
     if ( rc != IOTPRC_SUCCESS ) {
         LOG(ERROR, "Failed to send diagnostic log. reqId:%s rc=%d", reqId, rc);
@@ -417,12 +476,21 @@ IOTPRC IoTPManagedDevice_clearLog(IoTPManagedDevice *managedDevice, char *reqId)
 
     /* Set topic string */
     char *topic = "iotdevice-1/clear/diag/log";
-    char message[256];
-    snprintf(message, 256, "{\"reqId\":\"%s\"}", reqId); 
+    char buffer[256];
+    IoTPJsonWriter json;
+    const char *message = NULL;
 
     LOG(DEBUG,"Clear error codes. reqId:%s", reqId);
 
-    rc = iotp_client_publish((void *)managedDevice, topic, message, 1, NULL);
+    IoTPJsonWriter_init(&json, buffer, sizeof(buffer));
+    IoTPJsonWriter_beginObject(&json, NULL);
+    IoTPJsonWriter_addString(&json, "reqId", reqId);
+    IoTPJsonWriter_endObject(&json);
+    rc = IoTPJsonWriter_getString(&json, &message, NULL);
+    if ( rc == IOTPRC_SUCCESS ) {
+        rc = iotp_client_publish((void *)managedDevice, topic, (char *)message, 1, NULL);
+    }
+    IoTPJsonWriter_free(&json);
 
     if ( rc != IOTPRC_SUCCESS ) {
         LOG(ERROR, "Failed to clear diagnostic log. reqId:%s rc=%d", reqId, rc);
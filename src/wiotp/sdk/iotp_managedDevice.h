@@ -115,6 +115,18 @@ DLLExport IOTPRC IoTPManagedDevice_disconnect(IoTPManagedDevice *managedDevice);
  */
 DLLExport IOTPRC IoTPManagedDevice_setCommandHandler(IoTPManagedDevice *managedDevice, IoTPCallbackHandler cb);
 
+/**
+ * The IoTPManagedDevice_setMessageHandler() API sets the Command Callback function, that is invoked
+ * with a message descriptor and a user context. Topic and payload of the commands are
+ * not copied. It replaces the callback set by IoTPManagedDevice_setCommandHandler().
+ *
+ * @param managedDevice  - A pointer to IoTP managed device handle.
+ * @param cb             - A Function pointer to the IoTPMessageHandler.
+ * @param context        - User context passed to the callback.
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPManagedDevice_setMessageHandler(IoTPManagedDevice *managedDevice, IoTPMessageHandler cb, void *context);
+
 /**
  * The IoTPManagedDevice_subscribeToCommands() API subscribe to commands for the device.
  * To receive command specified by "commandId" paramete, a command callback handler
@@ -278,6 +290,28 @@ DLLExport IOTPRC IoTPManagedDevice_clearLog(IoTPManagedDevice *managedDevice, ch
  */
 DLLExport IOTPRC IoTPManagedDevice_setEventCallback(IoTPManagedDevice *managedDevice, IoTPEventCallbackHandler cb);
 
+/**
+ * The IoTPManagedDevice_setConnectionStateHandler() API sets handler to get notifications on connection
+ * state changes. If connection is lost and automatic reconnect is enabled, client reconnects in
+ * background, and events sent while reconnecting are buffered by MQTT client.
+ *
+ * @param managedDevice  - A pointer to IoTP managed device handle.
+ * @param cb             - A Function pointer to the IoTPConnectionStateHandler. Set to NULL to clear handler.
+ * @param context        - User context passed to the handler
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPManagedDevice_setConnectionStateHandler(IoTPManagedDevice *managedDevice, IoTPConnectionStateHandler cb, void *context);
+
+/**
+ * The IoTPManagedDevice_getStats() API returns client statistics, e.g. number of events merged
+ * by event coalescer (options.mqtt.coalesceWindow) and number of batches published.
+ *
+ * @param managedDevice  - A pointer to IoTP managed device handle.
+ * @param stats          - A pointer to IoTPStats, filled in by the API.
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPManagedDevice_getStats(IoTPManagedDevice *managedDevice, IoTPStats *stats);
+
 
 #if defined(__cplusplus)
  }
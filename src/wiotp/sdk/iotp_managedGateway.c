@@ -101,6 +101,32 @@ IOTPRC IoTPManagedGateway_setEventCallback(IoTPManagedGateway *managedGatway, Io
     return rc;
 }
 
+/* Sets connection state handler */
+IOTPRC IoTPManagedGateway_setConnectionStateHandler(IoTPManagedGateway *managedGateway, IoTPConnectionStateHandler cb, void *context)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    rc = iotp_client_setConnectionStateHandler((void *)managedGateway, cb, context);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to set connection state handler. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
+/* Returns client statistics */
+IOTPRC IoTPManagedGateway_getStats(IoTPManagedGateway *managedGateway, IoTPStats *stats)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    rc = iotp_client_getStats((void *)managedGateway, stats);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to get client statistics. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+    }
+
+    return rc;
+}
+
 /* Sends event to WIoTP */
 IOTPRC IoTPManagedGateway_sendEvent(IoTPManagedGateway *managedGateway, char *eventId, char *data, char *formatString, QoS qos, MQTTProperties *props)
 {
@@ -280,6 +306,19 @@ IOTPRC IoTPManagedGateway_setCommandHandler(IoTPManagedGateway *managedGateway,
     return rc;
 }
 
+/* Sets global command handler, invoked with message descriptor */
+IOTPRC IoTPManagedGateway_setMessageHandler(IoTPManagedGateway *managedGateway, IoTPMessageHandler cb, void *context)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    rc = iotp_client_setMessageHandler((void *)managedGateway, NULL, IoTP_Handler_Commands, cb, context);
+    if ( rc != IOTPRC_SUCCESS ) {
+        LOG(ERROR, "Failed to set IoTPManagedGateway global command handler: rc=%d", rc);
+    }
+
+    return rc;
+}
+
 IOTPRC IoTPManagedGateway_unsubscribeFromMonitoringMessages(IoTPManagedGateway *managedGateway, char *typeId, char *deviceId)
 {
     IOTPRC rc = IOTPRC_SUCCESS;
@@ -517,12 +556,23 @@ IOTPRC IoTPManagedGateway_addErrorCode(IoTPManagedGateway *managedGateway, char
 
     /* Set topic string */
     char *topic = "iotgateway-1/add/diag/errorCodes";
-    char message[256];
-    snprintf(message, 256, "{\"d\":{\"errorCode\":%d},\"reqId\":\"%s\"}", errorCode, reqId); 
-
-    LOG(DEBUG,"Notify errorCode: %s", message);
-
-    rc = iotp_client_publish((void *)managedGateway, topic, message, 1, NULL);
+    char buffer[256];
+    IoTPJsonWriter json;
+    const char *message = NULL;
+
+    IoTPJsonWriter_init(&json, buffer, sizeof(buffer));
+    IoTPJsonWriter_beginObject(&json, NULL);
+    IoTPJsonWriter_beginObject(&json, "d");
+    IoTPJsonWriter_addInt(&json, "errorCode", errorCode);
+    IoTPJsonWriter_endObject(&json);
+    IoTPJsonWriter_addString(&json, "reqId", reqId);
+    IoTPJsonWriter_endObject(&json);
+    rc = IoTPJsonWriter_getString(&json, &message, NULL);
+    if ( rc == IOTPRC_SUCCESS ) {
+        LOG(DEBUG,"Notify errorCode: %s", message);
+        rc = iotp_client_publish((void *)managedGateway, topic, (char *)message, 1, NULL);
+    }
+    IoTPJsonWriter_free(&json);
 
     if ( rc != IOTPRC_SUCCESS ) {
         LOG(ERROR, "Failed to notify errorCode:%d reqId:%s rc=%d", errorCode, reqId, rc);
@@ -546,12 +596,21 @@ IOTPRC IoTPManagedGateway_clearErrorCode(IoTPManagedGateway *managedGateway, cha
 
     /* Set topic string */
     char *topic = "iotgateway-1/clear/diag/errorCodes";
-    char message[256];
-    snprintf(message, 256, "{\"reqId\":\"%s\"}", reqId); 
+    char buffer[256];
+    IoTPJsonWriter json;
+    const char *message = NULL;
 
     LOG(DEBUG,"Clear error codes. reqId:%s", reqId);
 
-    rc = iotp_client_publish((void *)managedGateway, topic, message, 1, NULL);
+    IoTPJsonWriter_init(&json, buffer, sizeof(buffer));
+    IoTPJsonWriter_beginObject(&json, NULL);
+    IoTPJsonWriter_addString(&json, "reqId", reqId);
+    IoTPJsonWriter_endObject(&json);
+    rc = IoTPJsonWriter_getString(&json, &message, NULL);
+    if ( rc == IOTPRC_SUCCESS ) {
+        rc = iotp_client_publish((void *)managedGateway, topic, (char *)message, 1, NULL);
+    }
+    IoTPJsonWriter_free(&json);
 
     if ( rc != IOTPRC_SUCCESS ) {
         LOG(ERROR, "Failed to clear errorCodes. reqId:%s rc=%d", reqId, rc);
@@ -575,26 +634,26 @@ IOTPRC IoTPManagedGateway_addLogEntry(IoTPManagedGateway *managedGateway, char *
 
     /* Set topic string */
     char *topic = "iotgateway-1/add/diag/log";
-    char *logmsg = NULL;
-    char *logmsgformat = "{\"d\":{\"message\":\"%s\",\"timestamp\":\"%s\",\"data\":\"%s\",\"severity\":%d},\"reqId\":\"%s\"}";
-    int logmsglen = 0;
-    int  msglen = 0;
-    int  tslen = 0;
-    int  datalen = 0;
-    int reqidlen = 0;
-
-    if ( message ) msglen = strlen(message);
-    if ( timestamp ) tslen = strlen(timestamp);
-    if ( data ) datalen = strlen(data);
-    if ( reqId ) reqidlen = strlen(reqId);
-    
-    logmsglen = strlen(logmsgformat) + msglen + tslen + datalen + reqidlen + 16;
-    logmsg = (char *)malloc(logmsglen);
-    snprintf(logmsg, logmsglen, logmsgformat, message?message:"", timestamp?timestamp:"", data?data:"", severity, reqId);
-
-    LOG(DEBUG,"Add log: %s", logmsg);
-
-    rc = iotp_client_publish((void *)managedGateway, topic, logmsg, 1, NULL);
+    char buffer[512];
+    IoTPJsonWriter json;
+    const char *logmsg = NULL;
+
+    IoTPJsonWriter_init(&json, buffer, sizeof(buffer));
+    IoTPJsonWriter_beginObject(&json, NULL);
+    IoTPJsonWriter_beginObject(&json, "d");
+    IoTPJsonWriter_addString(&json, "message", message ? message : "");
+    IoTPJsonWriter_addString(&json, "timestamp", timestamp ? timestamp : "");
+    IoTPJsonWriter_addString(&json, "data", data ? data : "");
+    IoTPJsonWriter_addInt(&json, "severity", severity);
+    IoTPJsonWriter_endObject(&json);
+    IoTPJsonWriter_addString(&json, "reqId", reqId);
+    IoTPJsonWriter_endObject(&json);
+    rc = IoTPJsonWriter_getString(&json, &logmsg, NULL);
+    if ( rc == IOTPRC_SUCCESS ) {
+        LOG(DEBUG,"Add log: %s", logmsg);
+        rc = iotp_client_publish((void *)managedGateway, topic, (char *)logmsg, 1, NULL);
+    }
+    IoTPJsonWriter_free(&json);
 
     if ( rc != IOTPRC_SUCCESS ) {
         LOG(ERROR, "Failed to send diagnostic log. reqId:%s rc=%d", reqId, rc);
@@ -618,12 +677,21 @@ IOTPRC IoTPManagedGateway_clearLog(IoTPManagedGateway *managedGateway, char *req
 
     /* Set topic string */
     char *topic = "iotgateway-1/clear/diag/log";
-    char message[256];
-    snprintf(message, 256, "{\"reqId\":\"%s\"}", reqId); 
+    char buffer[256];
+    IoTPJsonWriter json;
+    const char *message = NULL;
 
     LOG(DEBUG,"Clear error codes. reqId:%s", reqId);
 
-    rc = iotp_client_publish((void *)managedGateway, topic, message, 1, NULL);
+    IoTPJsonWriter_init(&json, buffer, sizeof(buffer));
+    IoTPJsonWriter_beginObject(&json, NULL);
+    IoTPJsonWriter_addString(&json, "reqId", reqId);
+    IoTPJsonWriter_endObject(&json);
+    rc = IoTPJsonWriter_getString(&json, &message, NULL);
+    if ( rc == IOTPRC_SUCCESS ) {
+        rc = iotp_client_publish((void *)managedGateway, topic, (char *)message, 1, NULL);
+    }
+    IoTPJsonWriter_free(&json);
 
     if ( rc != IOTPRC_SUCCESS ) {
         LOG(ERROR, "Failed to clear diagnostic log. reqId:%s rc=%d", reqId, rc);
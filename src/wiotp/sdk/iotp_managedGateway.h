@@ -116,6 +116,18 @@ DLLExport IOTPRC IoTPManagedGateway_disconnect(IoTPManagedGateway *managedGatewa
  */
 DLLExport IOTPRC IoTPManagedGateway_setCommandHandler(IoTPManagedGateway *managedGateway, IoTPCallbackHandler cb);
 
+/**
+ * The IoTPManagedGateway_setMessageHandler() API sets the Command Callback function, that is invoked
+ * with a message descriptor and a user context. Topic and payload of the commands are
+ * not copied. It replaces the callback set by IoTPManagedGateway_setCommandHandler().
+ *
+ * @param managedGateway - A pointer to IoTP managed gateway handle.
+ * @param cb             - A Function pointer to the IoTPMessageHandler.
+ * @param context        - User context passed to the callback.
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPManagedGateway_setMessageHandler(IoTPManagedGateway *managedGateway, IoTPMessageHandler cb, void *context);
+
 /**
  * The IoTPManagedGateway_subscribeToCommands() API subscribe to commands for the device.
  * To receive command specified by "commandId" paramete, a command callback handler
@@ -393,6 +405,28 @@ DLLExport IOTPRC IoTPManagedGateway_clearLog(IoTPManagedGateway *managedGateway,
  */
 DLLExport IOTPRC IoTPManagedGateway_setEventCallback(IoTPManagedGateway *managedGateway, IoTPEventCallbackHandler cb);
 
+/**
+ * The IoTPManagedGateway_setConnectionStateHandler() API sets handler to get notifications on connection
+ * state changes. If connection is lost and automatic reconnect is enabled, client reconnects in
+ * background, and events sent while reconnecting are buffered by MQTT client.
+ *
+ * @param managedGateway - A pointer to IoTP managed gateway handle.
+ * @param cb             - A Function pointer to the IoTPConnectionStateHandler. Set to NULL to clear handler.
+ * @param context        - User context passed to the handler
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPManagedGateway_setConnectionStateHandler(IoTPManagedGateway *managedGateway, IoTPConnectionStateHandler cb, void *context);
+
+/**
+ * The IoTPManagedGateway_getStats() API returns client statistics, e.g. number of events merged
+ * by event coalescer (options.mqtt.coalesceWindow) and number of batches published.
+ *
+ * @param managedGateway - A pointer to IoTP managed gateway handle.
+ * @param stats          - A pointer to IoTPStats, filled in by the API.
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPManagedGateway_getStats(IoTPManagedGateway *managedGateway, IoTPStats *stats);
+
 
 #if defined(__cplusplus)
  }
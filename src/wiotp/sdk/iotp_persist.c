@@ -0,0 +1,809 @@
+/*******************************************************************************
+ * Copyright (c) 2019 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *
+ * Contrinutors:
+ *    Ranjan Dasgupta         - Initial drop
+ *
+ *******************************************************************************/
+
+/*
+ * Persistent outbound store of IoTP client.
+ *
+ * Implements MQTT client persistence interface (MQTTCLIENT_PERSISTENCE_USER) using
+ * an append only log, split into memory mapped segment files. MQTT client stores
+ * QoS1/QoS2 messages (and messages buffered while reconnecting) using this interface,
+ * and restores them from the store when client is created after a restart.
+ *
+ * Each record in a segment has a header, followed by key and data. Commit marker in
+ * the header is written after rest of the record is copied into the segment. On open,
+ * records of each segment are replayed in sequence, till the first record without a
+ * valid commit marker or checksum - so a record torn by a crash is discarded.
+ *
+ * If sync is enabled, pages of a stored record are flushed to disk (msync MS_SYNC) before
+ * the store returns, so that the record survives a power loss or an OS crash. Otherwise
+ * records are written back by the OS, and survive a crash of the process only.
+ *
+ * A segment is deleted when it is the oldest segment and has no live records.
+ */
+
+#include <MQTTAsync.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <limits.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "iotp_utils.h"
+#include "iotp_internal.h"
+
+#define IOTP_PERSIST_COMMIT        0x49505331   /* "IPS1" */
+#define IOTP_PERSIST_PUT           1
+#define IOTP_PERSIST_REMOVE        2
+#define IOTP_PERSIST_SEGMENT_SIZE  (1024 * 1024)
+#define IOTP_PERSIST_SEGMENT_MIN   (16 * 1024)
+#define IOTP_PERSIST_BUCKETS       256
+#define IOTP_PERSIST_ALIGN(n)      (((n) + 7) & ~((size_t)7))
+
+/* Record header */
+typedef struct iotp_persist_rechdr_t {
+    uint32_t commit;     /* Set to IOTP_PERSIST_COMMIT after record is written */
+    uint16_t type;       /* IOTP_PERSIST_PUT or IOTP_PERSIST_REMOVE */
+    uint16_t keylen;
+    uint32_t datalen;
+    uint32_t crc;        /* CRC32 of key and data */
+} iotp_persist_rechdr_t;
+
+/* Segment file */
+typedef struct iotp_persist_seg_t {
+    uint32_t   id;
+    int        fd;
+    char     * base;
+    size_t     size;     /* mapped size */
+    size_t     used;     /* size of committed records */
+    int        live;     /* number of live records */
+    struct iotp_persist_seg_t * next;
+} iotp_persist_seg_t;
+
+/* Index entry of a live record */
+typedef struct iotp_persist_entry_t {
+    char                * key;
+    iotp_persist_seg_t  * seg;
+    size_t                offset;   /* offset of data in segment */
+    uint32_t              datalen;
+    uint64_t              seq;      /* order of record in log */
+    struct iotp_persist_entry_t * next;
+} iotp_persist_entry_t;
+
+/* Open store of a client */
+typedef struct iotp_persist_store_t {
+    pthread_mutex_t        lock;
+    char                 * dir;
+    size_t                 maxBytes;
+    size_t                 segSize;
+    int                    sync;
+    size_t                 totalBytes;
+    iotp_persist_seg_t   * head;
+    iotp_persist_seg_t   * tail;
+    uint32_t               nextSegId;
+    int                    count;
+    uint64_t               seq;
+    iotp_persist_entry_t * buckets[IOTP_PERSIST_BUCKETS];
+} iotp_persist_store_t;
+
+/* Store configuration - passed as context of persistence interface */
+typedef struct iotp_persist_opts_t {
+    char   * path;
+    size_t   maxBytes;
+    int      sync;
+} iotp_persist_opts_t;
+
+static uint32_t crcTable[256];
+static pthread_once_t crcTableOnce = PTHREAD_ONCE_INIT;
+
+static void iotp_persist_initCRC(void)
+{
+    uint32_t i, j, c;
+    for (i = 0; i < 256; i++) {
+        c = i;
+        for (j = 0; j < 8; j++) {
+            c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+        }
+        crcTable[i] = c;
+    }
+}
+
+static uint32_t iotp_persist_crc(uint32_t crc, const char *buf, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)buf;
+    crc = ~crc;
+    while (len--) {
+        crc = crcTable[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static unsigned int iotp_persist_hash(const char *key)
+{
+    unsigned int h = 2166136261u;
+    while (*key) {
+        h = (h ^ (unsigned char)*key++) * 16777619u;
+    }
+    return h % IOTP_PERSIST_BUCKETS;
+}
+
+static iotp_persist_entry_t ** iotp_persist_findEntry(iotp_persist_store_t *store, const char *key)
+{
+    iotp_persist_entry_t **pp = &store->buckets[iotp_persist_hash(key)];
+    while (*pp && strcmp((*pp)->key, key)) {
+        pp = &(*pp)->next;
+    }
+    return pp;
+}
+
+/* Remove key from index */
+static void iotp_persist_unindex(iotp_persist_store_t *store, const char *key)
+{
+    iotp_persist_entry_t **pp = iotp_persist_findEntry(store, key);
+    iotp_persist_entry_t *entry = *pp;
+    if ( entry ) {
+        *pp = entry->next;
+        entry->seg->live--;
+        store->count--;
+        free(entry->key);
+        free(entry);
+    }
+}
+
+/* Add or replace key in index */
+static int iotp_persist_index(iotp_persist_store_t *store, const char *key, iotp_persist_seg_t *seg, size_t offset, uint32_t datalen)
+{
+    iotp_persist_entry_t *entry = NULL;
+
+    iotp_persist_unindex(store, key);
+    entry = (iotp_persist_entry_t *)calloc(1, sizeof(iotp_persist_entry_t));
+    if ( entry == NULL ) {
+        return MQTTCLIENT_PERSISTENCE_ERROR;
+    }
+    entry->key = strdup(key);
+    if ( entry->key == NULL ) {
+        free(entry);
+        return MQTTCLIENT_PERSISTENCE_ERROR;
+    }
+    entry->seg = seg;
+    entry->offset = offset;
+    entry->datalen = datalen;
+    entry->seq = store->seq++;
+    entry->next = store->buckets[iotp_persist_hash(key)];
+    store->buckets[iotp_persist_hash(key)] = entry;
+    seg->live++;
+    store->count++;
+    return 0;
+}
+
+static void iotp_persist_segPath(iotp_persist_store_t *store, uint32_t id, char *path, size_t len)
+{
+    snprintf(path, len, "%s/seg-%08u.log", store->dir, id);
+}
+
+/* Map a segment file of specified size */
+static iotp_persist_seg_t * iotp_persist_mapSegment(iotp_persist_store_t *store, uint32_t id, size_t size, int create)
+{
+    char path[PATH_MAX];
+    struct stat st;
+    iotp_persist_seg_t *seg = NULL;
+    int fd = -1;
+
+    iotp_persist_segPath(store, id, path, sizeof(path));
+    fd = open(path, create ? (O_RDWR | O_CREAT | O_EXCL) : O_RDWR, 0600);
+    if ( fd < 0 ) {
+        LOG(WARN, "Failed to open persistent store segment. path: %s | errno: %d", path, errno);
+        return NULL;
+    }
+    if ( create ) {
+        if ( ftruncate(fd, (off_t)size) != 0 ) {
+            LOG(WARN, "Failed to size persistent store segment. path: %s | errno: %d", path, errno);
+            close(fd);
+            unlink(path);
+            return NULL;
+        }
+    } else {
+        if ( fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(iotp_persist_rechdr_t) ) {
+            close(fd);
+            unlink(path);
+            return NULL;
+        }
+        size = (size_t)st.st_size;
+    }
+
+    seg = (iotp_persist_seg_t *)calloc(1, sizeof(iotp_persist_seg_t));
+    if ( seg == NULL ) {
+        close(fd);
+        return NULL;
+    }
+    seg->base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if ( seg->base == MAP_FAILED ) {
+        LOG(WARN, "Failed to map persistent store segment. path: %s | errno: %d", path, errno);
+        free(seg);
+        close(fd);
+        if ( create ) unlink(path);
+        return NULL;
+    }
+    seg->id = id;
+    seg->fd = fd;
+    seg->size = size;
+    return seg;
+}
+
+static void iotp_persist_unmapSegment(iotp_persist_store_t *store, iotp_persist_seg_t *seg, int remove)
+{
+    char path[PATH_MAX];
+
+    if ( !remove ) {
+        msync(seg->base, seg->size, MS_SYNC);
+    }
+    munmap(seg->base, seg->size);
+    close(seg->fd);
+    if ( remove ) {
+        iotp_persist_segPath(store, seg->id, path, sizeof(path));
+        unlink(path);
+    }
+    free(seg);
+}
+
+/* Flush pages of a record to disk */
+static int iotp_persist_sync(iotp_persist_seg_t *seg, size_t offset, size_t len)
+{
+    static size_t pageSize = 0;
+    size_t start = 0;
+
+    if ( pageSize == 0 ) {
+        pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    }
+    start = offset & ~(pageSize - 1);
+    if ( msync(seg->base + start, offset + len - start, MS_SYNC) != 0 ) {
+        LOG(ERROR, "Failed to sync persistent store segment. id: %u | errno: %d", seg->id, errno);
+        return MQTTCLIENT_PERSISTENCE_ERROR;
+    }
+    return 0;
+}
+
+/* Delete oldest segments without live records, and reset last segment if store is empty */
+static void iotp_persist_reclaim(iotp_persist_store_t *store)
+{
+    while ( store->head && store->head != store->tail && store->head->live == 0 ) {
+        iotp_persist_seg_t *seg = store->head;
+        store->head = seg->next;
+        store->totalBytes -= seg->used;
+        iotp_persist_unmapSegment(store, seg, 1);
+    }
+    if ( store->count == 0 && store->tail && store->tail->used > 0 ) {
+        /* Commit marker of first record is cleared first, so a partial reset replays as empty */
+        memset(store->tail->base, 0, store->tail->used);
+        store->totalBytes -= store->tail->used;
+        store->tail->used = 0;
+    }
+}
+
+/* Append a record to the log, and return offset of data in *offset */
+static int iotp_persist_append(iotp_persist_store_t *store, int type, const char *key, int bufcount, char *buffers[], int buflens[], iotp_persist_seg_t **segp, size_t *offset)
+{
+    iotp_persist_rechdr_t *hdr = NULL;
+    iotp_persist_seg_t *seg = store->tail;
+    size_t keylen = strlen(key);
+    size_t datalen = 0;
+    size_t reclen = 0;
+    char *ptr = NULL;
+    uint32_t crc = 0;
+    int i;
+
+    for (i = 0; i < bufcount; i++) {
+        datalen += (size_t)buflens[i];
+    }
+    if ( keylen == 0 || keylen > 0xFFFF || datalen > 0xFFFFFFFF ) {
+        return MQTTCLIENT_PERSISTENCE_ERROR;
+    }
+    reclen = IOTP_PERSIST_ALIGN(sizeof(iotp_persist_rechdr_t) + keylen + datalen);
+
+    /* Removals are always accepted, so that store can drain when it is full */
+    if ( type == IOTP_PERSIST_PUT && store->maxBytes > 0 && store->totalBytes + reclen > store->maxBytes ) {
+        iotp_persist_reclaim(store);
+        if ( store->totalBytes + reclen > store->maxBytes ) {
+            LOG(WARN, "Persistent store is full. dir: %s | usedBytes: %zu | maxBytes: %zu", store->dir, store->totalBytes, store->maxBytes);
+            return MQTTCLIENT_PERSISTENCE_ERROR;
+        }
+    }
+
+    /* Roll over to a new segment */
+    if ( seg == NULL || seg->used + reclen + sizeof(iotp_persist_rechdr_t) > seg->size ) {
+        size_t size = store->segSize;
+        if ( reclen + sizeof(iotp_persist_rechdr_t) > size ) {
+            size = IOTP_PERSIST_ALIGN(reclen + sizeof(iotp_persist_rechdr_t));
+        }
+        seg = iotp_persist_mapSegment(store, store->nextSegId, size, 1);
+        if ( seg == NULL ) {
+            return MQTTCLIENT_PERSISTENCE_ERROR;
+        }
+        store->nextSegId++;
+        if ( store->tail ) {
+            msync(store->tail->base, store->tail->size, MS_ASYNC);
+            store->tail->next = seg;
+        } else {
+            store->head = seg;
+        }
+        store->tail = seg;
+    }
+
+    hdr = (iotp_persist_rechdr_t *)(seg->base + seg->used);
+    ptr = (char *)(hdr + 1);
+    memcpy(ptr, key, keylen);
+    crc = iotp_persist_crc(crc, ptr, keylen);
+    ptr += keylen;
+    for (i = 0; i < bufcount; i++) {
+        if ( buflens[i] > 0 ) {
+            memcpy(ptr, buffers[i], (size_t)buflens[i]);
+            crc = iotp_persist_crc(crc, ptr, (size_t)buflens[i]);
+            ptr += buflens[i];
+        }
+    }
+    hdr->type = (uint16_t)type;
+    hdr->keylen = (uint16_t)keylen;
+    hdr->datalen = (uint32_t)datalen;
+    hdr->crc = crc;
+    __atomic_store_n(&hdr->commit, IOTP_PERSIST_COMMIT, __ATOMIC_RELEASE);
+
+    if ( segp ) *segp = seg;
+    if ( offset ) *offset = seg->used + sizeof(iotp_persist_rechdr_t) + keylen;
+    seg->used += reclen;
+    store->totalBytes += reclen;
+    return 0;
+}
+
+/* Replay records of a segment, and return size of valid records */
+static size_t iotp_persist_replay(iotp_persist_store_t *store, iotp_persist_seg_t *seg)
+{
+    size_t off = 0;
+    char key[0x10000];
+
+    while ( off + sizeof(iotp_persist_rechdr_t) <= seg->size ) {
+        iotp_persist_rechdr_t *hdr = (iotp_persist_rechdr_t *)(seg->base + off);
+        char *ptr = (char *)(hdr + 1);
+        size_t reclen = 0;
+
+        if ( hdr->commit != IOTP_PERSIST_COMMIT || hdr->keylen == 0 ) break;
+        reclen = IOTP_PERSIST_ALIGN(sizeof(iotp_persist_rechdr_t) + hdr->keylen + (size_t)hdr->datalen);
+        if ( off + reclen > seg->size ) break;
+        if ( iotp_persist_crc(0, ptr, hdr->keylen + (size_t)hdr->datalen) != hdr->crc ) break;
+
+        memcpy(key, ptr, hdr->keylen);
+        key[hdr->keylen] = '\0';
+        if ( hdr->type == IOTP_PERSIST_PUT ) {
+            iotp_persist_index(store, key, seg, off + sizeof(iotp_persist_rechdr_t) + hdr->keylen, hdr->datalen);
+        } else {
+            iotp_persist_unindex(store, key);
+        }
+        off += reclen;
+    }
+    return off;
+}
+
+static int iotp_persist_compareIds(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Load segments of store directory, in sequence */
+static int iotp_persist_load(iotp_persist_store_t *store)
+{
+    DIR *dir = NULL;
+    struct dirent *de = NULL;
+    uint32_t *ids = NULL;
+    int nids = 0;
+    int maxids = 0;
+    int i;
+
+    dir = opendir(store->dir);
+    if ( dir == NULL ) {
+        return MQTTCLIENT_PERSISTENCE_ERROR;
+    }
+    while ( (de = readdir(dir)) != NULL ) {
+        unsigned int id = 0;
+        char tail = 0;
+        if ( sscanf(de->d_name, "seg-%u.lo%c", &id, &tail) != 2 || tail != 'g' ) continue;
+        if ( nids == maxids ) {
+            uint32_t *tmp = NULL;
+            maxids = maxids ? maxids * 2 : 16;
+            tmp = (uint32_t *)realloc(ids, maxids * sizeof(uint32_t));
+            if ( tmp == NULL ) break;
+            ids = tmp;
+        }
+        ids[nids++] = (uint32_t)id;
+    }
+    closedir(dir);
+
+    if ( nids > 0 ) {
+        qsort(ids, nids, sizeof(uint32_t), iotp_persist_compareIds);
+    }
+    for (i = 0; i < nids; i++) {
+        iotp_persist_seg_t *seg = iotp_persist_mapSegment(store, ids[i], 0, 0);
+        if ( seg == NULL ) continue;
+        seg->used = iotp_persist_replay(store, seg);
+        store->totalBytes += seg->used;
+        if ( store->tail ) {
+            store->tail->next = seg;
+        } else {
+            store->head = seg;
+        }
+        store->tail = seg;
+        store->nextSegId = ids[i] + 1;
+    }
+    iotp_utils_freePtr((void *)ids);
+
+    /* Clear torn record, if any, after last valid record */
+    if ( store->tail ) {
+        memset(store->tail->base + store->tail->used, 0, store->tail->size - store->tail->used);
+    }
+    iotp_persist_reclaim(store);
+
+    LOG(INFO, "Persistent store is loaded. dir: %s | segments: %d | records: %d | usedBytes: %zu", store->dir, nids, store->count, store->totalBytes);
+    return 0;
+}
+
+static int iotp_persist_mkdirs(char *path)
+{
+    char *p = path;
+    while ( (p = strchr(p + 1, '/')) != NULL ) {
+        *p = '\0';
+        if ( mkdir(path, 0700) != 0 && errno != EEXIST ) {
+            *p = '/';
+            return -1;
+        }
+        *p = '/';
+    }
+    if ( mkdir(path, 0700) != 0 && errno != EEXIST ) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Persistence interface: open store of a client */
+static int iotp_persist_open(void **handle, const char *clientID, const char *serverURI, void *context)
+{
+    iotp_persist_opts_t *opts = (iotp_persist_opts_t *)context;
+    iotp_persist_store_t *store = NULL;
+    size_t len = 0;
+    char *p = NULL;
+
+    if ( handle == NULL || clientID == NULL || opts == NULL ) {
+        return MQTTCLIENT_PERSISTENCE_ERROR;
+    }
+    pthread_once(&crcTableOnce, iotp_persist_initCRC);
+
+    store = (iotp_persist_store_t *)calloc(1, sizeof(iotp_persist_store_t));
+    if ( store == NULL ) {
+        return MQTTCLIENT_PERSISTENCE_ERROR;
+    }
+
+    /* Each client uses a sub-directory named after client id */
+    len = strlen(opts->path) + strlen(clientID) + 2;
+    store->dir = (char *)malloc(len);
+    if ( store->dir == NULL ) {
+        iotp_utils_freePtr((void *)store);
+        return MQTTCLIENT_PERSISTENCE_ERROR;
+    }
+    snprintf(store->dir, len, "%s/%s", opts->path, clientID);
+    for (p = store->dir + strlen(opts->path) + 1; *p; p++) {
+        if ( !isalnum((unsigned char)*p) && *p != '-' && *p != '_' && *p != '.' ) {
+            *p = '_';
+        }
+    }
+    store->maxBytes = opts->maxBytes;
+    store->sync = opts->sync;
+    /* Space is reclaimed a segment at a time, so use smaller segments for a small store */
+    store->segSize = IOTP_PERSIST_SEGMENT_SIZE;
+    if ( store->maxBytes > 0 && store->maxBytes / 8 < store->segSize ) {
+        store->segSize = store->maxBytes / 8 & ~((size_t)4095);
+        if ( store->segSize < IOTP_PERSIST_SEGMENT_MIN ) {
+            store->segSize = IOTP_PERSIST_SEGMENT_MIN;
+        }
+    }
+    pthread_mutex_init(&store->lock, NULL);
+
+    if ( iotp_persist_mkdirs(store->dir) != 0 || iotp_persist_load(store) != 0 ) {
+        LOG(ERROR, "Failed to open persistent store. dir: %s | errno: %d", store->dir, errno);
+        pthread_mutex_destroy(&store->lock);
+        iotp_utils_freePtr((void *)store->dir);
+        iotp_utils_freePtr((void *)store);
+        return MQTTCLIENT_PERSISTENCE_ERROR;
+    }
+
+    *handle = store;
+    return 0;
+}
+
+static void iotp_persist_freeIndex(iotp_persist_store_t *store)
+{
+    int i;
+    for (i = 0; i < IOTP_PERSIST_BUCKETS; i++) {
+        iotp_persist_entry_t *entry = store->buckets[i];
+        while ( entry ) {
+            iotp_persist_entry_t *next = entry->next;
+            free(entry->key);
+            free(entry);
+            entry = next;
+        }
+        store->buckets[i] = NULL;
+    }
+    store->count = 0;
+}
+
+/* Persistence interface: close store */
+static int iotp_persist_close(void *handle)
+{
+    iotp_persist_store_t *store = (iotp_persist_store_t *)handle;
+    int empty = 0;
+
+    if ( store == NULL ) {
+        return MQTTCLIENT_PERSISTENCE_ERROR;
+    }
+    pthread_mutex_lock(&store->lock);
+    empty = (store->count == 0);
+    while ( store->head ) {
+        iotp_persist_seg_t *seg = store->head;
+        store->head = seg->next;
+        iotp_persist_unmapSegment(store, seg, empty);
+    }
+    if ( empty ) {
+        rmdir(store->dir);
+    }
+    iotp_persist_freeIndex(store);
+    pthread_mutex_unlock(&store->lock);
+
+    pthread_mutex_destroy(&store->lock);
+    iotp_utils_freePtr((void *)store->dir);
+    iotp_utils_freePtr((void *)store);
+    return 0;
+}
+
+/* Persistence interface: store data with a key */
+static int iotp_persist_put(void *handle, char *key, int bufcount, char *buffers[], int buflens[])
+{
+    iotp_persist_store_t *store = (iotp_persist_store_t *)handle;
+    iotp_persist_seg_t *seg = NULL;
+    size_t offset = 0;
+    size_t datalen = 0;
+    int rc = 0;
+    int i;
+
+    if ( store == NULL || key == NULL ) {
+        return MQTTCLIENT_PERSISTENCE_ERROR;
+    }
+    for (i = 0; i < bufcount; i++) {
+        datalen += (size_t)buflens[i];
+    }
+
+    pthread_mutex_lock(&store->lock);
+    rc = iotp_persist_append(store, IOTP_PERSIST_PUT, key, bufcount, buffers, buflens, &seg, &offset);
+    if ( rc == 0 ) {
+        rc = iotp_persist_index(store, key, seg, offset, (uint32_t)datalen);
+        if ( rc == 0 && store->sync ) {
+            size_t hdrOffset = offset - strlen(key) - sizeof(iotp_persist_rechdr_t);
+            rc = iotp_persist_sync(seg, hdrOffset, offset + datalen - hdrOffset);
+            if ( rc != 0 ) {
+                /* Record may not be on disk - drop it, so that store and MQTT client agree */
+                iotp_persist_unindex(store, key);
+                iotp_persist_append(store, IOTP_PERSIST_REMOVE, key, 0, NULL, NULL, NULL, NULL);
+            }
+        }
+        iotp_persist_reclaim(store);
+    }
+    pthread_mutex_unlock(&store->lock);
+    return rc;
+}
+
+/* Persistence interface: get data of a key */
+static int iotp_persist_get(void *handle, char *key, char **buffer, int *buflen)
+{
+    iotp_persist_store_t *store = (iotp_persist_store_t *)handle;
+    iotp_persist_entry_t *entry = NULL;
+    int rc = MQTTCLIENT_PERSISTENCE_ERROR;
+
+    if ( store == NULL || key == NULL || buffer == NULL || buflen == NULL ) {
+        return rc;
+    }
+    pthread_mutex_lock(&store->lock);
+    entry = *iotp_persist_findEntry(store, key);
+    if ( entry ) {
+        *buffer = (char *)malloc(entry->datalen ? entry->datalen : 1);
+        if ( *buffer ) {
+            memcpy(*buffer, entry->seg->base + entry->offset, entry->datalen);
+            *buflen = (int)entry->datalen;
+            rc = 0;
+        }
+    }
+    pthread_mutex_unlock(&store->lock);
+    return rc;
+}
+
+/* Persistence interface: remove a key */
+static int iotp_persist_remove(void *handle, char *key)
+{
+    iotp_persist_store_t *store = (iotp_persist_store_t *)handle;
+    int rc = 0;
+
+    if ( store == NULL || key == NULL ) {
+        return MQTTCLIENT_PERSISTENCE_ERROR;
+    }
+    pthread_mutex_lock(&store->lock);
+    if ( *iotp_persist_findEntry(store, key) != NULL ) {
+        iotp_persist_unindex(store, key);
+        if ( store->count > 0 ) {
+            /* Removal record is not required if store becomes empty, log is reset by reclaim */
+            rc = iotp_persist_append(store, IOTP_PERSIST_REMOVE, key, 0, NULL, NULL, NULL, NULL);
+        }
+        iotp_persist_reclaim(store);
+    }
+    pthread_mutex_unlock(&store->lock);
+    return rc;
+}
+
+static int iotp_persist_compareEntries(const void *a, const void *b)
+{
+    uint64_t x = (*(iotp_persist_entry_t * const *)a)->seq;
+    uint64_t y = (*(iotp_persist_entry_t * const *)b)->seq;
+    return (x > y) - (x < y);
+}
+
+/* Persistence interface: return keys in the order they were stored */
+static int iotp_persist_keys(void *handle, char ***keys, int *nkeys)
+{
+    iotp_persist_store_t *store = (iotp_persist_store_t *)handle;
+    iotp_persist_entry_t **entries = NULL;
+    int count = 0;
+    int i;
+
+    if ( store == NULL || keys == NULL || nkeys == NULL ) {
+        return MQTTCLIENT_PERSISTENCE_ERROR;
+    }
+    *keys = NULL;
+    *nkeys = 0;
+
+    pthread_mutex_lock(&store->lock);
+    if ( store->count > 0 ) {
+        entries = (iotp_persist_entry_t **)malloc(store->count * sizeof(iotp_persist_entry_t *));
+        *keys = (char **)malloc(store->count * sizeof(char *));
+        if ( entries == NULL || *keys == NULL ) {
+            iotp_utils_freePtr((void *)entries);
+            iotp_utils_freePtr((void *)*keys);
+            *keys = NULL;
+            pthread_mutex_unlock(&store->lock);
+            return MQTTCLIENT_PERSISTENCE_ERROR;
+        }
+        for (i = 0; i < IOTP_PERSIST_BUCKETS; i++) {
+            iotp_persist_entry_t *entry = store->buckets[i];
+            for ( ; entry; entry = entry->next) {
+                entries[count++] = entry;
+            }
+        }
+        qsort(entries, count, sizeof(iotp_persist_entry_t *), iotp_persist_compareEntries);
+        for (i = 0; i < count; i++) {
+            (*keys)[i] = strdup(entries[i]->key);
+        }
+        *nkeys = count;
+        iotp_utils_freePtr((void *)entries);
+    }
+    pthread_mutex_unlock(&store->lock);
+    return 0;
+}
+
+/* Persistence interface: remove all keys */
+static int iotp_persist_clear(void *handle)
+{
+    iotp_persist_store_t *store = (iotp_persist_store_t *)handle;
+
+    if ( store == NULL ) {
+        return MQTTCLIENT_PERSISTENCE_ERROR;
+    }
+    pthread_mutex_lock(&store->lock);
+    iotp_persist_freeIndex(store);
+    while ( store->head ) {
+        iotp_persist_seg_t *seg = store->head;
+        store->head = seg->next;
+        iotp_persist_unmapSegment(store, seg, 1);
+    }
+    store->tail = NULL;
+    store->totalBytes = 0;
+    pthread_mutex_unlock(&store->lock);
+    return 0;
+}
+
+/* Persistence interface: check if key exists */
+static int iotp_persist_containsKey(void *handle, char *key)
+{
+    iotp_persist_store_t *store = (iotp_persist_store_t *)handle;
+    int rc = MQTTCLIENT_PERSISTENCE_ERROR;
+
+    if ( store == NULL || key == NULL ) {
+        return rc;
+    }
+    pthread_mutex_lock(&store->lock);
+    if ( *iotp_persist_findEntry(store, key) != NULL ) {
+        rc = 0;
+    }
+    pthread_mutex_unlock(&store->lock);
+    return rc;
+}
+
+/*
+ * Initialize persistence interface of a client, to store data in specified directory.
+ * If sync is set, each stored record is flushed to disk before the store returns.
+ */
+IOTPRC iotp_persist_init(MQTTClient_persistence *persistence, const char *path, size_t maxBytes, int sync)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+    iotp_persist_opts_t *opts = NULL;
+
+    /* Sanity check */
+    if ( persistence == NULL || path == NULL || *path == '\0' ) {
+        rc = IOTPRC_ARGS_NULL_VALUE;
+        LOG(WARN, "Received NULL argument. rc: %d | reason: %s", rc, IOTPRC_toString(rc));
+        return rc;
+    }
+
+    opts = (iotp_persist_opts_t *)calloc(1, sizeof(iotp_persist_opts_t));
+    if ( opts == NULL ) {
+        rc = IOTPRC_NOMEM;
+        LOG(ERROR, "Failed to allocate persistent store options. rc: %d", rc);
+        return rc;
+    }
+    opts->path = strdup(path);
+    if ( opts->path == NULL ) {
+        iotp_utils_freePtr((void *)opts);
+        rc = IOTPRC_NOMEM;
+        LOG(ERROR, "Failed to allocate persistent store path. rc: %d", rc);
+        return rc;
+    }
+    opts->maxBytes = maxBytes;
+    opts->sync = sync;
+
+    persistence->context = opts;
+    persistence->popen = iotp_persist_open;
+    persistence->pclose = iotp_persist_close;
+    persistence->pput = iotp_persist_put;
+    persistence->pget = iotp_persist_get;
+    persistence->premove = iotp_persist_remove;
+    persistence->pkeys = iotp_persist_keys;
+    persistence->pclear = iotp_persist_clear;
+    persistence->pcontainskey = iotp_persist_containsKey;
+
+    LOG(INFO, "Persistent store is configured. path: %s | maxBytes: %zu | sync: %d", path, maxBytes, sync);
+
+    return rc;
+}
+
+/* Free persistence interface context */
+void iotp_persist_free(MQTTClient_persistence *persistence)
+{
+    iotp_persist_opts_t *opts = NULL;
+
+    if ( persistence == NULL || persistence->context == NULL ) {
+        return;
+    }
+    opts = (iotp_persist_opts_t *)persistence->context;
+    iotp_utils_freePtr((void *)opts->path);
+    iotp_utils_freePtr((void *)opts);
+    persistence->context = NULL;
+}
@@ -0,0 +1,323 @@
+/*******************************************************************************
+ * Copyright (c) 2019 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *
+ * Contrinutors:
+ *    Ranjan Dasgupta         - Initial drop
+ *
+ *******************************************************************************/
+
+/*
+ * Token bucket rate limiter of outbound publish requests.
+ *
+ * A client bucket limits all publish requests of a client. If a device rate
+ * is configured, publish requests to device topics (iot-2/type/<typeId>/id/<deviceId>/...)
+ * are also limited by a bucket of the device.
+ *
+ * Tokens are reserved in advance: a publish request that has to wait takes its
+ * tokens immediately (the bucket goes negative), and the caller sleeps until
+ * the tokens are due. This keeps requests in order, without holding the lock
+ * while waiting.
+ */
+
+#include <time.h>
+
+#include "iotp_utils.h"
+#include "iotp_internal.h"
+
+/* Device buckets are evicted when idle, once the table has these many devices */
+#define IOTP_RATELIMIT_MAX_DEVICES  4096
+
+static uint32_t iotp_ratelimit_hash(const char *key, size_t len)
+{
+    uint32_t h = 2166136261u;
+    size_t i;
+    for (i = 0; i < len; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Adds tokens accumulated since last update */
+static void iotp_ratelimit_refill(IoTPTokenBucket *bucket, double rate, double burst, uint64_t now)
+{
+    if ( now > bucket->last ) {
+        bucket->tokens += (double)(now - bucket->last) * rate / 1000000.0;
+        if ( bucket->tokens > burst )
+            bucket->tokens = burst;
+        bucket->last = now;
+    }
+}
+
+/*
+ * Reserves tokens in a bucket. Returns time (in microseconds) to wait for the tokens,
+ * or -1 if tokens are not available within maxWait microseconds. Request is always
+ * accepted if bucket is full, so that a request larger than the burst can be sent.
+ */
+static int64_t iotp_ratelimit_reserve(IoTPTokenBucket *bucket, double rate, double burst, int count, uint64_t now, int64_t maxWait)
+{
+    int64_t wait = 0;
+
+    iotp_ratelimit_refill(bucket, rate, burst, now);
+    if ( bucket->tokens < (double)count && bucket->tokens < burst ) {
+        wait = (int64_t)(((double)count - bucket->tokens) * 1000000.0 / rate) + 1;
+        if ( wait > maxWait )
+            return -1;
+    }
+    bucket->tokens -= (double)count;
+    return wait;
+}
+
+/* Returns bucket of the device of a topic, or NULL if topic is not a device topic */
+static IoTPTokenBucket * iotp_ratelimit_deviceBucket(IoTPRateLimiter *limiter, const char *topic, uint64_t now)
+{
+    const char *key = NULL;
+    const char *p = NULL;
+    size_t keylen = 0;
+    uint32_t hash = 0;
+    IoTPTokenBucket *bucket = NULL;
+
+    /* iot-2/type/<typeId>/id/<deviceId>/... - key is <typeId>/id/<deviceId> */
+    if ( topic == NULL || strncmp(topic, "iot-2/type/", 11) ) {
+        return NULL;
+    }
+    key = topic + 11;
+    p = strstr(key, "/id/");
+    if ( p == NULL ) {
+        return NULL;
+    }
+    p = strchr(p + 4, '/');
+    keylen = p ? (size_t)(p - key) : strlen(key);
+    hash = iotp_ratelimit_hash(key, keylen);
+
+    bucket = limiter->devices[hash % IOTP_RATELIMIT_BUCKETS];
+    while ( bucket ) {
+        if ( bucket->hash == hash && bucket->keylen == keylen && !memcmp(bucket->key, key, keylen) ) {
+            return bucket;
+        }
+        bucket = bucket->next;
+    }
+
+    /* Evict idle devices i.e. devices with full bucket */
+    if ( limiter->deviceCount >= IOTP_RATELIMIT_MAX_DEVICES ) {
+        int i;
+        for (i = 0; i < IOTP_RATELIMIT_BUCKETS; i++) {
+            IoTPTokenBucket **pp = &limiter->devices[i];
+            while ( *pp ) {
+                IoTPTokenBucket *b = *pp;
+                iotp_ratelimit_refill(b, limiter->deviceRate, limiter->deviceBurst, now);
+                if ( b->tokens >= limiter->deviceBurst ) {
+                    *pp = b->next;
+                    iotp_utils_freePtr((void *)b->key);
+                    iotp_utils_freePtr((void *)b);
+                    limiter->deviceCount -= 1;
+                } else {
+                    pp = &b->next;
+                }
+            }
+        }
+    }
+
+    bucket = (IoTPTokenBucket *)calloc(1, sizeof(IoTPTokenBucket));
+    if ( bucket == NULL ) {
+        return NULL;
+    }
+    bucket->key = (char *)malloc(keylen + 1);
+    if ( bucket->key == NULL ) {
+        iotp_utils_freePtr((void *)bucket);
+        return NULL;
+    }
+    memcpy(bucket->key, key, keylen);
+    bucket->key[keylen] = '\0';
+    bucket->keylen = keylen;
+    bucket->hash = hash;
+    bucket->tokens = limiter->deviceBurst;
+    bucket->last = now;
+    bucket->next = limiter->devices[hash % IOTP_RATELIMIT_BUCKETS];
+    limiter->devices[hash % IOTP_RATELIMIT_BUCKETS] = bucket;
+    limiter->deviceCount += 1;
+
+    return bucket;
+}
+
+/* Sleeps till reserved tokens are due, and sets delayed to 1 if caller had to wait */
+static void iotp_ratelimit_wait(int64_t wait, int *delayed)
+{
+    if ( wait > 0 ) {
+        struct timespec ts;
+        ts.tv_sec = (time_t)(wait / 1000000);
+        ts.tv_nsec = (long)(wait % 1000000) * 1000;
+        while ( nanosleep(&ts, &ts) != 0 && errno == EINTR )
+            ;
+        if ( delayed ) *delayed = 1;
+    }
+}
+
+/* Initializes rate limiter. Rates are in publish requests per second, timeout is in milliseconds. */
+void iotp_ratelimit_init(IoTPRateLimiter *limiter, int rate, int burst, int deviceRate, int timeout)
+{
+    memset(limiter, 0, sizeof(IoTPRateLimiter));
+    if ( rate <= 0 && deviceRate <= 0 ) {
+        return;
+    }
+
+    limiter->rate = (double)rate;
+    limiter->burst = (double)(burst > 0 ? burst : (rate > 0 ? rate : 1));
+    limiter->deviceRate = (double)deviceRate;
+    limiter->deviceBurst = (double)(deviceRate > 0 ? deviceRate : 1);
+    limiter->timeout = timeout;
+    limiter->client.tokens = limiter->burst;
+    limiter->client.last = iotp_utils_timeMicros();
+    pthread_mutex_init(&limiter->lock, NULL);
+    limiter->enabled = 1;
+}
+
+/* Frees device buckets of rate limiter */
+void iotp_ratelimit_free(IoTPRateLimiter *limiter)
+{
+    int i;
+
+    if ( limiter->enabled == 0 ) {
+        return;
+    }
+    for (i = 0; i < IOTP_RATELIMIT_BUCKETS; i++) {
+        IoTPTokenBucket *bucket = limiter->devices[i];
+        while ( bucket ) {
+            IoTPTokenBucket *next = bucket->next;
+            iotp_utils_freePtr((void *)bucket->key);
+            iotp_utils_freePtr((void *)bucket);
+            bucket = next;
+        }
+        limiter->devices[i] = NULL;
+    }
+    limiter->deviceCount = 0;
+    pthread_mutex_destroy(&limiter->lock);
+    limiter->enabled = 0;
+}
+
+/*
+ * Acquires tokens for count publish requests to a topic. If tokens are not available,
+ * waits for upto timeout milliseconds, and sets delayed to 1. Returns IOTPRC_RATE_LIMITED
+ * if tokens are not available within the timeout.
+ */
+IOTPRC iotp_ratelimit_acquire(IoTPRateLimiter *limiter, const char *topic, int count, int *delayed)
+{
+    IoTPTokenBucket *device = NULL;
+    uint64_t now = 0;
+    int64_t maxWait = 0;
+    int64_t wait = 0;
+    int64_t dwait = 0;
+
+    if ( delayed ) *delayed = 0;
+    if ( limiter->enabled == 0 || count <= 0 ) {
+        return IOTPRC_SUCCESS;
+    }
+
+    maxWait = (int64_t)limiter->timeout * 1000;
+    pthread_mutex_lock(&limiter->lock);
+    now = iotp_utils_timeMicros();
+    if ( limiter->deviceRate > 0 ) {
+        device = iotp_ratelimit_deviceBucket(limiter, topic, now);
+        if ( device ) {
+            dwait = iotp_ratelimit_reserve(device, limiter->deviceRate, limiter->deviceBurst, count, now, maxWait);
+            if ( dwait < 0 ) {
+                pthread_mutex_unlock(&limiter->lock);
+                return IOTPRC_RATE_LIMITED;
+            }
+        }
+    }
+    if ( limiter->rate > 0 ) {
+        wait = iotp_ratelimit_reserve(&limiter->client, limiter->rate, limiter->burst, count, now, maxWait);
+        if ( wait < 0 ) {
+            /* return tokens reserved in device bucket */
+            if ( device )
+                device->tokens += (double)count;
+            pthread_mutex_unlock(&limiter->lock);
+            return IOTPRC_RATE_LIMITED;
+        }
+    }
+    pthread_mutex_unlock(&limiter->lock);
+
+    if ( dwait > wait )
+        wait = dwait;
+    iotp_ratelimit_wait(wait, delayed);
+
+    return IOTPRC_SUCCESS;
+}
+
+/*
+ * Acquires tokens for a batch of publish requests, one request to each topic. Tokens are
+ * reserved in the bucket of the device of every topic, and in the client bucket for all
+ * requests. Either all tokens are reserved, or none - returns IOTPRC_RATE_LIMITED if any
+ * bucket has no tokens within the timeout.
+ */
+IOTPRC iotp_ratelimit_acquireTopics(IoTPRateLimiter *limiter, char **topics, int count, int *delayed)
+{
+    IoTPTokenBucket **devices = NULL;
+    uint64_t now = 0;
+    int64_t maxWait = 0;
+    int64_t wait = 0;
+    int64_t dwait = 0;
+    int i;
+
+    if ( delayed ) *delayed = 0;
+    if ( limiter->enabled == 0 || count <= 0 ) {
+        return IOTPRC_SUCCESS;
+    }
+    if ( limiter->deviceRate <= 0 ) {
+        return iotp_ratelimit_acquire(limiter, NULL, count, delayed);
+    }
+
+    /* buckets reserved so far, to return tokens if the batch is rejected */
+    devices = (IoTPTokenBucket **)calloc((size_t)count, sizeof(IoTPTokenBucket *));
+    if ( devices == NULL ) {
+        return IOTPRC_NOMEM;
+    }
+
+    maxWait = (int64_t)limiter->timeout * 1000;
+    pthread_mutex_lock(&limiter->lock);
+    now = iotp_utils_timeMicros();
+    for (i = 0; i < count; i++) {
+        devices[i] = iotp_ratelimit_deviceBucket(limiter, topics[i], now);
+        if ( devices[i] ) {
+            int64_t w = iotp_ratelimit_reserve(devices[i], limiter->deviceRate, limiter->deviceBurst, 1, now, maxWait);
+            if ( w < 0 ) {
+                devices[i] = NULL;
+                break;
+            }
+            if ( w > dwait )
+                dwait = w;
+        }
+    }
+    if ( i == count && limiter->rate > 0 ) {
+        wait = iotp_ratelimit_reserve(&limiter->client, limiter->rate, limiter->burst, count, now, maxWait);
+    }
+    if ( i < count || wait < 0 ) {
+        /* return tokens reserved in device buckets */
+        while ( i-- > 0 ) {
+            if ( devices[i] )
+                devices[i]->tokens += 1.0;
+        }
+        pthread_mutex_unlock(&limiter->lock);
+        iotp_utils_freePtr((void *)devices);
+        return IOTPRC_RATE_LIMITED;
+    }
+    pthread_mutex_unlock(&limiter->lock);
+    iotp_utils_freePtr((void *)devices);
+
+    if ( dwait > wait )
+        wait = dwait;
+    iotp_ratelimit_wait(wait, delayed);
+
+    return IOTPRC_SUCCESS;
+}
@@ -131,7 +131,16 @@ typedef enum {
     IOTPRC_DM_RESPONSE_INVALID_REQID = 1025,
 
     /** 1026: Could not find a call callback for the device management action. */
-    IOTPRC_DM_ACTION_NO_CALLBACK = 1026
+    IOTPRC_DM_ACTION_NO_CALLBACK = 1026,
+
+    /** 1027: Outbound in-flight window is full, publish request is not accepted. */
+    IOTPRC_WOULDBLOCK = 1027,
+
+    /** 1028: Publish rate limit is exceeded, publish request is not accepted. */
+    IOTPRC_RATE_LIMITED = 1028,
+
+    /** 1029: Some events of a batch are not accepted, status of each event is in its record. */
+    IOTPRC_PARTIAL_FAILURE = 1029
 
 } IOTPRC;
 
@@ -0,0 +1,463 @@
+/*******************************************************************************
+ * Copyright (c) 2019 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *
+ * Contrinutors:
+ *    Ranjan Dasgupta         - Initial drop
+ *
+ *******************************************************************************/
+
+
+/*
+ * Command requests waiting for a response.
+ *
+ * A request is a slot of a table. The request handle has the generation of the slot in
+ * high 32 bits and the index of the slot in low 32 bits, and is sent as Correlation Data
+ * of the command. A response is matched to its request by index, without a search, and
+ * the generation rejects responses of completed requests whose slot is reused.
+ *
+ * Timeouts are run by a hierarchical timer wheel of 4 levels of 64 slots, with a tick of
+ * 10 milliseconds. A request is added to a slot of level 0 if it expires within 64 ticks,
+ * of level 1 if it expires within 64^2 ticks, and so on. When level 0 wraps around, the
+ * next slot of level 1 is moved to lower levels, and so on. Adding, completing and
+ * cancelling a request take constant time, and a tick processes only the requests in
+ * one slot of each level.
+ */
+
+#include "iotp_utils.h"
+#include "iotp_internal.h"
+
+#define IOTP_RPC_INITIAL_SLOTS  1024
+#define IOTP_RPC_MAX_TICKS      ((uint64_t)1 << (IOTP_WHEEL_LEVELS * IOTP_WHEEL_BITS))
+
+/* Returns tick of current time */
+static uint64_t iotp_rpc_tick(IoTPRequests *requests)
+{
+    uint64_t now = iotp_utils_timeMicros();
+
+    if ( now < requests->start ) {
+        return 0;
+    }
+    return (now - requests->start) / IOTP_WHEEL_TICK;
+}
+
+/* Adds a slot to the wheel list of its expiry */
+static void iotp_rpc_link(IoTPRequests *requests, uint32_t index)
+{
+    IoTPRequestSlot *slot = &requests->slots[index];
+    uint64_t delta = slot->expiry - requests->now;
+    int level = 0;
+    uint32_t *head = NULL;
+
+    while ( level < IOTP_WHEEL_LEVELS - 1 && delta >= ((uint64_t)1 << ((level + 1) * IOTP_WHEEL_BITS)) )
+        level++;
+
+    slot->level = (uint8_t)level;
+    slot->wheelSlot = (uint8_t)((slot->expiry >> (level * IOTP_WHEEL_BITS)) & (IOTP_WHEEL_SLOTS - 1));
+    head = &requests->wheel[level][slot->wheelSlot];
+    slot->prev = 0;
+    slot->next = *head;
+    if ( *head )
+        requests->slots[*head].prev = index;
+    *head = index;
+}
+
+/* Removes a slot from its wheel list */
+static void iotp_rpc_unlink(IoTPRequests *requests, uint32_t index)
+{
+    IoTPRequestSlot *slot = &requests->slots[index];
+
+    if ( slot->prev )
+        requests->slots[slot->prev].next = slot->next;
+    else
+        requests->wheel[slot->level][slot->wheelSlot] = slot->next;
+    if ( slot->next )
+        requests->slots[slot->next].prev = slot->prev;
+}
+
+/* Returns a slot to free list. Handles of the request are not valid after this. */
+static void iotp_rpc_release(IoTPRequests *requests, uint32_t index)
+{
+    IoTPRequestSlot *slot = &requests->slots[index];
+
+    slot->pending = 0;
+    slot->cb = NULL;
+    slot->context = NULL;
+    slot->generation += 1;
+    if ( slot->generation == 0 )
+        slot->generation = 1;
+    slot->next = requests->freeList;
+    requests->freeList = index;
+    requests->pending -= 1;
+}
+
+/* Doubles request table. Slots are referenced by index, table can be moved. */
+static IOTPRC iotp_rpc_grow(IoTPRequests *requests)
+{
+    uint32_t size = requests->size ? requests->size * 2 : IOTP_RPC_INITIAL_SLOTS;
+    IoTPRequestSlot *slots = NULL;
+    uint32_t i;
+
+    if ( size <= requests->size ) {
+        return IOTPRC_NOMEM;
+    }
+    slots = (IoTPRequestSlot *)realloc(requests->slots, (size_t)size * sizeof(IoTPRequestSlot));
+    if ( slots == NULL ) {
+        return IOTPRC_NOMEM;
+    }
+    memset(&slots[requests->size], 0, (size_t)(size - requests->size) * sizeof(IoTPRequestSlot));
+    /* slot 0 is not used, 0 is end of lists */
+    for (i = size - 1; i >= requests->size && i > 0; i--) {
+        slots[i].generation = 1;
+        slots[i].next = requests->freeList;
+        requests->freeList = i;
+    }
+    requests->slots = slots;
+    requests->size = size;
+    return IOTPRC_SUCCESS;
+}
+
+/* Moves requests of a wheel slot to lower levels */
+static void iotp_rpc_cascade(IoTPRequests *requests, int level, int wheelSlot)
+{
+    uint32_t index = requests->wheel[level][wheelSlot];
+
+    requests->wheel[level][wheelSlot] = 0;
+    while ( index ) {
+        uint32_t next = requests->slots[index].next;
+        iotp_rpc_link(requests, index);
+        index = next;
+    }
+}
+
+/* Processes ticks upto current time. Returns number of expired requests, copied to requests->expired. */
+static uint32_t iotp_rpc_expire(IoTPRequests *requests, uint64_t tick)
+{
+    uint32_t count = 0;
+
+    while ( requests->now <= tick ) {
+        uint64_t t = requests->now;
+        int level = 1;
+        uint32_t index = 0;
+
+        /* when a level wraps around, next slot of the upper level is due */
+        while ( level < IOTP_WHEEL_LEVELS && (t & (((uint64_t)1 << (level * IOTP_WHEEL_BITS)) - 1)) == 0 )
+            level++;
+        while ( --level > 0 )
+            iotp_rpc_cascade(requests, level, (int)((t >> (level * IOTP_WHEEL_BITS)) & (IOTP_WHEEL_SLOTS - 1)));
+
+        index = requests->wheel[0][t & (IOTP_WHEEL_SLOTS - 1)];
+        requests->wheel[0][t & (IOTP_WHEEL_SLOTS - 1)] = 0;
+        while ( index ) {
+            IoTPRequestSlot *slot = &requests->slots[index];
+            uint32_t next = slot->next;
+
+            if ( count == requests->expiredSize ) {
+                uint32_t size = requests->expiredSize ? requests->expiredSize * 2 : 64;
+                IoTPRequestExpired *expired = (IoTPRequestExpired *)realloc(requests->expired, (size_t)size * sizeof(IoTPRequestExpired));
+                if ( expired == NULL ) {
+                    /* remaining requests of the slot expire on next tick */
+                    requests->wheel[0][t & (IOTP_WHEEL_SLOTS - 1)] = index;
+                    slot->prev = 0;
+                    return count;
+                }
+                requests->expired = expired;
+                requests->expiredSize = size;
+            }
+            requests->expired[count].request = ((uint64_t)slot->generation << 32) | index;
+            requests->expired[count].cb = slot->cb;
+            requests->expired[count].context = slot->context;
+            count++;
+            iotp_rpc_release(requests, index);
+            index = next;
+        }
+        requests->now = t + 1;
+    }
+    return count;
+}
+
+/* Timer thread - times out requests, while there are pending requests */
+static void * iotp_rpc_thread(void *arg)
+{
+    IoTPRequests *requests = (IoTPRequests *)arg;
+
+    pthread_mutex_lock(&requests->lock);
+    while ( requests->stop == 0 ) {
+        uint32_t count = 0;
+        uint32_t i = 0;
+        uint64_t next = 0;
+        struct timespec ts;
+
+        if ( requests->pending == 0 ) {
+            pthread_cond_wait(&requests->cond, &requests->lock);
+            continue;
+        }
+
+        count = iotp_rpc_expire(requests, iotp_rpc_tick(requests));
+        if ( count > 0 ) {
+            requests->timeouts += count;
+            /* handlers are invoked without lock, expired list is not changed by other threads */
+            pthread_mutex_unlock(&requests->lock);
+            for (i = 0; i < count; i++) {
+                IoTPRequestExpired *expired = &requests->expired[i];
+                LOG(DEBUG, "Command request timed out. request: %llx", (unsigned long long)expired->request);
+                if ( expired->cb != NULL )
+                    (*expired->cb)(expired->request, IOTPRC_TIMEOUT, NULL, expired->context);
+            }
+            pthread_mutex_lock(&requests->lock);
+            continue;
+        }
+
+        /* wait for next tick */
+        next = requests->start + requests->now * IOTP_WHEEL_TICK;
+        iotp_utils_deadline(next, &ts);
+        pthread_cond_timedwait(&requests->cond, &requests->lock, &ts);
+    }
+    pthread_mutex_unlock(&requests->lock);
+
+    return NULL;
+}
+
+/* Returns hash of device type and ID, to check the device of a response */
+uint32_t iotp_rpc_deviceHash(const char *typeId, size_t typeLen, const char *deviceId, size_t deviceLen)
+{
+    uint32_t h = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < typeLen; i++) {
+        h ^= (unsigned char)typeId[i];
+        h *= 16777619u;
+    }
+    h ^= '/';
+    h *= 16777619u;
+    for (i = 0; i < deviceLen; i++) {
+        h ^= (unsigned char)deviceId[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/*
+ * Initializes request table. Table and timer thread are created with the first request.
+ * Responses are sent as an event named after a token of the connection, so that responses
+ * are not received by other connections of a shared subscription group, or other processes.
+ */
+void iotp_rpc_init(IoTPRequests *requests)
+{
+    static uint32_t instances = 0;
+    uint64_t seed[4];
+    uint64_t token = 14695981039346656037ULL;
+    const unsigned char *p = (const unsigned char *)seed;
+    size_t i;
+
+    memset(requests, 0, sizeof(IoTPRequests));
+    pthread_mutex_init(&requests->lock, NULL);
+    iotp_utils_initCond(&requests->cond);
+    iotp_utils_initCond(&requests->subscribeCond);
+    requests->start = iotp_utils_timeMicros();
+
+    seed[0] = (uint64_t)getpid();
+    seed[1] = requests->start;
+    seed[2] = (uint64_t)__atomic_add_fetch(&instances, 1, __ATOMIC_RELAXED);
+    seed[3] = (uint64_t)(uintptr_t)requests;
+    for (i = 0; i < sizeof(seed); i++) {
+        token ^= p[i];
+        token *= 1099511628211ULL;
+    }
+    requests->eventLen = snprintf(requests->event, sizeof(requests->event), "%s-%016llx", IOTP_COMMAND_RESPONSE_EVENT, (unsigned long long)token);
+    requests->inited = 1;
+}
+
+/* Stops timer thread, and completes pending requests with IOTPRC_NOT_CONNECTED */
+void iotp_rpc_stop(IoTPRequests *requests)
+{
+    uint32_t i;
+
+    if ( requests->inited == 0 ) {
+        return;
+    }
+
+    pthread_mutex_lock(&requests->lock);
+    requests->stop = 1;
+    pthread_cond_signal(&requests->cond);
+    pthread_mutex_unlock(&requests->lock);
+    if ( requests->started ) {
+        pthread_join(requests->thread, NULL);
+        requests->started = 0;
+    }
+
+    for (i = 1; i < requests->size; i++) {
+        IoTPRequestSlot *slot = &requests->slots[i];
+        if ( slot->pending ) {
+            uint64_t request = ((uint64_t)slot->generation << 32) | i;
+            IoTPCommandResponseHandler cb = slot->cb;
+            void *context = slot->context;
+            iotp_rpc_unlink(requests, i);
+            iotp_rpc_release(requests, i);
+            if ( cb != NULL )
+                (*cb)(request, IOTPRC_NOT_CONNECTED, NULL, context);
+        }
+    }
+
+    iotp_utils_freePtr((void *)requests->slots);
+    iotp_utils_freePtr((void *)requests->expired);
+    requests->slots = NULL;
+    requests->expired = NULL;
+    requests->size = 0;
+    requests->expiredSize = 0;
+    requests->freeList = 0;
+    pthread_cond_destroy(&requests->subscribeCond);
+    pthread_cond_destroy(&requests->cond);
+    pthread_mutex_destroy(&requests->lock);
+    requests->inited = 0;
+}
+
+/* Adds a request, that times out after timeout milliseconds. Returns handle of the request. */
+IOTPRC iotp_rpc_add(IoTPRequests *requests, uint32_t device, int timeout, IoTPCommandResponseHandler cb, void *context, uint64_t *request)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+    IoTPRequestSlot *slot = NULL;
+    uint64_t ticks = 0;
+    uint64_t tick = 0;
+    uint32_t index = 0;
+
+    pthread_mutex_lock(&requests->lock);
+    if ( requests->stop ) {
+        pthread_mutex_unlock(&requests->lock);
+        return IOTPRC_INVALID_HANDLE;
+    }
+
+    if ( requests->started == 0 ) {
+        if ( pthread_create(&requests->thread, NULL, iotp_rpc_thread, requests) != 0 ) {
+            pthread_mutex_unlock(&requests->lock);
+            LOG(ERROR, "Failed to start timer thread of command requests");
+            return IOTPRC_FAILURE;
+        }
+        __atomic_store_n(&requests->started, 1, __ATOMIC_RELEASE);
+    }
+
+    if ( requests->freeList == 0 ) {
+        rc = iotp_rpc_grow(requests);
+        if ( rc != IOTPRC_SUCCESS ) {
+            pthread_mutex_unlock(&requests->lock);
+            LOG(ERROR, "Failed to allocate command request. pending: %u", requests->pending);
+            return rc;
+        }
+    }
+
+    tick = iotp_rpc_tick(requests);
+    /* timer thread waits while there are no requests, wheel is empty and can skip to current tick */
+    if ( requests->pending == 0 && tick > requests->now )
+        requests->now = tick;
+    if ( tick < requests->now )
+        tick = requests->now;
+
+    /* round up to ticks, upto range of the wheel */
+    ticks = ((uint64_t)timeout * 1000 + IOTP_WHEEL_TICK - 1) / IOTP_WHEEL_TICK;
+    if ( tick + ticks - requests->now >= IOTP_RPC_MAX_TICKS )
+        ticks = IOTP_RPC_MAX_TICKS - 1 - (tick - requests->now);
+
+    index = requests->freeList;
+    slot = &requests->slots[index];
+    requests->freeList = slot->next;
+    slot->pending = 1;
+    slot->device = device;
+    slot->expiry = tick + ticks;
+    slot->cb = cb;
+    slot->context = context;
+    iotp_rpc_link(requests, index);
+    requests->pending += 1;
+    requests->requests += 1;
+    *request = ((uint64_t)slot->generation << 32) | index;
+
+    if ( requests->pending == 1 )
+        pthread_cond_signal(&requests->cond);
+    pthread_mutex_unlock(&requests->lock);
+
+    return rc;
+}
+
+/* Returns slot of a pending request, or NULL */
+static IoTPRequestSlot * iotp_rpc_find(IoTPRequests *requests, uint64_t request)
+{
+    uint32_t index = (uint32_t)(request & 0xFFFFFFFF);
+    IoTPRequestSlot *slot = NULL;
+
+    if ( index == 0 || index >= requests->size ) {
+        return NULL;
+    }
+    slot = &requests->slots[index];
+    if ( slot->pending == 0 || slot->generation != (uint32_t)(request >> 32) ) {
+        return NULL;
+    }
+    return slot;
+}
+
+/* Cancels a pending request. Its handler is not invoked. */
+IOTPRC iotp_rpc_cancel(IoTPRequests *requests, uint64_t request)
+{
+    IOTPRC rc = IOTPRC_SUCCESS;
+
+    pthread_mutex_lock(&requests->lock);
+    if ( iotp_rpc_find(requests, request) == NULL ) {
+        rc = IOTPRC_NOT_FOUND;
+    } else {
+        uint32_t index = (uint32_t)(request & 0xFFFFFFFF);
+        iotp_rpc_unlink(requests, index);
+        iotp_rpc_release(requests, index);
+    }
+    pthread_mutex_unlock(&requests->lock);
+
+    return rc;
+}
+
+/*
+ * Completes a pending request with a response from a device, and invokes its handler.
+ * Returns IOTPRC_NOT_FOUND, if the request is not pending or is sent to another device.
+ */
+IOTPRC iotp_rpc_complete(IoTPRequests *requests, uint64_t request, uint32_t device, const IoTPMessage *response)
+{
+    IoTPRequestSlot *slot = NULL;
+    IoTPCommandResponseHandler cb = NULL;
+    void *context = NULL;
+
+    pthread_mutex_lock(&requests->lock);
+    slot = iotp_rpc_find(requests, request);
+    if ( slot == NULL || slot->device != device ) {
+        requests->unmatched += 1;
+        pthread_mutex_unlock(&requests->lock);
+        return IOTPRC_NOT_FOUND;
+    }
+    cb = slot->cb;
+    context = slot->context;
+    iotp_rpc_unlink(requests, (uint32_t)(request & 0xFFFFFFFF));
+    iotp_rpc_release(requests, (uint32_t)(request & 0xFFFFFFFF));
+    requests->responses += 1;
+    pthread_mutex_unlock(&requests->lock);
+
+    if ( cb != NULL )
+        (*cb)(request, IOTPRC_SUCCESS, response, context);
+
+    return IOTPRC_SUCCESS;
+}
+
+/* Returns statistics of command requests */
+void iotp_rpc_getStats(IoTPRequests *requests, IoTPStats *stats)
+{
+    pthread_mutex_lock(&requests->lock);
+    stats->commandRequests = requests->requests;
+    stats->commandResponses = requests->responses;
+    stats->commandTimeouts = requests->timeouts;
+    stats->commandUnmatched = requests->unmatched;
+    stats->commandPending = requests->pending;
+    pthread_mutex_unlock(&requests->lock);
+}
@@ -0,0 +1,220 @@
+/*******************************************************************************
+ * Copyright (c) 2019 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *
+ * Contrinutors:
+ *    Ranjan Dasgupta         - Initial drop
+ *
+ *******************************************************************************/
+
+/*
+ * Topic trie of handler topic filters.
+ *
+ * Each node is a level of a topic filter. A child is found by hashing the parent
+ * node and the level, so a lookup takes one hash probe for each level of the topic,
+ * plus the + and # wild card children, irrespective of the number of filters.
+ * A node has a value, if a filter ends at the node. When a topic matches more than
+ * one filter, the lowest value (the first handler added) is returned.
+ */
+
+#include "iotp_utils.h"
+#include "iotp_internal.h"
+
+#define IOTP_TRIE_INITIAL_BUCKETS  64
+
+static uint32_t iotp_trie_key(const IoTPTopicNode *parent, const char *level, size_t len)
+{
+    uint32_t h = 2166136261u;
+    uintptr_t p = (uintptr_t)parent;
+    size_t i;
+
+    for (i = 0; i < sizeof(p); i++) {
+        h ^= (uint32_t)(p & 0xFF);
+        h *= 16777619u;
+        p >>= 8;
+    }
+    for (i = 0; i < len; i++) {
+        h ^= (unsigned char)level[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Returns child of a node for a level, or NULL */
+static IoTPTopicNode * iotp_trie_child(IoTPTopicTrie *trie, const IoTPTopicNode *parent, const char *level, size_t len)
+{
+    IoTPTopicNode *node = NULL;
+    uint32_t key = 0;
+
+    if ( trie->nbuckets == 0 ) {
+        return NULL;
+    }
+    key = iotp_trie_key(parent, level, len);
+    for (node = trie->buckets[key & (trie->nbuckets - 1)]; node; node = node->next) {
+        if ( node->key == key && node->parent == parent && !strncmp(node->level, level, len) && node->level[len] == '\0' )
+            return node;
+    }
+    return NULL;
+}
+
+/* Doubles hash table, when there are more nodes than buckets */
+static void iotp_trie_grow(IoTPTopicTrie *trie)
+{
+    int nbuckets = trie->nbuckets ? trie->nbuckets * 2 : IOTP_TRIE_INITIAL_BUCKETS;
+    IoTPTopicNode **buckets = (IoTPTopicNode **)calloc((size_t)nbuckets, sizeof(IoTPTopicNode *));
+    int i;
+
+    if ( buckets == NULL ) {
+        /* longer hash chains */
+        return;
+    }
+    for (i = 0; i < trie->nbuckets; i++) {
+        IoTPTopicNode *node = trie->buckets[i];
+        while ( node ) {
+            IoTPTopicNode *next = node->next;
+            node->next = buckets[node->key & (nbuckets - 1)];
+            buckets[node->key & (nbuckets - 1)] = node;
+            node = next;
+        }
+    }
+    iotp_utils_freePtr((void *)trie->buckets);
+    trie->buckets = buckets;
+    trie->nbuckets = nbuckets;
+}
+
+/* Frees nodes of a trie */
+void iotp_trie_free(IoTPTopicTrie *trie)
+{
+    int i;
+
+    for (i = 0; i < trie->nbuckets; i++) {
+        IoTPTopicNode *node = trie->buckets[i];
+        while ( node ) {
+            IoTPTopicNode *next = node->next;
+            iotp_utils_freePtr((void *)node->level);
+            free(node);
+            node = next;
+        }
+    }
+    /* wild card nodes are not in hash table */
+    iotp_utils_freePtr((void *)trie->buckets);
+    trie->buckets = NULL;
+    trie->nbuckets = 0;
+    trie->count = 0;
+}
+
+/* Adds a topic filter with a value. If the filter is already added, the lower value is kept. */
+IOTPRC iotp_trie_insert(IoTPTopicTrie *trie, const char *filter, int value)
+{
+    IoTPTopicNode *parent = &trie->root;
+    const char *p = filter;
+
+    if ( filter == NULL || value <= 0 ) {
+        return IOTPRC_ARGS_NULL_VALUE;
+    }
+
+    for (;;) {
+        const char *sep = strchr(p, '/');
+        size_t len = sep ? (size_t)(sep - p) : strlen(p);
+        IoTPTopicNode *node = NULL;
+        int wild = 0;
+
+        if ( len == 1 && (*p == '+' || *p == '#') ) {
+            wild = *p;
+            node = (wild == '+') ? parent->plus : parent->hash;
+        } else {
+            node = iotp_trie_child(trie, parent, p, len);
+        }
+
+        if ( node == NULL ) {
+            node = (IoTPTopicNode *)calloc(1, sizeof(IoTPTopicNode));
+            if ( node == NULL ) {
+                return IOTPRC_NOMEM;
+            }
+            node->level = (char *)malloc(len + 1);
+            if ( node->level == NULL ) {
+                free(node);
+                return IOTPRC_NOMEM;
+            }
+            memcpy(node->level, p, len);
+            node->level[len] = '\0';
+            node->parent = parent;
+            node->key = iotp_trie_key(parent, p, len);
+            /* all nodes are in hash table, to be freed, but wild cards are found from parent */
+            if ( trie->count >= trie->nbuckets )
+                iotp_trie_grow(trie);
+            if ( trie->nbuckets == 0 ) {
+                free(node->level);
+                free(node);
+                return IOTPRC_NOMEM;
+            }
+            node->next = trie->buckets[node->key & (trie->nbuckets - 1)];
+            trie->buckets[node->key & (trie->nbuckets - 1)] = node;
+            trie->count += 1;
+            if ( wild == '+' )
+                parent->plus = node;
+            else if ( wild == '#' )
+                parent->hash = node;
+        }
+
+        if ( sep == NULL ) {
+            if ( node->value == 0 || value < node->value )
+                node->value = value;
+            return IOTPRC_SUCCESS;
+        }
+        parent = node;
+        p = sep + 1;
+    }
+}
+
+/* Keeps the lowest value */
+#define IOTP_TRIE_BEST(best, v)  if ( (v) > 0 && ((best) == 0 || (v) < (best)) ) (best) = (v)
+
+/* Matches remaining levels of a topic, starting at a node */
+static int iotp_trie_matchNode(IoTPTopicTrie *trie, IoTPTopicNode *node, const char *p, const char *end, int best)
+{
+    while ( node ) {
+        const char *sep = NULL;
+        size_t len = 0;
+        IoTPTopicNode *child = NULL;
+
+        /* # matches remaining levels, including none */
+        if ( node->hash )
+            IOTP_TRIE_BEST(best, node->hash->value);
+
+        if ( p == NULL ) {
+            IOTP_TRIE_BEST(best, node->value);
+            return best;
+        }
+
+        sep = (const char *)memchr(p, '/', (size_t)(end - p));
+        len = sep ? (size_t)(sep - p) : (size_t)(end - p);
+
+        /* + branch is matched recursively, literal branch in this loop */
+        if ( node->plus )
+            best = iotp_trie_matchNode(trie, node->plus, sep ? sep + 1 : NULL, end, best);
+
+        child = iotp_trie_child(trie, node, p, len);
+        node = child;
+        p = sep ? sep + 1 : NULL;
+    }
+    return best;
+}
+
+/* Returns the lowest value of filters matching a topic, or 0 if no filter matches */
+int iotp_trie_match(IoTPTopicTrie *trie, const char *topic, size_t topicLen)
+{
+    if ( topic == NULL || trie->count == 0 ) {
+        return 0;
+    }
+    return iotp_trie_matchNode(trie, &trie->root, topic, topic + topicLen, 0);
+}
@@ -17,10 +17,13 @@
  *******************************************************************************/
 
 #include <MQTTReasonCodes.h>
+#include <time.h>
+#include <pthread.h>
 
 #include "iotp_version.h"
 #include "iotp_utils.h"
 #include "iotp_rc.h"
+#include "iotp_internal.h"
 
 /* 
  * Structure with error/return code description.
@@ -57,7 +60,10 @@ static struct {
     { IOTPRC_DM_RESPONSE_PARSE_ERROR,  "Could not parse device management response from WIoTP." },
     { IOTPRC_DM_RESPONSE_NULL_REQID,   "Received a NULL request ID from WIoTP." },
     { IOTPRC_DM_RESPONSE_INVALID_REQID,"Received request ID does not match with cached requiest ID." },
-    { IOTPRC_DM_ACTION_NO_CALLBACK,    "Could not find a call callback for the device management action." }
+    { IOTPRC_DM_ACTION_NO_CALLBACK,    "Could not find a call callback for the device management action." },
+    { IOTPRC_WOULDBLOCK,               "Outbound in-flight window is full, publish request is not accepted." },
+    { IOTPRC_RATE_LIMITED,             "Publish rate limit is exceeded, publish request is not accepted." },
+    { IOTPRC_PARTIAL_FAILURE,          "Some events of a batch are not accepted, status of each event is in its record." }
 };
 #define NUM_RC (sizeof(rcDesc) / sizeof(rcDesc[0]))
 
@@ -234,6 +240,35 @@ void iotp_utils_delay(long milsecs)
 #endif
 }
 
+/*
+ * Returns current time of monotonic clock in microseconds. The clock is not changed by
+ * changes of system time, so it is used for intervals, timeouts and deadlines.
+ */
+uint64_t iotp_utils_timeMicros(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/* Initializes a condition variable, whose timed waits use deadlines of monotonic clock */
+void iotp_utils_initCond(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+/* Converts a time returned by iotp_utils_timeMicros() to deadline of a timed wait */
+void iotp_utils_deadline(uint64_t micros, struct timespec *ts)
+{
+    ts->tv_sec = (time_t)(micros / 1000000);
+    ts->tv_nsec = (long)(micros % 1000000) * 1000;
+}
+
 /* Print IoTP Client version information - if not written yet */
 void iotp_utils_writeClientVersion(void) 
 {
@@ -1208,6 +1243,65 @@ char * iotp_json_getAttr(IoTP_json_parse_t *json, int pos, char *name) {
     return NULL;
 }
 
+/* Validates a topic level used to build a publish topic. Returns 1 if valid */
+int iotp_topic_isValidLevel(const char * level) {
+    if ( level == NULL || *level == '\0' )
+        return 0;
+    /* level separator and wild card characters are not allowed */
+    return strpbrk(level, "/+#") == NULL;
+}
+
+/*
+ * Parses topic of a received message into slices of the topic, in a single pass. Topics are:
+ *   iot-2/cmd/<command>/fmt/<format>
+ *   iot-2/type/<type>/id/<id>/<cmd|evt|...>/<command>/fmt/<format>
+ * Levels that are not in the topic are set to NULL. Payload is not changed.
+ */
+void iotp_topic_parse(const char * topic, size_t topicLen, IoTPMessage * message) {
+    const char *levels[10];
+    size_t lens[10];
+    const char *p = topic;
+    const char *end = topic + topicLen;
+    int count = 0;
+    int i;
+
+    message->topic = topic;
+    message->topicLen = topicLen;
+
+    /* split at level separators, upto the levels used */
+    while ( p && count < 10 ) {
+        const char *sep = (const char *)memchr(p, '/', (size_t)(end - p));
+        levels[count] = p;
+        lens[count] = sep ? (size_t)(sep - p) : (size_t)(end - p);
+        count++;
+        p = sep ? sep + 1 : NULL;
+    }
+    for (i = count; i < 10; i++) {
+        levels[i] = NULL;
+        lens[i] = 0;
+    }
+
+    if ( lens[1] == 3 && !strncmp(levels[1], "cmd", 3) ) {
+        message->type = NULL;
+        message->typeLen = 0;
+        message->id = NULL;
+        message->idLen = 0;
+        message->command = levels[2];
+        message->commandLen = lens[2];
+        message->format = levels[4];
+        message->formatLen = lens[4];
+    } else {
+        message->type = levels[2];
+        message->typeLen = lens[2];
+        message->id = levels[4];
+        message->idLen = lens[4];
+        message->command = levels[6];
+        message->commandLen = lens[6];
+        message->format = levels[8];
+        message->formatLen = lens[8];
+    }
+}
+
 /* Match MQTT topic with topic filter. Returns 1 if matched */
 int iotp_match_mqttTopic(const char * topic, const char * filter) {
     int len = topic ? (int)strlen(topic) : 0;
@@ -50,6 +50,8 @@
 #include <dlfcn.h>
 #endif
 
+#include <MQTTProperties.h>
+
 #include "iotp_rc.h"
 
 
@@ -305,6 +307,80 @@ enum IoTP_json_state_e {
  */
 typedef void (*IoTPCallbackHandler)(char* type, char* id, char* command, char *format, void* payload, size_t payloadlen);
 
+/**
+ * IoTPMessage: Descriptor of a received message. Parts of the topic are slices of the received
+ * topic - a pointer and a length, and are not NUL terminated. Parts that are not in the topic
+ * have a NULL pointer and zero length. The descriptor, topic, payload and properties are valid
+ * only till the handler returns. The descriptor is built on the stack of the dispatching thread,
+ * with no allocations.
+ */
+typedef struct IoTPMessage {
+    /** Topic of the message */
+    const char     * topic;
+    size_t           topicLen;
+    /** Device type ID, or application ID of monitoring messages */
+    const char     * type;
+    size_t           typeLen;
+    /** Device ID */
+    const char     * id;
+    size_t           idLen;
+    /** Command ID or event ID */
+    const char     * command;
+    size_t           commandLen;
+    /** Format (e.g. json) */
+    const char     * format;
+    size_t           formatLen;
+    /** Payload of the message */
+    const void     * payload;
+    size_t           payloadlen;
+    /** QoS of the message, as received */
+    int              qos;
+    /** Set if the message is a retained message */
+    int              retained;
+    /** MQTT v5 properties of the message e.g. user properties, content type, response topic */
+    const MQTTProperties * properties;
+    /** Time the message was received by the client, in microseconds of monotonic clock (see iotp_utils_timeMicros) */
+    uint64_t         arrivalTime;
+} IoTPMessage;
+
+/**
+ * IoTPMessageHandler: Handler to process received messages, using a message descriptor.
+ * Unlike IoTPCallbackHandler, topic and payload are not copied.
+ *
+ * @param message        - Descriptor of the message
+ * @param context        - User context passed when the handler is set
+ */
+typedef void (*IoTPMessageHandler)(const IoTPMessage *message, void *context);
+
+/**
+ * IoTPBatchHandler: Handler to process a batch of received messages, in the order received. A batch
+ * is collected by a dispatch worker, up to options.mqtt.batchSize messages, or the messages received
+ * within options.mqtt.batchWait microseconds of the first message. Descriptors, topics, payloads and
+ * properties of the messages are valid only till the handler returns.
+ *
+ * @param messages       - Array of message descriptors
+ * @param count          - Number of messages in the array
+ * @param context        - User context passed when the handler is set
+ */
+typedef void (*IoTPBatchHandler)(const IoTPMessage *messages, int count, void *context);
+
+/** Event ID of command responses, set in Response Topic of commands sent using IoTPApplication_sendCommandRequest() */
+#define IOTP_COMMAND_RESPONSE_EVENT  "cmdResponse"
+
+/**
+ * IoTPCommandResponseHandler: Handler to process completion of a command request sent using
+ * IoTPApplication_sendCommandRequest(). It is invoked once for a request, with the response of
+ * the device, or when the request times out or the application is destroyed.
+ *
+ * @param request        - Handle of the request, returned by IoTPApplication_sendCommandRequest()
+ * @param rc             - IOTPRC_SUCCESS if a response is received, IOTPRC_TIMEOUT if no response
+ *                         is received within the timeout, or IOTPRC_NOT_CONNECTED if the
+ *                         application is destroyed
+ * @param response       - Descriptor of the response, or NULL if rc is not IOTPRC_SUCCESS
+ * @param context        - User context passed when the request is sent
+ */
+typedef void (*IoTPCommandResponseHandler)(uint64_t request, int rc, const IoTPMessage *response, void *context);
+
 /**
  * IoTPDMActionHandler: Handler to process device and firmware action Callback.
  * Platform sends payload in JSON format.
@@ -327,6 +403,222 @@ typedef void (*IoTPDMActionHandler)(IoTP_DMAction_type_t type, char *reqId, void
  */
 typedef void (*IoTPEventCallbackHandler)(char *id, int rc, void *success, void *failure);
 
+/**
+ * Connection states of IoTP client, reported to IoTPConnectionStateHandler.
+ */
+typedef enum IoTPConnectionState {
+    /** Client is not connected, and will not reconnect */
+    IoTPConnection_Disconnected  = 0,
+    /** Client is connected */
+    IoTPConnection_Connected     = 1,
+    /** Connection is lost, client is reconnecting in background */
+    IoTPConnection_Reconnecting  = 2
+} IoTPConnectionState;
+
+/**
+ * IoTPConnectionStateHandler: Handler to process connection state changes of IoTP client.
+ * It is invoked from MQTT client thread, and should not block.
+ *
+ * @param id             - IoTP client ID
+ * @param state          - New connection state
+ * @param reason         - Reason of state change, if available. Could be NULL.
+ * @param context        - User context passed to the *_setConnectionStateHandler API
+ */
+typedef void (*IoTPConnectionStateHandler)(char *id, IoTPConnectionState state, char *reason, void *context);
+
+/**
+ * IoTPBufferReleaseHandler: Handler to return ownership of a payload buffer passed to
+ * one of the *_sendEventBuffer APIs. It is invoked once, after the publish request
+ * completes (successfully or not).
+ *
+ * @param buffer         - Pointer to payload buffer
+ * @param bufferlen      - Size of payload buffer
+ * @param context        - User context passed to the send API
+ */
+typedef void (*IoTPBufferReleaseHandler)(void *buffer, size_t bufferlen, void *context);
+
+/**
+ * IoTPDeliveryInfo: Completion status of a publish request, passed to IoTPDeliveryHandler.
+ */
+typedef struct IoTPDeliveryInfo {
+    /** Delivery token returned by the publish API */
+    int        token;
+    /** IOTPRC_SUCCESS if publish request is completed, or IOTPRC_FAILURE or MQTT client error code */
+    int        rc;
+    /** MQTT V5 reason code received from the server */
+    int        reasonCode;
+    /** Time when the publish request is accepted by the MQTT client, in microseconds of monotonic clock (see iotp_utils_timeMicros) */
+    uint64_t   submitTime;
+    /** Time when the publish request is completed, in microseconds of monotonic clock (see iotp_utils_timeMicros) */
+    uint64_t   ackTime;
+} IoTPDeliveryInfo;
+
+/**
+ * IoTPDeliveryHandler: Handler to process completion of a publish request sent using
+ * one of the *Async publish APIs. It is invoked once for each publish request accepted
+ * by the MQTT client. For QoS0 the request is completed when the message is written to
+ * the network, for QoS1 and QoS2 when the message is acknowledged by the server.
+ *
+ * @param info           - Completion status of the publish request
+ * @param context        - User context passed to the publish API
+ */
+typedef void (*IoTPDeliveryHandler)(IoTPDeliveryInfo *info, void *context);
+
+/**
+ * Statistics of an outbound priority lane. Device management messages are published in
+ * the control lane, all other messages in the bulk lane.
+ */
+typedef struct IoTPLaneStats {
+    /** Publish requests completed successfully */
+    uint64_t   published;
+    /** Publish requests failed */
+    uint64_t   failed;
+    /** Publish requests submitted to MQTT client, and not yet completed */
+    uint64_t   depth;
+    /** Highest depth of the lane */
+    uint64_t   maxDepth;
+    /** Sum of time (in microseconds) from submit to completion of completed publish requests */
+    uint64_t   totalLatency;
+    /** Highest time (in microseconds) from submit to completion of a publish request */
+    uint64_t   maxLatency;
+} IoTPLaneStats;
+
+/** Maximum number of dispatch workers (options.mqtt.dispatchWorkers) */
+#define IOTP_MAX_DISPATCH_WORKERS  32
+
+/** Maximum number of messages in a batch (options.mqtt.batchSize) */
+#define IOTP_MAX_BATCH_SIZE  4096
+
+/**
+ * Statistics of a dispatch worker, that invokes callbacks of received messages
+ * of the devices assigned to the worker.
+ */
+typedef struct IoTPWorkerStats {
+    /** Messages processed by the worker */
+    uint64_t   processed;
+    /** Batches of messages taken from the queue by the worker - one per message, if batches are not enabled */
+    uint64_t   batches;
+    /** Messages in the queue of the worker, not yet processed */
+    uint64_t   depth;
+    /** Highest depth of the queue */
+    uint64_t   maxDepth;
+    /** Sum of time (in microseconds) from arrival to completion of callback of processed messages */
+    uint64_t   totalLatency;
+    /** Highest time (in microseconds) from arrival to completion of callback of a message */
+    uint64_t   maxLatency;
+} IoTPWorkerStats;
+
+/**
+ * Statistics of IoTP client, returned by *_getStats APIs.
+ */
+typedef struct IoTPStats {
+    /** Events buffered by the coalescer, to be merged into a batch */
+    uint64_t   eventsMerged;
+    /** Batches of merged events published by the coalescer */
+    uint64_t   batchesPublished;
+    /** Events discarded by the coalescer, as the batch could not be published */
+    uint64_t   eventsDropped;
+    /** Publish requests delayed by the rate limiter */
+    uint64_t   publishesDelayed;
+    /** Publish requests rejected by the rate limiter with IOTPRC_RATE_LIMITED */
+    uint64_t   publishesRejected;
+    /** Publish requests enqueued in submission queue */
+    uint64_t   submitQueued;
+    /** Publish requests in submission queue, that could not be submitted to MQTT client */
+    uint64_t   submitFailed;
+    /** Publish requests sent with a topic alias instead of the topic */
+    uint64_t   topicAliasPublishes;
+    /** Bytes of topics not sent, as topic aliases were used */
+    uint64_t   topicAliasBytesSaved;
+    /** Events published with changed fields only */
+    uint64_t   deltaPublishes;
+    /** Events not published, as no field is changed */
+    uint64_t   deltaSkipped;
+    /** Bytes of event payloads not sent, as fields are not changed */
+    uint64_t   deltaBytesSaved;
+    /** Statistics of control lane (device management messages) */
+    IoTPLaneStats control;
+    /** Statistics of bulk lane (events and other messages) */
+    IoTPLaneStats bulk;
+    /** Times the receiving thread waited for space, as inbound queue was full (policy block) */
+    uint64_t   inboundBlocked;
+    /** Time (in microseconds) from the receiving thread waits for space, till a message is queued again (policy block) */
+    uint64_t   inboundBlockedTime;
+    /** Queued messages discarded to queue received messages (policy dropOldest) */
+    uint64_t   inboundDroppedOldest;
+    /** Received messages discarded, as the inbound queue is full (policy dropNewest) */
+    uint64_t   inboundDroppedNewest;
+    /** Command requests sent, expecting a response */
+    uint64_t   commandRequests;
+    /** Command requests completed by a response */
+    uint64_t   commandResponses;
+    /** Command requests timed out, as no response is received */
+    uint64_t   commandTimeouts;
+    /** Responses received with correlation data that does not match a pending request */
+    uint64_t   commandUnmatched;
+    /** Command requests waiting for a response */
+    uint64_t   commandPending;
+    /** Number of dispatch workers, 0 if callbacks are invoked by the receiving thread */
+    int        dispatchWorkers;
+    /** Statistics of dispatch workers - first dispatchWorkers entries are set */
+    IoTPWorkerStats workers[IOTP_MAX_DISPATCH_WORKERS];
+} IoTPStats;
+
+/**
+ * IoTPEventBatchCallbackHandler: Handler to process completion of a batch of events.
+ * It is invoked once, after all events of the batch that were accepted for delivery
+ * complete (successfully or not).
+ *
+ * @param count          - Number of events in the batch
+ * @param succeeded      - Number of events that were delivered
+ * @param failed         - Number of events that failed, including events not accepted for delivery
+ * @param context        - User context set in the batch
+ */
+typedef void (*IoTPEventBatchCallbackHandler)(int count, int succeeded, int failed, void *context);
+
+/**
+ * IoTPEventRecord: An event in a batch of events.
+ */
+typedef struct IoTPEventRecord {
+    /** Device type ID. Used only for device events sent by a gateway. If NULL, the gateway type ID is used. */
+    char   * typeId;
+    /** Device ID. Used only for device events sent by a gateway. If NULL, the gateway device ID is used. */
+    char   * deviceId;
+    /** Event ID e.g. status, gps */
+    char   * eventId;
+    /** Format of the event e.g. json */
+    char   * format;
+    /** Payload buffer of the event */
+    void   * payload;
+    /** Size of payload buffer */
+    size_t   payloadlen;
+    /** Output - IOTPRC_SUCCESS if event was accepted for delivery, or IOTPRC_* on error */
+    int      rc;
+} IoTPEventRecord;
+
+/**
+ * IoTPEventBatch: A batch of events to be published using a single API call.
+ * The batch, records and payload buffers can be reused as soon as the send API returns.
+ */
+typedef struct IoTPEventBatch {
+    /** Array of events */
+    IoTPEventRecord               * events;
+    /** Number of events in the array */
+    int                             count;
+    /** QoS for all events in the batch */
+    QoS                             qos;
+    /** Optional. Function pointer to the IoTPEventBatchCallbackHandler */
+    IoTPEventBatchCallbackHandler   callback;
+    /** Optional. User context passed to the callback */
+    void                          * context;
+} IoTPEventBatch;
+
+/**
+ * IoTPTopic: Handle of a pre-built publish topic, returned by the *_prepare*Topic APIs.
+ * The topic string is built and validated once, when the handle is created.
+ */
+typedef struct IoTPTopic IoTPTopic;
+
 /**
  * IoTPLogHandler: Callback handler to process log and trace messages from IoTP Client.
  *
@@ -343,6 +635,224 @@ typedef void IoTPLogHandler(int logLevel, char *message);
  */
 typedef void MQTTTraceHandler(int traceLevel, char *message);
 
+/**
+ * The IoTPTopic_publish() API publishes a payload buffer to a topic prepared using one of
+ * the *_prepare*Topic APIs (e.g. IoTPDevice_prepareEventTopic(), IoTPGateway_prepareDeviceEventTopic()).
+ * The payload buffer can be reused as soon as the API returns.
+ *
+ * @param topic          - A pointer to IoTP topic handle.
+ * @param buffer         - Payload buffer
+ * @param bufferlen      - Size of payload buffer
+ * @param qos            - QoS for the publish. Supported values : QoS0, QoS1, QoS2
+ * @param props          - MQTT V5 properties
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPTopic_publish(IoTPTopic *topic, void *buffer, size_t bufferlen, QoS qos, MQTTProperties *props);
+
+/**
+ * The IoTPTopic_publishAsync() API publishes a payload buffer to a prepared topic, and returns
+ * the delivery token of the publish request. If deliveryCB is specified, it is invoked with the
+ * delivery token, status and acknowledgement time when the publish request completes.
+ * The payload buffer can be reused as soon as the API returns.
+ *
+ * @param topic          - A pointer to IoTP topic handle.
+ * @param buffer         - Payload buffer
+ * @param bufferlen      - Size of payload buffer
+ * @param qos            - QoS for the publish. Supported values : QoS0, QoS1, QoS2
+ * @param props          - MQTT V5 properties
+ * @param deliveryCB     - Optional. A function pointer to the IoTPDeliveryHandler.
+ * @param context        - Optional. User context passed to the delivery callback.
+ * @param token          - Optional. Returned delivery token.
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPTopic_publishAsync(IoTPTopic *topic, void *buffer, size_t bufferlen, QoS qos, MQTTProperties *props, IoTPDeliveryHandler deliveryCB, void *context, int *token);
+
+/**
+ * The IoTPTopic_getString() API returns the topic string of a topic handle.
+ *
+ * @param topic          - A pointer to IoTP topic handle.
+ * @return char *        - Topic string, or NULL if topic handle is NULL
+ */
+DLLExport const char * IoTPTopic_getString(IoTPTopic *topic);
+
+/**
+ * The IoTPTopic_destroy() API destroys a topic handle. Topic handles must be destroyed
+ * before the client handle used to create them is destroyed.
+ *
+ * @param topic          - A pointer to IoTP topic handle.
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPTopic_destroy(IoTPTopic *topic);
+
+/**
+ * Maximum nesting level of objects and arrays in a JSON writer.
+ */
+#define IOTP_JSON_MAX_DEPTH   32
+
+/**
+ * IoTPJsonWriter: Streaming JSON writer to build payloads. Values are escaped and formatted
+ * as they are added. A writer can be declared on the stack, and must be initialized using
+ * IoTPJsonWriter_init(). Fields are managed by the IoTPJsonWriter_* APIs, and must not be changed.
+ *
+ * Errors are sticky - once an API fails, subsequent APIs return the same error, and
+ * IoTPJsonWriter_getString() fails. A payload can be built without checking each API call.
+ */
+typedef struct IoTPJsonWriter {
+    /** Buffer of the payload - caller buffer, or heap buffer allocated by the writer */
+    char           * buffer;
+    /** Size of buffer */
+    size_t           size;
+    /** Length of payload */
+    size_t           len;
+    /** Set to 1 if buffer is allocated by the writer */
+    int              allocated;
+    /** Number of open objects and arrays */
+    int              depth;
+    /** First error */
+    int              rc;
+    /** Type of open objects and arrays */
+    unsigned char    scope[IOTP_JSON_MAX_DEPTH];
+} IoTPJsonWriter;
+
+/**
+ * The IoTPJsonWriter_init() API initializes a JSON writer. If buffer is specified, payload is
+ * written to the buffer until it is full, and then moved to a heap buffer. Heap buffer is kept
+ * across IoTPJsonWriter_reset() calls, and is freed by IoTPJsonWriter_free().
+ *
+ * @param writer         - A pointer to JSON writer
+ * @param buffer         - Optional. Initial buffer of the payload.
+ * @param size           - Size of buffer
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPJsonWriter_init(IoTPJsonWriter *writer, char *buffer, size_t size);
+
+/**
+ * The IoTPJsonWriter_reset() API clears the payload and errors of a JSON writer, to build a new payload
+ * using the same buffer.
+ *
+ * @param writer         - A pointer to JSON writer
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPJsonWriter_reset(IoTPJsonWriter *writer);
+
+/**
+ * The IoTPJsonWriter_free() API frees heap buffer allocated by a JSON writer.
+ *
+ * @param writer         - A pointer to JSON writer
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPJsonWriter_free(IoTPJsonWriter *writer);
+
+/**
+ * The IoTPJsonWriter_beginObject() API starts a JSON object. For all IoTPJsonWriter_begin* and
+ * IoTPJsonWriter_add* APIs, name is required inside an object, and must be NULL inside an array
+ * or for the top level value.
+ *
+ * @param writer         - A pointer to JSON writer
+ * @param name           - Member name, or NULL
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPJsonWriter_beginObject(IoTPJsonWriter *writer, const char *name);
+
+/**
+ * The IoTPJsonWriter_endObject() API ends the current JSON object.
+ *
+ * @param writer         - A pointer to JSON writer
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPJsonWriter_endObject(IoTPJsonWriter *writer);
+
+/**
+ * The IoTPJsonWriter_beginArray() API starts a JSON array.
+ *
+ * @param writer         - A pointer to JSON writer
+ * @param name           - Member name, or NULL
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPJsonWriter_beginArray(IoTPJsonWriter *writer, const char *name);
+
+/**
+ * The IoTPJsonWriter_endArray() API ends the current JSON array.
+ *
+ * @param writer         - A pointer to JSON writer
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPJsonWriter_endArray(IoTPJsonWriter *writer);
+
+/**
+ * The IoTPJsonWriter_addString() API adds a string. Quotes, backslash and control characters
+ * are escaped. If value is NULL, null is added.
+ *
+ * @param writer         - A pointer to JSON writer
+ * @param name           - Member name, or NULL
+ * @param value          - UTF-8 string
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPJsonWriter_addString(IoTPJsonWriter *writer, const char *name, const char *value);
+
+/**
+ * The IoTPJsonWriter_addInt() API adds an integer.
+ *
+ * @param writer         - A pointer to JSON writer
+ * @param name           - Member name, or NULL
+ * @param value          - Integer value
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPJsonWriter_addInt(IoTPJsonWriter *writer, const char *name, int64_t value);
+
+/**
+ * The IoTPJsonWriter_addDouble() API adds a number, with the shortest representation (upto 17
+ * significant digits) that reads back as the same value. NaN and infinity are added as null.
+ *
+ * @param writer         - A pointer to JSON writer
+ * @param name           - Member name, or NULL
+ * @param value          - Number
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPJsonWriter_addDouble(IoTPJsonWriter *writer, const char *name, double value);
+
+/**
+ * The IoTPJsonWriter_addBool() API adds true or false.
+ *
+ * @param writer         - A pointer to JSON writer
+ * @param name           - Member name, or NULL
+ * @param value          - 0 for false, true otherwise
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPJsonWriter_addBool(IoTPJsonWriter *writer, const char *name, int value);
+
+/**
+ * The IoTPJsonWriter_addNull() API adds null.
+ *
+ * @param writer         - A pointer to JSON writer
+ * @param name           - Member name, or NULL
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPJsonWriter_addNull(IoTPJsonWriter *writer, const char *name);
+
+/**
+ * The IoTPJsonWriter_addRaw() API adds a value that is already JSON encoded, as is.
+ * If json is NULL or empty, null is added.
+ *
+ * @param writer         - A pointer to JSON writer
+ * @param name           - Member name, or NULL
+ * @param json           - JSON encoded value
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess or IOTPRC_* on error
+ */
+DLLExport IOTPRC IoTPJsonWriter_addRaw(IoTPJsonWriter *writer, const char *name, const char *json);
+
+/**
+ * The IoTPJsonWriter_getString() API returns the NUL terminated payload of a JSON writer.
+ * The payload is valid until the writer is reset, freed or a value is added.
+ *
+ * @param writer         - A pointer to JSON writer
+ * @param json           - Returned payload
+ * @param len            - Optional. Returned length of payload.
+ * @return IOTPRC        - Returns IOTPRC_SUCCESS onsuccess, IOTPRC_ARGS_INVALID_VALUE if an object
+ *                         or array is not closed, or the first error of the writer.
+ */
+DLLExport IOTPRC IoTPJsonWriter_getString(IoTPJsonWriter *writer, const char **json, size_t *len);
+
 /*
 /// @cond EXCLUDE
 */
@@ -353,6 +863,7 @@ DLLExport void iotp_utils_freePtr(void * p);
 DLLExport char * iotp_utils_trim(char *str);
 DLLExport void iotp_utils_generateUUID(char* uuid_str);
 DLLExport void iotp_utils_delay(long milsecs);
+DLLExport uint64_t iotp_utils_timeMicros(void);
 DLLExport void iotp_utils_writeClientVersion(void);
 DLLExport IOTPRC iotp_utils_setLogHandler(IoTPLogTypes type, void * handler);
 DLLExport IOTPRC iotp_utils_fileExist(const char * filePath);
@@ -366,7 +877,14 @@ DLLExport int iotp_json_getInt(IoTP_json_parse_t * pobj, const char * name, int
 DLLExport int iotp_json_getInteger(IoTP_json_parse_t * pobj, const char * name, int deflt);
 DLLExport double iotp_json_getNumber(IoTP_json_parse_t * pobj, const char * name, double deflt);
 DLLExport char * iotp_json_getAttr(IoTP_json_parse_t * pobj, int pos, char * name);
+DLLExport IoTP_json_parse_t * iotp_cbor_init(int payloadlen, char *payload);
+DLLExport int iotp_cbor_parse(IoTP_json_parse_t * pobj);
+DLLExport IOTPRC iotp_cbor_encode(IoTP_json_parse_t * pobj, void **out, size_t *outlen);
+DLLExport IOTPRC iotp_cbor_fromJson(const void *json, size_t jsonlen, void **cbor, size_t *cborlen);
+DLLExport IOTPRC iotp_cbor_toJson(const void *cbor, size_t cborlen, char **json, size_t *jsonlen);
 DLLExport int iotp_match_mqttTopic(const char * topic, const char * filter);
+DLLExport int iotp_topic_isValidLevel(const char * level);
+DLLExport void iotp_topic_parse(const char * topic, size_t topicLen, IoTPMessage * message);
 
 #define LOG(sev, fmts...) iotp_utils_log((LOGLEVEL_##sev), __FILE__, __FUNCTION__, __LINE__, fmts);
 
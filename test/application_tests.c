@@ -19,6 +19,7 @@
 #include "test_utils.h"
 #include "iotp_config.h"
 #include "iotp_application.h"
+#include "iotp_internal.h"
 
 /*
  * validateApplication_tests.c: IBM Watson IoT Platform C Client Application API validation tests
@@ -30,10 +31,18 @@
  * - IoTPApplication_connect
  * - IoTPApplication_disconnect
  * - IoTPApplication_sendEvent
+ * - IoTPApplication_sendEventBuffer
  * - IoTPApplication_sendCommand
+ * - IoTPApplication_sendCommandRequest
+ * - IoTPApplication_cancelCommandRequest
  * - IoTPApplication_setEventHandler
+ * - IoTPApplication_setEventBatchHandler
  * - IoTPApplication_subscribeToEvents
  * - IoTPApplication_unsubscribeFromEvents
+ * - IoTPApplicationGroup_create
+ * - IoTPApplicationGroup_destroy
+ * - iotp_trie_insert
+ * - iotp_trie_match
  */
 
 int logCallbackActive = 0;
@@ -217,10 +226,261 @@ int testApplication_sendEvent(void)
 }
 
 
+/* Tests: Send event using payload buffer - error cases */
+int testApplication_sendEventBufferVal(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPApplication *application = NULL;
+    unsigned char data[] = { 0x00, 0x01, 0x02, 0x00 };
+
+    rc = IoTPApplication_sendEventBuffer(application, "type1", "id1", "status", data, sizeof(data), "bin", QoS0, NULL, NULL, NULL);
+    TEST_ASSERT("IoTPApplication_sendEventBufferVal Invalid application object", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    rc = IoTPConfig_create(&config, "./wiotpapp.yaml");
+    TEST_ASSERT("IoTPApplication_sendEventBufferVal Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPApplication_create(&application, config);
+    TEST_ASSERT("IoTPApplication_sendEventBufferVal Create application with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPApplication_sendEventBuffer(application, "type1", "id1", "status", NULL, sizeof(data), "bin", QoS0, NULL, NULL, NULL);
+    TEST_ASSERT("IoTPApplication_sendEventBufferVal NULL buffer with non-zero length", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    rc = IoTPApplication_sendEventBuffer(application, "type1", "id1", "status", data, sizeof(data), "bin", 3, NULL, NULL, NULL);
+    TEST_ASSERT("IoTPApplication_sendEventBufferVal Invalid QoS=3", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+    rc = IoTPApplication_sendEventBuffer(application, "type1", "id1", "status", data, sizeof(data), "bin", QoS0, NULL, NULL, NULL);
+    TEST_ASSERT("IoTPApplication_sendEventBufferVal Send when not connected", rc == IOTPRC_NOT_CONNECTED, "rcE=%d rcA=%d", IOTPRC_NOT_CONNECTED, rc);
+    rc = IoTPApplication_destroy(application);
+    TEST_ASSERT("IoTPApplication_sendEventBufferVal Destroy a valid application handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPApplication_sendEventBufferVal Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+int testApplication_prepareTopicVal(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPApplication *application = NULL;
+    IoTPTopic *topic = NULL;
+
+    rc = IoTPApplication_prepareEventTopic(NULL, "type1", "id1", "status", "json", &topic);
+    TEST_ASSERT("IoTPApplication_prepareTopicVal Invalid application object", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    rc = IoTPConfig_create(&config, "./wiotpapp.yaml");
+    TEST_ASSERT("IoTPApplication_prepareTopicVal Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPApplication_create(&application, config);
+    TEST_ASSERT("IoTPApplication_prepareTopicVal Create application with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPApplication_prepareEventTopic(application, "+", "id1", "status", "json", &topic);
+    TEST_ASSERT("IoTPApplication_prepareTopicVal Wild card type", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+    rc = IoTPApplication_prepareEventTopic(application, "type1", "id1", "status", "json", &topic);
+    TEST_ASSERT("IoTPApplication_prepareTopicVal Prepare event topic", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = strcmp(IoTPTopic_getString(topic), "iot-2/type/type1/id/id1/evt/status/fmt/json");
+    TEST_ASSERT("IoTPApplication_prepareTopicVal Event topic string", rc == 0, "rcE=%d rcA=%d", 0, rc);
+    IoTPTopic_destroy(topic);
+    rc = IoTPApplication_prepareCommandTopic(application, "type1", "id1", "reboot", "json", &topic);
+    TEST_ASSERT("IoTPApplication_prepareTopicVal Prepare command topic", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = strcmp(IoTPTopic_getString(topic), "iot-2/type/type1/id/id1/cmd/reboot/fmt/json");
+    TEST_ASSERT("IoTPApplication_prepareTopicVal Command topic string", rc == 0, "rcE=%d rcA=%d", 0, rc);
+    rc = IoTPTopic_publish(topic, "{}", 2, QoS0, NULL);
+    TEST_ASSERT("IoTPApplication_prepareTopicVal Publish when not connected", rc == IOTPRC_NOT_CONNECTED, "rcE=%d rcA=%d", IOTPRC_NOT_CONNECTED, rc);
+    rc = IoTPTopic_destroy(topic);
+    TEST_ASSERT("IoTPApplication_prepareTopicVal Destroy command topic", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPApplication_destroy(application);
+    TEST_ASSERT("IoTPApplication_prepareTopicVal Destroy a valid application handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPApplication_prepareTopicVal Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+void commandResponseHandler(uint64_t request, int rc, const IoTPMessage *response, void *context)
+{
+    fprintf(stdout, "Command request completed: request=%llx rc=%d\n", (unsigned long long)request, rc);
+}
+
+/* Tests: Send command request - error cases */
+int testApplication_sendCommandRequestVal(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPApplication *application = NULL;
+    uint64_t request = 0;
+
+    rc = IoTPApplication_sendCommandRequest(application, "type1", "id1", "reboot", "{}", 2, "json", QoS1, NULL, 1000, commandResponseHandler, NULL, &request);
+    TEST_ASSERT("IoTPApplication_sendCommandRequestVal Invalid application object", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    rc = IoTPConfig_create(&config, "./wiotpapp.yaml");
+    TEST_ASSERT("IoTPApplication_sendCommandRequestVal Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPApplication_create(&application, config);
+    TEST_ASSERT("IoTPApplication_sendCommandRequestVal Create application with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPApplication_sendCommandRequest(application, "type1", "id1", "reboot", "{}", 2, "json", QoS1, NULL, 1000, NULL, NULL, &request);
+    TEST_ASSERT("IoTPApplication_sendCommandRequestVal NULL handler", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    rc = IoTPApplication_sendCommandRequest(application, "+", "id1", "reboot", "{}", 2, "json", QoS1, NULL, 1000, commandResponseHandler, NULL, &request);
+    TEST_ASSERT("IoTPApplication_sendCommandRequestVal Wild card type", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+    rc = IoTPApplication_sendCommandRequest(application, "type1", "id1", "reboot", "{}", 2, "json", QoS1, NULL, 0, commandResponseHandler, NULL, &request);
+    TEST_ASSERT("IoTPApplication_sendCommandRequestVal Invalid timeout=0", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+    rc = IoTPApplication_sendCommandRequest(application, "type1", "id1", "reboot", "{}", 2, "json", QoS1, NULL, 1000, commandResponseHandler, NULL, &request);
+    TEST_ASSERT("IoTPApplication_sendCommandRequestVal Send when not connected", rc == IOTPRC_NOT_CONNECTED, "rcE=%d rcA=%d", IOTPRC_NOT_CONNECTED, rc);
+    rc = IoTPApplication_cancelCommandRequest(application, ((uint64_t)1 << 32) | 1);
+    TEST_ASSERT("IoTPApplication_sendCommandRequestVal Cancel request that is not pending", rc == IOTPRC_NOT_FOUND, "rcE=%d rcA=%d", IOTPRC_NOT_FOUND, rc);
+    rc = IoTPApplication_destroy(application);
+    TEST_ASSERT("IoTPApplication_sendCommandRequestVal Destroy a valid application handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPApplication_sendCommandRequestVal Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+void eventCallback(char* type, char* id, char* eventId, char *format, void* payload, size_t payloadlen)
+{
+    fprintf(stdout, "Received event: type=%s id=%s event=%s\n", type ? type : "", id ? id : "", eventId ? eventId : "");
+}
+
+void commandMessageHandler(const IoTPMessage *message, void *context)
+{
+    fprintf(stdout, "Received command: %.*s qos=%d\n", (int)message->commandLen, message->command, message->qos);
+}
+
+/* Tests: Event handlers of many devices */
+int testApplication_setEventHandlers(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPApplication *application = NULL;
+    char deviceId[32];
+    int failed = 0;
+    int i;
+
+    rc = IoTPConfig_create(&config, "./wiotpapp.yaml");
+    TEST_ASSERT("IoTPApplication_setEventHandlers Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPApplication_create(&application, config);
+    TEST_ASSERT("IoTPApplication_setEventHandlers Create application with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    for (i = 0; i < 5000; i++) {
+        snprintf(deviceId, sizeof(deviceId), "dev%d", i);
+        if ( IoTPApplication_setEventHandler(application, eventCallback, "sensor", deviceId, "status", "json") != IOTPRC_SUCCESS )
+            failed++;
+    }
+    TEST_ASSERT("IoTPApplication_setEventHandlers Set handlers of 5000 devices", failed == 0, "failed=%d", failed);
+    rc = IoTPApplication_setEventHandler(application, eventCallback, "sensor", "dev10", "status", "json");
+    TEST_ASSERT("IoTPApplication_setEventHandlers Update handler of a device", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPApplication_setEventHandler(application, eventCallback, "sensor", "+", "+", "json");
+    TEST_ASSERT("IoTPApplication_setEventHandlers Set wild card handler", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPApplication_setEventBatchHandler(application, NULL, NULL, "sensor", "+", "+", "json");
+    TEST_ASSERT("IoTPApplication_setEventHandlers NULL batch handler", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    rc = IoTPApplication_setCommandMessageHandler(application, commandMessageHandler, NULL, "sensor", "dev1", "reboot", NULL);
+    TEST_ASSERT("IoTPApplication_setEventHandlers NULL command format", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    rc = IoTPApplication_setCommandMessageHandler(application, commandMessageHandler, &failed, "sensor", "dev1", "reboot", "json");
+    TEST_ASSERT("IoTPApplication_setEventHandlers Set command message handler", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPApplication_destroy(application);
+    TEST_ASSERT("IoTPApplication_setEventHandlers Destroy a valid application handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPApplication_setEventHandlers Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+/* Tests: Topic trie used to resolve handler of a topic */
+int testApplication_topicTrie(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPTopicTrie trie;
+    char *topic = NULL;
+    int value = 0;
+
+    memset(&trie, 0, sizeof(trie));
+    rc = iotp_trie_insert(&trie, NULL, 1);
+    TEST_ASSERT("iotp_trie_insert: NULL filter", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    value = iotp_trie_match(&trie, "iot-2/type/sensor/id/dev1/evt/status/fmt/json", 45);
+    TEST_ASSERT("iotp_trie_match: Empty trie", value == 0, "expected=%d actual=%d", 0, value);
+
+    /* Value is the order in which handler is added - the first handler added wins */
+    rc = iotp_trie_insert(&trie, "iot-2/type/sensor/id/dev1/evt/status/fmt/json", 1);
+    TEST_ASSERT("iotp_trie_insert: Add device filter", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = iotp_trie_insert(&trie, "iot-2/type/sensor/id/+/evt/+/fmt/json", 2);
+    TEST_ASSERT("iotp_trie_insert: Add + filter", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = iotp_trie_insert(&trie, "iot-2/type/sensor/#", 3);
+    TEST_ASSERT("iotp_trie_insert: Add # filter", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = iotp_trie_insert(&trie, "#", 4);
+    TEST_ASSERT("iotp_trie_insert: Add catch-all filter", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = iotp_trie_insert(&trie, "iot-2/type/sensor/id/dev1/evt/status/fmt/json", 5);
+    TEST_ASSERT("iotp_trie_insert: Add device filter again", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    topic = "iot-2/type/sensor/id/dev1/evt/status/fmt/json";
+    value = iotp_trie_match(&trie, topic, strlen(topic));
+    TEST_ASSERT("iotp_trie_match: Device filter wins over wild cards", value == 1, "expected=%d actual=%d", 1, value);
+    topic = "iot-2/type/sensor/id/dev2/evt/status/fmt/json";
+    value = iotp_trie_match(&trie, topic, strlen(topic));
+    TEST_ASSERT("iotp_trie_match: + filter wins over # filters", value == 2, "expected=%d actual=%d", 2, value);
+    topic = "iot-2/type/sensor/id/dev2/evt/status/fmt/xml";
+    value = iotp_trie_match(&trie, topic, strlen(topic));
+    TEST_ASSERT("iotp_trie_match: # filter matches remaining levels", value == 3, "expected=%d actual=%d", 3, value);
+    topic = "iot-2/type/sensor";
+    value = iotp_trie_match(&trie, topic, strlen(topic));
+    TEST_ASSERT("iotp_trie_match: # filter matches parent level", value == 3, "expected=%d actual=%d", 3, value);
+    topic = "iot-2/type/gateway/id/gw1/evt/status/fmt/json";
+    value = iotp_trie_match(&trie, topic, strlen(topic));
+    TEST_ASSERT("iotp_trie_match: Catch-all filter", value == 4, "expected=%d actual=%d", 4, value);
+    topic = "iot-2/type/sensor/id/dev1/evt/status/fmt/json/extra";
+    value = iotp_trie_match(&trie, topic, 45);
+    TEST_ASSERT("iotp_trie_match: Topic length is honoured", value == 1, "expected=%d actual=%d", 1, value);
+
+    /* Without catch-all filter, a topic of other type is not matched */
+    iotp_trie_free(&trie);
+    memset(&trie, 0, sizeof(trie));
+    rc = iotp_trie_insert(&trie, "iot-2/type/sensor/id/+/evt/+/fmt/json", 1);
+    TEST_ASSERT("iotp_trie_insert: Add + filter to new trie", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    topic = "iot-2/type/gateway/id/gw1/evt/status/fmt/json";
+    value = iotp_trie_match(&trie, topic, strlen(topic));
+    TEST_ASSERT("iotp_trie_match: Unmatched topic", value == 0, "expected=%d actual=%d", 0, value);
+    topic = "iot-2/type/sensor/id/dev1/evt/status";
+    value = iotp_trie_match(&trie, topic, strlen(topic));
+    TEST_ASSERT("iotp_trie_match: Shorter topic is not matched", value == 0, "expected=%d actual=%d", 0, value);
+    iotp_trie_free(&trie);
+
+    return IOTPRC_SUCCESS;
+}
+
+void eventBatchHandler(const IoTPMessage *messages, int count, void *context)
+{
+    fprintf(stdout, "Received batch of events: count=%d\n", count);
+}
+
+/* Tests: Application group */
+int testApplication_groupVal(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPApplicationGroup *group = NULL;
+    IoTPApplication *application = NULL;
+    int connections = 0;
+
+    rc = IoTPApplicationGroup_create(&group, NULL, 2);
+    TEST_ASSERT("IoTPApplication_groupVal Create group with NULL config", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    rc = IoTPConfig_create(&config, "./wiotpapp.yaml");
+    TEST_ASSERT("IoTPApplication_groupVal Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPApplicationGroup_create(&group, config, -1);
+    TEST_ASSERT("IoTPApplication_groupVal Create group with connections=-1", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+    rc = IoTPApplicationGroup_create(&group, config, IOTP_MAX_GROUP_CONNECTIONS + 1);
+    TEST_ASSERT("IoTPApplication_groupVal Create group with too many connections", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+    rc = IoTPApplicationGroup_create(&group, config, 3);
+    TEST_ASSERT("IoTPApplication_groupVal Create group with 3 connections", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPApplicationGroup_getConnections(group, &connections);
+    TEST_ASSERT("IoTPApplication_groupVal Get connections", rc == IOTPRC_SUCCESS && connections == 3, "connections=%d rcA=%d", connections, rc);
+    rc = IoTPApplicationGroup_getApplication(group, 3, &application);
+    TEST_ASSERT("IoTPApplication_groupVal Get application with invalid index", rc == IOTPRC_NOT_FOUND, "rcE=%d rcA=%d", IOTPRC_NOT_FOUND, rc);
+    rc = IoTPApplicationGroup_getApplication(group, 2, &application);
+    TEST_ASSERT("IoTPApplication_groupVal Get application", rc == IOTPRC_SUCCESS && application != NULL, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPApplicationGroup_setEventMessageHandler(group, commandMessageHandler, NULL, "+", "+", "+", "+");
+    TEST_ASSERT("IoTPApplication_groupVal Set event message handler", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPApplicationGroup_setEventBatchHandler(group, eventBatchHandler, NULL, "type1", "+", "+", "json");
+    TEST_ASSERT("IoTPApplication_groupVal Set event batch handler", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPApplicationGroup_subscribeToEvents(group, "+", "+", "+", "+");
+    TEST_ASSERT("IoTPApplication_groupVal Subscribe to events", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPApplicationGroup_destroy(group);
+    TEST_ASSERT("IoTPApplication_groupVal Destroy group", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPApplication_groupVal Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
 int main(void)
 {
     int rc = 0;
-    int (*tests[])() = {testApplication_create, testApplication_setMQTTLogHandler, testApplication_sendEventVal, testApplication_connect, testApplication_sendEvent};
+    int (*tests[])() = {testApplication_create, testApplication_setMQTTLogHandler, testApplication_sendEventVal, testApplication_sendEventBufferVal, testApplication_prepareTopicVal, testApplication_sendCommandRequestVal, testApplication_setEventHandlers, testApplication_topicTrie, testApplication_groupVal, testApplication_connect, testApplication_sendEvent};
     int i;
     int count = (int)TEST_COUNT(tests);
 
@@ -18,6 +18,7 @@
 
 #include "test_utils.h"
 #include "iotp_config.h"
+#include "iotp_internal.h"
 
 /*
  * validateConfig_tests.c: IBM Watson IoT Platform C Client Configuration API validation tests
@@ -303,6 +304,123 @@ int testConfig_setProperty(void)
     rc = IoTPConfig_setProperty(config, "auth.token", "dev1");
     TEST_ASSERT("IoTPConfig_setProperty: auth.token is valid", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
 
+    rc = IoTPConfig_setProperty(config, "options.mqtt.maxInflight", "xxxx");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.maxInflight is invalid", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.maxInflight", "-1");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.maxInflight is negative", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.maxInflight", "100");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.maxInflight is valid", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.maxBufferedBytes", "-1");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.maxBufferedBytes is negative", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.maxBufferedBytes", "1048576");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.maxBufferedBytes is valid", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.publishTimeout", "xxxx");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.publishTimeout is invalid", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.publishTimeout", "0");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.publishTimeout is valid", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.persistence.path", "./persist");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.persistence.path is valid", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.persistence.maxBytes", "-1");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.persistence.maxBytes is negative", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.persistence.maxBytes", "10485760");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.persistence.maxBytes is valid", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.persistence.sync", "xxxx");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.persistence.sync is invalid", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.persistence.sync", "false");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.persistence.sync is valid", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.compression", "xxxx");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.compression is invalid", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.compression", "deflate");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.compression is valid", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.compressionMinSize", "-1");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.compressionMinSize is negative", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.coalesceWindow", "-1");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.coalesceWindow is negative", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.coalesceWindow", "100");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.coalesceWindow is valid", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.coalesceMaxBytes", "0");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.coalesceMaxBytes is zero", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.rateLimit", "-1");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.rateLimit is negative", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.rateLimit", "100");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.rateLimit is valid", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.deviceRateLimit", "xxxx");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.deviceRateLimit is invalid", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.rateLimitTimeout", "1000");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.rateLimitTimeout is valid", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.controlMaxInflight", "-1");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.controlMaxInflight is negative", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.submitQueueSize", "-1");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.submitQueueSize is negative", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.submitQueueSize", "1024");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.submitQueueSize is valid", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.topicAliasMaximum", "-1");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.topicAliasMaximum is negative", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.topicAliasMaximum", "65536");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.topicAliasMaximum is too large", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.deltaHeartbeat", "-1");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.deltaHeartbeat is negative", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.deltaDeadband", "abc");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.deltaDeadband is not a number", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.deltaDeadband", "0.25");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.deltaDeadband is valid", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.cborTranscode", "yes");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.cborTranscode is not a boolean", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.dispatchWorkers", "33");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.dispatchWorkers is too large", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.dispatchWorkers", "4");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.dispatchWorkers is valid", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.inboundQueueSize", "-1");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.inboundQueueSize is negative", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.inboundOverflow", "drop");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.inboundOverflow is not a policy", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.inboundOverflow", "dropOldest");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.inboundOverflow is valid", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.batchSize", "4097");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.batchSize is too large", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.batchSize", "64");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.batchSize is valid", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPConfig_setProperty(config, "options.mqtt.batchWait", "-1");
+    TEST_ASSERT("IoTPConfig_setProperty: options.mqtt.batchWait is negative", rc == IOTPRC_PARAM_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_PARAM_INVALID_VALUE, rc);
+
     return rc;
 }
 
@@ -377,11 +495,343 @@ int testConfig_readEnvironment(void)
 }
 
 
+/* Tests: JSON writer */
+int testUtils_jsonWriter(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    char buffer[16];
+    IoTPJsonWriter json;
+    const char *out = NULL;
+    size_t len = 0;
+    int i;
+
+    /* starts in caller buffer, and moves to heap buffer when it is full */
+    rc = IoTPJsonWriter_init(&json, buffer, sizeof(buffer));
+    TEST_ASSERT("IoTPJsonWriter_init: Initialize writer", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    IoTPJsonWriter_beginObject(&json, NULL);
+    IoTPJsonWriter_addString(&json, "s", "a\"b\\c\n\x01");
+    IoTPJsonWriter_addInt(&json, "i", -1234567890123LL);
+    IoTPJsonWriter_addDouble(&json, "d", 0.1);
+    IoTPJsonWriter_addDouble(&json, "w", 42.0);
+    IoTPJsonWriter_beginArray(&json, "a");
+    IoTPJsonWriter_addBool(&json, NULL, 1);
+    IoTPJsonWriter_addNull(&json, NULL);
+    IoTPJsonWriter_addRaw(&json, NULL, "{}");
+    IoTPJsonWriter_endArray(&json);
+    IoTPJsonWriter_endObject(&json);
+    rc = IoTPJsonWriter_getString(&json, &out, &len);
+    TEST_ASSERT("IoTPJsonWriter_getString: Get payload", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = strcmp(out, "{\"s\":\"a\\\"b\\\\c\\n\\u0001\",\"i\":-1234567890123,\"d\":0.1,\"w\":42,\"a\":[true,null,{}]}");
+    TEST_ASSERT("IoTPJsonWriter_getString: Verify payload", rc == 0, "payload=%s", out);
+    TEST_ASSERT("IoTPJsonWriter_getString: Verify length", len == strlen(out), "expected=%d actual=%d", (int)strlen(out), (int)len);
+
+    /* reset reuses the buffer */
+    rc = IoTPJsonWriter_reset(&json);
+    TEST_ASSERT("IoTPJsonWriter_reset: Reset writer", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    IoTPJsonWriter_beginArray(&json, NULL);
+    for (i = 0; i < 3; i++)
+        IoTPJsonWriter_addInt(&json, NULL, i * 100);
+    IoTPJsonWriter_endArray(&json);
+    rc = IoTPJsonWriter_getString(&json, &out, NULL);
+    TEST_ASSERT("IoTPJsonWriter_getString: Get payload after reset", rc == IOTPRC_SUCCESS && !strcmp(out, "[0,100,200]"), "rc=%d payload=%s", rc, out ? out : "");
+
+    /* errors */
+    IoTPJsonWriter_reset(&json);
+    IoTPJsonWriter_beginObject(&json, NULL);
+    rc = IoTPJsonWriter_addInt(&json, NULL, 1);
+    TEST_ASSERT("IoTPJsonWriter_addInt: Object member without name", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    rc = IoTPJsonWriter_endObject(&json);
+    TEST_ASSERT("IoTPJsonWriter_endObject: Error is sticky", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    IoTPJsonWriter_reset(&json);
+    IoTPJsonWriter_beginObject(&json, NULL);
+    rc = IoTPJsonWriter_getString(&json, &out, NULL);
+    TEST_ASSERT("IoTPJsonWriter_getString: Object is not closed", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+    rc = IoTPJsonWriter_endArray(&json);
+    TEST_ASSERT("IoTPJsonWriter_endArray: Array is not open", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+
+    rc = IoTPJsonWriter_free(&json);
+    TEST_ASSERT("IoTPJsonWriter_free: Free writer", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    return rc;
+}
+
+int testUtils_cbor(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    const char *json = "{\"s\":\"abc\",\"i\":-5,\"l\":12345678901,\"d\":1.5,\"a\":[true,false,null,{}]}";
+    /* {"a": h'0102', 1: 1.0 (half), "n": undefined} with indefinite length map */
+    unsigned char cborIn[] = { 0xbf, 0x61, 'a', 0x42, 0x01, 0x02, 0x01, 0xf9, 0x3c, 0x00, 0x61, 'n', 0xf7, 0xff };
+    unsigned char cborBad[] = { 0xa1, 0x61 };
+    unsigned char *tags = NULL;
+    size_t ntags = 1000000;
+    IoTP_json_parse_t *pobj = NULL;
+    void *cbor = NULL;
+    size_t cborlen = 0;
+    char *out = NULL;
+    size_t outlen = 0;
+    char *msg = NULL;
+
+    /* JSON to CBOR, and back */
+    rc = iotp_cbor_fromJson(json, strlen(json), &cbor, &cborlen);
+    TEST_ASSERT("iotp_cbor_fromJson: Encode JSON", rc == IOTPRC_SUCCESS && cborlen > 0 && cborlen < strlen(json), "rc=%d len=%d", rc, (int)cborlen);
+    TEST_ASSERT("iotp_cbor_fromJson: Map header", cbor && ((unsigned char *)cbor)[0] == 0xa5, "byte=%x", cbor ? ((unsigned char *)cbor)[0] : 0);
+    rc = iotp_cbor_toJson(cbor, cborlen, &out, &outlen);
+    TEST_ASSERT("iotp_cbor_toJson: Decode CBOR", rc == IOTPRC_SUCCESS && !strcmp(out, json) && outlen == strlen(json), "rc=%d json=%s", rc, out ? out : "");
+    iotp_utils_freePtr(out);
+    out = NULL;
+
+    /* same entries as JSON parser */
+    msg = (char *)malloc(cborlen);
+    memcpy(msg, cbor, cborlen);
+    pobj = iotp_cbor_init((int)cborlen, msg);
+    TEST_ASSERT("iotp_cbor_init: Parse CBOR", pobj != NULL, "pobj=%p", pobj);
+    if ( pobj ) {
+        TEST_ASSERT("iotp_json_getString: CBOR text", !strcmp(iotp_json_getString(pobj, "s"), "abc"), "s=%s", iotp_json_getString(pobj, "s"));
+        TEST_ASSERT("iotp_json_getInt: CBOR integer", iotp_json_getInt(pobj, "i", 0) == -5, "i=%d", iotp_json_getInt(pobj, "i", 0));
+        TEST_ASSERT("iotp_json_getNumber: CBOR float", iotp_json_getNumber(pobj, "d", 0) == 1.5, "d=%g", iotp_json_getNumber(pobj, "d", 0));
+        iotp_json_free(pobj);
+    }
+    free(msg);
+    iotp_utils_freePtr(cbor);
+
+    /* byte strings are base64url, keys are text, undefined is null */
+    rc = iotp_cbor_toJson(cborIn, sizeof(cborIn), &out, &outlen);
+    TEST_ASSERT("iotp_cbor_toJson: Decode CBOR types", rc == IOTPRC_SUCCESS && !strcmp(out, "{\"a\":\"AQI\",\"1\":1,\"n\":null}"), "rc=%d json=%s", rc, out ? out : "");
+    iotp_utils_freePtr(out);
+    out = NULL;
+
+    /* errors */
+    rc = iotp_cbor_toJson(cborBad, sizeof(cborBad), &out, &outlen);
+    TEST_ASSERT("iotp_cbor_toJson: Truncated CBOR", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+    rc = iotp_cbor_fromJson("{\"a\":", 5, &cbor, &cborlen);
+    TEST_ASSERT("iotp_cbor_fromJson: Invalid JSON", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+
+    /* a long chain of tags in an array does not recurse */
+    tags = (unsigned char *)malloc(ntags + 2);
+    tags[0] = 0x81;
+    memset(tags + 1, 0xc6, ntags);
+    tags[ntags + 1] = 0xa0;
+    rc = iotp_cbor_toJson(tags, ntags + 1, &out, &outlen);
+    TEST_ASSERT("iotp_cbor_toJson: Chain of tags without item", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+    rc = iotp_cbor_toJson(tags, ntags + 2, &out, &outlen);
+    TEST_ASSERT("iotp_cbor_toJson: Tagged item", rc == IOTPRC_SUCCESS && out && !strcmp(out, "[{}]"), "rc=%d json=%s", rc, out ? out : "");
+    iotp_utils_freePtr(out);
+    out = NULL;
+    free(tags);
+
+    return IOTPRC_SUCCESS;
+}
+
+int testUtils_topicParse(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPMessage msg;
+    const char *cmdTopic = "iot-2/cmd/reboot/fmt/json";
+    const char *devTopic = "iot-2/type/gwType/id/dev1/cmd/update/fmt/cbor";
+
+    /* device command */
+    iotp_topic_parse(cmdTopic, strlen(cmdTopic), &msg);
+    TEST_ASSERT("iotp_topic_parse: Command topic has no type and id", msg.type == NULL && msg.typeLen == 0 && msg.id == NULL && msg.idLen == 0, "type=%p id=%p", msg.type, msg.id);
+    rc = (msg.commandLen == 6 && !strncmp(msg.command, "reboot", 6) && msg.command == cmdTopic + 10) ? 0 : 1;
+    TEST_ASSERT("iotp_topic_parse: Command is a slice of the topic", rc == 0, "command=%.*s", (int)msg.commandLen, msg.command ? msg.command : "");
+    rc = (msg.formatLen == 4 && !strncmp(msg.format, "json", 4)) ? 0 : 1;
+    TEST_ASSERT("iotp_topic_parse: Command format", rc == 0, "format=%.*s", (int)msg.formatLen, msg.format ? msg.format : "");
+
+    /* gateway device command - topic length excludes trailing bytes */
+    iotp_topic_parse(devTopic, strlen(devTopic) - 2, &msg);
+    rc = (msg.typeLen == 6 && !strncmp(msg.type, "gwType", 6) && msg.idLen == 4 && !strncmp(msg.id, "dev1", 4)) ? 0 : 1;
+    TEST_ASSERT("iotp_topic_parse: Device type and id", rc == 0, "type=%.*s id=%.*s", (int)msg.typeLen, msg.type, (int)msg.idLen, msg.id);
+    rc = (msg.commandLen == 6 && !strncmp(msg.command, "update", 6) && msg.formatLen == 2 && !strncmp(msg.format, "cb", 2)) ? 0 : 1;
+    TEST_ASSERT("iotp_topic_parse: Device command and format", rc == 0, "command=%.*s format=%.*s", (int)msg.commandLen, msg.command, (int)msg.formatLen, msg.format);
+
+    /* short topic */
+    iotp_topic_parse("iot-2/app/myApp/mon", 19, &msg);
+    TEST_ASSERT("iotp_topic_parse: Missing levels are not set", msg.typeLen == 5 && msg.id == NULL && msg.command == NULL && msg.format == NULL, "typeLen=%d", (int)msg.typeLen);
+
+    return IOTPRC_SUCCESS;
+}
+
+
+/* Returns 1 if segment file of persistent store exists */
+static int persistSegmentExists(const char *dir, int id)
+{
+    char path[256];
+
+    snprintf(path, sizeof(path), "%s/seg-%08u.log", dir, (unsigned int)id);
+    return access(path, F_OK) == 0;
+}
+
+int testUtils_persist(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    MQTTClient_persistence persistence;
+    void *handle = NULL;
+    const char *dir = "./persist_unit/unitClient";
+    char path[256];
+    char key[16];
+    char data[1000];
+    char *buffers[1] = { data };
+    int buflens[1] = { sizeof(data) };
+    char **keys = NULL;
+    int nkeys = 0;
+    char *buffer = NULL;
+    int buflen = 0;
+    unsigned char hdr[16];
+    long off = 0;
+    long last = -1;
+    FILE *fp = NULL;
+    int count = 40;
+    int inOrder = 1;
+    int i;
+
+    /* 16KB segments - records of 1KB fill three segments */
+    rc = iotp_persist_init(&persistence, "./persist_unit", 131072, 0);
+    TEST_ASSERT("iotp_persist_init: Configure store", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    if ( rc != IOTPRC_SUCCESS )
+        return rc;
+    rc = persistence.popen(&handle, "unitClient", "ssl://localhost:8883", persistence.context);
+    TEST_ASSERT("iotp_persist: Open store", rc == 0, "rcE=%d rcA=%d", 0, rc);
+    for (i = 0; i < count && rc == 0; i++) {
+        snprintf(key, sizeof(key), "s-%d", i);
+        memset(data, 'a' + i % 26, sizeof(data));
+        rc = persistence.pput(handle, key, 1, buffers, buflens);
+    }
+    TEST_ASSERT("iotp_persist: Append records", rc == 0, "rcE=%d rcA=%d", 0, rc);
+    persistence.pclose(handle);
+    TEST_ASSERT("iotp_persist: Records span segments", persistSegmentExists(dir, 0) && persistSegmentExists(dir, 1) && persistSegmentExists(dir, 2) && !persistSegmentExists(dir, 3), "dir=%s", dir);
+
+    /* corrupt data of the last committed record of the last segment */
+    snprintf(path, sizeof(path), "%s/seg-%08u.log", dir, 2u);
+    fp = fopen(path, "r+b");
+    TEST_ASSERT("iotp_persist: Open last segment", fp != NULL, "path=%s", path);
+    if ( fp ) {
+        for (;;) {
+            uint32_t commit, datalen;
+            uint16_t keylen;
+            if ( fseek(fp, off, SEEK_SET) != 0 || fread(hdr, 1, sizeof(hdr), fp) != sizeof(hdr) )
+                break;
+            memcpy(&commit, hdr, 4);
+            memcpy(&keylen, hdr + 6, 2);
+            memcpy(&datalen, hdr + 8, 4);
+            if ( commit != 0x49505331 || keylen == 0 )
+                break;
+            last = off + (long)sizeof(hdr) + keylen;
+            off += (long)((sizeof(hdr) + keylen + datalen + 7) & ~(size_t)7);
+        }
+        if ( last >= 0 ) {
+            fseek(fp, last, SEEK_SET);
+            fputc('#', fp);
+        }
+        fclose(fp);
+    }
+    TEST_ASSERT("iotp_persist: Find last record", last > 0, "offset=%ld", last);
+
+    /* torn record is discarded, the rest are replayed in order */
+    rc = persistence.popen(&handle, "unitClient", "ssl://localhost:8883", persistence.context);
+    TEST_ASSERT("iotp_persist: Reopen store", rc == 0, "rcE=%d rcA=%d", 0, rc);
+    rc = persistence.pkeys(handle, &keys, &nkeys);
+    TEST_ASSERT("iotp_persist: Replay all but the corrupted record", rc == 0 && nkeys == count - 1, "countE=%d countA=%d", count - 1, nkeys);
+    for (i = 0; i < nkeys; i++) {
+        snprintf(key, sizeof(key), "s-%d", i);
+        if ( strcmp(keys[i], key) )
+            inOrder = 0;
+        free(keys[i]);
+    }
+    iotp_utils_freePtr((void *)keys);
+    TEST_ASSERT("iotp_persist: Records are replayed in order", inOrder == 1, "inOrder=%d", inOrder);
+    rc = persistence.pget(handle, "s-38", &buffer, &buflen);
+    TEST_ASSERT("iotp_persist: Get replayed record", rc == 0 && buflen == sizeof(data) && buffer[0] == 'a' + 38 % 26, "rc=%d len=%d", rc, buflen);
+    iotp_utils_freePtr((void *)buffer);
+    rc = persistence.pget(handle, "s-39", &buffer, &buflen);
+    TEST_ASSERT("iotp_persist: Corrupted record is not found", rc != 0, "rc=%d", rc);
+
+    /* acknowledged records of the oldest segments are deleted with their segments */
+    for (i = 0; i < 30; i++) {
+        snprintf(key, sizeof(key), "s-%d", i);
+        persistence.premove(handle, key);
+    }
+    TEST_ASSERT("iotp_persist: Acknowledged head segments are deleted", !persistSegmentExists(dir, 0) && !persistSegmentExists(dir, 1) && persistSegmentExists(dir, 2), "dir=%s", dir);
+    for (i = 30; i < count - 1; i++) {
+        snprintf(key, sizeof(key), "s-%d", i);
+        persistence.premove(handle, key);
+    }
+    persistence.pclose(handle);
+    iotp_persist_free(&persistence);
+    TEST_ASSERT("iotp_persist: Empty store is deleted", access(dir, F_OK) != 0, "dir=%s", dir);
+    rmdir("./persist_unit");
+
+    return IOTPRC_SUCCESS;
+}
+
+/* dispatch handler that waits till the test releases it */
+static pthread_mutex_t dispatchLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dispatchCond = PTHREAD_COND_INITIALIZER;
+static int dispatchHold = 0;
+static int dispatchCount = 0;
+
+static void dispatchHandler(void *context, IoTPDispatchEntry *entries, int count)
+{
+    pthread_mutex_lock(&dispatchLock);
+    while ( dispatchHold )
+        pthread_cond_wait(&dispatchCond, &dispatchLock);
+    dispatchCount += count;
+    pthread_mutex_unlock(&dispatchLock);
+}
+
+int testUtils_dispatchBlock(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPDispatcher dispatcher;
+    IoTPStats stats;
+    const char *topic = "iot-2/type/devType/id/dev1/evt/status/fmt/json";
+    uint64_t start = 0;
+    uint64_t elapsed = 0;
+    int i;
+
+    memset(&dispatcher, 0, sizeof(dispatcher));
+    dispatchHold = 1;
+    dispatchCount = 0;
+    rc = iotp_dispatch_init(&dispatcher, 1, 2, IoTPInboundOverflow_block, 1, 0, dispatchHandler, NULL);
+    TEST_ASSERT("iotp_dispatch_init: Start one worker", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    if ( rc != IOTPRC_SUCCESS )
+        return rc;
+
+    /* handler holds the first message, the next two fill the queue */
+    for (i = 0; i < 3; i++) {
+        rc = iotp_dispatch_enqueue(&dispatcher, topic, 0, "{}", 2, 1, 0, NULL);
+        TEST_ASSERT("iotp_dispatch_enqueue: Queue message", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+        while ( i == 0 && dispatcher.workers[0].queued > 0 )
+            usleep(1000);
+    }
+
+    /* queue is full - receiving thread waits, and the message is returned */
+    start = iotp_utils_timeMicros();
+    rc = iotp_dispatch_enqueue(&dispatcher, topic, 0, "{}", 2, 1, 0, NULL);
+    elapsed = iotp_utils_timeMicros() - start;
+    TEST_ASSERT("iotp_dispatch_enqueue: Full queue", rc == IOTPRC_WOULDBLOCK, "rcE=%d rcA=%d", IOTPRC_WOULDBLOCK, rc);
+    TEST_ASSERT("iotp_dispatch_enqueue: Waits for space", elapsed >= 90000, "elapsed=%d", (int)elapsed);
+    iotp_dispatch_getStats(&dispatcher, &stats);
+    TEST_ASSERT("iotp_dispatch_getStats: Blocked", stats.inboundBlocked >= 1, "blocked=%d", (int)stats.inboundBlocked);
+
+    /* space is made while the receiving thread waits */
+    pthread_mutex_lock(&dispatchLock);
+    dispatchHold = 0;
+    pthread_cond_broadcast(&dispatchCond);
+    pthread_mutex_unlock(&dispatchLock);
+    rc = iotp_dispatch_enqueue(&dispatcher, topic, 0, "{}", 2, 1, 0, NULL);
+    TEST_ASSERT("iotp_dispatch_enqueue: Queue message after space is made", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    iotp_dispatch_stop(&dispatcher);
+    TEST_ASSERT("iotp_dispatch_stop: Queued messages are processed", dispatchCount == 4, "countE=4 countA=%d", dispatchCount);
+
+    return IOTPRC_SUCCESS;
+}
+
 
 int main(void)
 {
     int rc = 0;
-    int (*tests[])() = {testConfig_setLogHandle, testConfig_create, testConfig_clear, testConfig_setProperty, testConfig_readConfigFile, testConfig_readEnvironment};
+    int (*tests[])() = {testConfig_setLogHandle, testConfig_create, testConfig_clear, testConfig_setProperty, testConfig_readConfigFile, testConfig_readEnvironment, testUtils_jsonWriter, testUtils_cbor, testUtils_topicParse, testUtils_dispatchBlock, testUtils_persist};
     int i;
     int count = (int)TEST_COUNT(tests);
 
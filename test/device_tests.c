@@ -16,6 +16,7 @@
  *
  *******************************************************************************/
 
+#include <sys/stat.h>
 #include "test_utils.h"
 #include "iotp_config.h"
 #include "iotp_device.h"
@@ -30,6 +31,7 @@
  * - IoTPDevice_connect
  * - IoTPDevice_disconnect
  * - IoTPDevice_sendEvent
+ * - IoTPDevice_sendEventBuffer
  * - IoTPDevice_setCommandsHandler
  * - IoTPDevice_subscribeToCommands
  * - IoTPDevice_handleCommand
@@ -48,6 +50,28 @@ void logCallback (int level, char * message)
     logCallbackActive = 1;
 }
 
+int bufferReleased = 0;
+void bufferReleaseCallback (void *buffer, size_t bufferlen, void *context)
+{
+    fprintf(stdout, "Buffer released: len=%d context=%s\n", (int)bufferlen, context? (char *)context:"NULL");
+    fflush(stdout);
+    bufferReleased += 1;
+}
+
+int deliveryCount = 0;
+int deliveryFailed = 0;
+int deliveryTokenSum = 0;
+void deliveryCallback (IoTPDeliveryInfo *info, void *context)
+{
+    fprintf(stdout, "Delivery complete: token=%d rc=%d latency=%llu context=%s\n", info->token, info->rc,
+        (unsigned long long)(info->ackTime - info->submitTime), context? (char *)context:"NULL");
+    fflush(stdout);
+    deliveryCount += 1;
+    deliveryTokenSum += info->token;
+    if ( info->rc != IOTPRC_SUCCESS || info->ackTime < info->submitTime )
+        deliveryFailed += 1;
+}
+
 void MQTTTraceCallback (int level, char * message)
 {
     fprintf(stdout, "level=%d: %s\n", level, message? message:"NULL");
@@ -210,10 +234,483 @@ int testDevice_sendEvent(void)
     return rc;
 }
 
+/* Tests: Device send event using payload buffer */
+int testDevice_sendEventBuffer(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPDevice *device = NULL;
+    unsigned char data[] = { 0xA1, 0x64, 0x74, 0x65, 0x6D, 0x70, 0x00, 0x18, 0x2A };
+
+    rc = IoTPDevice_sendEventBuffer(NULL, "status", data, sizeof(data), "cbor", QoS0, NULL, NULL, NULL);
+    TEST_ASSERT("IoTPDevice_sendEventBuffer: Invalid device object", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+
+    rc = IoTPConfig_create(&config, "./wiotpdev.yaml");
+    TEST_ASSERT("IoTPDevice_sendEventBuffer: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    IoTPConfig_readEnvironment(config);
+    rc = IoTPDevice_create(&device, config);
+    TEST_ASSERT("IoTPDevice_sendEventBuffer: Create device with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPDevice_sendEventBuffer(device, "status", NULL, sizeof(data), "cbor", QoS0, NULL, NULL, NULL);
+    TEST_ASSERT("IoTPDevice_sendEventBuffer: NULL buffer with non-zero length", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    rc = IoTPDevice_sendEventBuffer(device, "status", data, sizeof(data), NULL, QoS0, NULL, NULL, NULL);
+    TEST_ASSERT("IoTPDevice_sendEventBuffer: Invalid format", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    rc = IoTPDevice_sendEventBuffer(device, "status", data, sizeof(data), "cbor", 3, NULL, NULL, NULL);
+    TEST_ASSERT("IoTPDevice_sendEventBuffer: Invalid QoS=3", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+    rc = IoTPDevice_sendEventBuffer(device, "status", data, sizeof(data), "cbor", QoS0, NULL, &bufferReleaseCallback, "notconnected");
+    TEST_ASSERT("IoTPDevice_sendEventBuffer: Send when not connected", rc == IOTPRC_NOT_CONNECTED, "rcE=%d rcA=%d", IOTPRC_NOT_CONNECTED, rc);
+    TEST_ASSERT("IoTPDevice_sendEventBuffer: Buffer is not released on error", bufferReleased == 0, "rcE=%d rcA=%d", 0, bufferReleased);
+
+    rc = IoTPDevice_connect(device);
+    TEST_ASSERT("IoTPDevice_sendEventBuffer: Connect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_sendEventBuffer(device, "status", data, sizeof(data), "cbor", QoS1, NULL, &bufferReleaseCallback, "sent");
+    TEST_ASSERT("IoTPDevice_sendEventBuffer: Send binary event QoS1", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    sleep(2);
+    TEST_ASSERT("IoTPDevice_sendEventBuffer: Buffer is released on completion", bufferReleased == 1, "rcE=%d rcA=%d", 1, bufferReleased);
+
+    rc = IoTPDevice_disconnect(device);
+    TEST_ASSERT("IoTPDevice_sendEventBuffer: Disconnect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_destroy(device);
+    TEST_ASSERT("IoTPDevice_sendEventBuffer: Destroy a valid device handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPDevice_sendEventBuffer: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+int testDevice_prepareEventTopic(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPDevice *device = NULL;
+    IoTPTopic *topic = NULL;
+    char *data = "{\"d\" : {\"SensorID\": \"Test\", \"Reading\": 7 }}";
+
+    rc = IoTPDevice_prepareEventTopic(NULL, "status", "json", &topic);
+    TEST_ASSERT("IoTPDevice_prepareEventTopic: Invalid device object", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    rc = IoTPTopic_publish(NULL, data, strlen(data), QoS0, NULL);
+    TEST_ASSERT("IoTPDevice_prepareEventTopic: Publish with invalid topic object", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+
+    rc = IoTPConfig_create(&config, "./wiotpdev.yaml");
+    TEST_ASSERT("IoTPDevice_prepareEventTopic: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    IoTPConfig_readEnvironment(config);
+    rc = IoTPDevice_create(&device, config);
+    TEST_ASSERT("IoTPDevice_prepareEventTopic: Create device with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPDevice_prepareEventTopic(device, "status/+", "json", &topic);
+    TEST_ASSERT("IoTPDevice_prepareEventTopic: Invalid event id", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+    rc = IoTPDevice_prepareEventTopic(device, "status", "json", &topic);
+    TEST_ASSERT("IoTPDevice_prepareEventTopic: Prepare event topic", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = strcmp(IoTPTopic_getString(topic), "iot-2/evt/status/fmt/json");
+    TEST_ASSERT("IoTPDevice_prepareEventTopic: Topic string", rc == 0, "rcE=%d rcA=%d", 0, rc);
+    rc = IoTPTopic_publish(topic, data, strlen(data), QoS0, NULL);
+    TEST_ASSERT("IoTPDevice_prepareEventTopic: Publish when not connected", rc == IOTPRC_NOT_CONNECTED, "rcE=%d rcA=%d", IOTPRC_NOT_CONNECTED, rc);
+
+    rc = IoTPDevice_connect(device);
+    TEST_ASSERT("IoTPDevice_prepareEventTopic: Connect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPTopic_publish(topic, data, strlen(data), 3, NULL);
+    TEST_ASSERT("IoTPDevice_prepareEventTopic: Invalid QoS=3", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+    rc = IoTPTopic_publish(topic, data, strlen(data), QoS1, NULL);
+    TEST_ASSERT("IoTPDevice_prepareEventTopic: Publish event QoS1", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPTopic_publish(topic, data, strlen(data), QoS1, NULL);
+    TEST_ASSERT("IoTPDevice_prepareEventTopic: Publish event again QoS1", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    sleep(2);
+
+    rc = IoTPTopic_destroy(topic);
+    TEST_ASSERT("IoTPDevice_prepareEventTopic: Destroy topic", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_disconnect(device);
+    TEST_ASSERT("IoTPDevice_prepareEventTopic: Disconnect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_destroy(device);
+    TEST_ASSERT("IoTPDevice_prepareEventTopic: Destroy a valid device handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPDevice_prepareEventTopic: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+int testDevice_sendEventWindow(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPDevice *device = NULL;
+    char *data = "{\"d\" : {\"SensorID\": \"Test\", \"Reading\": 7 }}";
+    int i;
+
+    rc = IoTPConfig_create(&config, "./wiotpdev.yaml");
+    TEST_ASSERT("IoTPDevice_sendEventWindow: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    IoTPConfig_readEnvironment(config);
+    rc = IoTPConfig_setProperty(config, "options.mqtt.maxInflight", "1");
+    TEST_ASSERT("IoTPDevice_sendEventWindow: Set maxInflight", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_setProperty(config, "options.mqtt.publishTimeout", "10000");
+    TEST_ASSERT("IoTPDevice_sendEventWindow: Set publishTimeout", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_create(&device, config);
+    TEST_ASSERT("IoTPDevice_sendEventWindow: Create device with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_connect(device);
+    TEST_ASSERT("IoTPDevice_sendEventWindow: Connect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    /* each publish waits for the previous publish to complete */
+    for (i = 0; i < 5; i++) {
+        rc = IoTPDevice_sendEvent(device, "status", data, "json", QoS1, NULL);
+        if ( rc != IOTPRC_SUCCESS )
+            break;
+    }
+    TEST_ASSERT("IoTPDevice_sendEventWindow: Send events with window of one message", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    sleep(2);
+
+    rc = IoTPDevice_disconnect(device);
+    TEST_ASSERT("IoTPDevice_sendEventWindow: Disconnect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_destroy(device);
+    TEST_ASSERT("IoTPDevice_sendEventWindow: Destroy a valid device handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPDevice_sendEventWindow: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+int testDevice_sendEventAsync(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPDevice *device = NULL;
+    char *data = "{\"d\" : {\"SensorID\": \"Test\", \"Reading\": 7 }}";
+    int token = 0;
+    int tokenSum = 0;
+    IoTPMessage command = { 0 };
+    int i;
+
+    rc = IoTPDevice_sendEventAsync(NULL, "status", data, strlen(data), "json", QoS0, NULL, &deliveryCallback, NULL, &token);
+    TEST_ASSERT("IoTPDevice_sendEventAsync: Invalid device object", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+
+    rc = IoTPConfig_create(&config, "./wiotpdev.yaml");
+    TEST_ASSERT("IoTPDevice_sendEventAsync: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    IoTPConfig_readEnvironment(config);
+    rc = IoTPDevice_create(&device, config);
+    TEST_ASSERT("IoTPDevice_sendEventAsync: Create device with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPDevice_sendEventAsync(device, "status", data, strlen(data), "json", 3, NULL, &deliveryCallback, NULL, &token);
+    TEST_ASSERT("IoTPDevice_sendEventAsync: Invalid QoS=3", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+    rc = IoTPDevice_sendEventAsync(device, "status", data, strlen(data), "json", QoS1, NULL, &deliveryCallback, "notconnected", &token);
+    TEST_ASSERT("IoTPDevice_sendEventAsync: Send when not connected", rc == IOTPRC_NOT_CONNECTED, "rcE=%d rcA=%d", IOTPRC_NOT_CONNECTED, rc);
+    rc = IoTPDevice_sendCommandResponse(device, NULL, data, strlen(data), QoS1);
+    TEST_ASSERT("IoTPDevice_sendCommandResponse: NULL command", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    command.topic = "iot-2/cmd/reboot/fmt/json";
+    command.topicLen = strlen(command.topic);
+    rc = IoTPDevice_sendCommandResponse(device, &command, data, strlen(data), QoS1);
+    TEST_ASSERT("IoTPDevice_sendCommandResponse: Command without response topic", rc == IOTPRC_NOT_FOUND, "rcE=%d rcA=%d", IOTPRC_NOT_FOUND, rc);
+
+    rc = IoTPDevice_connect(device);
+    TEST_ASSERT("IoTPDevice_sendEventAsync: Connect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    for (i = 0; i < 3; i++) {
+        token = 0;
+        rc = IoTPDevice_sendEventAsync(device, "status", data, strlen(data), "json", QoS1, NULL, &deliveryCallback, "sent", &token);
+        TEST_ASSERT("IoTPDevice_sendEventAsync: Send event QoS1", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+        tokenSum += token;
+    }
+    sleep(2);
+    TEST_ASSERT("IoTPDevice_sendEventAsync: Delivery callback is invoked for each event", deliveryCount == 3, "rcE=%d rcA=%d", 3, deliveryCount);
+    TEST_ASSERT("IoTPDevice_sendEventAsync: Delivery callback reports returned tokens", deliveryTokenSum == tokenSum, "rcE=%d rcA=%d", tokenSum, deliveryTokenSum);
+    TEST_ASSERT("IoTPDevice_sendEventAsync: Events are delivered", deliveryFailed == 0, "rcE=%d rcA=%d", 0, deliveryFailed);
+
+    rc = IoTPDevice_disconnect(device);
+    TEST_ASSERT("IoTPDevice_sendEventAsync: Disconnect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_destroy(device);
+    TEST_ASSERT("IoTPDevice_sendEventAsync: Destroy a valid device handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPDevice_sendEventAsync: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+int testDevice_persistence(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPDevice *device = NULL;
+    char *data = "{\"d\" : {\"SensorID\": \"Test\", \"Reading\": 7 }}";
+    struct stat st;
+
+    rc = IoTPConfig_create(&config, "./wiotpdev.yaml");
+    TEST_ASSERT("IoTPDevice_persistence: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    IoTPConfig_readEnvironment(config);
+    rc = IoTPConfig_setProperty(config, "options.mqtt.persistence.path", "./persist_test");
+    TEST_ASSERT("IoTPDevice_persistence: Set persistence path", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_setProperty(config, "options.mqtt.persistence.maxBytes", "1048576");
+    TEST_ASSERT("IoTPDevice_persistence: Set persistence maxBytes", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_create(&device, config);
+    TEST_ASSERT("IoTPDevice_persistence: Create device with persistence", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = stat("./persist_test", &st);
+    TEST_ASSERT("IoTPDevice_persistence: Persistence directory is created", rc == 0 && S_ISDIR(st.st_mode), "rcE=%d rcA=%d", 0, rc);
+
+    rc = IoTPDevice_connect(device);
+    TEST_ASSERT("IoTPDevice_persistence: Connect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_sendEvent(device, "status", data, "json", QoS1, NULL);
+    TEST_ASSERT("IoTPDevice_persistence: Send event QoS1", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    sleep(2);
+
+    rc = IoTPDevice_disconnect(device);
+    TEST_ASSERT("IoTPDevice_persistence: Disconnect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_destroy(device);
+    TEST_ASSERT("IoTPDevice_persistence: Destroy a valid device handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPDevice_persistence: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+int testDevice_sendEventCompressed(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPDevice *device = NULL;
+    char data[1024];
+    char *p = data;
+    int i;
+
+    for (i = 0; i < 20; i++) {
+        p += sprintf(p, "{\"SensorID\": \"Test\", \"Reading\": %d },", i);
+    }
+
+    rc = IoTPConfig_create(&config, "./wiotpdev.yaml");
+    TEST_ASSERT("IoTPDevice_sendEventCompressed: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    IoTPConfig_readEnvironment(config);
+    rc = IoTPConfig_setProperty(config, "options.mqtt.compression", "deflate");
+    TEST_ASSERT("IoTPDevice_sendEventCompressed: Set compression", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_create(&device, config);
+    TEST_ASSERT("IoTPDevice_sendEventCompressed: Create device with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_connect(device);
+    TEST_ASSERT("IoTPDevice_sendEventCompressed: Connect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPDevice_sendEvent(device, "status", data, "json", QoS0, NULL);
+    TEST_ASSERT("IoTPDevice_sendEventCompressed: Send event compressed by config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_sendEvent(device, "status", "{}", "json", QoS0, NULL);
+    TEST_ASSERT("IoTPDevice_sendEventCompressed: Send event smaller than compressionMinSize", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_sendEvent(device, "status", data, "json-deflate", QoS0, NULL);
+    TEST_ASSERT("IoTPDevice_sendEventCompressed: Send event with compressed format", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPDevice_disconnect(device);
+    TEST_ASSERT("IoTPDevice_sendEventCompressed: Disconnect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_destroy(device);
+    TEST_ASSERT("IoTPDevice_sendEventCompressed: Destroy a valid device handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPDevice_sendEventCompressed: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+int testDevice_sendEventCoalesced(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPDevice *device = NULL;
+    IoTPStats stats;
+    int i;
+
+    rc = IoTPConfig_create(&config, "./wiotpdev.yaml");
+    TEST_ASSERT("IoTPDevice_sendEventCoalesced: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    IoTPConfig_readEnvironment(config);
+    rc = IoTPConfig_setProperty(config, "options.mqtt.coalesceWindow", "100");
+    TEST_ASSERT("IoTPDevice_sendEventCoalesced: Set coalesce window", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_create(&device, config);
+    TEST_ASSERT("IoTPDevice_sendEventCoalesced: Create device with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_getStats(device, NULL);
+    TEST_ASSERT("IoTPDevice_sendEventCoalesced: Get stats with NULL argument", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    rc = IoTPDevice_connect(device);
+    TEST_ASSERT("IoTPDevice_sendEventCoalesced: Connect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    for (i = 0; i < 5; i++) {
+        rc = IoTPDevice_sendEvent(device, "status", "{\"SensorID\": \"Test\", \"Reading\": 7 }", "json", QoS0, NULL);
+        TEST_ASSERT("IoTPDevice_sendEventCoalesced: Send event", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    }
+    sleep(1);
+
+    rc = IoTPDevice_getStats(device, &stats);
+    TEST_ASSERT("IoTPDevice_sendEventCoalesced: Get stats", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    TEST_ASSERT("IoTPDevice_sendEventCoalesced: Events merged", stats.eventsMerged == 5, "expected=%d actual=%d", 5, (int)stats.eventsMerged);
+    TEST_ASSERT("IoTPDevice_sendEventCoalesced: Batches published", stats.batchesPublished >= 1, "expected>=%d actual=%d", 1, (int)stats.batchesPublished);
+
+    rc = IoTPDevice_disconnect(device);
+    TEST_ASSERT("IoTPDevice_sendEventCoalesced: Disconnect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_destroy(device);
+    TEST_ASSERT("IoTPDevice_sendEventCoalesced: Destroy a valid device handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPDevice_sendEventCoalesced: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+int testDevice_sendEventQueued(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPDevice *device = NULL;
+    IoTPStats stats;
+    int i;
+
+    rc = IoTPConfig_create(&config, "./wiotpdev.yaml");
+    TEST_ASSERT("IoTPDevice_sendEventQueued: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    IoTPConfig_readEnvironment(config);
+    rc = IoTPConfig_setProperty(config, "options.mqtt.submitQueueSize", "64");
+    TEST_ASSERT("IoTPDevice_sendEventQueued: Set submission queue size", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_create(&device, config);
+    TEST_ASSERT("IoTPDevice_sendEventQueued: Create device with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_sendEvent(device, "status", "{\"SensorID\": \"Test\", \"Reading\": 7 }", "json", QoS0, NULL);
+    TEST_ASSERT("IoTPDevice_sendEventQueued: Send event before connect", rc == IOTPRC_NOT_CONNECTED, "rcE=%d rcA=%d", IOTPRC_NOT_CONNECTED, rc);
+    rc = IoTPDevice_connect(device);
+    TEST_ASSERT("IoTPDevice_sendEventQueued: Connect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    for (i = 0; i < 10; i++) {
+        rc = IoTPDevice_sendEvent(device, "status", "{\"SensorID\": \"Test\", \"Reading\": 7 }", "json", QoS0, NULL);
+        TEST_ASSERT("IoTPDevice_sendEventQueued: Send event", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    }
+
+    /* disconnect waits for queued events to be submitted */
+    rc = IoTPDevice_disconnect(device);
+    TEST_ASSERT("IoTPDevice_sendEventQueued: Disconnect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_getStats(device, &stats);
+    TEST_ASSERT("IoTPDevice_sendEventQueued: Get stats", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    TEST_ASSERT("IoTPDevice_sendEventQueued: Events queued", stats.submitQueued == 10, "expected=%d actual=%d", 10, (int)stats.submitQueued);
+    TEST_ASSERT("IoTPDevice_sendEventQueued: Events submitted", stats.submitFailed == 0, "expected=%d actual=%d", 0, (int)stats.submitFailed);
+    rc = IoTPDevice_destroy(device);
+    TEST_ASSERT("IoTPDevice_sendEventQueued: Destroy a valid device handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPDevice_sendEventQueued: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+int testDevice_sendEventTopicAlias(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPDevice *device = NULL;
+    IoTPStats stats;
+    int i;
+
+    rc = IoTPConfig_create(&config, "./wiotpdev.yaml");
+    TEST_ASSERT("IoTPDevice_sendEventTopicAlias: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    IoTPConfig_readEnvironment(config);
+    rc = IoTPConfig_setProperty(config, "options.mqtt.topicAliasMaximum", "10");
+    TEST_ASSERT("IoTPDevice_sendEventTopicAlias: Set topic alias maximum", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_create(&device, config);
+    TEST_ASSERT("IoTPDevice_sendEventTopicAlias: Create device with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_connect(device);
+    TEST_ASSERT("IoTPDevice_sendEventTopicAlias: Connect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    /* first event records the topic, second sets the alias, rest are sent without the topic */
+    for (i = 0; i < 10; i++) {
+        rc = IoTPDevice_sendEvent(device, "status", "{\"SensorID\": \"Test\", \"Reading\": 7 }", "json", QoS0, NULL);
+        TEST_ASSERT("IoTPDevice_sendEventTopicAlias: Send event", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    }
+
+    rc = IoTPDevice_getStats(device, &stats);
+    TEST_ASSERT("IoTPDevice_sendEventTopicAlias: Get stats", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    TEST_ASSERT("IoTPDevice_sendEventTopicAlias: Events sent with topic alias", stats.topicAliasPublishes > 0, "expected=>0 actual=%d", (int)stats.topicAliasPublishes);
+    TEST_ASSERT("IoTPDevice_sendEventTopicAlias: Topic bytes saved", stats.topicAliasBytesSaved == stats.topicAliasPublishes * (strlen("iot-2/evt/status/fmt/json") - 3),
+        "expected=%d actual=%d", (int)(stats.topicAliasPublishes * (strlen("iot-2/evt/status/fmt/json") - 3)), (int)stats.topicAliasBytesSaved);
+    rc = IoTPDevice_disconnect(device);
+    TEST_ASSERT("IoTPDevice_sendEventTopicAlias: Disconnect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_destroy(device);
+    TEST_ASSERT("IoTPDevice_sendEventTopicAlias: Destroy a valid device handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPDevice_sendEventTopicAlias: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+int testDevice_sendEventDelta(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPDevice *device = NULL;
+    IoTPStats stats;
+
+    rc = IoTPConfig_create(&config, "./wiotpdev.yaml");
+    TEST_ASSERT("IoTPDevice_sendEventDelta: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    IoTPConfig_readEnvironment(config);
+    rc = IoTPConfig_setProperty(config, "options.mqtt.deltaHeartbeat", "60");
+    TEST_ASSERT("IoTPDevice_sendEventDelta: Set heartbeat interval", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_setProperty(config, "options.mqtt.deltaDeadband", "0.5");
+    TEST_ASSERT("IoTPDevice_sendEventDelta: Set dead-band", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_create(&device, config);
+    TEST_ASSERT("IoTPDevice_sendEventDelta: Create device with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_connect(device);
+    TEST_ASSERT("IoTPDevice_sendEventDelta: Connect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    /* full state, change within dead-band, and change of a field */
+    rc = IoTPDevice_sendEvent(device, "status", "{\"SensorID\": \"Test\", \"Reading\": 7.0 }", "json", QoS0, NULL);
+    TEST_ASSERT("IoTPDevice_sendEventDelta: Send full state", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_sendEvent(device, "status", "{\"SensorID\": \"Test\", \"Reading\": 7.2 }", "json", QoS0, NULL);
+    TEST_ASSERT("IoTPDevice_sendEventDelta: Send unchanged state", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_sendEvent(device, "status", "{\"SensorID\": \"Test\", \"Reading\": 8.0 }", "json", QoS0, NULL);
+    TEST_ASSERT("IoTPDevice_sendEventDelta: Send changed state", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPDevice_getStats(device, &stats);
+    TEST_ASSERT("IoTPDevice_sendEventDelta: Get stats", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    TEST_ASSERT("IoTPDevice_sendEventDelta: Unchanged events", stats.deltaSkipped == 1, "expected=%d actual=%d", 1, (int)stats.deltaSkipped);
+    TEST_ASSERT("IoTPDevice_sendEventDelta: Changed events", stats.deltaPublishes == 1, "expected=%d actual=%d", 1, (int)stats.deltaPublishes);
+    TEST_ASSERT("IoTPDevice_sendEventDelta: Bytes saved", stats.deltaBytesSaved > 0, "expected=>0 actual=%d", (int)stats.deltaBytesSaved);
+
+    /* async publish is sent in full, so the next event is not compared with state before it */
+    char *asyncData = "{\"SensorID\": \"Test\", \"Reading\": 9.0 }";
+    rc = IoTPDevice_sendEventAsync(device, "status", asyncData, strlen(asyncData), "json", QoS0, NULL, NULL, NULL, NULL);
+    TEST_ASSERT("IoTPDevice_sendEventDelta: Send async state", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_sendEvent(device, "status", "{\"SensorID\": \"Test\", \"Reading\": 8.0 }", "json", QoS0, NULL);
+    TEST_ASSERT("IoTPDevice_sendEventDelta: Send state after async", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_getStats(device, &stats);
+    TEST_ASSERT("IoTPDevice_sendEventDelta: Get stats after async", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    TEST_ASSERT("IoTPDevice_sendEventDelta: State after async is not skipped", stats.deltaSkipped == 1 && stats.deltaPublishes == 1, "skipped=%d publishes=%d", (int)stats.deltaSkipped, (int)stats.deltaPublishes);
+    rc = IoTPDevice_disconnect(device);
+    TEST_ASSERT("IoTPDevice_sendEventDelta: Disconnect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_destroy(device);
+    TEST_ASSERT("IoTPDevice_sendEventDelta: Destroy a valid device handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPDevice_sendEventDelta: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+/* Connection state handler */
+int stateConnected = 0;
+int stateDisconnected = 0;
+
+void connectionStateHandler(char *id, IoTPConnectionState state, char *reason, void *context)
+{
+    if ( state == IoTPConnection_Connected ) {
+        stateConnected += 1;
+    } else if ( state == IoTPConnection_Disconnected ) {
+        stateDisconnected += 1;
+    }
+}
+
+int testDevice_setConnectionStateHandler(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPDevice *device = NULL;
+    char *data = "{\"d\" : {\"SensorID\": \"Test\", \"Reading\": 7 }}";
+
+    rc = IoTPDevice_setConnectionStateHandler(NULL, &connectionStateHandler, NULL);
+    TEST_ASSERT("IoTPDevice_setConnectionStateHandler: Invalid device object", rc == IOTPRC_INVALID_HANDLE, "rcE=%d rcA=%d", IOTPRC_INVALID_HANDLE, rc);
+
+    rc = IoTPConfig_create(&config, "./wiotpdev.yaml");
+    TEST_ASSERT("IoTPDevice_setConnectionStateHandler: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    IoTPConfig_readEnvironment(config);
+    rc = IoTPDevice_create(&device, config);
+    TEST_ASSERT("IoTPDevice_setConnectionStateHandler: Create device with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPDevice_setConnectionStateHandler(device, &connectionStateHandler, NULL);
+    TEST_ASSERT("IoTPDevice_setConnectionStateHandler: Set handler", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPDevice_connect(device);
+    TEST_ASSERT("IoTPDevice_setConnectionStateHandler: Connect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    TEST_ASSERT("IoTPDevice_setConnectionStateHandler: Connected state is reported", stateConnected == 1, "rcE=%d rcA=%d", 1, stateConnected);
+
+    rc = IoTPDevice_disconnect(device);
+    TEST_ASSERT("IoTPDevice_setConnectionStateHandler: Disconnect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    TEST_ASSERT("IoTPDevice_setConnectionStateHandler: Disconnected state is reported", stateDisconnected == 1, "rcE=%d rcA=%d", 1, stateDisconnected);
+    rc = IoTPDevice_sendEvent(device, "status", data, "json", QoS0, NULL);
+    TEST_ASSERT("IoTPDevice_setConnectionStateHandler: Send after disconnect", rc == IOTPRC_NOT_CONNECTED, "rcE=%d rcA=%d", IOTPRC_NOT_CONNECTED, rc);
+
+    rc = IoTPDevice_destroy(device);
+    TEST_ASSERT("IoTPDevice_setConnectionStateHandler: Destroy a valid device handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPDevice_setConnectionStateHandler: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
 int main(void)
 {
     int rc = 0;
-    int (*tests[])() = {testDevice_create, testDevice_setMQTTLogHandler, testDevice_sendEventVal, testDevice_connect, testDevice_sendEvent};
+    int (*tests[])() = {testDevice_create, testDevice_setMQTTLogHandler, testDevice_sendEventVal, testDevice_connect, testDevice_sendEvent, testDevice_sendEventBuffer, testDevice_prepareEventTopic, testDevice_sendEventWindow, testDevice_sendEventAsync, testDevice_setConnectionStateHandler, testDevice_persistence, testDevice_sendEventCompressed, testDevice_sendEventCoalesced, testDevice_sendEventQueued, testDevice_sendEventTopicAlias, testDevice_sendEventDelta};
     int i;
     int count = (int)TEST_COUNT(tests);
 
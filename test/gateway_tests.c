@@ -30,6 +30,9 @@
  * - IoTPGateway_connect
  * - IoTPGateway_disconnect
  * - IoTPGateway_sendEvent
+ * - IoTPGateway_sendEventBuffer
+ * - IoTPGateway_sendDeviceEventBuffer
+ * - IoTPGateway_sendDeviceEvents
  * - IoTPGateway_setCommandsHandler
  * - IoTPGateway_subscribeToCommands
  * - IoTPGateway_handleCommand
@@ -48,6 +51,21 @@ void logCallback (int level, char * message)
     logCallbackActive = 1;
 }
 
+int batchCompleted = 0;
+int batchSucceeded = 0;
+void batchCallback (int count, int succeeded, int failed, void *context)
+{
+    fprintf(stdout, "Batch completed: count=%d succeeded=%d failed=%d\n", count, succeeded, failed);
+    fflush(stdout);
+    batchSucceeded = succeeded;
+    batchCompleted += 1;
+}
+
+void commandMessageHandler (const IoTPMessage *message, void *context)
+{
+    fprintf(stdout, "Received command: %.*s\n", (int)message->commandLen, message->command);
+}
+
 void MQTTTraceCallback (int level, char * message)
 {
     fprintf(stdout, "level=%d: %s\n", level, message? message:"NULL");
@@ -216,10 +234,258 @@ int testGateway_sendEvent(void)
     return rc;
 }
 
+/* Tests: Send event using payload buffer - error cases */
+int testGateway_sendEventBufferVal(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPGateway *gateway = NULL;
+    unsigned char data[] = { 0x00, 0x01, 0x02, 0x00 };
+
+    rc = IoTPGateway_sendEventBuffer(gateway, "status", data, sizeof(data), "bin", QoS0, NULL, NULL, NULL);
+    TEST_ASSERT("IoTPGateway_sendEventBufferVal: Invalid gateway object", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    rc = IoTPConfig_create(&config, "./wiotpgw.yaml");
+    TEST_ASSERT("IoTPGateway_sendEventBufferVal: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPGateway_create(&gateway, config);
+    TEST_ASSERT("IoTPGateway_sendEventBufferVal: Create gateway with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPGateway_sendEventBuffer(gateway, "status", NULL, sizeof(data), "bin", QoS0, NULL, NULL, NULL);
+    TEST_ASSERT("IoTPGateway_sendEventBufferVal: NULL buffer with non-zero length", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    rc = IoTPGateway_sendEventBuffer(gateway, "status", data, sizeof(data), "bin", 3, NULL, NULL, NULL);
+    TEST_ASSERT("IoTPGateway_sendEventBufferVal: Invalid QoS=3", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+    rc = IoTPGateway_sendDeviceEventBuffer(gateway, "devType", NULL, "status", data, sizeof(data), "bin", QoS0, NULL, NULL, NULL);
+    TEST_ASSERT("IoTPGateway_sendEventBufferVal: Invalid device ID", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    rc = IoTPGateway_sendDeviceEventBuffer(gateway, "devType", "dev1", "status", data, sizeof(data), "bin", -1, NULL, NULL, NULL);
+    TEST_ASSERT("IoTPGateway_sendEventBufferVal: Invalid device event QoS=-1", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+    rc = IoTPGateway_sendDeviceEventBuffer(gateway, "devType", "dev1", "status", data, sizeof(data), "bin", QoS0, NULL, NULL, NULL);
+    TEST_ASSERT("IoTPGateway_sendEventBufferVal: Send device event when not connected", rc == IOTPRC_NOT_CONNECTED, "rcE=%d rcA=%d", IOTPRC_NOT_CONNECTED, rc);
+    rc = IoTPGateway_destroy(gateway);
+    TEST_ASSERT("IoTPGateway_sendEventBufferVal: Destroy a valid gateway handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPGateway_sendEventBufferVal: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+/* Tests: Send a batch of device events */
+int testGateway_sendDeviceEvents(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPGateway *gateway = NULL;
+    char *data = "{\"d\" : {\"SensorID\": \"Test\", \"Reading\": 7 }}";
+    IoTPEventRecord events[3] = {
+        { "devType", "dev1", "status", "json", data, strlen(data), 0 },
+        { "devType", "dev2", "status", "json", data, strlen(data), 0 },
+        { NULL, NULL, "status", "json", data, strlen(data), 0 }
+    };
+    IoTPEventBatch batch = { events, 3, QoS1, batchCallback, NULL };
+
+    rc = IoTPGateway_sendDeviceEvents(NULL, &batch);
+    TEST_ASSERT("IoTPGateway_sendDeviceEvents: Invalid gateway object", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+
+    rc = IoTPConfig_create(&config, "./wiotpgw.yaml");
+    TEST_ASSERT("IoTPGateway_sendDeviceEvents: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    IoTPConfig_readEnvironment(config);
+    rc = IoTPGateway_create(&gateway, config);
+    TEST_ASSERT("IoTPGateway_sendDeviceEvents: Create gateway with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPGateway_sendDeviceEvents(gateway, NULL);
+    TEST_ASSERT("IoTPGateway_sendDeviceEvents: NULL batch", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    events[1].eventId = NULL;
+    rc = IoTPGateway_sendDeviceEvents(gateway, &batch);
+    TEST_ASSERT("IoTPGateway_sendDeviceEvents: Invalid event ID", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    TEST_ASSERT("IoTPGateway_sendDeviceEvents: Invalid event is marked", events[1].rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, events[1].rc);
+    TEST_ASSERT("IoTPGateway_sendDeviceEvents: Valid event of rejected batch is marked", events[0].rc == IOTPRC_FAILURE, "rcE=%d rcA=%d", IOTPRC_FAILURE, events[0].rc);
+    events[0].eventId = NULL;
+    rc = IoTPGateway_sendDeviceEvents(gateway, &batch);
+    TEST_ASSERT("IoTPGateway_sendDeviceEvents: All invalid events are marked", events[0].rc == IOTPRC_ARGS_NULL_VALUE && events[1].rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d,%d", IOTPRC_ARGS_NULL_VALUE, events[0].rc, events[1].rc);
+    events[0].eventId = "status";
+    events[1].eventId = "status";
+    batch.qos = 3;
+    rc = IoTPGateway_sendDeviceEvents(gateway, &batch);
+    TEST_ASSERT("IoTPGateway_sendDeviceEvents: Invalid QoS=3", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+    batch.qos = QoS1;
+    rc = IoTPGateway_sendDeviceEvents(gateway, &batch);
+    TEST_ASSERT("IoTPGateway_sendDeviceEvents: Send when not connected", rc == IOTPRC_NOT_CONNECTED, "rcE=%d rcA=%d", IOTPRC_NOT_CONNECTED, rc);
+
+    rc = IoTPGateway_connect(gateway);
+    TEST_ASSERT("IoTPGateway_sendDeviceEvents: Connect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPGateway_sendDeviceEvents(gateway, &batch);
+    TEST_ASSERT("IoTPGateway_sendDeviceEvents: Send batch QoS1", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    sleep(2);
+    TEST_ASSERT("IoTPGateway_sendDeviceEvents: Batch callback is invoked once", batchCompleted == 1, "rcE=%d rcA=%d", 1, batchCompleted);
+    TEST_ASSERT("IoTPGateway_sendDeviceEvents: All events are delivered", batchSucceeded == 3, "rcE=%d rcA=%d", 3, batchSucceeded);
+
+    rc = IoTPGateway_disconnect(gateway);
+    TEST_ASSERT("IoTPGateway_sendDeviceEvents: Disconnect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPGateway_destroy(gateway);
+    TEST_ASSERT("IoTPGateway_sendDeviceEvents: Destroy a valid gateway handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPGateway_sendDeviceEvents: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+int testGateway_rateLimit(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPGateway *gateway = NULL;
+    IoTPStats stats;
+    char *data = "{\"d\" : {\"SensorID\": \"Test\", \"Reading\": 7 }}";
+    int i;
+
+    rc = IoTPConfig_create(&config, "./wiotpgw.yaml");
+    TEST_ASSERT("IoTPGateway_rateLimit: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    IoTPConfig_readEnvironment(config);
+    IoTPConfig_setProperty(config, "options.mqtt.rateLimit", "100");
+    IoTPConfig_setProperty(config, "options.mqtt.deviceRateLimit", "2");
+    rc = IoTPGateway_create(&gateway, config);
+    TEST_ASSERT("IoTPGateway_rateLimit: Create gateway with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPGateway_connect(gateway);
+    TEST_ASSERT("IoTPGateway_rateLimit: Connect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    /* Device limit allows a burst of 2 events per device */
+    for (i = 0; i < 2; i++) {
+        rc = IoTPGateway_sendDeviceEvent(gateway, "devType", "dev1", "status", data, "json", QoS0, NULL);
+        TEST_ASSERT("IoTPGateway_rateLimit: Send event within device limit", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    }
+    rc = IoTPGateway_sendDeviceEvent(gateway, "devType", "dev1", "status", data, "json", QoS0, NULL);
+    TEST_ASSERT("IoTPGateway_rateLimit: Send event over device limit", rc == IOTPRC_RATE_LIMITED, "rcE=%d rcA=%d", IOTPRC_RATE_LIMITED, rc);
+    rc = IoTPGateway_sendDeviceEvent(gateway, "devType", "dev2", "status", data, "json", QoS0, NULL);
+    TEST_ASSERT("IoTPGateway_rateLimit: Send event of other device", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    /* Device limit applies to each device of an event batch */
+    IoTPEventRecord events[3] = {
+        { "devType", "dev3", "status", "json", data, strlen(data), 0 },
+        { "devType", "dev4", "status", "json", data, strlen(data), 0 },
+        { "devType", "dev3", "status", "json", data, strlen(data), 0 }
+    };
+    IoTPEventBatch batch = { events, 3, QoS0, NULL, NULL };
+    rc = IoTPGateway_sendDeviceEvents(gateway, &batch);
+    TEST_ASSERT("IoTPGateway_rateLimit: Send batch within device limit", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPGateway_sendDeviceEvents(gateway, &batch);
+    TEST_ASSERT("IoTPGateway_rateLimit: Send batch over device limit", rc == IOTPRC_RATE_LIMITED, "rcE=%d rcA=%d", IOTPRC_RATE_LIMITED, rc);
+    TEST_ASSERT("IoTPGateway_rateLimit: Rate limited event is marked", events[0].rc == IOTPRC_RATE_LIMITED, "rcE=%d rcA=%d", IOTPRC_RATE_LIMITED, events[0].rc);
+    rc = IoTPGateway_sendDeviceEvent(gateway, "devType", "dev4", "status", data, "json", QoS0, NULL);
+    TEST_ASSERT("IoTPGateway_rateLimit: Rejected batch returns device tokens", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPGateway_getStats(gateway, &stats);
+    TEST_ASSERT("IoTPGateway_rateLimit: Get stats", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    TEST_ASSERT("IoTPGateway_rateLimit: Rejected publish is counted", stats.publishesRejected == 4, "expected=%d actual=%d", 4, (int)stats.publishesRejected);
+
+    rc = IoTPGateway_disconnect(gateway);
+    TEST_ASSERT("IoTPGateway_rateLimit: Disconnect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPGateway_destroy(gateway);
+    TEST_ASSERT("IoTPGateway_rateLimit: Destroy a valid gateway handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPGateway_rateLimit: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+int testGateway_dispatchWorkers(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPGateway *gateway = NULL;
+    IoTPStats stats;
+
+    rc = IoTPConfig_create(&config, "./wiotpgw.yaml");
+    TEST_ASSERT("IoTPGateway_dispatchWorkers: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    IoTPConfig_readEnvironment(config);
+    IoTPConfig_setProperty(config, "options.mqtt.dispatchWorkers", "4");
+    IoTPConfig_setProperty(config, "options.mqtt.inboundQueueSize", "100");
+    rc = IoTPGateway_create(&gateway, config);
+    TEST_ASSERT("IoTPGateway_dispatchWorkers: Create gateway with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPGateway_setMessageHandler(gateway, commandMessageHandler, NULL);
+    TEST_ASSERT("IoTPGateway_dispatchWorkers: Set message handler", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPGateway_connect(gateway);
+    TEST_ASSERT("IoTPGateway_dispatchWorkers: Connect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPGateway_getStats(gateway, &stats);
+    TEST_ASSERT("IoTPGateway_dispatchWorkers: Get stats", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    TEST_ASSERT("IoTPGateway_dispatchWorkers: Workers are started", stats.dispatchWorkers == 4, "expected=%d actual=%d", 4, stats.dispatchWorkers);
+    TEST_ASSERT("IoTPGateway_dispatchWorkers: Worker queue is empty", stats.workers[0].depth == 0, "expected=%d actual=%d", 0, (int)stats.workers[0].depth);
+    TEST_ASSERT("IoTPGateway_dispatchWorkers: No message is dropped", stats.inboundDroppedOldest == 0 && stats.inboundDroppedNewest == 0, "expected=%d actual=%d", 0, (int)(stats.inboundDroppedOldest + stats.inboundDroppedNewest));
+
+    rc = IoTPGateway_disconnect(gateway);
+    TEST_ASSERT("IoTPGateway_dispatchWorkers: Disconnect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPGateway_destroy(gateway);
+    TEST_ASSERT("IoTPGateway_dispatchWorkers: Destroy a valid gateway handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPGateway_dispatchWorkers: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+int testGateway_prepareDeviceEventTopic(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPGateway *gateway = NULL;
+    IoTPTopic *topic = NULL;
+
+    rc = IoTPGateway_prepareDeviceEventTopic(NULL, "devType", "devId", "status", "json", &topic);
+    TEST_ASSERT("IoTPGateway_prepareDeviceEventTopic: Invalid gateway object", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+
+    rc = IoTPConfig_create(&config, "./wiotpgw.yaml");
+    TEST_ASSERT("IoTPGateway_prepareDeviceEventTopic: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPGateway_create(&gateway, config);
+    TEST_ASSERT("IoTPGateway_prepareDeviceEventTopic: Create gateway with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPGateway_prepareDeviceEventTopic(gateway, "devType", "devId", "status", NULL, &topic);
+    TEST_ASSERT("IoTPGateway_prepareDeviceEventTopic: NULL format", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    rc = IoTPGateway_prepareDeviceEventTopic(gateway, "devType", "dev#", "status", "json", &topic);
+    TEST_ASSERT("IoTPGateway_prepareDeviceEventTopic: Invalid device id", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+    rc = IoTPGateway_prepareDeviceEventTopic(gateway, "devType", "devId", "status", "json", &topic);
+    TEST_ASSERT("IoTPGateway_prepareDeviceEventTopic: Prepare device event topic", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = strcmp(IoTPTopic_getString(topic), "iot-2/type/devType/id/devId/evt/status/fmt/json");
+    TEST_ASSERT("IoTPGateway_prepareDeviceEventTopic: Device event topic string", rc == 0, "rcE=%d rcA=%d", 0, rc);
+    rc = IoTPTopic_destroy(topic);
+    TEST_ASSERT("IoTPGateway_prepareDeviceEventTopic: Destroy device event topic", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPGateway_prepareDeviceEventTopic(gateway, NULL, NULL, "status", "json", &topic);
+    TEST_ASSERT("IoTPGateway_prepareDeviceEventTopic: Prepare gateway event topic", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPTopic_publish(topic, "{}", 2, QoS0, NULL);
+    TEST_ASSERT("IoTPGateway_prepareDeviceEventTopic: Publish when not connected", rc == IOTPRC_NOT_CONNECTED, "rcE=%d rcA=%d", IOTPRC_NOT_CONNECTED, rc);
+    rc = IoTPTopic_destroy(topic);
+    TEST_ASSERT("IoTPGateway_prepareDeviceEventTopic: Destroy gateway event topic", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPGateway_destroy(gateway);
+    TEST_ASSERT("IoTPGateway_prepareDeviceEventTopic: Destroy a valid gateway handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPGateway_prepareDeviceEventTopic: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+int testGateway_sendDeviceEventAsyncVal(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPGateway *gateway = NULL;
+    int token = 0;
+
+    rc = IoTPGateway_sendDeviceEventAsync(NULL, "devType", "devId", "status", "{}", 2, "json", QoS0, NULL, NULL, NULL, &token);
+    TEST_ASSERT("IoTPGateway_sendDeviceEventAsyncVal: Invalid gateway object", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+
+    rc = IoTPConfig_create(&config, "./wiotpgw.yaml");
+    TEST_ASSERT("IoTPGateway_sendDeviceEventAsyncVal: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPGateway_create(&gateway, config);
+    TEST_ASSERT("IoTPGateway_sendDeviceEventAsyncVal: Create gateway with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPGateway_sendDeviceEventAsync(gateway, "devType", "devId", NULL, "{}", 2, "json", QoS0, NULL, NULL, NULL, &token);
+    TEST_ASSERT("IoTPGateway_sendDeviceEventAsyncVal: NULL event id", rc == IOTPRC_ARGS_NULL_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_NULL_VALUE, rc);
+    rc = IoTPGateway_sendDeviceEventAsync(gateway, "devType", "devId", "status", "{}", 2, "json", 3, NULL, NULL, NULL, &token);
+    TEST_ASSERT("IoTPGateway_sendDeviceEventAsyncVal: Invalid QoS=3", rc == IOTPRC_ARGS_INVALID_VALUE, "rcE=%d rcA=%d", IOTPRC_ARGS_INVALID_VALUE, rc);
+    rc = IoTPGateway_sendDeviceEventAsync(gateway, NULL, NULL, "status", "{}", 2, "json", QoS0, NULL, NULL, NULL, &token);
+    TEST_ASSERT("IoTPGateway_sendDeviceEventAsyncVal: Send when not connected", rc == IOTPRC_NOT_CONNECTED, "rcE=%d rcA=%d", IOTPRC_NOT_CONNECTED, rc);
+    rc = IoTPGateway_destroy(gateway);
+    TEST_ASSERT("IoTPGateway_sendDeviceEventAsyncVal: Destroy a valid gateway handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("IoTPGateway_sendDeviceEventAsyncVal: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
 int main(void)
 {
     int rc = 0;
-    int (*tests[])() = {testGateway_create, testGateway_setMQTTLogHandler, testGateway_sendEventVal, testGateway_connect, testGateway_sendEvent};
+    int (*tests[])() = {testGateway_create, testGateway_setMQTTLogHandler, testGateway_sendEventVal, testGateway_sendEventBufferVal, testGateway_sendDeviceEventAsyncVal, testGateway_connect, testGateway_sendEvent, testGateway_sendDeviceEvents, testGateway_prepareDeviceEventTopic, testGateway_rateLimit, testGateway_dispatchWorkers};
     int i;
     int count = (int)TEST_COUNT(tests);
 
@@ -0,0 +1,159 @@
+/*******************************************************************************
+ * Copyright (c) 2019 IBM Corp.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *
+ * Contrinutors:
+ *    Ranjan Dasgupta         - Initial drop
+ *
+ *******************************************************************************/
+
+#include "iotp_application.h"
+#include "iotp_internal.h"
+
+/*
+ * handler_bench.c: IBM Watson IoT Platform C Client message handler benchmark
+ *
+ * Measures the cost of setting and looking up event handlers of an application,
+ * with a number of handlers (first argument, default 10000) and lookups (second
+ * argument, default 100000). Handler topic filters are indexed in a topic trie.
+ * The linear scan of filters with iotp_match_mqttTopic(), used before the trie,
+ * is measured for comparison. Does not connect to the server.
+ *
+ * Usage: handler_bench [handlers] [lookups]
+ */
+
+static double elapsed(uint64_t start)
+{
+    return (double)(iotp_utils_timeMicros() - start) / 1000000.0;
+}
+
+static void eventCallback(char* typeId, char* deviceId, char* eventId, char* format, void* payload, size_t payloadSize)
+{
+}
+
+/* Linear scan of filters - returns first matching filter + 1, or 0 */
+static int linearMatch(char **filters, int count, const char *topic)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if ( iotp_match_mqttTopic(topic, filters[i]) )
+            return i + 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int rc = IOTPRC_SUCCESS;
+    int handlers = argc > 1 ? atoi(argv[1]) : 10000;
+    int lookups = argc > 2 ? atoi(argv[2]) : 100000;
+    IoTPConfig *config = NULL;
+    IoTPApplication *application = NULL;
+    IoTPTopicTrie trie;
+    char **filters = NULL;
+    char **topics = NULL;
+    char typeId[32];
+    uint64_t start = 0;
+    double linearSet, trieSet, apiSet, linearLookup, trieLookup;
+    int matched = 0;
+    int i;
+
+    if ( handlers <= 0 || lookups <= 0 ) {
+        fprintf(stderr, "Usage: %s [handlers] [lookups]\n", argv[0]);
+        return 1;
+    }
+
+    /* filters of events of a device type, and topics of devices of the types */
+    filters = (char **)calloc((size_t)handlers, sizeof(char *));
+    topics = (char **)calloc((size_t)lookups, sizeof(char *));
+    for (i = 0; i < handlers; i++) {
+        filters[i] = (char *)malloc(64);
+        snprintf(filters[i], 64, "iot-2/type/type%d/id/+/evt/+/fmt/+", i);
+    }
+    for (i = 0; i < lookups; i++) {
+        topics[i] = (char *)malloc(64);
+        snprintf(topics[i], 64, "iot-2/type/type%d/id/dev%d/evt/status/fmt/json", (int)(((uint32_t)i * 2654435761u) % (uint32_t)handlers), i);
+    }
+
+    /* set handlers - each filter is checked against the filters already set */
+    start = iotp_utils_timeMicros();
+    for (i = 0; i < handlers; i++)
+        matched += linearMatch(filters, i, filters[i]);
+    linearSet = elapsed(start);
+
+    memset(&trie, 0, sizeof(trie));
+    start = iotp_utils_timeMicros();
+    for (i = 0; i < handlers; i++) {
+        if ( iotp_trie_match(&trie, filters[i], strlen(filters[i])) == 0 )
+            rc = iotp_trie_insert(&trie, filters[i], i + 1);
+        if ( rc != IOTPRC_SUCCESS )
+            break;
+    }
+    trieSet = elapsed(start);
+    if ( rc != IOTPRC_SUCCESS ) {
+        fprintf(stderr, "iotp_trie_insert failed. rc=%d\n", rc);
+        return 1;
+    }
+
+    /* look up handler of received messages */
+    start = iotp_utils_timeMicros();
+    for (i = 0; i < lookups; i++)
+        matched += linearMatch(filters, handlers, topics[i]);
+    linearLookup = elapsed(start);
+
+    start = iotp_utils_timeMicros();
+    for (i = 0; i < lookups; i++)
+        matched -= iotp_trie_match(&trie, topics[i], strlen(topics[i]));
+    trieLookup = elapsed(start);
+    iotp_trie_free(&trie);
+
+    if ( matched != 0 ) {
+        fprintf(stderr, "Linear scan and topic trie found different handlers\n");
+        return 1;
+    }
+
+    /* set handlers with the application API */
+    rc = IoTPConfig_create(&config, "./wiotpapp.yaml");
+    if ( rc == IOTPRC_SUCCESS )
+        rc = IoTPApplication_create(&application, config);
+    if ( rc != IOTPRC_SUCCESS ) {
+        fprintf(stderr, "Failed to create application. rc=%d\n", rc);
+        return 1;
+    }
+    start = iotp_utils_timeMicros();
+    for (i = 0; i < handlers && rc == IOTPRC_SUCCESS; i++) {
+        snprintf(typeId, sizeof(typeId), "type%d", i);
+        rc = IoTPApplication_setEventHandler(application, eventCallback, typeId, "+", "+", "+");
+    }
+    apiSet = elapsed(start);
+    IoTPApplication_destroy(application);
+    IoTPConfig_clear(config);
+    if ( rc != IOTPRC_SUCCESS ) {
+        fprintf(stderr, "IoTPApplication_setEventHandler failed. rc=%d\n", rc);
+        return 1;
+    }
+
+    printf("Handlers: %d  Lookups: %d\n", handlers, lookups);
+    printf("Set handlers:   linear %.3f s   trie %.3f s   IoTPApplication_setEventHandler %.3f s\n", linearSet, trieSet, apiSet);
+    printf("Lookup:         linear %.2f us  trie %.2f us  per message\n",
+        linearLookup * 1000000.0 / lookups, trieLookup * 1000000.0 / lookups);
+
+    for (i = 0; i < handlers; i++)
+        free(filters[i]);
+    for (i = 0; i < lookups; i++)
+        free(topics[i]);
+    free(filters);
+    free(topics);
+
+    return 0;
+}
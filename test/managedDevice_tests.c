@@ -19,6 +19,7 @@
 #include "test_utils.h"
 #include "iotp_config.h"
 #include "iotp_managedDevice.h"
+#include "iotp_internal.h"
 
 /*
  * validateManagedDevice_tests.c: IBM Watson IoT Platform C Client Managed Device API validation tests
@@ -34,6 +35,7 @@
  * - IoTPManagedDevice_subscribeToCommands
  * - IoTPManagedDevice_handleCommand
  * - IoTPManagedDevice_unsubscribeFromCommands
+ * - IoTPManagedDevice_setActionHandler
  */
 
 int logCallbackActive = 0;
@@ -210,11 +212,101 @@ int testManagedDevice_sendEvent(void)
     return rc;
 }
 
+int testManagedDevice_priorityLanes(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPManagedDevice *managedDevice = NULL;
+    char *data = "{\"d\" : {\"SensorID\": \"Test\", \"Reading\": 7 }}";
+    IoTPStats stats;
+
+    rc = IoTPConfig_create(&config, "./wiotpdev.yaml");
+    TEST_ASSERT("testManagedDevice_priorityLanes: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    IoTPConfig_readEnvironment(config);
+    rc = IoTPConfig_setProperty(config, "options.mqtt.controlMaxInflight", "10");
+    TEST_ASSERT("testManagedDevice_priorityLanes: Set control lane window", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPManagedDevice_create(&managedDevice, config);
+    TEST_ASSERT("testManagedDevice_priorityLanes: Create managedDevice with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPManagedDevice_connect(managedDevice);
+    TEST_ASSERT("testManagedDevice_priorityLanes: Connect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = IoTPManagedDevice_sendEvent(managedDevice, "status", data, "json", QoS1, NULL);
+    TEST_ASSERT("testManagedDevice_priorityLanes: Send event in bulk lane", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPManagedDevice_manage(managedDevice);
+    TEST_ASSERT("testManagedDevice_priorityLanes: Send manage request in control lane", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    sleep(2);
+
+    rc = IoTPManagedDevice_getStats(managedDevice, &stats);
+    TEST_ASSERT("testManagedDevice_priorityLanes: Get stats", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    TEST_ASSERT("testManagedDevice_priorityLanes: Event is published in bulk lane", stats.bulk.published == 1, "expected=%d actual=%d", 1, (int)stats.bulk.published);
+    TEST_ASSERT("testManagedDevice_priorityLanes: Manage request is published in control lane", stats.control.published == 1, "expected=%d actual=%d", 1, (int)stats.control.published);
+    TEST_ASSERT("testManagedDevice_priorityLanes: Control lane is empty", stats.control.depth == 0, "expected=%d actual=%d", 0, (int)stats.control.depth);
+
+    rc = IoTPManagedDevice_disconnect(managedDevice);
+    TEST_ASSERT("testManagedDevice_priorityLanes: Disconnect client", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPManagedDevice_destroy(managedDevice);
+    TEST_ASSERT("testManagedDevice_priorityLanes: Destroy a valid managedDevice handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("testManagedDevice_priorityLanes: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
+int dmResponseCount = 0;
+
+void dmResponseHandler(IoTP_DMAction_type_t type, char *reqId, void *payload, size_t payloadlen)
+{
+    fprintf(stdout, "Received DM response: type=%d reqId=%s\n", type, reqId ? reqId : "");
+    fflush(stdout);
+    if ( type == IoTP_DMResponse )
+        dmResponseCount += 1;
+}
+
+/* Feeds a DM response message to managed client */
+static int dmResponse(IoTPManagedDevice *managedDevice, char *payload)
+{
+    char topic[] = "iotdm-1/response";
+
+    return iotp_client_dmMessageArrived(managedDevice, topic, payload, strlen(payload));
+}
+
+/* Tests: Only response of the current request of managed device is delivered */
+int testManagedDevice_dmResponse(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config = NULL;
+    IoTPManagedDevice *managedDevice = NULL;
+
+    rc = IoTPConfig_create(&config, "./wiotpdev.yaml");
+    TEST_ASSERT("testManagedDevice_dmResponse: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPManagedDevice_create(&managedDevice, config);
+    TEST_ASSERT("testManagedDevice_dmResponse: Create managedDevice with valid config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPManagedDevice_setActionHandler(managedDevice, IoTP_DMResponse, dmResponseHandler);
+    TEST_ASSERT("testManagedDevice_dmResponse: Set response handler", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+
+    rc = dmResponse(managedDevice, "{\"rc\":200,\"reqId\":\"req-1\"}");
+    TEST_ASSERT("testManagedDevice_dmResponse: Response of current request", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    TEST_ASSERT("testManagedDevice_dmResponse: Response is delivered", dmResponseCount == 1, "expected=%d actual=%d", 1, dmResponseCount);
+    rc = dmResponse(managedDevice, "{\"rc\":200,\"reqId\":\"req-2\"}");
+    TEST_ASSERT("testManagedDevice_dmResponse: Response of another request", rc == IOTPRC_DM_RESPONSE_INVALID_REQID, "rcE=%d rcA=%d", IOTPRC_DM_RESPONSE_INVALID_REQID, rc);
+    TEST_ASSERT("testManagedDevice_dmResponse: Response is not delivered", dmResponseCount == 1, "expected=%d actual=%d", 1, dmResponseCount);
+    rc = dmResponse(managedDevice, "{\"rc\":200,\"reqId\":\"req-1\"}");
+    TEST_ASSERT("testManagedDevice_dmResponse: Response of current request again", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    TEST_ASSERT("testManagedDevice_dmResponse: Response is delivered again", dmResponseCount == 2, "expected=%d actual=%d", 2, dmResponseCount);
+    rc = dmResponse(managedDevice, "{\"rc\":200}");
+    TEST_ASSERT("testManagedDevice_dmResponse: Response without request ID", rc == IOTPRC_DM_RESPONSE_NULL_REQID, "rcE=%d rcA=%d", IOTPRC_DM_RESPONSE_NULL_REQID, rc);
+
+    rc = IoTPManagedDevice_destroy(managedDevice);
+    TEST_ASSERT("testManagedDevice_dmResponse: Destroy a valid managedDevice handle", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_clear(config);
+    TEST_ASSERT("testManagedDevice_dmResponse: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
 
 int main(void)
 {
     int rc = 0;
-    int (*tests[])() = {testManagedDevice_create, testManagedDevice_setMQTTLogHandler, testManagedDevice_sendEventVal, testManagedDevice_connect, testManagedDevice_sendEvent};
+    int (*tests[])() = {testManagedDevice_create, testManagedDevice_setMQTTLogHandler, testManagedDevice_sendEventVal, testManagedDevice_connect, testManagedDevice_sendEvent, testManagedDevice_priorityLanes, testManagedDevice_dmResponse};
     int i;
     int count = (int)TEST_COUNT(tests);
 
@@ -30,6 +30,7 @@
  * - IoTPManagedGateway_connect
  * - IoTPManagedGateway_disconnect
  * - IoTPManagedGateway_sendEvent
+ * - IoTPManagedGateway_setActionHandler
  * - IoTPManagedGateway_setCommandsHandler
  * - IoTPManagedGateway_subscribeToCommands
  * - IoTPManagedGateway_handleCommand
@@ -83,6 +84,48 @@ int testManagedGateway_create(void)
     return rc;
 }
 
+void dmActionHandler(IoTP_DMAction_type_t type, char *reqId, void *payload, size_t payloadlen)
+{
+    fprintf(stdout, "Received DM action: type=%d reqId=%s\n", type, reqId ? reqId : "");
+}
+
+/* Tests: DM action handlers of gateways in one process */
+int testManagedGateway_setActionHandler(void)
+{
+    int rc = IOTPRC_SUCCESS;
+    IoTPConfig *config1 = NULL;
+    IoTPConfig *config2 = NULL;
+    IoTPManagedGateway *managedGateway1 = NULL;
+    IoTPManagedGateway *managedGateway2 = NULL;
+
+    rc = IoTPConfig_create(&config1, "./wiotpgw.yaml");
+    TEST_ASSERT("IoTPManagedGateway_setActionHandler: Create config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_create(&config2, "./wiotpgw.yaml");
+    TEST_ASSERT("IoTPManagedGateway_setActionHandler: Create second config object", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPConfig_setProperty(config2, "identity.deviceId", "iotc_test_gw2");
+    TEST_ASSERT("IoTPManagedGateway_setActionHandler: Set device ID of second gateway", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPManagedGateway_create(&managedGateway1, config1);
+    TEST_ASSERT("IoTPManagedGateway_setActionHandler: Create managedGateway", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPManagedGateway_create(&managedGateway2, config2);
+    TEST_ASSERT("IoTPManagedGateway_setActionHandler: Create second managedGateway", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPManagedGateway_setActionHandler(managedGateway1, IoTP_DMReboot, dmActionHandler);
+    TEST_ASSERT("IoTPManagedGateway_setActionHandler: Set reboot handler before connect", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPManagedGateway_setActionHandler(managedGateway2, IoTP_DMReboot, dmActionHandler);
+    TEST_ASSERT("IoTPManagedGateway_setActionHandler: Set reboot handler of second gateway", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPManagedGateway_setActionHandler(managedGateway2, (IoTP_DMAction_type_t)(IoTP_DMActions + 1), dmActionHandler);
+    TEST_ASSERT("IoTPManagedGateway_setActionHandler: Set handler of invalid type", rc == IOTPRC_HANDLER_INVALID, "rcE=%d rcA=%d", IOTPRC_HANDLER_INVALID, rc);
+    rc = IoTPManagedGateway_destroy(managedGateway1);
+    TEST_ASSERT("IoTPManagedGateway_setActionHandler: Destroy managedGateway", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPManagedGateway_setActionHandler(managedGateway2, IoTP_DMFactoryReset, dmActionHandler);
+    TEST_ASSERT("IoTPManagedGateway_setActionHandler: Set handler after other gateway is destroyed", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    rc = IoTPManagedGateway_destroy(managedGateway2);
+    TEST_ASSERT("IoTPManagedGateway_setActionHandler: Destroy second managedGateway", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    IoTPConfig_clear(config1);
+    rc = IoTPConfig_clear(config2);
+    TEST_ASSERT("IoTPManagedGateway_setActionHandler: Clear Config", rc == IOTPRC_SUCCESS, "rcE=%d rcA=%d", IOTPRC_SUCCESS, rc);
+    return rc;
+}
+
 /* Tests: MQTT Log handler setup */
 int testManagedGateway_setMQTTLogHandler(void)
 {
@@ -220,7 +263,7 @@ int testManagedGateway_sendEvent(void)
 int main(void)
 {
     int rc = 0;
-    int (*tests[])() = {testManagedGateway_create, testManagedGateway_setMQTTLogHandler, testManagedGateway_sendEventVal, testManagedGateway_connect, testManagedGateway_sendEvent};
+    int (*tests[])() = {testManagedGateway_create, testManagedGateway_setMQTTLogHandler, testManagedGateway_sendEventVal, testManagedGateway_setActionHandler, testManagedGateway_connect, testManagedGateway_sendEvent};
     int i;
     int count = (int)TEST_COUNT(tests);
 